@@ -0,0 +1,447 @@
+#include "AffineKernel.h"
+
+#include <cstdint>
+#include <cstring>
+
+#if defined(_M_X64) || defined(__x86_64__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#    define AFFINE_KERNEL_X86 1
+#    include <immintrin.h>
+#    if defined(_MSC_VER)
+#        include <intrin.h>
+#        define AFFINE_TARGET_AVX2
+#    else
+#        define AFFINE_TARGET_AVX2 __attribute__((target("avx2")))
+#    endif
+#else
+#    define AFFINE_KERNEL_X86 0
+#endif
+
+namespace
+{
+    // Cephes sinf/cosf constants
+    constexpr float kFourOverPi = 1.27323954473516f;
+    constexpr float kDP1        = 0.78515625f;
+    constexpr float kDP2        = 2.4187564849853515625e-4f;
+    constexpr float kDP3        = 3.77489497744594108e-8f;
+    constexpr float kSin0       = -1.9515295891e-4f;
+    constexpr float kSin1       = 8.3321608736e-3f;
+    constexpr float kSin2       = -1.6666654611e-1f;
+    constexpr float kCos0       = 2.443315711809948e-5f;
+    constexpr float kCos1       = -1.388731625493765e-3f;
+    constexpr float kCos2       = 4.166664568298827e-2f;
+
+    constexpr uint32_t kSignBit = 0x80000000u;
+
+    uint32_t AsBits(float f)
+    {
+        uint32_t u;
+        std::memcpy(&u, &f, sizeof(u));
+        return u;
+    }
+
+    float AsFloat(uint32_t u)
+    {
+        float f;
+        std::memcpy(&f, &u, sizeof(f));
+        return f;
+    }
+
+    void WriteMatrix(float* m, float m00, float m01, float m10, float m11, float tx, float ty)
+    {
+        m[0]  = m00;
+        m[1]  = m01;
+        m[2]  = 0.f;
+        m[3]  = 0.f;
+        m[4]  = m10;
+        m[5]  = m11;
+        m[6]  = 0.f;
+        m[7]  = 0.f;
+        m[8]  = 0.f;
+        m[9]  = 0.f;
+        m[10] = 1.f;
+        m[11] = 0.f;
+        m[12] = tx;
+        m[13] = ty;
+        m[14] = 0.f;
+        m[15] = 1.f;
+    }
+
+    void BuildScalar(const float* px, const float* py, const float* sx, const float* sy, const float* rot, size_t count, float* out)
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            float s, c;
+            SinCos(rot[i], &s, &c);
+
+            float m00 = sx[i] * c;
+            float m01 = sx[i] * s;
+            float m10 = AsFloat(AsBits(sy[i] * s) ^ kSignBit);
+            float m11 = sy[i] * c;
+            WriteMatrix(out + 16 * i, m00, m01, m10, m11, px[i], py[i]);
+        }
+    }
+
+#if AFFINE_KERNEL_X86
+    void SinCos4(__m128 x, __m128* outSin, __m128* outCos)
+    {
+        const __m128  signMask = _mm_castsi128_ps(_mm_set1_epi32(static_cast<int>(kSignBit)));
+        const __m128i two      = _mm_set1_epi32(2);
+        const __m128i four     = _mm_set1_epi32(4);
+
+        __m128 signSin = _mm_and_ps(x, signMask);
+        x              = _mm_andnot_ps(signMask, x);
+
+        __m128i j = _mm_cvttps_epi32(_mm_mul_ps(x, _mm_set1_ps(kFourOverPi)));
+        j         = _mm_and_si128(_mm_add_epi32(j, _mm_set1_epi32(1)), _mm_set1_epi32(~1));
+        __m128 y  = _mm_cvtepi32_ps(j);
+
+        __m128 swapSin  = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(j, four), 29));
+        __m128 polyMask = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(j, two), _mm_setzero_si128()));
+        __m128 signCos  = _mm_castsi128_ps(_mm_slli_epi32(_mm_andnot_si128(_mm_sub_epi32(j, two), four), 29));
+
+        x = _mm_sub_ps(x, _mm_mul_ps(y, _mm_set1_ps(kDP1)));
+        x = _mm_sub_ps(x, _mm_mul_ps(y, _mm_set1_ps(kDP2)));
+        x = _mm_sub_ps(x, _mm_mul_ps(y, _mm_set1_ps(kDP3)));
+
+        __m128 z = _mm_mul_ps(x, x);
+
+        __m128 yc = _mm_mul_ps(_mm_set1_ps(kCos0), z);
+        yc        = _mm_add_ps(yc, _mm_set1_ps(kCos1));
+        yc        = _mm_mul_ps(yc, z);
+        yc        = _mm_add_ps(yc, _mm_set1_ps(kCos2));
+        yc        = _mm_mul_ps(yc, z);
+        yc        = _mm_mul_ps(yc, z);
+        yc        = _mm_sub_ps(yc, _mm_mul_ps(z, _mm_set1_ps(0.5f)));
+        yc        = _mm_add_ps(yc, _mm_set1_ps(1.f));
+
+        __m128 ys = _mm_mul_ps(_mm_set1_ps(kSin0), z);
+        ys        = _mm_add_ps(ys, _mm_set1_ps(kSin1));
+        ys        = _mm_mul_ps(ys, z);
+        ys        = _mm_add_ps(ys, _mm_set1_ps(kSin2));
+        ys        = _mm_mul_ps(ys, z);
+        ys        = _mm_mul_ps(ys, x);
+        ys        = _mm_add_ps(ys, x);
+
+        __m128 s = _mm_or_ps(_mm_and_ps(polyMask, ys), _mm_andnot_ps(polyMask, yc));
+        __m128 c = _mm_or_ps(_mm_and_ps(polyMask, yc), _mm_andnot_ps(polyMask, ys));
+
+        *outSin = _mm_xor_ps(s, _mm_xor_ps(signSin, swapSin));
+        *outCos = _mm_xor_ps(c, signCos);
+    }
+
+    // Transposes four instances' coefficients into four 64-byte matrices.
+    void StoreMatrices4(float* out, __m128 m00, __m128 m01, __m128 m10, __m128 m11, __m128 tx, __m128 ty)
+    {
+        const __m128 zero     = _mm_setzero_ps();
+        const __m128 row2     = _mm_setr_ps(0.f, 0.f, 1.f, 0.f);
+        const __m128 zeroOne  = _mm_setr_ps(0.f, 1.f, 0.f, 1.f);
+        __m128       r0Lo     = _mm_unpacklo_ps(m00, m01);
+        __m128       r0Hi     = _mm_unpackhi_ps(m00, m01);
+        __m128       r1Lo     = _mm_unpacklo_ps(m10, m11);
+        __m128       r1Hi     = _mm_unpackhi_ps(m10, m11);
+        __m128       r3Lo     = _mm_unpacklo_ps(tx, ty);
+        __m128       r3Hi     = _mm_unpackhi_ps(tx, ty);
+        __m128       rows0[4] = { _mm_movelh_ps(r0Lo, zero), _mm_movehl_ps(zero, r0Lo), _mm_movelh_ps(r0Hi, zero), _mm_movehl_ps(zero, r0Hi) };
+        __m128       rows1[4] = { _mm_movelh_ps(r1Lo, zero), _mm_movehl_ps(zero, r1Lo), _mm_movelh_ps(r1Hi, zero), _mm_movehl_ps(zero, r1Hi) };
+        __m128       rows3[4] = { _mm_movelh_ps(r3Lo, zeroOne), _mm_movehl_ps(zeroOne, r3Lo), _mm_movelh_ps(r3Hi, zeroOne), _mm_movehl_ps(zeroOne, r3Hi) };
+
+        for (int k = 0; k < 4; ++k)
+        {
+            float* m = out + 16 * k;
+            _mm_storeu_ps(m + 0, rows0[k]);
+            _mm_storeu_ps(m + 4, rows1[k]);
+            _mm_storeu_ps(m + 8, row2);
+            _mm_storeu_ps(m + 12, rows3[k]);
+        }
+    }
+
+    void BuildSSE(const float* px, const float* py, const float* sx, const float* sy, const float* rot, size_t count, float* out)
+    {
+        const __m128 signMask = _mm_castsi128_ps(_mm_set1_epi32(static_cast<int>(kSignBit)));
+
+        size_t i = 0;
+        for (; i + 4 <= count; i += 4)
+        {
+            __m128 s, c;
+            SinCos4(_mm_loadu_ps(rot + i), &s, &c);
+
+            __m128 vsx = _mm_loadu_ps(sx + i);
+            __m128 vsy = _mm_loadu_ps(sy + i);
+
+            StoreMatrices4(out + 16 * i,
+                           _mm_mul_ps(vsx, c),
+                           _mm_mul_ps(vsx, s),
+                           _mm_xor_ps(_mm_mul_ps(vsy, s), signMask),
+                           _mm_mul_ps(vsy, c),
+                           _mm_loadu_ps(px + i),
+                           _mm_loadu_ps(py + i));
+        }
+
+        BuildScalar(px + i, py + i, sx + i, sy + i, rot + i, count - i, out + 16 * i);
+    }
+
+    AFFINE_TARGET_AVX2 void SinCos8(__m256 x, __m256* outSin, __m256* outCos)
+    {
+        const __m256  signMask = _mm256_castsi256_ps(_mm256_set1_epi32(static_cast<int>(kSignBit)));
+        const __m256i two      = _mm256_set1_epi32(2);
+        const __m256i four     = _mm256_set1_epi32(4);
+
+        __m256 signSin = _mm256_and_ps(x, signMask);
+        x              = _mm256_andnot_ps(signMask, x);
+
+        __m256i j = _mm256_cvttps_epi32(_mm256_mul_ps(x, _mm256_set1_ps(kFourOverPi)));
+        j         = _mm256_and_si256(_mm256_add_epi32(j, _mm256_set1_epi32(1)), _mm256_set1_epi32(~1));
+        __m256 y  = _mm256_cvtepi32_ps(j);
+
+        __m256 swapSin  = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_and_si256(j, four), 29));
+        __m256 polyMask = _mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_and_si256(j, two), _mm256_setzero_si256()));
+        __m256 signCos  = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_andnot_si256(_mm256_sub_epi32(j, two), four), 29));
+
+        x = _mm256_sub_ps(x, _mm256_mul_ps(y, _mm256_set1_ps(kDP1)));
+        x = _mm256_sub_ps(x, _mm256_mul_ps(y, _mm256_set1_ps(kDP2)));
+        x = _mm256_sub_ps(x, _mm256_mul_ps(y, _mm256_set1_ps(kDP3)));
+
+        __m256 z = _mm256_mul_ps(x, x);
+
+        __m256 yc = _mm256_mul_ps(_mm256_set1_ps(kCos0), z);
+        yc        = _mm256_add_ps(yc, _mm256_set1_ps(kCos1));
+        yc        = _mm256_mul_ps(yc, z);
+        yc        = _mm256_add_ps(yc, _mm256_set1_ps(kCos2));
+        yc        = _mm256_mul_ps(yc, z);
+        yc        = _mm256_mul_ps(yc, z);
+        yc        = _mm256_sub_ps(yc, _mm256_mul_ps(z, _mm256_set1_ps(0.5f)));
+        yc        = _mm256_add_ps(yc, _mm256_set1_ps(1.f));
+
+        __m256 ys = _mm256_mul_ps(_mm256_set1_ps(kSin0), z);
+        ys        = _mm256_add_ps(ys, _mm256_set1_ps(kSin1));
+        ys        = _mm256_mul_ps(ys, z);
+        ys        = _mm256_add_ps(ys, _mm256_set1_ps(kSin2));
+        ys        = _mm256_mul_ps(ys, z);
+        ys        = _mm256_mul_ps(ys, x);
+        ys        = _mm256_add_ps(ys, x);
+
+        __m256 s = _mm256_blendv_ps(yc, ys, polyMask);
+        __m256 c = _mm256_blendv_ps(ys, yc, polyMask);
+
+        *outSin = _mm256_xor_ps(s, _mm256_xor_ps(signSin, swapSin));
+        *outCos = _mm256_xor_ps(c, signCos);
+    }
+
+    // 256-bit twin of StoreMatrices4; mixing in legacy SSE stores here costs
+    // an AVX/SSE transition per call.
+    AFFINE_TARGET_AVX2 void StoreMatrices8(float* out, __m256 m00, __m256 m01, __m256 m10, __m256 m11, __m256 tx, __m256 ty)
+    {
+        const __m256 zero    = _mm256_setzero_ps();
+        const __m256 zeroOne = _mm256_setr_ps(0.f, 1.f, 0.f, 1.f, 0.f, 1.f, 0.f, 1.f);
+        const __m256 row2    = _mm256_setr_ps(0.f, 0.f, 1.f, 0.f, 0.f, 0.f, 1.f, 0.f);
+
+        // lanes hold instances (k, k + 4)
+        __m256 r0Lo = _mm256_unpacklo_ps(m00, m01);
+        __m256 r0Hi = _mm256_unpackhi_ps(m00, m01);
+        __m256 r1Lo = _mm256_unpacklo_ps(m10, m11);
+        __m256 r1Hi = _mm256_unpackhi_ps(m10, m11);
+        __m256 r3Lo = _mm256_unpacklo_ps(tx, ty);
+        __m256 r3Hi = _mm256_unpackhi_ps(tx, ty);
+
+        __m256 rows0[4] = {
+            _mm256_shuffle_ps(r0Lo, zero, _MM_SHUFFLE(1, 0, 1, 0)),
+            _mm256_shuffle_ps(r0Lo, zero, _MM_SHUFFLE(3, 2, 3, 2)),
+            _mm256_shuffle_ps(r0Hi, zero, _MM_SHUFFLE(1, 0, 1, 0)),
+            _mm256_shuffle_ps(r0Hi, zero, _MM_SHUFFLE(3, 2, 3, 2))
+        };
+        __m256 rows1[4] = {
+            _mm256_shuffle_ps(r1Lo, zero, _MM_SHUFFLE(1, 0, 1, 0)),
+            _mm256_shuffle_ps(r1Lo, zero, _MM_SHUFFLE(3, 2, 3, 2)),
+            _mm256_shuffle_ps(r1Hi, zero, _MM_SHUFFLE(1, 0, 1, 0)),
+            _mm256_shuffle_ps(r1Hi, zero, _MM_SHUFFLE(3, 2, 3, 2))
+        };
+        __m256 rows3[4] = {
+            _mm256_shuffle_ps(r3Lo, zeroOne, _MM_SHUFFLE(1, 0, 1, 0)),
+            _mm256_shuffle_ps(r3Lo, zeroOne, _MM_SHUFFLE(3, 2, 3, 2)),
+            _mm256_shuffle_ps(r3Hi, zeroOne, _MM_SHUFFLE(1, 0, 1, 0)),
+            _mm256_shuffle_ps(r3Hi, zeroOne, _MM_SHUFFLE(3, 2, 3, 2))
+        };
+
+        for (int k = 0; k < 4; ++k)
+        {
+            float* lo = out + 16 * k;
+            float* hi = out + 16 * (k + 4);
+            _mm256_storeu_ps(lo + 0, _mm256_permute2f128_ps(rows0[k], rows1[k], 0x20));
+            _mm256_storeu_ps(lo + 8, _mm256_permute2f128_ps(row2, rows3[k], 0x20));
+            _mm256_storeu_ps(hi + 0, _mm256_permute2f128_ps(rows0[k], rows1[k], 0x31));
+            _mm256_storeu_ps(hi + 8, _mm256_permute2f128_ps(row2, rows3[k], 0x31));
+        }
+    }
+
+    AFFINE_TARGET_AVX2 void BuildAVX2(const float* px, const float* py, const float* sx, const float* sy, const float* rot, size_t count, float* out)
+    {
+        const __m256 signMask = _mm256_castsi256_ps(_mm256_set1_epi32(static_cast<int>(kSignBit)));
+
+        size_t i = 0;
+        for (; i + 8 <= count; i += 8)
+        {
+            __m256 s, c;
+            SinCos8(_mm256_loadu_ps(rot + i), &s, &c);
+
+            __m256 vsx = _mm256_loadu_ps(sx + i);
+            __m256 vsy = _mm256_loadu_ps(sy + i);
+            __m256 m00 = _mm256_mul_ps(vsx, c);
+            __m256 m01 = _mm256_mul_ps(vsx, s);
+            __m256 m10 = _mm256_xor_ps(_mm256_mul_ps(vsy, s), signMask);
+            __m256 m11 = _mm256_mul_ps(vsy, c);
+            __m256 tx  = _mm256_loadu_ps(px + i);
+            __m256 ty  = _mm256_loadu_ps(py + i);
+
+            StoreMatrices8(out + 16 * i, m00, m01, m10, m11, tx, ty);
+        }
+
+        BuildSSE(px + i, py + i, sx + i, sy + i, rot + i, count - i, out + 16 * i);
+    }
+
+    bool CpuHasAVX2()
+    {
+#    if defined(_MSC_VER)
+        int info[4] = {};
+        __cpuid(info, 0);
+        if (info[0] < 7)
+            return false;
+
+        __cpuid(info, 1);
+        bool osxsave = (info[2] & (1 << 27)) != 0;
+        bool avx     = (info[2] & (1 << 28)) != 0;
+        if (!osxsave || !avx || (_xgetbv(0) & 0x6) != 0x6)
+            return false;
+
+        __cpuidex(info, 7, 0);
+        return (info[1] & (1 << 5)) != 0;
+#    else
+        return __builtin_cpu_supports("avx2");
+#    endif
+    }
+#endif
+}   // namespace
+
+void SinCos(float x, float* outSin, float* outCos)
+{
+    uint32_t signSin = AsBits(x) & kSignBit;
+    x                = AsFloat(AsBits(x) & ~kSignBit);
+
+    int32_t j = static_cast<int32_t>(x * kFourOverPi);
+    j         = (j + 1) & ~1;
+    float y   = static_cast<float>(j);
+
+    uint32_t swapSin  = static_cast<uint32_t>(j & 4) << 29;
+    bool     polyMask = (j & 2) == 0;
+    uint32_t signCos  = static_cast<uint32_t>(~(j - 2) & 4) << 29;
+
+    x = x - y * kDP1;
+    x = x - y * kDP2;
+    x = x - y * kDP3;
+
+    float z = x * x;
+
+    float yc = kCos0 * z;
+    yc       = yc + kCos1;
+    yc       = yc * z;
+    yc       = yc + kCos2;
+    yc       = yc * z;
+    yc       = yc * z;
+    yc       = yc - z * 0.5f;
+    yc       = yc + 1.f;
+
+    float ys = kSin0 * z;
+    ys       = ys + kSin1;
+    ys       = ys * z;
+    ys       = ys + kSin2;
+    ys       = ys * z;
+    ys       = ys * x;
+    ys       = ys + x;
+
+    float s = polyMask ? ys : yc;
+    float c = polyMask ? yc : ys;
+
+    *outSin = AsFloat(AsBits(s) ^ signSin ^ swapSin);
+    *outCos = AsFloat(AsBits(c) ^ signCos);
+}
+
+bool IsAffineKernelPathSupported(AffineKernelPath path)
+{
+    switch (path)
+    {
+        case AffineKernelPath::Scalar:
+            return true;
+#if AFFINE_KERNEL_X86
+        case AffineKernelPath::SSE:
+            return true;
+        case AffineKernelPath::AVX2:
+        {
+            static const bool hasAVX2 = CpuHasAVX2();
+            return hasAVX2;
+        }
+#endif
+        default:
+            return false;
+    }
+}
+
+AffineKernelPath SelectedAffineKernelPath()
+{
+    static const AffineKernelPath path =
+        IsAffineKernelPathSupported(AffineKernelPath::AVX2) ? AffineKernelPath::AVX2 :
+        IsAffineKernelPathSupported(AffineKernelPath::SSE)  ? AffineKernelPath::SSE :
+                                                              AffineKernelPath::Scalar;
+    return path;
+}
+
+const char* AffineKernelPathName(AffineKernelPath path)
+{
+    switch (path)
+    {
+        case AffineKernelPath::Scalar:
+            return "scalar";
+        case AffineKernelPath::SSE:
+            return "sse";
+        case AffineKernelPath::AVX2:
+            return "avx2";
+    }
+    return "unknown";
+}
+
+void BuildAffineMatrices(const float* posX,
+                         const float* posY,
+                         const float* scaleX,
+                         const float* scaleY,
+                         const float* rotation,
+                         size_t       count,
+                         float*       out)
+{
+    BuildAffineMatrices(SelectedAffineKernelPath(), posX, posY, scaleX, scaleY, rotation, count, out);
+}
+
+void BuildAffineMatrices(AffineKernelPath path,
+                         const float*     posX,
+                         const float*     posY,
+                         const float*     scaleX,
+                         const float*     scaleY,
+                         const float*     rotation,
+                         size_t           count,
+                         float*           out)
+{
+    if (!IsAffineKernelPathSupported(path))
+        path = AffineKernelPath::Scalar;
+
+    switch (path)
+    {
+#if AFFINE_KERNEL_X86
+        case AffineKernelPath::AVX2:
+            BuildAVX2(posX, posY, scaleX, scaleY, rotation, count, out);
+            break;
+        case AffineKernelPath::SSE:
+            BuildSSE(posX, posY, scaleX, scaleY, rotation, count, out);
+            break;
+#endif
+        default:
+            BuildScalar(posX, posY, scaleX, scaleY, rotation, count, out);
+            break;
+    }
+}
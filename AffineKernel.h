@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+
+// Batched 2D world-matrix construction.
+//
+// For every i writes the 16-float row-major matrix
+//     CreateScale(sx, sy, 1) * CreateRotationZ(r) * CreateTranslation(px, py, 0)
+// to out + 16 * i, which is the layout `row_major matrix world` expects.
+// sin/cos use a Cephes-style polynomial accurate to ~1e-7 for |r| < 8192.
+// All paths evaluate the same operations in the same order, so their results
+// are bit-identical to each other.
+
+enum class AffineKernelPath
+{
+    Scalar,
+    SSE,
+    AVX2,
+};
+
+AffineKernelPath SelectedAffineKernelPath();
+const char*      AffineKernelPathName(AffineKernelPath path);
+bool             IsAffineKernelPathSupported(AffineKernelPath path);
+
+void BuildAffineMatrices(const float* posX,
+                         const float* posY,
+                         const float* scaleX,
+                         const float* scaleY,
+                         const float* rotation,
+                         size_t       count,
+                         float*       out);
+
+// Forces a specific path; used for validation and benchmarks.
+void BuildAffineMatrices(AffineKernelPath path,
+                         const float*     posX,
+                         const float*     posY,
+                         const float*     scaleX,
+                         const float*     scaleY,
+                         const float*     rotation,
+                         size_t           count,
+                         float*           out);
+
+void SinCos(float x, float* outSin, float* outCos);
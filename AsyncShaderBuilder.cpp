@@ -0,0 +1,172 @@
+#include "AsyncShaderBuilder.h"
+#include "FrameTimer.h"
+#include "Profiler.h"
+
+#include <algorithm>
+
+namespace
+{
+    void RunShaderBuild(AsyncShaderBuilder& builder, ShaderBuild& build)
+    {
+        PROFILE_SCOPE("ShaderBuild");
+
+        build.startNs = NowNanoseconds();
+        build.state.store(ShaderBuildState::Building, std::memory_order_relaxed);
+
+        bool ok = true;
+        if (!build.cacheHit)
+            ok = builder.compiler->Compile(build.request, build.bytecode, build.errors) && !build.bytecode.empty();
+        build.compiledNs = NowNanoseconds();
+
+        if (ok && build.createObjects)
+            ok = build.createObjects(build.user, build, build.errors);
+        build.readyNs = NowNanoseconds();
+
+        build.state.store(ok ? ShaderBuildState::Ready : ShaderBuildState::Failed, std::memory_order_release);
+    }
+
+    void BuilderMain(AsyncShaderBuilder& builder)
+    {
+        PROFILE_THREAD("ShaderBuilder");
+
+        while (true)
+        {
+            ShaderBuild* build = nullptr;
+            {
+                std::unique_lock<std::mutex> lock(builder.mutex);
+                builder.wake.wait(lock, [&]() { return !builder.queue.empty() || !builder.running; });
+                if (builder.queue.empty())
+                    break;
+
+                build = builder.queue.front();
+                builder.queue.pop_front();
+            }
+
+            RunShaderBuild(builder, *build);
+
+            // under the lock, so a waiter between its check and its wait still hears it
+            {
+                std::lock_guard<std::mutex> lock(builder.mutex);
+            }
+            builder.done.notify_all();
+        }
+    }
+}   // namespace
+
+void StartShaderBuilder(AsyncShaderBuilder& builder, IShaderCompiler& compiler, ShaderCache* cache, uint32_t threadCount)
+{
+    StopShaderBuilder(builder);
+
+    if (threadCount == 0)
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+
+    builder.compiler = &compiler;
+    builder.cache    = cache;
+    builder.running  = true;
+    builder.builds.clear();
+
+    for (uint32_t i = 0; i < threadCount; ++i)
+        builder.threads.emplace_back(BuilderMain, std::ref(builder));
+}
+
+void StopShaderBuilder(AsyncShaderBuilder& builder)
+{
+    {
+        std::lock_guard<std::mutex> lock(builder.mutex);
+        builder.running = false;
+    }
+    builder.wake.notify_all();
+
+    for (std::thread& thread : builder.threads)
+        thread.join();
+    builder.threads.clear();
+
+    CollectShaderBuilds(builder);
+}
+
+ShaderBuild& QueueShaderBuild(AsyncShaderBuilder&         builder,
+                              const char*                 name,
+                              const ShaderCompileRequest& request,
+                              bool                        critical,
+                              ShaderObjectFunction        createObjects,
+                              void*                       user)
+{
+    builder.builds.push_back(std::make_unique<ShaderBuild>());
+
+    ShaderBuild& build  = *builder.builds.back();
+    build.name          = name;
+    build.request       = request;
+    build.critical      = critical;
+    build.createObjects = createObjects;
+    build.user          = user;
+    build.queuedNs      = NowNanoseconds();
+
+    // copied: the view dies with the next SaveShaderCache
+    ShaderBytecode cached;
+    if (builder.cache && FindCachedShader(*builder.cache, request, cached))
+    {
+        build.cacheHit = true;
+        build.bytecode.assign(cached.data, cached.data + cached.size);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(builder.mutex);
+        auto at = critical ? std::find_if(builder.queue.begin(), builder.queue.end(), [](const ShaderBuild* b) { return !b->critical; })
+                           : builder.queue.end();
+        builder.queue.insert(at, &build);
+    }
+    builder.wake.notify_one();
+    return build;
+}
+
+bool IsShaderBuildDone(const ShaderBuild& build)
+{
+    ShaderBuildState state = build.state.load(std::memory_order_acquire);
+    return state == ShaderBuildState::Ready || state == ShaderBuildState::Failed;
+}
+
+bool IsShaderBuildReady(const ShaderBuild& build)
+{
+    return build.state.load(std::memory_order_acquire) == ShaderBuildState::Ready;
+}
+
+bool WaitForShaderBuild(AsyncShaderBuilder& builder, const ShaderBuild& build)
+{
+    std::unique_lock<std::mutex> lock(builder.mutex);
+    builder.done.wait(lock, [&]() { return IsShaderBuildDone(build); });
+    return IsShaderBuildReady(build);
+}
+
+bool WaitForCriticalShaders(AsyncShaderBuilder& builder)
+{
+    bool ok = true;
+    for (const auto& build : builder.builds)
+    {
+        if (build->critical)
+            ok = WaitForShaderBuild(builder, *build) && ok;
+    }
+    return ok;
+}
+
+bool CollectShaderBuilds(AsyncShaderBuilder& builder)
+{
+    bool allDone = true;
+    for (const auto& build : builder.builds)
+    {
+        if (build->collected)
+            continue;
+        if (!IsShaderBuildDone(*build))
+        {
+            allDone = false;
+            continue;
+        }
+
+        build->collected = true;
+        if (builder.cache && !build->cacheHit && IsShaderBuildReady(*build))
+        {
+            ShaderBytecode stored;
+            AddCompiledShader(*builder.cache, build->request, std::vector<uint8_t>(build->bytecode), (build->compiledNs - build->startNs) / 1e6, stored);
+        }
+    }
+    return allDone;
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#include "ShaderCache.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+enum class ShaderBuildState : uint32_t
+{
+    Queued,
+    Building,
+    Ready,
+    Failed,
+};
+
+struct ShaderBuild;
+
+// Creates a build's pipeline objects (shader, input layouts) from its
+// bytecode on a builder thread, so the device must allow creation from any
+// thread; D3D11 devices do. Returns false and fills `errors` on failure.
+using ShaderObjectFunction = bool (*)(void* user, const ShaderBuild& build, std::string& errors);
+
+// One shader's way from source to pipeline objects; the handle QueueShaderBuild
+// returns. The request's strings must outlive the build. Everything below
+// `state` is written by the builder thread and may be read once the state
+// is Ready or Failed.
+struct ShaderBuild
+{
+    const char*          name = nullptr;
+    ShaderCompileRequest request;
+    bool                 critical      = false;   // ahead of the rest in the queue; the first frame waits for these
+    ShaderObjectFunction createObjects = nullptr;
+    void*                user          = nullptr;
+    bool                 cacheHit      = false;   // bytecode came from the cache, only the objects are built
+    bool                 collected     = false;   // owning thread: seen done by CollectShaderBuilds
+
+    std::atomic<ShaderBuildState> state { ShaderBuildState::Queued };
+
+    std::vector<uint8_t> bytecode;
+    std::string          errors;
+    uint64_t             queuedNs   = 0;
+    uint64_t             startNs    = 0;   // taken by a builder thread
+    uint64_t             compiledNs = 0;
+    uint64_t             readyNs    = 0;   // objects created, or the build failed
+};
+
+// Compiles shaders and creates their pipeline objects on threads of its own,
+// so startup can go on (and frames can start) while they build. Cache lookups
+// and inserts stay on the owning thread: a hit is resolved when queued, a
+// fresh compile is added by CollectShaderBuilds.
+//
+// Not on the JobSystem: a compile takes milliseconds, and a frame waiting on
+// a parallel-for would pick one up and stall.
+struct AsyncShaderBuilder
+{
+    IShaderCompiler* compiler = nullptr;   // called from every builder thread at once
+    ShaderCache*     cache    = nullptr;   // may be null
+
+    std::vector<std::unique_ptr<ShaderBuild>> builds;   // owning thread only
+
+    // guarded by mutex
+    std::mutex               mutex;
+    std::condition_variable  wake;    // builder threads
+    std::condition_variable  done;    // waiters
+    std::deque<ShaderBuild*> queue;   // critical first, then in queue order
+    bool                     running = false;
+
+    std::vector<std::thread> threads;
+};
+
+// threadCount 0 = one per hardware thread.
+void StartShaderBuilder(AsyncShaderBuilder& builder, IShaderCompiler& compiler, ShaderCache* cache, uint32_t threadCount);
+
+// Builds what is still queued, then joins the threads and collects.
+void StopShaderBuilder(AsyncShaderBuilder& builder);
+
+// Between Start and Stop. The build lives until the next StartShaderBuilder.
+ShaderBuild& QueueShaderBuild(AsyncShaderBuilder&         builder,
+                              const char*                 name,
+                              const ShaderCompileRequest& request,
+                              bool                        critical,
+                              ShaderObjectFunction        createObjects,
+                              void*                       user);
+
+// Ready or Failed. Any thread.
+bool IsShaderBuildDone(const ShaderBuild& build);
+bool IsShaderBuildReady(const ShaderBuild& build);
+
+// Blocks until the build is done; true when it is Ready.
+bool WaitForShaderBuild(AsyncShaderBuilder& builder, const ShaderBuild& build);
+
+// Same for every critical build queued so far.
+bool WaitForCriticalShaders(AsyncShaderBuilder& builder);
+
+// Owning thread, e.g. once a frame: adds finished compiles to the cache.
+// True once every build queued so far is done.
+bool CollectShaderBuilds(AsyncShaderBuilder& builder);
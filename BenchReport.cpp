@@ -0,0 +1,107 @@
+#include "BenchReport.h"
+
+#include <cstdio>
+
+namespace
+{
+    const BenchMetric* FindMetric(const BenchReport& report, const std::string& name)
+    {
+        for (const BenchMetric& metric : report.metrics)
+        {
+            if (metric.name == name)
+                return &metric;
+        }
+        return nullptr;
+    }
+}   // namespace
+
+void AddBenchMetric(BenchReport& report, const char* name, double value, const char* unit)
+{
+    for (BenchMetric& metric : report.metrics)
+    {
+        if (metric.name == name)
+        {
+            metric.value = value;
+            metric.unit  = unit;
+            return;
+        }
+    }
+    report.metrics.push_back(BenchMetric { name, value, unit });
+}
+
+bool WriteBenchReportJSON(const BenchReport& report, const char* path)
+{
+    FILE* file = std::fopen(path, "w");
+    if (!file)
+        return false;
+
+    std::fprintf(file, "{\n  \"metrics\": [\n");
+    for (size_t i = 0; i < report.metrics.size(); ++i)
+    {
+        const BenchMetric& metric = report.metrics[i];
+        std::fprintf(file,
+                     "    { \"name\": \"%s\", \"value\": %.9g, \"unit\": \"%s\" }%s\n",
+                     metric.name.c_str(),
+                     metric.value,
+                     metric.unit.c_str(),
+                     i + 1 < report.metrics.size() ? "," : "");
+    }
+    std::fprintf(file, "  ]\n}\n");
+
+    bool ok = std::ferror(file) == 0;
+    std::fclose(file);
+    return ok;
+}
+
+bool ReadBenchReportJSON(BenchReport& report, const char* path)
+{
+    FILE* file = std::fopen(path, "r");
+    if (!file)
+        return false;
+
+    report.metrics.clear();
+
+    char line[512];
+    while (std::fgets(line, sizeof(line), file))
+    {
+        char   name[256];
+        char   unit[64];
+        double value = 0.0;
+        if (std::sscanf(line, " { \"name\": \"%255[^\"]\", \"value\": %lf, \"unit\": \"%63[^\"]\"", name, &value, unit) == 3)
+            report.metrics.push_back(BenchMetric { name, value, unit });
+    }
+
+    bool ok = std::ferror(file) == 0;
+    std::fclose(file);
+    return ok;
+}
+
+double BenchNoiseFloor(const std::string& unit)
+{
+    if (unit == "ms")
+        return 0.01;
+    if (unit == "us")
+        return 1.0;
+    if (unit == "ns")
+        return 1.0;
+    return 0.0;
+}
+
+std::vector<BenchRegression> CompareBenchReports(const BenchReport& baseline, const BenchReport& current, double threshold)
+{
+    std::vector<BenchRegression> regressions;
+    for (const BenchMetric& metric : current.metrics)
+    {
+        const BenchMetric* before = FindMetric(baseline, metric.name);
+        if (!before)
+            continue;
+
+        double floor = BenchNoiseFloor(metric.unit);
+        if (floor > 0.0 && before->value < floor)
+            continue;
+
+        if (metric.value > before->value * (1.0 + threshold) && metric.value - before->value > floor)
+            regressions.push_back(BenchRegression { metric.name, before->value, metric.value });
+    }
+    return regressions;
+}
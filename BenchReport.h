@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Named benchmark results, written as JSON so runs on the build machines can
+// be compared. Every metric is a cost (time, bytes, allocations): lower is
+// better.
+struct BenchMetric
+{
+    std::string name;   // dotted, e.g. "frame.update_ms"
+    double      value = 0.0;
+    std::string unit;
+};
+
+struct BenchReport
+{
+    std::vector<BenchMetric> metrics;
+};
+
+// Replaces an earlier value of the same name.
+void AddBenchMetric(BenchReport& report, const char* name, double value, const char* unit);
+
+bool WriteBenchReportJSON(const BenchReport& report, const char* path);
+
+// Reads what WriteBenchReportJSON wrote (one metric per line); not a general
+// JSON parser.
+bool ReadBenchReportJSON(BenchReport& report, const char* path);
+
+struct BenchRegression
+{
+    std::string name;
+    double      baseline = 0.0;
+    double      current  = 0.0;
+};
+
+// Smallest increase of a metric in `unit` that can count as a regression:
+// timer and scheduler noise for the time units, none for the deterministic
+// ones (counts, bytes, maps).
+double BenchNoiseFloor(const std::string& unit);
+
+// Metrics more than `threshold` (0.1 = 10%) and more than their unit's noise
+// floor above their baseline. A zero baseline of a deterministic unit
+// regresses on any increase. Time metrics whose baseline is under the noise
+// floor measured below the timer's resolution and are left out, as are
+// metrics missing on either side.
+std::vector<BenchRegression> CompareBenchReports(const BenchReport& baseline, const BenchReport& current, double threshold);
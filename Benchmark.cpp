@@ -0,0 +1,1279 @@
+// Portable CPU benchmarks for the renderer. No window or GPU required; the
+// correctness checks are in renderer_tests.
+// Linux: cmake -S . -B build && cmake --build build, or
+//        g++ -O2 -std=c++20 -pthread Benchmark.cpp AffineKernel.cpp AsyncShaderBuilder.cpp BenchReport.cpp ConstantArena.cpp DrawBucket.cpp DynamicResolution.cpp FrameAllocator.cpp FramePacer.cpp FrameTimer.cpp HeapCounter.cpp InputCapture.cpp InputEvents.cpp InstanceBuffer.cpp JobSystem.cpp MappedFile.cpp MeshFile.cpp MeshOptimizer.cpp NullRenderContext.cpp ObjMesh.cpp PrimitiveBatcher.cpp Profiler.cpp Scene.cpp ShaderCache.cpp SoftwareRasterizer.cpp SpatialGrid.cpp StateTrackingContext.cpp TestSupport.cpp TransformGraph.cpp VertexFormat.cpp -o bench
+//   --images <dir>      write software-rasterized frames as PPM for diffing
+//   --json <path>       write the tracked metrics (all costs, lower is better)
+//   --baseline <path>   compare against an earlier --json file; exit 2 on a regression
+//   --threshold <f>     allowed increase over the baseline (default 0.1 = 10%)
+//                       and over the unit's noise floor (BenchNoiseFloor)
+
+#include "AffineKernel.h"
+#include "AsyncShaderBuilder.h"
+#include "BenchReport.h"
+#include "ConstantArena.h"
+#include "DrawBucket.h"
+#include "DynamicResolution.h"
+#include "FrameAllocator.h"
+#include "FramePacer.h"
+#include "HeapCounter.h"
+#include "InputCapture.h"
+#include "InputEvents.h"
+#include "InstanceBuffer.h"
+#include "JobSystem.h"
+#include "MeshFile.h"
+#include "MeshOptimizer.h"
+#include "NullRenderContext.h"
+#include "ObjMesh.h"
+#include "PrimitiveBatcher.h"
+#include "Profiler.h"
+#include "ShaderCache.h"
+#include "SoftwareRasterizer.h"
+#include "SpatialGrid.h"
+#include "StateTrackingContext.h"
+#include "TestSupport.h"
+#include "TransformGraph.h"
+#include "VertexFormat.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <iterator>
+#include <memory>
+#include <numeric>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+using BenchClock = std::chrono::steady_clock;
+
+volatile float g_benchSink = 0.f;
+
+BenchReport g_report;   // metrics for --json / --baseline
+
+// Samples per tracked time; the fastest is reported, the slower ones are the
+// scheduler and frequency changes.
+const int kBenchRepetitions = 10;
+
+// The smallest of kBenchRepetitions results of `sample`.
+template<typename Fn>
+double FastestOf(Fn&& sample)
+{
+    double fastest = sample();
+    for (int i = 1; i < kBenchRepetitions; ++i)
+        fastest = std::min(fastest, sample());
+    return fastest;
+}
+
+// Milliseconds per call after one warm-up call: the fastest of
+// kBenchRepetitions samples that share the `iterations` calls (at least one
+// each).
+template<typename Fn>
+double MeasureMs(int iterations, Fn&& fn)
+{
+    fn();
+
+    int perSample = std::max(1, iterations / kBenchRepetitions);
+    return FastestOf([&]() {
+        auto begin = BenchClock::now();
+        for (int i = 0; i < perSample; ++i)
+            fn();
+        auto end = BenchClock::now();
+
+        return std::chrono::duration<double, std::milli>(end - begin).count() / perSample;
+    });
+}
+
+void BenchInstancePacking()
+{
+    const size_t counts[] = { 1000, 10000, 100000, 1000000 };
+
+    for (size_t count : counts)
+    {
+        InstanceTransforms transforms;
+        LayoutInstanceGrid(transforms, count, 1.f);
+
+        std::vector<InstanceData> packed(count);
+
+        double ms = MeasureMs(20, [&]() {
+            RotateInstances(transforms, 0.001f);
+            PackInstances(transforms, 0, count, packed.data());
+            g_benchSink = g_benchSink + packed[count - 1].world[0];
+        });
+
+        std::printf("instance packing  %8zu instances  %8.3f ms  %10.0f instances/ms\n", count, ms, count / ms);
+        AddBenchMetric(g_report, ("instance_pack." + std::to_string(count) + ".ns_per_instance").c_str(), ms * 1e6 / count, "ns");
+    }
+}
+
+void BenchAffineKernels()
+{
+    const size_t count = 1000000;
+    AffineInputs in    = MakeAffineInputs(count, 3.2f);
+
+    std::vector<float> out(count * 16);
+
+    double referenceMs = MeasureMs(5, [&]() {
+        for (size_t i = 0; i < count; ++i)
+            ReferenceWorldMatrix(in.px[i], in.py[i], in.sx[i], in.sy[i], in.rot[i], &out[i * 16]);
+        g_benchSink = g_benchSink + out[0];
+    });
+    std::printf("affine kernel     %-9s %8zu matrices  %8.3f ms  %10.0f matrices/ms\n", "simplemath", count, referenceMs, count / referenceMs);
+    AddBenchMetric(g_report, "matrix.simplemath.ns_per_matrix", referenceMs * 1e6 / count, "ns");
+
+    const AffineKernelPath paths[] = { AffineKernelPath::Scalar, AffineKernelPath::SSE, AffineKernelPath::AVX2 };
+    for (AffineKernelPath path : paths)
+    {
+        if (!IsAffineKernelPathSupported(path))
+            continue;
+
+        double ms = MeasureMs(20, [&]() {
+            BuildAffineMatrices(path, in.px.data(), in.py.data(), in.sx.data(), in.sy.data(), in.rot.data(), count, out.data());
+            g_benchSink = g_benchSink + out[0];
+        });
+        std::printf("affine kernel     %-9s %8zu matrices  %8.3f ms  %10.0f matrices/ms\n", AffineKernelPathName(path), count, ms, count / ms);
+        AddBenchMetric(g_report, (std::string("matrix.") + AffineKernelPathName(path) + ".ns_per_matrix").c_str(), ms * 1e6 / count, "ns");
+    }
+}
+
+// g_triangleVertices / g_triangleIndices from EntryPoint.cpp
+const RasterVertex g_benchTriangleVertices[] = {
+    { -0.5f, 0.f, 1.f, 0.f, 0.f },
+    { 0.f, 0.5f, 0.f, 0.f, 1.f },
+    { 0.5f, 0.f, 0.f, 1.f, 0.f }
+};
+
+const uint32_t g_benchTriangleIndices[] = { 0, 1, 2 };
+
+void BenchSoftwareRasterizer(const char* imageDir)
+{
+    const size_t counts[] = { 1, 1000, 10000, 100000 };
+
+    SoftwareRasterizer* rasterizer = CreateSoftwareRasterizer(0);
+
+    RasterTarget target;
+    ResizeRasterTarget(target, 1280, 720);
+
+    for (size_t count : counts)
+    {
+        InstanceTransforms transforms;
+        if (count == 1)
+            AddInstance(transforms, 0.f, 0.f, 1.f, 1.f, 0.f);
+        else
+            LayoutInstanceGrid(transforms, count, 1.f);
+
+        std::vector<InstanceData> worlds(count);
+        PackInstances(transforms, 0, count, worlds.data());
+
+        std::vector<RasterDrawCall> draws(count);
+        for (size_t i = 0; i < count; ++i)
+            draws[i] = { g_benchTriangleVertices, g_benchTriangleIndices, 3, worlds[i].world };
+
+        const float clearColor[] = { 0.f, 0.f, 0.f, 1.f };
+        RasterStats stats;
+
+        double ms = MeasureMs(10, [&]() {
+            ClearRasterTarget(target, clearColor);
+            RasterizeDraws(rasterizer, target, draws.data(), draws.size(), &stats);
+        });
+
+        std::printf("software raster   %8zu triangles  %8.3f ms  (setup %.3f, raster %.3f)  %u workers  %llu px  hash %016llx\n",
+                    count,
+                    ms,
+                    stats.setupMs,
+                    stats.rasterMs,
+                    RasterWorkerCount(rasterizer),
+                    static_cast<unsigned long long>(stats.pixelsWritten),
+                    static_cast<unsigned long long>(HashRasterTarget(target)));
+
+        if (imageDir)
+        {
+            std::string path = std::string(imageDir) + "/raster_" + std::to_string(count) + ".ppm";
+            if (!WriteRasterTargetPPM(target, path.c_str()))
+                std::printf("failed to write %s\n", path.c_str());
+        }
+    }
+
+    DestroySoftwareRasterizer(rasterizer);
+}
+
+void BenchProfiler()
+{
+    const int zones = 1 << 15;   // half the ring, so nothing is dropped
+
+    ProfileCapture capture;
+    double         ms = MeasureMs(20, [&]() {
+        for (int i = 0; i < zones; ++i)
+        {
+            PROFILE_SCOPE("Bench");
+        }
+        capture.threads.clear();
+        ProfilerCollect(capture);
+    });
+
+    uint64_t ticks       = 0;
+    double   timestampMs = MeasureMs(20, [&]() {
+        for (int i = 0; i < zones; ++i)
+            ticks += ProfilerTimestamp();
+    });
+    g_benchSink = static_cast<float>(ticks & 1);
+
+    // two timestamps per zone are the floor; the rest is the profiler's own cost
+    std::printf("profiler zone       %6.2f ns  (begin + end + collect, timestamp %.2f ns)\n",
+                ms * 1e6 / zones,
+                timestampMs * 1e6 / zones);
+}
+
+void BenchShaderCache()
+{
+    const char* path = "shader_cache_bench.bin";
+    std::remove(path);
+
+    const char                        source[] = "float4 main() : SV_TARGET { return 1; }";
+    const int                         count    = 64;
+    std::vector<std::string>          entryPoints(count);
+    std::vector<ShaderCompileRequest> requests(count);
+    for (int i = 0; i < count; ++i)
+    {
+        entryPoints[i]         = "main" + std::to_string(i);
+        requests[i].source     = source;
+        requests[i].sourceSize = sizeof(source) - 1;
+        requests[i].entryPoint = entryPoints[i].c_str();
+        requests[i].target     = "ps_5_0";
+    }
+
+    StubShaderCompiler compiler;
+    compiler.spinUs = 500;   // stand-in for D3DCompile
+
+    auto run = [&]() {
+        ShaderCache    cache;
+        ShaderBytecode bytecode;
+        OpenShaderCache(cache, path, 16 << 20);
+        for (const ShaderCompileRequest& r : requests)
+            GetOrCompileShader(cache, compiler, r, bytecode, nullptr);
+        SaveShaderCache(cache);
+        CloseShaderCache(cache);
+    };
+
+    auto   begin  = BenchClock::now();
+    run();
+    double coldMs = std::chrono::duration<double, std::milli>(BenchClock::now() - begin).count();
+    double warmMs = MeasureMs(20, run);
+
+    std::printf("shader cache      %d shaders  cold %.3f ms  warm %.3f ms\n", count, coldMs, warmMs);
+    std::remove(path);
+}
+
+void BenchStateTracking()
+{
+    const int draws = 100000;
+
+    RecordingRenderContext device;
+    StateTrackingContext   tracker;
+    tracker.inner = &device;
+
+    RenderHandle   vertexBuffers[2] = { reinterpret_cast<RenderHandle>(0x100), reinterpret_cast<RenderHandle>(0x200) };
+    RenderHandle   shader           = reinterpret_cast<RenderHandle>(0x300);
+    RenderViewport viewport         = { 0.f, 0.f, 1280.f, 720.f, 0.f, 1.f };
+
+    // two meshes alternating every 8 draws, everything else shared
+    double directMs = MeasureMs(5, [&]() {
+        for (int i = 0; i < draws; ++i)
+            BindDrawState(device, vertexBuffers[(i / 8) & 1], shader, viewport);
+    });
+    int directCalls = device.calls;
+
+    device.calls     = 0;
+    double trackedMs = MeasureMs(5, [&]() {
+        for (int i = 0; i < draws; ++i)
+            BindDrawState(tracker, vertexBuffers[(i / 8) & 1], shader, viewport);
+    });
+
+    std::printf("state tracking    %d draws  direct %.3f ms (%d calls)  tracked %.3f ms (%d calls)\n",
+                draws,
+                directMs,
+                directCalls / 6,
+                trackedMs,
+                device.calls / 6);
+}
+
+void BenchDrawBucket()
+{
+    for (int count : { 10000, 50000 })
+    {
+        for (int threads : { 1, 4 })
+        {
+            DrawBucket bucket;
+
+            double recordMs = MeasureMs(10, [&]() { RecordSyntheticDrawsThreaded(bucket, count, threads); });
+            double sortMs   = MeasureMs(10, [&]() { SortDrawBucket(bucket); });
+
+            RecordingRenderContext sortedDevice;
+            double                 submitMs = MeasureMs(10, [&]() {
+                sortedDevice.calls = 0;
+                SubmitDrawBucket(bucket, sortedDevice);
+            });
+
+            // same commands in recording order, for the bind count
+            for (uint32_t i = 0; i < bucket.sorted.size(); ++i)
+                bucket.sorted[i] = { 0, static_cast<uint32_t>(i % threads), static_cast<uint32_t>(i / threads) };
+            RecordingRenderContext unsortedDevice;
+            SubmitDrawBucket(bucket, unsortedDevice);
+
+            std::printf("draw bucket   %6d draws  %d threads  record %.3f ms  sort %.3f ms  submit %.3f ms  binds %d (unsorted %d)\n",
+                        count,
+                        threads,
+                        recordMs,
+                        sortMs,
+                        submitMs,
+                        sortedDevice.calls,
+                        unsortedDevice.calls);
+        }
+    }
+}
+
+// HUD-style frame: many small shapes. Batched vs. one map and one draw per shape.
+void BenchPrimitiveBatcher()
+{
+    const float color[3] = { 1.f, 0.5f, 0.f };
+
+    for (int shapes : { 1000, 100000 })
+    {
+        RecordingRenderContext device;
+        RenderHandle           vb = device.AddBuffer((1 << 16) * sizeof(BatchVertex));
+        RenderHandle           ib = device.AddBuffer((3 << 15) * sizeof(uint32_t));
+
+        PrimitiveBatcher batcher;
+        InitPrimitiveBatcher(batcher, &device, vb, 1 << 16, ib, 3 << 15);
+
+        double batchedMs = MeasureMs(10, [&]() {
+            for (int i = 0; i < shapes; ++i)
+                BatchRect(batcher, static_cast<float>(i & 1023), static_cast<float>(i >> 10), 1.f, 1.f, color);
+            EndBatcherFrame(batcher);
+        });
+        double batchedDraws = static_cast<double>(batcher.total.draws) / 11;
+        double wraps        = static_cast<double>(batcher.vertexRing.wraps) / 11;
+
+        // per shape: its own buffer contents, full state and a draw
+        RenderHandle   shapeVb  = device.AddBuffer(4 * sizeof(BatchVertex));
+        RenderHandle   shapeIb  = device.AddBuffer(6 * sizeof(uint32_t));
+        RenderHandle   shader   = reinterpret_cast<RenderHandle>(0x300);
+        RenderViewport viewport = { 0.f, 0.f, 1280.f, 720.f, 0.f, 1.f };
+        device.draws            = 0;
+
+        double perShapeMs = MeasureMs(10, [&]() {
+            for (int i = 0; i < shapes; ++i)
+            {
+                float        x = static_cast<float>(i & 1023);
+                float        y = static_cast<float>(i >> 10);
+                BatchVertex* v = static_cast<BatchVertex*>(device.Map(shapeVb, MapMode::WriteDiscard));
+                v[0]           = { x, y, color[0], color[1], color[2] };
+                v[1]           = { x + 1.f, y, color[0], color[1], color[2] };
+                v[2]           = { x + 1.f, y + 1.f, color[0], color[1], color[2] };
+                v[3]           = { x, y + 1.f, color[0], color[1], color[2] };
+                device.Unmap(shapeVb, 4 * sizeof(BatchVertex));
+
+                uint32_t* idx     = static_cast<uint32_t*>(device.Map(shapeIb, MapMode::WriteDiscard));
+                uint32_t  quad[6] = { 0, 1, 2, 0, 2, 3 };
+                std::memcpy(idx, quad, sizeof(quad));
+                device.Unmap(shapeIb, sizeof(quad));
+
+                BindDrawState(device, shapeVb, shader, viewport);
+                device.DrawIndexed(6, 0, 0);
+            }
+            device.mapModes.clear();
+        });
+
+        std::printf("primitive batch %6d rects  batched %.3f ms (%.0f draws, %.1f wraps)  per shape %.3f ms (%d draws)\n",
+                    shapes,
+                    batchedMs,
+                    batchedDraws,
+                    wraps,
+                    perShapeMs,
+                    device.draws / 11);
+    }
+}
+
+void BenchVertexFormats()
+{
+    const size_t                          count = 1 << 20;
+    std::vector<float>                    vertices(count * 5);
+    std::vector<float>                    floats(count * 4);
+    std::mt19937                          rng(3);
+    std::uniform_real_distribution<float> unit(-1.f, 1.f);
+    for (float& v : vertices)
+        v = unit(rng);
+    for (float& v : floats)
+        v = unit(rng);
+
+    std::vector<uint8_t>  packed(count * 8);
+    std::vector<uint16_t> halves(floats.size());
+
+    for (VertexPackPath path : kVertexPackPaths)
+    {
+        if (!IsVertexPackPathSupported(path))
+            continue;
+
+        double halfMs = MeasureMs(10, [&]() { FloatToHalf(path, floats.data(), floats.size(), halves.data()); });
+        std::printf("vertex pack   %-6s  %zu floats -> half     %7.3f ms  %8.0f floats/ms\n", VertexPackPathName(path), floats.size(), halfMs, floats.size() / halfMs);
+
+        for (VertexFormat format : { VertexFormat::Half, VertexFormat::Snorm16 })
+        {
+            double ms = MeasureMs(10, [&]() { PackVertices(path, format, vertices.data(), count, packed.data()); });
+            std::printf("vertex pack   %-6s  %zu vertices -> %-7s %7.3f ms  %8.0f vertices/ms  %zu -> %zu bytes\n",
+                        VertexPackPathName(path),
+                        count,
+                        VertexFormatName(format),
+                        ms,
+                        count / ms,
+                        count * 20,
+                        count * GetVertexLayout(format).stride);
+            AddBenchMetric(g_report, (std::string("vertex_pack.") + VertexPackPathName(path) + "." + VertexFormatName(format) + ".ns_per_vertex").c_str(), ms * 1e6 / count, "ns");
+        }
+    }
+}
+
+// Load time of a grid mesh from OBJ text (parse + pack, what it takes to reach
+// pSysMem) against the mapped container, warm page cache.
+void BenchMeshFile()
+{
+    const char* obj  = "mesh_bench.obj";
+    const char* path = "mesh_bench.mesh";
+
+    const uint32_t        side = 512;
+    std::vector<float>    vertices;
+    std::vector<uint32_t> indices;
+    for (uint32_t y = 0; y < side; ++y)
+        for (uint32_t x = 0; x < side; ++x)
+            vertices.insert(vertices.end(), { x * (2.f / (side - 1)) - 1.f, y * (2.f / (side - 1)) - 1.f, x / float(side), y / float(side), 0.5f });
+    for (uint32_t y = 0; y + 1 < side; ++y)
+        for (uint32_t x = 0; x + 1 < side; ++x)
+        {
+            uint32_t i = y * side + x;
+            indices.insert(indices.end(), { i, i + 1, i + side + 1, i, i + side + 1, i + side });
+        }
+    size_t vertexCount = vertices.size() / 5;
+
+    FILE* file = std::fopen(obj, "wb");
+    for (size_t i = 0; i < vertexCount; ++i)
+        std::fprintf(file, "v %.6f %.6f 0 %.6f %.6f %.6f\n", vertices[i * 5], vertices[i * 5 + 1], vertices[i * 5 + 2], vertices[i * 5 + 3], vertices[i * 5 + 4]);
+    for (size_t i = 0; i < indices.size(); i += 3)
+        std::fprintf(file, "f %u %u %u\n", indices[i] + 1, indices[i + 1] + 1, indices[i + 2] + 1);
+    std::fclose(file);
+
+    WriteMeshFile(path, VertexFormat::Half, vertices.data(), vertexCount, indices.data(), indices.size());
+
+    ObjMesh              parsed;
+    std::vector<uint8_t> packedVertices;
+    std::vector<uint8_t> packedIndices;
+    double               objMs = MeasureMs(3, [&]() {
+        LoadObjMesh(obj, parsed);
+        IndexFormat width = SelectIndexFormat(parsed.z.size());
+        packedVertices.resize(parsed.z.size() * GetVertexLayout(VertexFormat::Half).stride);
+        packedIndices.resize(parsed.indices.size() * IndexFormatSize(width));
+        PackVertices(VertexFormat::Half, parsed.vertices.data(), parsed.z.size(), packedVertices.data());
+        PackIndices(parsed.indices.data(), parsed.indices.size(), width, packedIndices.data());
+    });
+
+    MeshView mesh;
+    double   mapMs    = MeasureMs(20, [&]() {
+        OpenMeshFile(mesh, path, false);
+        CloseMeshFile(mesh);
+    });
+    double   verifyMs = MeasureMs(20, [&]() {
+        OpenMeshFile(mesh, path, true);
+        CloseMeshFile(mesh);
+    });
+
+    // whole mesh through a 1 MB buffer, as an uploader would for a file it won't map
+    std::vector<uint8_t> chunk(1 << 20);
+    double               streamMs = MeasureMs(20, [&]() {
+        MeshStreamReader reader;
+        OpenMeshStream(reader, path);
+        const MeshFileHeader& h        = reader.header;
+        uint64_t              perChunk = chunk.size() / h.vertexStride;
+        for (uint64_t first = 0; first < h.vertexCount; first += perChunk)
+            ReadMeshVertices(reader, first, std::min(perChunk, h.vertexCount - first), chunk.data());
+        perChunk = chunk.size() / IndexFormatSize(static_cast<IndexFormat>(h.indexFormat));
+        for (uint64_t first = 0; first < h.indexCount; first += perChunk)
+            ReadMeshIndices(reader, first, std::min(perChunk, h.indexCount - first), chunk.data());
+        CloseMeshStream(reader);
+    });
+
+    std::printf("mesh load         %zu vertices %zu indices  obj %.0f KB %.2f ms  mesh %.0f KB: map %.3f ms  map+verify %.3f ms  stream %.3f ms\n",
+                vertexCount,
+                indices.size(),
+                std::filesystem::file_size(obj) / 1024.0,
+                objMs,
+                std::filesystem::file_size(path) / 1024.0,
+                mapMs,
+                verifyMs,
+                streamMs);
+
+    std::remove(obj);
+    std::remove(path);
+}
+
+// The three passes on a ~1M-triangle sphere delivered in random triangle order.
+void BenchMeshOptimizer()
+{
+    std::vector<float>    positions;
+    std::vector<uint32_t> indices;
+    AppendSphere(positions, indices, 500, 1000, 1.f);
+    size_t vertexCount = positions.size() / 3;
+    ShuffleTriangles(indices, 7);
+
+    std::vector<uint32_t> cacheOrder(indices.size());
+    std::vector<uint32_t> overdrawOrder(indices.size());
+    std::vector<uint32_t> remapped;
+    std::vector<float>    fetchOrder(positions.size());
+
+    double cacheMs    = MeasureMs(3, [&]() { OptimizeVertexCache(cacheOrder.data(), indices.data(), indices.size(), vertexCount); });
+    double overdrawMs = MeasureMs(3, [&]() { OptimizeOverdraw(overdrawOrder.data(), cacheOrder.data(), cacheOrder.size(), positions.data(), vertexCount, 3, 1.05f); });
+    double fetchMs    = MeasureMs(3, [&]() {
+        remapped = overdrawOrder;
+        OptimizeVertexFetch(fetchOrder.data(), remapped.data(), remapped.size(), positions.data(), vertexCount, 3 * sizeof(float));
+    });
+
+    VertexCacheStats before = AnalyzeVertexCache(indices.data(), indices.size(), vertexCount, 16);
+    VertexCacheStats cached = AnalyzeVertexCache(cacheOrder.data(), cacheOrder.size(), vertexCount, 16);
+    VertexCacheStats after  = AnalyzeVertexCache(remapped.data(), remapped.size(), vertexCount, 16);
+
+    std::printf("mesh optimize     %zu triangles  cache %.1f ms  overdraw %.1f ms  fetch %.1f ms\n", indices.size() / 3, cacheMs, overdrawMs, fetchMs);
+    std::printf("mesh optimize     acmr %.3f -> %.3f -> %.3f  atvr %.3f -> %.3f -> %.3f  (input, cache pass, all passes)\n",
+                before.acmr,
+                cached.acmr,
+                after.acmr,
+                before.atvr,
+                cached.atvr,
+                after.atvr);
+}
+
+// 1M instance-sized entries on a 1000x1000 layout over [-8, 8]², viewed
+// through [-1, 1]²: about 1.6% visible.
+void BenchSpatialGrid()
+{
+    const uint32_t count  = 1000000;
+    const float    extent = 8.f;
+    const float    pitch  = 2.f * extent / 1000.f;
+
+    std::vector<SpatialRect> bounds(count);
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        float x   = -extent + pitch * (i % 1000 + 0.5f);
+        float y   = -extent + pitch * (i / 1000 + 0.5f);
+        bounds[i] = SpatialRect { x - pitch * 0.5f, y - pitch * 0.5f, x + pitch * 0.5f, y + pitch * 0.5f };
+    }
+
+    SpatialGrid grid;
+    double      insertMs = MeasureMs(3, [&]() {
+        InitSpatialGrid(grid, SpatialRect { -extent, -extent, extent, extent }, 2.f * pitch);
+        for (uint32_t i = 0; i < count; ++i)
+            SetSpatialEntry(grid, i, bounds[i]);
+    });
+
+    // jitter stays inside the cell; a full pitch shift crosses into the next one half the time
+    float  jitter   = pitch * 0.01f;
+    int    step     = 0;
+    double moveMs   = MeasureMs(5, [&]() {
+        float d = ++step % 2 ? jitter : -jitter;
+        for (uint32_t i = 0; i < count; ++i)
+            SetSpatialEntry(grid, i, SpatialRect { bounds[i].minX + d, bounds[i].minY, bounds[i].maxX + d, bounds[i].maxY });
+    });
+    double crossMs  = MeasureMs(5, [&]() {
+        float d = ++step % 2 ? pitch : 0.f;
+        for (uint32_t i = 0; i < count; ++i)
+            SetSpatialEntry(grid, i, SpatialRect { bounds[i].minX + d, bounds[i].minY, bounds[i].maxX + d, bounds[i].maxY });
+    });
+    for (uint32_t i = 0; i < count; ++i)
+        SetSpatialEntry(grid, i, bounds[i]);
+
+    const SpatialRect     view = { -1.f, -1.f, 1.f, 1.f };
+    std::vector<uint32_t> visible;
+    std::vector<uint32_t> scanned;
+    double                cullMs = MeasureMs(20, [&]() { CullSpatialGrid(grid, view, visible); });
+    double                scanMs = MeasureMs(20, [&]() {
+        scanned.clear();
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            const SpatialRect& b = bounds[i];
+            if (b.maxX >= view.minX && b.minX <= view.maxX && b.maxY >= view.minY && b.minY <= view.maxY)
+                scanned.push_back(i);
+        }
+    });
+
+    std::mt19937                          rng(3);
+    std::uniform_real_distribution<float> position(-extent, extent);
+    std::vector<uint32_t>                 hits;
+    uint32_t                              picked = 0;
+    const int                             picks  = 100000;
+    double                                pickMs = MeasureMs(1, [&]() {
+        for (int i = 0; i < picks; ++i)
+            PickSpatialPoint(grid, position(rng), position(rng), picked);
+    });
+    double rectMs = MeasureMs(1, [&]() {
+        for (int i = 0; i < picks; ++i)
+        {
+            float x = position(rng);
+            float y = position(rng);
+            hits.clear();
+            QuerySpatialRect(grid, SpatialRect { x, y, x + 0.1f, y + 0.1f }, hits);
+        }
+    });
+    g_benchSink = g_benchSink + picked + hits.size();
+
+    std::printf("spatial grid      %u entries  insert %.1f ms  update in cell %.1f ms  across cells %.1f ms\n", count, insertMs, moveMs, crossMs);
+    std::printf("spatial grid      cull %zu visible  grid %.3f ms  linear scan %.3f ms (%zu)\n", visible.size(), cullMs, scanMs, scanned.size());
+    AddBenchMetric(g_report, "spatial_grid.cull_ms", cullMs, "ms");
+    std::printf("spatial grid      pick %.3f us  0.1x0.1 rect query %.3f us\n", pickMs * 1000.0 / picks, rectMs * 1000.0 / picks);
+}
+
+// Window procedure -> update traffic across threads, and the per-frame drain.
+void BenchInputEvents()
+{
+    auto           queue = std::make_unique<InputQueue>();
+    const uint64_t count = 10000000;
+
+    auto        begin = BenchClock::now();
+    std::thread producer([&]() {
+        for (uint64_t i = 0; i < count; ++i)
+        {
+            while (!queue->Push(InputEvent { i, static_cast<uint8_t>(i), (i & 1) == 0 }))
+                std::this_thread::yield();
+        }
+    });
+
+    InputEvent event;
+    uint64_t   popped = 0;
+    while (popped < count)
+    {
+        if (queue->Pop(event))
+            ++popped;
+        else
+            std::this_thread::yield();
+    }
+    producer.join();
+    double transferMs = std::chrono::duration<double, std::milli>(BenchClock::now() - begin).count();
+
+    // a busy frame: 64 events, 8 keys
+    InputTracker  tracker;
+    KeyFrameInput frame;
+    InitInputTracker(tracker, 0, 1024);
+
+    uint64_t now     = 0;
+    double   drainMs = MeasureMs(10000, [&]() {
+        for (uint64_t i = 0; i < 64; ++i)
+            queue->Push(InputEvent { now + i * 100, static_cast<uint8_t>('A' + i % 8), (i / 8) % 2 == 0 });
+        now += 16000000;
+        ConsumeInputEvents(tracker, *queue, now, frame);
+        RecordInputSubmit(tracker, now + 1000);
+    });
+
+    std::printf("input events      spsc %.1f M events/s across threads  drain of 64 events + latency %.3f us per frame\n",
+                count / transferMs / 1000.0,
+                drainMs * 1000.0);
+}
+
+// The system clock at 240 fps with no work: what sleep plus spin achieves here.
+void BenchFramePacer()
+{
+    SystemPacerClock clock;
+    FramePacer       pacer;
+    InitFramePacer(pacer, &clock, 240.0, 240);
+
+    for (int frame = 0; frame < 240; ++frame)
+        WaitForNextFrame(pacer);
+
+    FrameTimeStats intervals = ComputeFrameTimeStats(pacer.intervals);
+    FrameTimeStats lateness  = ComputeFrameTimeStats(pacer.lateness);
+    std::printf("frame pacer       240 fps  interval p50 %.4f  p99 %.4f ms  late p99 %.4f  max %.4f ms  spin %.2f%% of the time  slack %.3f ms\n",
+                intervals.p50Ms,
+                intervals.p99Ms,
+                lateness.p99Ms,
+                lateness.maxMs,
+                100.0 * pacer.spunNs / (intervals.meanMs * 1e6 * intervals.samples),
+                pacer.sleepSlackNs / 1e6);
+}
+
+// A load that swings between light and 2.5x the budget: frames over budget
+// with the controller against a fixed full size.
+void BenchDynamicResolution()
+{
+    DynamicResolutionSettings settings;
+    DynamicResolution         dr;
+    InitDynamicResolution(dr, settings, 1920, 1080);
+
+    std::mt19937       rng(9);
+    std::vector<float> trace(60000);
+    for (size_t i = 0; i < trace.size(); ++i)
+    {
+        float load = i / 600 % 3 == 0 ? 8.f : i / 600 % 3 == 1 ? 20.f : 40.f;
+        trace[i]   = load * (0.9f + 0.2f * (rng() % 1000) / 1000.f);
+    }
+
+    size_t overFixed   = 0;
+    size_t overDynamic = 0;
+    double scaleSum    = 0.0;
+    auto   begin       = BenchClock::now();
+    for (float fullMs : trace)
+    {
+        float frameMs = ScaledFrameMs(dr, fullMs);
+        overFixed += fullMs > settings.budgetMs ? 1 : 0;
+        overDynamic += frameMs > settings.budgetMs ? 1 : 0;
+        scaleSum += DynamicResolutionScale(dr);
+        UpdateDynamicResolution(dr, frameMs);
+    }
+    double updateMs = std::chrono::duration<double, std::milli>(BenchClock::now() - begin).count();
+
+    std::printf("dynamic res       over budget %.1f%% fixed vs %.1f%% scaled  mean scale %.2f  %llu down %llu up  %.3f us per update\n",
+                100.0 * overFixed / trace.size(),
+                100.0 * overDynamic / trace.size(),
+                scaleSum / trace.size(),
+                static_cast<unsigned long long>(dr.lowered),
+                static_cast<unsigned long long>(dr.raised),
+                updateMs * 1000.0 / trace.size());
+}
+
+// Recording and replaying the update of a 10k instance scene: the capture's
+// overhead next to the update it drives.
+void BenchInputCapture()
+{
+    const char* path = "input_capture_bench.bin";
+
+    std::mt19937       rng(3);
+    SceneControls      initial;
+    InputCaptureWriter writer;
+    initial.requestedInstanceCount = 10000;
+    if (!BeginInputCapture(writer, path, initial, 0.5f))
+        return;
+
+    const int frames = 2000;
+    auto      begin  = BenchClock::now();
+    for (int frame = 0; frame < frames; ++frame)
+        WriteInputCaptureFrame(writer, SyntheticCaptureFrame(rng, frame));
+    EndInputCapture(writer);
+    double writeMs = std::chrono::duration<double, std::milli>(BenchClock::now() - begin).count();
+
+    InputCaptureReader reader;
+    if (!OpenInputCapture(reader, path))
+        return;
+
+    SceneState scene;
+    ResetCaptureScene(scene, CaptureControlsToScene(reader.header.initial), reader.header.instanceRadius);
+
+    InputCaptureFrame frame;
+    double            readMs = 0.0;
+    begin                    = BenchClock::now();
+    while (true)
+    {
+        auto readBegin = BenchClock::now();
+        bool more      = ReadInputCaptureFrame(reader, frame);
+        readMs += std::chrono::duration<double, std::milli>(BenchClock::now() - readBegin).count();
+        if (!more)
+            break;
+        StepCapturedFrame(scene, frame);
+    }
+    double replayMs = std::chrono::duration<double, std::milli>(BenchClock::now() - begin).count();
+    CloseInputCapture(reader);
+    std::remove(path);
+
+    std::printf("input capture     %.1f bytes/frame  write %.3f us  read %.3f us  replayed update %.3f ms/frame  hash %016llx\n",
+                static_cast<double>(writer.bytes) / frames,
+                writeMs * 1000.0 / frames,
+                readMs * 1000.0 / frames,
+                replayMs / frames,
+                static_cast<unsigned long long>(HashSceneState(scene)));
+}
+
+// The window's per-frame CPU work for a 10k instance scene with a key held,
+// phase by phase against the null device, and the heap traffic of a warm frame.
+void BenchFrameUpdate()
+{
+    NullRenderContext device;
+    RenderResources   resources;
+    resources.constantBuffer = device.CreateBuffer(sizeof(ConstantBuffer));
+    resources.instanceBuffer = device.CreateBuffer(sizeof(InstanceData) * resources.instanceCapacity);
+
+    ConstantArena arena;
+    InitConstantArena(arena, device.CreateBuffer(1 << 16), 1 << 16, false);
+    resources.constantArena = &arena;
+
+    SceneState    scene;
+    KeyFrameInput input;
+    DrawBucket    bucket;
+    scene.requestedInstanceCount = 10000;
+    input.heldFraction['D']      = 1.f;
+
+    // warm-up: layout, grid and every vector's capacity
+    BeginConstantArenaFrame(arena, 1, 0);
+    UpdateSceneInput(scene, input, 1.f / 60.f);
+    UploadScene(device, resources, scene);
+    RenderScene(device, resources, scene.cpuConstantData, scene.drawnInstances, bucket);
+    EndConstantArenaFrame(arena);
+
+    // each phase's fastest sample of 50 frames
+    const int frames      = 500;
+    const int perSample   = frames / kBenchRepetitions;
+    double    updateMs    = 1e30;
+    double    uploadMs    = 1e30;
+    double    renderMs    = 1e30;
+    int       frame       = 0;
+    uint64_t  allocations = HeapAllocationCount();
+    uint64_t  bytes       = HeapAllocatedBytes();
+    for (int sample = 0; sample < kBenchRepetitions; ++sample)
+    {
+        double update = 0.0;
+        double upload = 0.0;
+        double render = 0.0;
+        for (int i = 0; i < perSample; ++i, ++frame)
+        {
+            auto t0 = BenchClock::now();
+            UpdateSceneInput(scene, input, 1.f / 60.f);
+            auto t1 = BenchClock::now();
+            UploadScene(device, resources, scene);
+            auto t2 = BenchClock::now();
+            BeginConstantArenaFrame(arena, frame + 2, frame);
+            RenderScene(device, resources, scene.cpuConstantData, scene.drawnInstances, bucket);
+            EndConstantArenaFrame(arena);
+            auto t3 = BenchClock::now();
+            device.EndFrame();
+
+            update += std::chrono::duration<double, std::milli>(t1 - t0).count();
+            upload += std::chrono::duration<double, std::milli>(t2 - t1).count();
+            render += std::chrono::duration<double, std::milli>(t3 - t2).count();
+        }
+        updateMs = std::min(updateMs, update / perSample);
+        uploadMs = std::min(uploadMs, upload / perSample);
+        renderMs = std::min(renderMs, render / perSample);
+    }
+    double allocationsPerFrame = static_cast<double>(HeapAllocationCount() - allocations) / frames;
+    double bytesPerFrame       = static_cast<double>(HeapAllocatedBytes() - bytes) / frames;
+
+    std::printf("frame update      %zu instances  update %.4f ms  upload %.4f ms  render %.4f ms  heap %.1f allocations %.0f bytes per frame\n",
+                SceneInstanceCount(scene),
+                updateMs,
+                uploadMs,
+                renderMs,
+                allocationsPerFrame,
+                bytesPerFrame);
+
+    AddBenchMetric(g_report, "frame.update_ms", updateMs, "ms");
+    AddBenchMetric(g_report, "frame.upload_ms", uploadMs, "ms");
+    AddBenchMetric(g_report, "frame.render_ms", renderMs, "ms");
+    AddBenchMetric(g_report, "frame.allocations", allocationsPerFrame, "count");
+    AddBenchMetric(g_report, "frame.allocated_bytes", bytesPerFrame, "bytes");
+}
+
+// Many objects with their own world matrix: a discard map per draw on one
+// constant buffer against the arena's single map and offset binds. A null
+// device map costs nothing, so this is only the CPU side; the per-map driver
+// rename the arena avoids does not show here.
+void BenchConstantArena()
+{
+    const int      frames  = 200;
+    const uint32_t objects = 2000;
+
+    NullRenderContext device;
+    RenderHandle      perDraw = device.CreateBuffer(sizeof(ConstantBuffer));
+
+    ConstantArena arena;
+    InitConstantArena(arena, device.CreateBuffer(objects * kConstantBufferAlignment * 3), objects * kConstantBufferAlignment * 3, false);
+
+    std::vector<ConstantBuffer> constants(objects);
+    for (uint32_t i = 0; i < objects; ++i)
+    {
+        constants[i].world[0]  = 1.f;
+        constants[i].world[12] = static_cast<float>(i);
+    }
+
+    const int perSample = frames / kBenchRepetitions;
+    double    perDrawMs = FastestOf([&]() {
+        auto begin = BenchClock::now();
+        for (int frame = 0; frame < perSample; ++frame)
+        {
+            for (uint32_t i = 0; i < objects; ++i)
+            {
+                UpdateConstantBuffer(device, perDraw, &constants[i], sizeof(ConstantBuffer));
+                device.SetVSConstantBuffer(0, perDraw);
+                device.DrawIndexed(3, 0, 0);
+            }
+            device.EndFrame();
+        }
+        return std::chrono::duration<double, std::milli>(BenchClock::now() - begin).count() / perSample;
+    });
+    uint64_t perDrawMaps = device.total.maps / frames;
+    device.total         = {};
+
+    std::vector<uint32_t> offsets(objects);
+    int                   frame   = 0;
+    double                arenaMs = FastestOf([&]() {
+        auto begin = BenchClock::now();
+        for (int i = 0; i < perSample; ++i, ++frame)
+        {
+            // two frames in flight
+            BeginConstantArenaFrame(arena, frame + 1, frame > 1 ? frame - 1 : 0);
+            for (uint32_t j = 0; j < objects; ++j)
+                offsets[j] = PushConstants(arena, &constants[j], sizeof(ConstantBuffer));
+            FlushConstantArena(arena, device);
+            for (uint32_t j = 0; j < objects; ++j)
+            {
+                device.SetVSConstantBufferRange(0, ConstantArenaRange(arena, offsets[j], sizeof(ConstantBuffer)));
+                device.DrawIndexed(3, 0, 0);
+            }
+            EndConstantArenaFrame(arena);
+            device.EndFrame();
+        }
+        return std::chrono::duration<double, std::milli>(BenchClock::now() - begin).count() / perSample;
+    });
+
+    std::printf("constant arena    %u draws  per-draw map %.4f ms (%llu maps)  arena %.4f ms (%.0f maps, %.0f KB, %llu full) per frame\n",
+                objects,
+                perDrawMs,
+                static_cast<unsigned long long>(perDrawMaps),
+                arenaMs,
+                static_cast<double>(arena.total.maps) / frames,
+                static_cast<double>(arena.total.bytes) / frames / 1024.0,
+                static_cast<unsigned long long>(arena.total.full));
+
+    AddBenchMetric(g_report, "constant_arena.per_draw_ms", perDrawMs, "ms");
+    AddBenchMetric(g_report, "constant_arena.arena_ms", arenaMs, "ms");
+    AddBenchMetric(g_report, "constant_arena.maps_per_frame", static_cast<double>(arena.total.maps) / frames, "maps");
+}
+
+// The UI's frame statistics over a full 1024 frame history: a sorted copy on
+// the heap against one from the frame scratch.
+void BenchFrameAllocator()
+{
+    FrameTimer timer;
+    InitFrameTimer(timer, 1024);
+    for (int i = 0; i < 1024; ++i)
+        RecordFrameTime(timer, 1'000'000 + (i * 7919) % 500'000);
+
+    LinearAllocator scratch;
+    InitLinearAllocator(scratch, 64 * 1024);
+
+    const int iterations  = 2000;
+    uint64_t  allocations = HeapAllocationCount();
+    double    heapMs      = MeasureMs(iterations, [&] { g_benchSink = g_benchSink + static_cast<float>(ComputeFrameTimeStats(timer).p99Ms); });
+    double    heapCount   = static_cast<double>(HeapAllocationCount() - allocations) / (iterations + 1);
+
+    allocations      = HeapAllocationCount();
+    double scratchMs = MeasureMs(iterations,
+                                 [&]
+                                 {
+                                     ResetLinearAllocator(scratch);
+                                     g_benchSink = g_benchSink + static_cast<float>(ComputeFrameTimeStats(timer, scratch).p99Ms);
+                                 });
+    double scratchCount = static_cast<double>(HeapAllocationCount() - allocations) / (iterations + 1);
+
+    std::printf("frame allocator   1024 frame stats  heap %.4f ms (%.1f allocations)  scratch %.4f ms (%.1f allocations)\n", heapMs, heapCount, scratchMs, scratchCount);
+
+    AddBenchMetric(g_report, "frame_allocator.stats_heap_ms", heapMs, "ms");
+    AddBenchMetric(g_report, "frame_allocator.stats_scratch_ms", scratchMs, "ms");
+    AddBenchMetric(g_report, "frame_allocator.stats_scratch_allocations", scratchCount, "count");
+}
+
+// Spin plus packing of 1M instances split over 1..N threads, and the cost of
+// a job that does nothing.
+void BenchJobSystem()
+{
+    const uint32_t count = 1000000;
+
+    InstanceTransforms transforms;
+    LayoutInstanceGrid(transforms, count, 1.f);
+    std::vector<InstanceData> packed(count);
+
+    uint32_t hardware = std::max(1u, std::thread::hardware_concurrency());
+    double   singleMs = 0.0;
+    for (uint32_t threads = 1;; threads = std::min(threads * 2, hardware))
+    {
+        JobSystem jobs;
+        StartJobSystem(jobs, threads);
+
+        double ms = MeasureMs(20, [&]() {
+            ParallelFor(jobs, count, 8192, [&](uint32_t begin, uint32_t end) { RotateInstanceRange(transforms, begin, end - begin, 0.001f); });
+            ParallelFor(jobs, count, 2048, [&](uint32_t begin, uint32_t end) { PackInstances(transforms, begin, end - begin, packed.data() + begin); });
+            g_benchSink = g_benchSink + packed[count - 1].world[0];
+        });
+        if (threads == 1)
+            singleMs = ms;
+
+        std::printf("job system        %2u threads  spin+pack %u  %8.3f ms  speedup %.2fx  steals %llu\n",
+                    threads,
+                    count,
+                    ms,
+                    singleMs / ms,
+                    static_cast<unsigned long long>(JobSteals(jobs)));
+        StopJobSystem(jobs);
+
+        if (threads == 1)
+            AddBenchMetric(g_report, "job_system.pack_1m_1t_ms", ms, "ms");
+        if (threads == hardware)
+        {
+            AddBenchMetric(g_report, "job_system.pack_1m_all_ms", ms, "ms");
+            break;
+        }
+    }
+
+    JobSystem jobs;
+    StartJobSystem(jobs, hardware);
+
+    const uint32_t emptyJobs = 100000;
+    JobFunction    nothing   = [](void*, uint32_t, uint32_t) {};
+    double         ms        = MeasureMs(5, [&]() {
+        JobCounter counter;
+        for (uint32_t i = 0; i < emptyJobs; ++i)
+            SubmitJob(jobs, nothing, nullptr, 0, 1, 0, &counter);
+        WaitForCounter(jobs, counter);
+    });
+    StopJobSystem(jobs);
+
+    std::printf("job system        %2u threads  empty job %.1f ns submit to done\n", hardware, ms * 1e6 / emptyJobs);
+    AddBenchMetric(g_report, "job_system.empty_job_ns", ms * 1e6 / emptyJobs, "ns");
+}
+
+// Startup with 2 critical and 10 deferred shaders of 20 ms each: compiled one
+// after another, against the builder's wait for the critical ones and for all.
+void BenchAsyncShaders()
+{
+    const int latencyMs = 20;
+    const int critical  = 2;
+    const int total     = 12;
+
+    const char           source[] = "float4 main() : SV_TARGET { return 1; }";
+    std::string          names[total];
+    ShaderCompileRequest requests[total];
+    for (int i = 0; i < total; ++i)
+    {
+        names[i]               = "entry" + std::to_string(i);
+        requests[i].source     = source;
+        requests[i].sourceSize = sizeof(source) - 1;
+        requests[i].entryPoint = names[i].c_str();
+        requests[i].target     = "ps_5_0";
+    }
+
+    LatencyShaderCompiler compiler;
+    compiler.latencyMs = latencyMs;
+
+    uint64_t             begin = NowNanoseconds();
+    std::vector<uint8_t> bytecode;
+    std::string          errors;
+    for (const ShaderCompileRequest& request : requests)
+        compiler.Compile(request, bytecode, errors);
+    double sequentialMs = (NowNanoseconds() - begin) / 1e6;
+
+    const uint32_t     threads = 4;
+    AsyncShaderBuilder builder;
+    begin = NowNanoseconds();
+    StartShaderBuilder(builder, compiler, nullptr, threads);
+    for (int i = 0; i < total; ++i)
+        QueueShaderBuild(builder, names[i].c_str(), requests[i], i < critical, nullptr, nullptr);
+    WaitForCriticalShaders(builder);
+    double criticalMs = (NowNanoseconds() - begin) / 1e6;
+    StopShaderBuilder(builder);
+    double allMs = (NowNanoseconds() - begin) / 1e6;
+
+    std::printf("async shaders     %d x %d ms  sequential %7.2f ms  first frame after %6.2f ms  all ready %6.2f ms (%u threads)\n",
+                total,
+                latencyMs,
+                sequentialMs,
+                criticalMs,
+                allMs,
+                threads);
+    AddBenchMetric(g_report, "async_shaders.sequential_ms", sequentialMs, "ms");
+    AddBenchMetric(g_report, "async_shaders.critical_ms", criticalMs, "ms");
+    AddBenchMetric(g_report, "async_shaders.all_ms", allMs, "ms");
+
+    // the builder's own cost per build: queue, hand-off, wake-up, collect
+    const int builds     = 2000;
+    compiler.latencyMs   = 0;
+    double    perBuildUs = FastestOf([&]() {
+        uint64_t start = NowNanoseconds();
+        StartShaderBuilder(builder, compiler, nullptr, threads);
+        for (int i = 0; i < builds; ++i)
+            QueueShaderBuild(builder, "overhead", requests[i % total], false, nullptr, nullptr);
+        StopShaderBuilder(builder);
+        return (NowNanoseconds() - start) / 1e3 / builds;
+    });
+
+    std::printf("async shaders     %d empty builds  %.2f us each\n", builds, perBuildUs);
+    AddBenchMetric(g_report, "async_shaders.build_overhead_us", perBuildUs, "us");
+}
+
+// `count` nodes with `fanout` children per node, depth-first.
+void AddWideTransformTree(TransformGraph& graph, uint32_t parent, uint32_t levels, uint32_t fanout, uint32_t& budget)
+{
+    if (budget == 0)
+        return;
+
+    --budget;
+    uint32_t node = AddTransformNode(graph, parent, 0.01f, 0.02f, 1.f, 1.f, 0.1f);
+    if (levels > 1)
+    {
+        for (uint32_t i = 0; i < fanout && budget > 0; ++i)
+            AddWideTransformTree(graph, node, levels - 1, fanout, budget);
+    }
+}
+
+// Update plus upload per frame of wide (fan-out 16) and deep (chains of 256
+// below one root) hierarchies, with a share of random nodes edited each frame.
+void BenchTransformGraph()
+{
+    const uint32_t sizes[]  = { 10000, 100000, 1000000 };
+    const double   shares[] = { 0.0, 0.0001, 0.01, 0.1, 1.0 };
+    const char*    labels[] = { "static", "0.01pct", "1pct", "10pct", "full" };
+
+    for (int shape = 0; shape < 2; ++shape)
+    {
+        for (uint32_t count : sizes)
+        {
+            TransformGraph graph;
+            ReserveTransformGraph(graph, count);
+            if (shape == 0)
+            {
+                uint32_t budget = count;
+                AddWideTransformTree(graph, kNoTransformNode, 6, 16, budget);
+            }
+            else
+            {
+                uint32_t root = AddTransformNode(graph, kNoTransformNode, 0.f, 0.f, 1.f, 1.f, 0.f);
+                for (uint32_t parent = root; TransformNodeCount(graph) < count;)
+                    parent = TransformNodeCount(graph) % 256 == 1 ? AddTransformNode(graph, root, 0.01f, 0.f, 1.f, 1.f, 0.01f) : AddTransformNode(graph, parent, 0.01f, 0.f, 1.f, 1.f, 0.01f);
+            }
+            UpdateTransformGraph(graph);
+
+            NullRenderContext device;
+            RenderHandle      buffer = device.CreateBuffer(count * sizeof(InstanceData));
+
+            std::mt19937 random(count);
+            for (size_t s = 0; s < std::size(shares); ++s)
+            {
+                std::vector<uint32_t> edits(static_cast<size_t>(shares[s] * count));
+                for (uint32_t& node : edits)
+                    node = random() % count;
+                if (shares[s] == 1.0)
+                    std::iota(edits.begin(), edits.end(), 0u);
+
+                float    angle   = 0.f;
+                uint64_t updated = 0;
+                int      calls   = 0;
+                device.total     = {};
+                device.frame     = {};
+                int    frames    = count >= 1000000 ? 5 : 20;
+                double ms        = MeasureMs(frames, [&]() {
+                    ++calls;
+                    angle += 0.001f;
+                    for (uint32_t node : edits)
+                        SetTransformLocal(graph, node, graph.local.positionX[node], graph.local.positionY[node], 1.f, 1.f, angle);
+                    UpdateTransformGraph(graph);
+                    UploadTransformGraph(device, buffer, graph);
+                    updated += graph.stats.updatedNodes;
+                    device.EndFrame();
+                });
+
+                std::printf("transform graph   %-4s %7u  %-8s  %8.3f ms  %9.0f nodes  %9.1f KB up in %5.0f copies\n",
+                            shape == 0 ? "wide" : "deep",
+                            count,
+                            labels[s],
+                            ms,
+                            static_cast<double>(updated) / calls,
+                            static_cast<double>(device.total.bytesUploaded) / calls / 1024.0,
+                            static_cast<double>(device.total.updates) / calls);
+
+                // a static frame is below the timer's resolution; what it must
+                // not do is recompute or upload anything
+                char name[64];
+                if (count == 1000000 && s == 0)
+                {
+                    std::snprintf(name, sizeof(name), "transform_graph.%s_1m_static_nodes", shape == 0 ? "wide" : "deep");
+                    AddBenchMetric(g_report, name, static_cast<double>(updated) / calls, "count");
+                    std::snprintf(name, sizeof(name), "transform_graph.%s_1m_static_bytes", shape == 0 ? "wide" : "deep");
+                    AddBenchMetric(g_report, name, static_cast<double>(device.total.bytesUploaded) / calls, "bytes");
+                }
+                if (count == 1000000 && (s == 2 || s == 4))
+                {
+                    std::snprintf(name, sizeof(name), "transform_graph.%s_1m_%s_ms", shape == 0 ? "wide" : "deep", labels[s]);
+                    AddBenchMetric(g_report, name, ms, "ms");
+                }
+            }
+        }
+    }
+}
+
+int main(int argc, char** argv)
+{
+    const char* imageDir     = nullptr;
+    const char* jsonPath     = nullptr;
+    const char* baselinePath = nullptr;
+    double      threshold    = 0.1;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg      = argv[i];
+        bool        hasValue = i + 1 < argc;
+        if (arg == "--images" && hasValue)
+            imageDir = argv[++i];
+        else if (arg == "--json" && hasValue)
+            jsonPath = argv[++i];
+        else if (arg == "--baseline" && hasValue)
+            baselinePath = argv[++i];
+        else if (arg == "--threshold" && hasValue)
+            threshold = std::atof(argv[++i]);
+        else
+        {
+            std::fprintf(stderr, "unknown option %s\n", argv[i]);
+            return 1;
+        }
+    }
+
+    BenchAffineKernels();
+    BenchInstancePacking();
+    BenchFrameUpdate();
+    BenchProfiler();
+    BenchShaderCache();
+    BenchStateTracking();
+    BenchDrawBucket();
+    BenchPrimitiveBatcher();
+    BenchVertexFormats();
+    BenchMeshFile();
+    BenchMeshOptimizer();
+    BenchSpatialGrid();
+    BenchInputEvents();
+    BenchFramePacer();
+    BenchDynamicResolution();
+    BenchInputCapture();
+    BenchConstantArena();
+    BenchFrameAllocator();
+    BenchJobSystem();
+    BenchAsyncShaders();
+    BenchTransformGraph();
+    BenchSoftwareRasterizer(imageDir);
+
+    if (jsonPath && !WriteBenchReportJSON(g_report, jsonPath))
+    {
+        std::fprintf(stderr, "failed to write %s\n", jsonPath);
+        return 1;
+    }
+
+    if (baselinePath)
+    {
+        BenchReport baseline;
+        if (!ReadBenchReportJSON(baseline, baselinePath))
+        {
+            std::fprintf(stderr, "failed to read %s\n", baselinePath);
+            return 1;
+        }
+
+        std::vector<BenchRegression> regressions = CompareBenchReports(baseline, g_report, threshold);
+        for (const BenchRegression& r : regressions)
+            std::printf("REGRESSION        %-40s %.4g -> %.4g (+%.1f%%)\n", r.name.c_str(), r.baseline, r.current, r.baseline > 0.0 ? 100.0 * (r.current / r.baseline - 1.0) : 100.0);
+        std::printf("baseline          %s  %zu metrics, %zu more than %.0f%% over\n", baselinePath, g_report.metrics.size(), regressions.size(), threshold * 100.0);
+        if (!regressions.empty())
+            return 2;
+    }
+    return 0;
+}
@@ -0,0 +1,143 @@
+#include "ConstantArena.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+    uint32_t AlignConstants(uint32_t size)
+    {
+        return (size + kConstantBufferAlignment - 1) & ~(kConstantBufferAlignment - 1);
+    }
+}   // namespace
+
+void AccumulateConstantArenaStats(ConstantArenaStats& total, const ConstantArenaStats& frame)
+{
+    total.blocks += frame.blocks;
+    total.bytes += frame.bytes;
+    total.maps += frame.maps;
+    total.wraps += frame.wraps;
+    total.full += frame.full;
+}
+
+void InitConstantArena(ConstantArena& arena, RenderHandle buffer, uint32_t capacity, bool discardEachFrame)
+{
+    arena                  = ConstantArena {};
+    arena.buffer           = buffer;
+    arena.capacity         = capacity & ~(kConstantBufferAlignment - 1);
+    arena.discardEachFrame = discardEachFrame;
+    arena.staging.reserve(arena.capacity);
+    arena.inFlight.reserve(8);
+}
+
+void BeginConstantArenaFrame(ConstantArena& arena, uint64_t frame, uint64_t completedFrame)
+{
+    size_t retired = 0;
+    while (retired < arena.inFlight.size() && arena.inFlight[retired].frame <= completedFrame)
+        arena.used -= arena.inFlight[retired++].bytes;
+    arena.inFlight.erase(arena.inFlight.begin(), arena.inFlight.begin() + retired);
+
+    // the first discard of the frame gives the driver a fresh buffer
+    if (arena.discardEachFrame)
+    {
+        arena.inFlight.clear();
+        arena.head = 0;
+        arena.used = 0;
+    }
+
+    arena.frameIndex   = frame;
+    arena.frameBytes   = 0;
+    arena.segmentCount = 0;
+    arena.flushed      = 0;
+    arena.staging.clear();
+}
+
+uint32_t PushConstants(ConstantArena& arena, const void* data, uint32_t size)
+{
+    uint32_t aligned = AlignConstants(std::max(size, 1u));
+    bool     wrap    = arena.head + aligned > arena.capacity;
+    uint32_t padding = wrap ? arena.capacity - arena.head : 0;
+    if (arena.used + padding + aligned > arena.capacity || (wrap && arena.segmentCount == 2))
+    {
+        ++arena.frame.full;
+        return kConstantArenaFull;
+    }
+
+    if (wrap)
+    {
+        arena.used += padding;
+        arena.frameBytes += padding;
+        arena.head = 0;
+        ++arena.frame.wraps;
+    }
+
+    if (arena.segmentCount == 0 || wrap)
+    {
+        ConstantArena::Segment& segment = arena.segments[arena.segmentCount++];
+        segment.offset                  = arena.head;
+        segment.staging                 = static_cast<uint32_t>(arena.staging.size());
+        segment.size                    = 0;
+    }
+
+    size_t at = arena.staging.size();
+    arena.staging.resize(at + aligned);   // zero fills the padding
+    std::memcpy(arena.staging.data() + at, data, size);
+    arena.segments[arena.segmentCount - 1].size += aligned;
+
+    uint32_t offset = arena.head;
+    arena.head += aligned;
+    arena.used += aligned;
+    arena.frameBytes += aligned;
+    ++arena.frame.blocks;
+    return offset;
+}
+
+ConstantRange ConstantArenaRange(const ConstantArena& arena, uint32_t offset, uint32_t size)
+{
+    ConstantRange range;
+    range.buffer = arena.buffer;
+    range.offset = offset;
+    range.size   = AlignConstants(size);
+    return range;
+}
+
+bool FlushConstantArena(ConstantArena& arena, IRenderContext& context)
+{
+    uint32_t end = static_cast<uint32_t>(arena.staging.size());
+    if (arena.flushed == end)
+        return true;
+
+    uint32_t begin = arena.discardEachFrame ? 0 : arena.flushed;
+    MapMode  mode  = arena.discardEachFrame || !arena.mappedOnce ? MapMode::WriteDiscard : MapMode::WriteNoOverwrite;
+
+    uint8_t* mapped = static_cast<uint8_t*>(context.Map(arena.buffer, mode));
+    if (!mapped)
+        return false;
+
+    for (uint32_t i = 0; i < arena.segmentCount; ++i)
+    {
+        const ConstantArena::Segment& segment = arena.segments[i];
+
+        uint32_t from = std::max(begin, segment.staging);
+        uint32_t to   = std::min(end, segment.staging + segment.size);
+        if (from < to)
+            std::memcpy(mapped + segment.offset + (from - segment.staging), arena.staging.data() + from, to - from);
+    }
+
+    context.Unmap(arena.buffer, end - begin);
+
+    arena.flushed    = end;
+    arena.mappedOnce = true;
+    arena.frame.bytes += end - begin;
+    ++arena.frame.maps;
+    return true;
+}
+
+void EndConstantArenaFrame(ConstantArena& arena)
+{
+    if (arena.frameBytes > 0 && !arena.discardEachFrame)
+        arena.inFlight.push_back(ConstantArena::FrameInFlight { arena.frameIndex, arena.frameBytes });
+
+    AccumulateConstantArenaStats(arena.total, arena.frame);
+    arena.frame = {};
+}
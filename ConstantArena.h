@@ -0,0 +1,89 @@
+#pragma once
+
+#include "RenderContext.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+constexpr uint32_t kConstantArenaFull = UINT32_MAX;
+
+struct ConstantArenaStats
+{
+    uint64_t blocks = 0;   // PushConstants that got a block
+    uint64_t bytes  = 0;   // copied into the buffer by flushes
+    uint64_t maps   = 0;
+    uint64_t wraps  = 0;   // the ring went back to offset 0
+    uint64_t full   = 0;   // pushes refused because frames in flight still own the space
+};
+
+void AccumulateConstantArenaStats(ConstantArenaStats& total, const ConstantArenaStats& frame);
+
+// Per-draw constants suballocated from one large dynamic constant buffer used
+// as a ring. Blocks are kConstantBufferAlignment aligned and staged on the CPU,
+// a flush copies everything staged since the last one under a single
+// WriteNoOverwrite map, and draws bind their block by offset
+// (SetVSConstantBufferRange). A frame's bytes are reused only after the caller
+// reports that frame complete on the GPU, e.g. from an event query.
+//
+// Without NO_OVERWRITE maps on constant buffers (pre-11.1 drivers),
+// discardEachFrame restarts the ring at 0 every frame and flushes with
+// WriteDiscard, re-copying the whole frame so earlier blocks survive the rename.
+struct ConstantArena
+{
+    RenderHandle buffer           = nullptr;
+    uint32_t     capacity         = 0;   // bytes, a multiple of kConstantBufferAlignment
+    bool         discardEachFrame = false;
+
+    ConstantArenaStats frame;
+    ConstantArenaStats total;
+
+    // ring: `used` bytes up to `head` belong to frames in flight and the open one
+    uint32_t head       = 0;
+    uint32_t used       = 0;   // wrap padding included
+    uint64_t frameIndex = 0;
+    uint32_t frameBytes = 0;
+    bool     mappedOnce = false;
+
+    struct FrameInFlight
+    {
+        uint64_t frame = 0;
+        uint32_t bytes = 0;
+    };
+    std::vector<FrameInFlight> inFlight;   // oldest first
+
+    // The open frame's blocks in push order, and where they go in the ring:
+    // a frame wraps at most once, so at most two contiguous segments.
+    struct Segment
+    {
+        uint32_t offset  = 0;   // in the buffer
+        uint32_t staging = 0;   // in `staging`
+        uint32_t size    = 0;
+    };
+    std::vector<uint8_t> staging;
+    Segment              segments[2];
+    uint32_t             segmentCount = 0;
+    uint32_t             flushed      = 0;   // staging bytes already in the buffer
+};
+
+void InitConstantArena(ConstantArena& arena, RenderHandle buffer, uint32_t capacity, bool discardEachFrame);
+
+// Frames are numbered from 1; completedFrame is the newest one the GPU has
+// finished (0 for none). Releases the space of every completed frame.
+void BeginConstantArenaFrame(ConstantArena& arena, uint64_t frame, uint64_t completedFrame);
+
+// Stages `size` bytes (zero padded to the alignment) and returns their offset
+// in the buffer, or kConstantArenaFull when the ring has no room left; the
+// caller falls back to its own buffer or waits for the GPU.
+uint32_t PushConstants(ConstantArena& arena, const void* data, uint32_t size);
+
+// Range binding for a block returned by PushConstants.
+ConstantRange ConstantArenaRange(const ConstantArena& arena, uint32_t offset, uint32_t size);
+
+// Copies the blocks pushed since the last flush into the buffer with one map.
+// Call before the draws that use them are submitted.
+bool FlushConstantArena(ConstantArena& arena, IRenderContext& context);
+
+// Hands the frame's space to the GPU until it is reported complete, and folds
+// `frame` into `total`.
+void EndConstantArenaFrame(ConstantArena& arena);
@@ -0,0 +1,166 @@
+#include "D3D11RenderContext.h"
+#include "framework.h"
+
+void D3D11RenderContext::SetInputLayout(RenderHandle layout)
+{
+    context->IASetInputLayout(static_cast<ID3D11InputLayout*>(layout));
+}
+
+void D3D11RenderContext::SetPrimitiveTopology(PrimitiveTopology topology)
+{
+    switch (topology)
+    {
+        case PrimitiveTopology::TriangleList:
+            context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+            break;
+        case PrimitiveTopology::LineList:
+            context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_LINELIST);
+            break;
+    }
+}
+
+void D3D11RenderContext::SetVertexBuffers(uint32_t startSlot, uint32_t count, const RenderHandle* buffers, const uint32_t* strides, const uint32_t* offsets)
+{
+    ID3D11Buffer* d3dBuffers[D3D11_IA_VERTEX_INPUT_RESOURCE_SLOT_COUNT] = {};
+    for (uint32_t i = 0; i < count; ++i)
+        d3dBuffers[i] = static_cast<ID3D11Buffer*>(buffers[i]);
+
+    context->IASetVertexBuffers(startSlot, count, d3dBuffers, strides, offsets);
+}
+
+void D3D11RenderContext::SetIndexBuffer(RenderHandle buffer, IndexFormat format, uint32_t offset)
+{
+    context->IASetIndexBuffer(
+        static_cast<ID3D11Buffer*>(buffer),
+        format == IndexFormat::UInt16 ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT,
+        offset);
+}
+
+void D3D11RenderContext::SetVertexShader(RenderHandle shader)
+{
+    context->VSSetShader(static_cast<ID3D11VertexShader*>(shader), nullptr, 0);
+}
+
+void D3D11RenderContext::SetVSConstantBuffer(uint32_t slot, RenderHandle buffer)
+{
+    ID3D11Buffer* d3dBuffer = static_cast<ID3D11Buffer*>(buffer);
+    context->VSSetConstantBuffers(slot, 1, &d3dBuffer);
+}
+
+void D3D11RenderContext::SetVSConstantBufferRange(uint32_t slot, const ConstantRange& range)
+{
+    if (range.size == 0 || !context1)
+    {
+        SetVSConstantBuffer(slot, range.buffer);
+        return;
+    }
+
+    // in 16-byte constants
+    ID3D11Buffer* d3dBuffer     = static_cast<ID3D11Buffer*>(range.buffer);
+    UINT          firstConstant = range.offset / 16;
+    UINT          numConstants  = range.size / 16;
+    context1->VSSetConstantBuffers1(slot, 1, &d3dBuffer, &firstConstant, &numConstants);
+}
+
+void D3D11RenderContext::SetViewport(const RenderViewport& viewport)
+{
+    D3D11_VIEWPORT d3dViewport = {
+        viewport.x,
+        viewport.y,
+        viewport.width,
+        viewport.height,
+        viewport.minDepth,
+        viewport.maxDepth
+    };
+    context->RSSetViewports(1, &d3dViewport);
+}
+
+void D3D11RenderContext::SetPixelShader(RenderHandle shader)
+{
+    context->PSSetShader(static_cast<ID3D11PixelShader*>(shader), nullptr, 0);
+}
+
+void D3D11RenderContext::SetRenderTarget(RenderHandle view)
+{
+    ID3D11RenderTargetView* rtv = static_cast<ID3D11RenderTargetView*>(view);
+    context->OMSetRenderTargets(1, &rtv, nullptr);
+}
+
+void D3D11RenderContext::ClearRenderTarget(RenderHandle view, const float color[4])
+{
+    context->ClearRenderTargetView(static_cast<ID3D11RenderTargetView*>(view), color);
+}
+
+void* D3D11RenderContext::Map(RenderHandle buffer, MapMode mode)
+{
+    D3D11_MAPPED_SUBRESOURCE mappedResource;
+    HRESULT                  hr = context->Map(
+        static_cast<ID3D11Buffer*>(buffer),
+        0,
+        mode == MapMode::WriteNoOverwrite ? D3D11_MAP_WRITE_NO_OVERWRITE : D3D11_MAP_WRITE_DISCARD,
+        0,
+        &mappedResource);
+
+    if (FAILED(hr))
+    {
+        OutputDebugStringA("Map Fail\n");
+        return nullptr;
+    }
+
+    return mappedResource.pData;
+}
+
+void D3D11RenderContext::Unmap(RenderHandle buffer, size_t)
+{
+    context->Unmap(static_cast<ID3D11Buffer*>(buffer), 0);
+}
+
+void D3D11RenderContext::UpdateBuffer(RenderHandle buffer, size_t offset, const void* data, size_t size)
+{
+    D3D11_BOX box = {};
+    box.left      = static_cast<UINT>(offset);
+    box.right     = static_cast<UINT>(offset + size);
+    box.bottom    = 1;
+    box.back      = 1;
+    context->UpdateSubresource(static_cast<ID3D11Buffer*>(buffer), 0, &box, data, 0, 0);
+}
+
+void D3D11RenderContext::DrawIndexed(uint32_t indexCount, uint32_t startIndex, int32_t baseVertex)
+{
+    context->DrawIndexed(indexCount, startIndex, baseVertex);
+}
+
+void D3D11RenderContext::DrawIndexedInstanced(uint32_t indexCount, uint32_t instanceCount, uint32_t startIndex, int32_t baseVertex, uint32_t startInstance)
+{
+    context->DrawIndexedInstanced(indexCount, instanceCount, startIndex, baseVertex, startInstance);
+}
+
+void BuildInputElements(const VertexLayout& layout, D3D11_INPUT_ELEMENT_DESC* out)
+{
+    for (uint32_t i = 0; i < layout.elementCount; ++i)
+    {
+        const VertexElement& element = layout.elements[i];
+
+        DXGI_FORMAT format = DXGI_FORMAT_UNKNOWN;
+        switch (element.format)
+        {
+            case VertexElementFormat::Float2:
+                format = DXGI_FORMAT_R32G32_FLOAT;
+                break;
+            case VertexElementFormat::Float3:
+                format = DXGI_FORMAT_R32G32B32_FLOAT;
+                break;
+            case VertexElementFormat::Half2:
+                format = DXGI_FORMAT_R16G16_FLOAT;
+                break;
+            case VertexElementFormat::Snorm16x2:
+                format = DXGI_FORMAT_R16G16_SNORM;
+                break;
+            case VertexElementFormat::Unorm8x4:
+                format = DXGI_FORMAT_R8G8B8A8_UNORM;
+                break;
+        }
+
+        out[i] = { element.semantic, element.semanticIndex, format, 0, element.offset, D3D11_INPUT_PER_VERTEX_DATA, 0 };
+    }
+}
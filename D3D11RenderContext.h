@@ -0,0 +1,35 @@
+#pragma once
+
+#include "RenderContext.h"
+#include "VertexFormat.h"
+
+#include <d3d11_1.h>
+
+// IRenderContext over an immediate ID3D11DeviceContext. Handles are raw ID3D11* pointers.
+struct D3D11RenderContext : IRenderContext
+{
+    ID3D11DeviceContext*  context  = nullptr;
+    ID3D11DeviceContext1* context1 = nullptr;   // D3D11.1, for constant buffer ranges; may be null
+
+    void SetInputLayout(RenderHandle layout) override;
+    void SetPrimitiveTopology(PrimitiveTopology topology) override;
+    void SetVertexBuffers(uint32_t startSlot, uint32_t count, const RenderHandle* buffers, const uint32_t* strides, const uint32_t* offsets) override;
+    void SetIndexBuffer(RenderHandle buffer, IndexFormat format, uint32_t offset) override;
+    void SetVertexShader(RenderHandle shader) override;
+    void SetVSConstantBuffer(uint32_t slot, RenderHandle buffer) override;
+    void SetVSConstantBufferRange(uint32_t slot, const ConstantRange& range) override;
+    void SetViewport(const RenderViewport& viewport) override;
+    void SetPixelShader(RenderHandle shader) override;
+    void SetRenderTarget(RenderHandle view) override;
+    void ClearRenderTarget(RenderHandle view, const float color[4]) override;
+
+    void* Map(RenderHandle buffer, MapMode mode) override;
+    void  Unmap(RenderHandle buffer, size_t bytesWritten) override;
+    void  UpdateBuffer(RenderHandle buffer, size_t offset, const void* data, size_t size) override;
+
+    void DrawIndexed(uint32_t indexCount, uint32_t startIndex, int32_t baseVertex) override;
+    void DrawIndexedInstanced(uint32_t indexCount, uint32_t instanceCount, uint32_t startIndex, int32_t baseVertex, uint32_t startInstance) override;
+};
+
+// Per-vertex input elements of `layout` in slot 0; `out` needs layout.elementCount entries.
+void BuildInputElements(const VertexLayout& layout, D3D11_INPUT_ELEMENT_DESC* out);
@@ -0,0 +1,41 @@
+#include "D3DShaderCompiler.h"
+#include "framework.h"
+
+#include <d3dcompiler.h>
+#include <wrl/client.h>
+
+using Microsoft::WRL::ComPtr;
+
+bool D3DShaderCompiler::Compile(const ShaderCompileRequest& request, std::vector<uint8_t>& bytecode, std::string& errors)
+{
+    // D3D_SHADER_MACRO list, null terminated
+    std::vector<D3D_SHADER_MACRO> macros;
+    macros.reserve(request.defineCount + 1);
+    for (size_t i = 0; i < request.defineCount; ++i)
+        macros.push_back({ request.defines[i].name, request.defines[i].value });
+    macros.push_back({ nullptr, nullptr });
+
+    ComPtr<ID3DBlob> shaderBlob;
+    ComPtr<ID3DBlob> errorBlob;
+    HRESULT          hr = D3DCompile(request.source,
+                            request.sourceSize,
+                            nullptr,
+                            macros.data(),
+                            nullptr,
+                            request.entryPoint,
+                            request.target,
+                            request.flags,
+                            0,
+                            &shaderBlob,
+                            &errorBlob);
+
+    if (errorBlob)
+        errors.assign(static_cast<const char*>(errorBlob->GetBufferPointer()), errorBlob->GetBufferSize());
+
+    if (FAILED(hr))
+        return false;
+
+    const uint8_t* data = static_cast<const uint8_t*>(shaderBlob->GetBufferPointer());
+    bytecode.assign(data, data + shaderBlob->GetBufferSize());
+    return true;
+}
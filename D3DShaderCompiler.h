@@ -0,0 +1,9 @@
+#pragma once
+
+#include "ShaderCache.h"
+
+// IShaderCompiler over D3DCompile. ShaderCompileRequest::flags are D3DCOMPILE_* flags.
+struct D3DShaderCompiler : IShaderCompiler
+{
+    bool Compile(const ShaderCompileRequest& request, std::vector<uint8_t>& bytecode, std::string& errors) override;
+};
@@ -0,0 +1,131 @@
+#include "DrawBucket.h"
+#include "Profiler.h"
+
+#include <algorithm>
+
+uint64_t MakeDrawSortKey(uint32_t pass, uint32_t shaderId, uint32_t bufferId, float depth)
+{
+    float    clamped = std::min(std::max(depth, 0.f), 1.f);
+    uint64_t d       = static_cast<uint64_t>(clamped * 16777215.f);
+
+    return (static_cast<uint64_t>(pass & 0xF) << 60) |
+           (static_cast<uint64_t>(shaderId & 0xFFFF) << 44) |
+           (static_cast<uint64_t>(bufferId & 0xFFFFF) << 24) |
+           d;
+}
+
+void ResetDrawBucket(DrawBucket& bucket, size_t threadCount)
+{
+    bucket.lists.resize(std::max<size_t>(threadCount, 1));
+    for (DrawCommandList& list : bucket.lists)
+        list.commands.clear();
+
+    bucket.sorted.clear();
+}
+
+void SortDrawBucket(DrawBucket& bucket)
+{
+    PROFILE_SCOPE("SortDrawBucket");
+
+    size_t count = 0;
+    for (const DrawCommandList& list : bucket.lists)
+        count += list.commands.size();
+
+    // merge: list order first, so equal keys come out in a deterministic order
+    std::vector<DrawSortEntry>& entries = bucket.sorted;
+    entries.resize(count);
+
+    size_t   next   = 0;
+    uint64_t keyAnd = ~0ull;
+    uint64_t keyOr  = 0;
+    for (uint32_t l = 0; l < bucket.lists.size(); ++l)
+    {
+        const std::vector<DrawCommand>& commands = bucket.lists[l].commands;
+        for (uint32_t i = 0; i < commands.size(); ++i)
+        {
+            uint64_t key    = commands[i].sortKey;
+            entries[next++] = { key, l, i };
+            keyAnd &= key;
+            keyOr |= key;
+        }
+    }
+
+    if (count < 2)
+        return;
+
+    // LSD radix, 8 bits per pass; bytes that are the same in every key are skipped
+    std::vector<DrawSortEntry>& scratch = bucket.scratch;
+    scratch.resize(count);
+
+    uint64_t varying = keyAnd ^ keyOr;
+    for (uint32_t shift = 0; shift < 64; shift += 8)
+    {
+        if (((varying >> shift) & 0xFF) == 0)
+            continue;
+
+        uint32_t offsets[256] = {};
+        for (const DrawSortEntry& e : entries)
+            ++offsets[(e.key >> shift) & 0xFF];
+
+        uint32_t sum = 0;
+        for (uint32_t& offset : offsets)
+        {
+            uint32_t n = offset;
+            offset     = sum;
+            sum += n;
+        }
+
+        for (const DrawSortEntry& e : entries)
+            scratch[offsets[(e.key >> shift) & 0xFF]++] = e;
+
+        entries.swap(scratch);
+    }
+}
+
+void SubmitDrawBucket(const DrawBucket& bucket, IRenderContext& context)
+{
+    PROFILE_SCOPE("SubmitDrawBucket");
+
+    const DrawCommand* prev = nullptr;
+    for (const DrawSortEntry& e : bucket.sorted)
+    {
+        const DrawCommand& cmd = bucket.lists[e.list].commands[e.index];
+
+        if (!prev || prev->inputLayout != cmd.inputLayout)
+            context.SetInputLayout(cmd.inputLayout);
+
+        bool instanced = cmd.vertexBuffers[1] != nullptr;
+
+        bool sameVertexBuffers = prev != nullptr;
+        for (int slot = 0; slot < 2 && sameVertexBuffers; ++slot)
+        {
+            sameVertexBuffers = prev->vertexBuffers[slot] == cmd.vertexBuffers[slot] &&
+                                prev->vertexStrides[slot] == cmd.vertexStrides[slot] &&
+                                prev->vertexOffsets[slot] == cmd.vertexOffsets[slot];
+        }
+        if (!sameVertexBuffers)
+            context.SetVertexBuffers(0, instanced ? 2 : 1, cmd.vertexBuffers, cmd.vertexStrides, cmd.vertexOffsets);
+
+        if (!prev || prev->indexBuffer != cmd.indexBuffer || prev->indexFormat != cmd.indexFormat)
+            context.SetIndexBuffer(cmd.indexBuffer, cmd.indexFormat, 0);
+
+        if (!prev || prev->vertexShader != cmd.vertexShader)
+            context.SetVertexShader(cmd.vertexShader);
+
+        if (!prev ||
+            prev->constants.buffer != cmd.constants.buffer ||
+            prev->constants.offset != cmd.constants.offset ||
+            prev->constants.size != cmd.constants.size)
+            context.SetVSConstantBufferRange(0, cmd.constants);
+
+        if (!prev || prev->pixelShader != cmd.pixelShader)
+            context.SetPixelShader(cmd.pixelShader);
+
+        if (cmd.instanceCount > 0)
+            context.DrawIndexedInstanced(cmd.indexCount, cmd.instanceCount, cmd.startIndex, cmd.baseVertex, cmd.startInstance);
+        else
+            context.DrawIndexed(cmd.indexCount, cmd.startIndex, cmd.baseVertex);
+
+        prev = &cmd;
+    }
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include "RenderContext.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+// One indexed draw with everything it binds. instanceCount == 0 means a plain
+// DrawIndexed; vertexBuffers[1] is the per-instance stream or null.
+struct DrawCommand
+{
+    uint64_t      sortKey;
+    RenderHandle  inputLayout;
+    RenderHandle  vertexShader;
+    RenderHandle  pixelShader;
+    ConstantRange constants;   // VS slot 0
+    RenderHandle  indexBuffer;
+    RenderHandle  vertexBuffers[2];
+    uint32_t      vertexStrides[2];
+    uint32_t      vertexOffsets[2];
+    uint32_t      indexCount;
+    uint32_t      instanceCount;
+    uint32_t      startIndex;
+    int32_t       baseVertex;
+    uint32_t      startInstance;
+    IndexFormat   indexFormat;
+};
+
+static_assert(std::is_trivially_copyable_v<DrawCommand>, "DrawCommand must stay POD");
+
+// 63..60 pass | 59..44 shader | 43..24 buffers | 23..0 depth
+// Ids are caller-assigned and truncated to their field width; depth is
+// clamped to [0, 1] and sorts front to back.
+uint64_t MakeDrawSortKey(uint32_t pass, uint32_t shaderId, uint32_t bufferId, float depth);
+
+// Commands recorded by one thread. Padded so neighbouring lists never share a line.
+struct alignas(64) DrawCommandList
+{
+    std::vector<DrawCommand> commands;
+};
+
+struct DrawSortEntry
+{
+    uint64_t key;
+    uint32_t list;
+    uint32_t index;
+};
+
+struct DrawBucket
+{
+    std::vector<DrawCommandList> lists;   // one per recording thread
+    std::vector<DrawSortEntry>   sorted;   // filled by SortDrawBucket
+    std::vector<DrawSortEntry>   scratch;
+};
+
+// Empties every list (keeping capacity) and sizes the bucket for `threadCount` recorders.
+void ResetDrawBucket(DrawBucket& bucket, size_t threadCount);
+
+// Merges all lists and radix-sorts by key. Stable: equal keys keep list order,
+// then recording order.
+void SortDrawBucket(DrawBucket& bucket);
+
+// Issues the sorted commands, binding only what differs from the previous one.
+// Pass state (render target, viewport, topology) is the caller's job.
+void SubmitDrawBucket(const DrawBucket& bucket, IRenderContext& context);
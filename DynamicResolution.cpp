@@ -0,0 +1,96 @@
+#include "DynamicResolution.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    int LowestLevel(const DynamicResolutionSettings& s)
+    {
+        return std::max(0, static_cast<int>(std::floor((s.maxScale - s.minScale) / s.scaleStep + 1e-3f)));
+    }
+
+    float LevelScale(const DynamicResolutionSettings& s, int level)
+    {
+        return std::max(s.minScale, s.maxScale - level * s.scaleStep);
+    }
+
+    void SetLevel(DynamicResolution& dr, int level)
+    {
+        dr.level       = level;
+        dr.head        = 0;
+        dr.samples     = 0;
+        dr.framesUnder = 0;
+    }
+}   // namespace
+
+void InitDynamicResolution(DynamicResolution& dr, const DynamicResolutionSettings& settings, uint32_t outputWidth, uint32_t outputHeight)
+{
+    dr.settings = settings;
+    dr.window.assign(std::max(settings.windowFrames, 1), 0.f);
+    dr.lowered = 0;
+    dr.raised  = 0;
+    SetLevel(dr, 0);
+    SetDynamicResolutionOutput(dr, outputWidth, outputHeight);
+}
+
+void SetDynamicResolutionOutput(DynamicResolution& dr, uint32_t outputWidth, uint32_t outputHeight)
+{
+    dr.outputWidth  = outputWidth;
+    dr.outputHeight = outputHeight;
+}
+
+bool UpdateDynamicResolution(DynamicResolution& dr, float frameMs)
+{
+    const DynamicResolutionSettings& s = dr.settings;
+
+    dr.window[dr.head] = frameMs;
+    dr.head            = (dr.head + 1) % dr.window.size();
+    dr.samples         = std::min(dr.samples + 1, dr.window.size());
+    if (dr.samples < dr.window.size())
+        return false;
+
+    dr.sorted.assign(dr.window.begin(), dr.window.end());
+    size_t rank = (dr.sorted.size() * 9) / 10;
+    std::nth_element(dr.sorted.begin(), dr.sorted.begin() + rank, dr.sorted.end());
+    float p90 = dr.sorted[rank];
+
+    int lowest = LowestLevel(s);
+    if (p90 > s.budgetMs * s.lowerAbove)
+    {
+        if (dr.level == lowest)
+            return false;
+
+        // cost ~ pixels ~ scale², so the scale that fits is scale * sqrt(budget / p90)
+        float wanted = LevelScale(s, dr.level) * std::sqrt(s.budgetMs * s.lowerAbove / p90);
+        int   steps  = std::max(1, static_cast<int>(std::ceil((LevelScale(s, dr.level) - wanted) / s.scaleStep - 1e-3f)));
+        SetLevel(dr, std::min(dr.level + steps, lowest));
+        ++dr.lowered;
+        return true;
+    }
+
+    if (p90 < s.budgetMs * s.raiseBelow && dr.level > 0)
+    {
+        if (++dr.framesUnder < s.raiseDelay)
+            return false;
+
+        SetLevel(dr, dr.level - 1);
+        ++dr.raised;
+        return true;
+    }
+
+    dr.framesUnder = 0;
+    return false;
+}
+
+float DynamicResolutionScale(const DynamicResolution& dr)
+{
+    return LevelScale(dr.settings, dr.level);
+}
+
+void DynamicRenderSize(const DynamicResolution& dr, uint32_t& width, uint32_t& height)
+{
+    float scale = DynamicResolutionScale(dr);
+    width       = std::max(1u, static_cast<uint32_t>(dr.outputWidth * scale + 0.5f));
+    height      = std::max(1u, static_cast<uint32_t>(dr.outputHeight * scale + 0.5f));
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+struct DynamicResolutionSettings
+{
+    float budgetMs     = 1000.f / 60.f;
+    float minScale     = 0.5f;    // per axis
+    float maxScale     = 1.f;
+    float scaleStep    = 0.1f;
+    float lowerAbove   = 1.f;     // share of the budget the window's p90 may reach
+    float raiseBelow   = 0.8f;    // share of the budget needed as headroom before a step up
+    int   windowFrames = 16;      // frames judged together, refilled after every change
+    int   raiseDelay   = 60;      // consecutive headroom frames before a step up
+};
+
+// Picks the internal render size from recent frame times. The scale moves in
+// settings.scaleStep increments: down as soon as a full window's p90 is over
+// budget (several steps at once when far over, assuming cost follows pixel
+// count), up one step only after raiseDelay frames with headroom. Samples
+// taken at the old size are dropped after a change. Deterministic: the same
+// frame time trace gives the same sizes.
+struct DynamicResolution
+{
+    DynamicResolutionSettings settings;
+
+    int      level        = 0;   // steps below maxScale
+    uint32_t outputWidth  = 0;
+    uint32_t outputHeight = 0;
+
+    std::vector<float> window;   // ring of the last windowFrames frame times
+    std::vector<float> sorted;   // scratch for the percentile
+    size_t             head        = 0;
+    size_t             samples     = 0;
+    int                framesUnder = 0;
+
+    uint64_t lowered = 0;
+    uint64_t raised  = 0;
+};
+
+void InitDynamicResolution(DynamicResolution& dr, const DynamicResolutionSettings& settings, uint32_t outputWidth, uint32_t outputHeight);
+
+// New output (window) size; the scale is kept.
+void SetDynamicResolutionOutput(DynamicResolution& dr, uint32_t outputWidth, uint32_t outputHeight);
+
+// Adds one frame's time; returns true when the render size changed.
+bool UpdateDynamicResolution(DynamicResolution& dr, float frameMs);
+
+float DynamicResolutionScale(const DynamicResolution& dr);
+
+// Output size times the scale, at least 1x1.
+void DynamicRenderSize(const DynamicResolution& dr, uint32_t& width, uint32_t& height);
@@ -1,7 +1,26 @@
 ﻿#include "EntryPoint.h"
+#include "AsyncShaderBuilder.h"
+#include "D3D11RenderContext.h"
+#include "D3DShaderCompiler.h"
+#include "DynamicResolution.h"
+#include "FrameAllocator.h"
+#include "FramePacer.h"
+#include "FrameTimer.h"
+#include "HeapCounter.h"
+#include "InputCapture.h"
+#include "JobSystem.h"
+#include "MeshFile.h"
+#include "PrimitiveBatcher.h"
+#include "Profiler.h"
+#include "Scene.h"
+#include "SimulationThread.h"
+#include "ShaderCache.h"
+#include "StateTrackingContext.h"
+#include "VertexFormat.h"
 #include "framework.h"
 
-#include <chrono>
+#include <algorithm>
+#include <cfloat>
 #include <string>
 
 #include <comdef.h>
@@ -10,7 +29,8 @@
 #include <d3dcompiler.inl>
 #include <directxtk/SimpleMath.h>    
 #include <directxtk/SimpleMath.inl>  
-#include <sstream>
+#include <timeapi.h>
+#include <windowsx.h>
 #include <wrl/client.h>
 using namespace DirectX;
 using namespace DirectX::SimpleMath;
@@ -22,6 +42,7 @@ using Microsoft::WRL::ComPtr;
 
 #pragma comment(lib, "d3d11.lib")
 #pragma comment(lib, "d3dcompiler.lib")
+#pragma comment(lib, "winmm.lib")
 
 struct WindowContext
 {
@@ -33,13 +54,63 @@ struct WindowContext
 
     Vector2 windowResolution = { 1280.f, 720.f };
 
+    // resize: WndProc records, the next frame applies
+    bool     resizePending  = false;
+    uint32_t pendingSize[2] = {};
+    bool     minimized      = false;
+
     // timer
-    uint32_t prevCount = 0;
-    float    deltaTime = 0.f;
+    FrameTimer frameTimer;
+    float      deltaTime = 0.f;
+
+    // startup, phase by phase up to the first present
+    StartupTimer startup;
+    bool         startupLogged = false;
+    double       allShadersMs  = 0.0;   // start to the last shader ready, once they all are
+
+    // per-frame scratch, reset at the top of every frame
+    LinearAllocator frameAllocator;
+
+    // heap traffic per phase on this thread; the UI shows the last full frame
+    HeapPhaseStats frameHeap;
+    HeapPhaseStats lastFrameHeap;
+
+    // frame pacing
+    SystemPacerClock pacerClock;
+    FramePacer       pacer;
+    bool             vsync = true;   // Present(1); off, the pacer alone sets the rate
+
+    // profiler
+    ProfileCapture profileCapture;
+    uint64_t       profileFirstFrame = 0;
+    int            profileFramesLeft = 0;   // > 0 while a capture is running
+
+    // simulation thread
+    bool          threadedSimulation = false;   // requested by the UI, applied between frames
+    int           simulationFrameLag = 0;
+    SceneControls controlEdits;                 // UI edits waiting to be posted
+    bool          hasControlEdits = false;
+
+    // debug overlay
+    bool showOverlay = false;
+
+    // picking, main-thread simulation only
+    bool pickPending    = false;
+    int  pickPixel[2]   = {};   // client pixel of the last click
+    int  pickedInstance = -1;
 
     bool isRunning = false;
 
-    bool isKeyDown[256] = {};
+    // input: WndProc pushes, the update drains
+    InputQueue    inputQueue;
+    uint64_t      droppedInputEvents = 0;
+    InputTracker  inputTracker;
+    KeyFrameInput frameInput;
+
+    // input capture, main-thread simulation only; HeadlessRunner --replay plays it back
+    bool               captureRequested = false;   // starts at the next update, from a reset scene
+    InputCaptureWriter inputCapture;
+    InputCaptureFrame  captureFrame;   // this frame's record, written after the UI
 };
 
 struct Vertex
@@ -48,9 +119,16 @@ struct Vertex
     Vector3 color;
 };
 
-struct __declspec(align(16)) ConstantBuffer
+static_assert(sizeof(Vertex) == sizeof(BatchVertex), "the batcher draws with the Vertex input layout");
+
+constexpr int kGpuTimerFrames = 4;
+constexpr int kFrameFences    = 4;   // frames the constant arena can have in flight
+
+// register(b1) of VSupscale
+struct UpscaleConstants
 {
-    Matrix world;   // 64 bytes
+    float uvScale[2];   // rendered part of the scene target
+    float uvClamp[2];   // last texel center inside it
 };
 
 struct D3DRenderer
@@ -58,27 +136,88 @@ struct D3DRenderer
     ComPtr<ID3D11Device>        device;      // factory
     ComPtr<ID3D11DeviceContext> context;     // draw 
     ComPtr<IDXGISwapChain>      swapChain;   // back buffer
+    ComPtr<IDXGIDevice1>        dxgiDevice;  // frame latency
 
+    ComPtr<ID3D11Texture2D>        backBuffer;
     ComPtr<ID3D11RenderTargetView> renderTargetView;   // back buffer
-    D3D11_VIEWPORT                 viewport;           // draw
+    RenderViewport                 outputViewport;     // whole back buffer
+
+    // The scene renders into the top left of an output-sized MSAA target, is
+    // resolved, then stretched over the back buffer. A scale change only moves
+    // the viewport; nothing is reallocated until the window resizes.
+    ComPtr<ID3D11Texture2D>          sceneTarget;   // 4x MSAA
+    ComPtr<ID3D11RenderTargetView>   sceneTargetView;
+    ComPtr<ID3D11Texture2D>          resolvedTarget;
+    ComPtr<ID3D11ShaderResourceView> resolvedView;
+    UINT                             sampleQuality = 0;
+
+    ComPtr<ID3D11VertexShader> upscaleVertexShader;     // fullscreen triangle
+    ComPtr<ID3D11PixelShader>  upscalePixelShader;
+    ComPtr<ID3D11Buffer>       upscaleConstantBuffer;   // UpscaleConstants
+    ComPtr<ID3D11SamplerState> linearSampler;
+    bool                       upscaleReady = false;    // until then the scene renders at full size and resolves straight to the back buffer
+
+    DynamicResolution dynamicResolution;
+    bool              dynamicResolutionEnabled = true;
+
+    // GPU time of the scene passes, read back kGpuTimerFrames - 1 frames late so
+    // the CPU never waits on it; each slot remembers the scale it was taken at
+    ComPtr<ID3D11Query> gpuDisjoint[kGpuTimerFrames];
+    ComPtr<ID3D11Query> gpuBegin[kGpuTimerFrames];
+    ComPtr<ID3D11Query> gpuEnd[kGpuTimerFrames];
+    int                 gpuTimerLevel[kGpuTimerFrames] = {};
+    uint64_t            gpuTimerFrames                 = 0;   // issued so far
+    float               gpuFrameMs                     = 0.f;
+
+    // Per-draw constants suballocated from one buffer and bound by offset
+    // (D3D11.1); without offsetting the arena buffer stays null and draws use
+    // their own constant buffers. An event query per frame tells the arena
+    // which frames the GPU is done with.
+    ComPtr<ID3D11DeviceContext1> context1;
+    ComPtr<ID3D11Buffer>         constantArenaBuffer;
+    ConstantArena                constantArena;
+    ComPtr<ID3D11Query>          frameFence[kFrameFences];   // frame f signals slot f % kFrameFences
+    uint64_t                     arenaFrame     = 0;         // open frame, from 1
+    uint64_t                     completedFrame = 0;
 
     ComPtr<ID3D11VertexShader> vertexShader;   // vertex shader
     ComPtr<ID3D11PixelShader>  pixelShader;    // pixel shader
     ComPtr<ID3D11InputLayout>  inputLayout;    // input layout
 
     ComPtr<ID3D11Buffer> vertexBuffer;
-    uint32_t             vertexStride;
-    uint32_t             vertexOffset;
-
     ComPtr<ID3D11Buffer> indexBuffer;
-    uint32_t             indexCount;
-
     ComPtr<ID3D11Buffer> constantBuffer;
-    ConstantBuffer       cpuConstantData;
 
-    Vector2 triPosition = { 0.f, 0.f };
-    Vector2 triScale    = { 1.f, 1.f };
-    float   triRotation = 0.f;
+    // scene.mesh when present, else the built-in triangle
+    VertexFormat sceneFormat   = kSceneVertexFormat;   // layout of vertexBuffer
+    bool         sceneFromMesh = false;
+
+    // instancing
+    ComPtr<ID3D11VertexShader> instancedVertexShader;
+    ComPtr<ID3D11InputLayout>  instancedInputLayout;
+    ComPtr<ID3D11Buffer>       instanceBuffer;   // default usage, InstanceData per drawn instance
+
+    // immediate-mode geometry
+    ComPtr<ID3D11InputLayout> batchInputLayout;        // float Vertex layout, whatever the scene uses
+    ComPtr<ID3D11Buffer>      batchVertexBuffer;       // dynamic ring
+    ComPtr<ID3D11Buffer>      batchIndexBuffer;        // dynamic ring
+    ComPtr<ID3D11Buffer>      overlayConstantBuffer;   // pixels to clip space
+
+    // Shaders compile and get their objects on builder threads. Startup waits
+    // for the critical ones only; the rest are swapped in by PollShaderBuilds
+    // as they finish, the cache is saved once they all have.
+    D3DShaderCompiler  shaderCompiler;
+    ShaderCache        shaderCache;
+    AsyncShaderBuilder shaderBuilder;
+    ShaderBuild*       instancedBuild  = nullptr;
+    ShaderBuild*       upscaleBuild[2] = {};   // vertex, pixel
+    bool               shadersSettled  = false;
+
+    D3D11RenderContext   renderContext;   // raw device context calls
+    StateTrackingContext stateTracker;    // submission goes through this, drops redundant binds
+    RenderResources      resources;       // raw handles + strides/counts/viewport
+    DrawBucket           drawBucket;      // per-frame draw commands, sorted before submission
+    PrimitiveBatcher     batcher;         // overlay shapes, batched into the rings
 };
 
 Vertex g_triangleVertices[] = {
@@ -89,8 +228,19 @@ Vertex g_triangleVertices[] = {
 
 uint32_t g_triangleIndices[] = { 0, 1, 2 };
 
+constexpr uint32_t kBatchVertexCapacity = 1 << 16;
+constexpr int      kMaxSceneInstances   = 1 << 20;   // past instanceCapacity only culling keeps them all drawn
+constexpr uint32_t kBatchIndexCapacity  = 3 << 15;
+constexpr uint32_t kConstantArenaBytes  = 1 << 16;
+
 WindowContext g_windowContext = {};
 D3DRenderer   g_renderer      = {};
+SceneState    g_scene         = {};
+
+SimulationThread     g_simulation;
+const SceneSnapshot* g_snapshot = nullptr;   // this frame's snapshot while the simulation thread runs
+
+JobSystem g_jobs;   // this thread plus a worker per other core; splits the instance passes
 
 bool             Init();
 bool             InitD3D();
@@ -99,7 +249,18 @@ LRESULT CALLBACK WndProc(HWND, UINT, WPARAM, LPARAM);
 LRESULT CALLBACK ImGui_ImplWin32_WndProcHandler(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam);
 INT_PTR CALLBACK About(HWND, UINT, WPARAM, LPARAM);
 bool             D3DCheckFail(HRESULT hr, const wchar_t* msg);
-bool             UpdateConstantBuffer(void* data, size_t size, ComPtr<ID3D11Buffer>& buffer);
+void             QueueShaderBuilds();
+void             PollShaderBuilds();
+void             SettleShaderBuilds();
+void             LogShaderBuildFailures();
+bool             CreateSizeDependentTargets(UINT width, UINT height);
+bool             ResizeSwapChain(UINT width, UINT height);
+void             CurrentRenderSize(uint32_t& width, uint32_t& height);
+void             UpscaleToBackBuffer(uint32_t renderWidth, uint32_t renderHeight);
+void             BeginGpuTimer();
+void             EndGpuTimer();
+void             BeginConstantFrame();
+void             EndConstantFrame();
 void             RenderImgui();
 
 int APIENTRY wWinMain(_In_ HINSTANCE     hInstance,
@@ -107,143 +268,307 @@ int APIENTRY wWinMain(_In_ HINSTANCE     hInstance,
                       _In_ LPWSTR        lpCmdLine,
                       _In_ int           nCmdShow)
 {
+    StartupTimer& startup = g_windowContext.startup;
+    BeginStartupTimer(startup, NowNanoseconds());
+
     if (!Init())
     {
         OutputDebugStringA("Init failed\n");
         return -1;
     }
+    MarkStartupPhase(startup, "Window", NowNanoseconds());
 
+    // a failed start still has to join the shader builder threads and
+    // restore the timer resolution Init raised
     if (!InitD3D())
     {
+        StopShaderBuilder(g_renderer.shaderBuilder);
+        timeEndPeriod(1);
         OutputDebugStringA("InitD3D failed\n");
         return -1;
     }
 
     if (!InitImgui())
     {
+        StopShaderBuilder(g_renderer.shaderBuilder);
+        timeEndPeriod(1);
         OutputDebugStringA("InitImgui failed\n");
         return -1;
     }
+    MarkStartupPhase(startup, "Imgui", NowNanoseconds());
+
+    // workers only once nothing can fail, so every exit path joins them
+    StartJobSystem(g_jobs, 0);
+    g_scene.jobs = &g_jobs;
+
+    PROFILE_THREAD("Main");
 
     MSG msg = {};
 
-    while (true)
+    while (g_windowContext.isRunning)
     {
+        // Wait for the frame's start, then take every message that arrived
+        // meanwhile, so a burst of them costs one frame rather than one each
+        {
+            PROFILE_SCOPE("Pacing");
+            WaitForNextFrame(g_windowContext.pacer);
+        }
+
+        {
+            PROFILE_SCOPE("Message");
+
+            while (::PeekMessage(&msg, nullptr, 0, 0, PM_REMOVE))
+            {
+                if (msg.message == WM_QUIT)
+                {
+                    g_windowContext.isRunning = false;
+                    break;
+                }
+
+                ::TranslateMessage(&msg);
+                ::DispatchMessage(&msg);
+            }
+        }
+
         if (!g_windowContext.isRunning)
             break;
 
-        if (::PeekMessage(&msg, nullptr, 0, 0, PM_REMOVE))
+        // Nothing to draw into while minimized; the schedule restarts on wake
+        // so the pause does not count as a missed deadline
+        if (g_windowContext.minimized)
         {
-            if (msg.message == WM_QUIT)
-                break;
-
-            ::TranslateMessage(&msg);
-            ::DispatchMessage(&msg);
+            ::WaitMessage();
+            SetFramePacerTarget(g_windowContext.pacer, g_windowContext.pacer.targetFps);
+            continue;
         }
-        else
+
+        if (g_windowContext.resizePending)
         {
-            uint32_t currentCount = std::chrono::duration_cast<std::chrono::milliseconds>(
-                                        std::chrono::high_resolution_clock::now().time_since_epoch())
-                                        .count();
-            g_windowContext.deltaTime = (currentCount - g_windowContext.prevCount) / 1000.f;
-            g_windowContext.prevCount = currentCount;
+            PROFILE_SCOPE("Resize");
 
-            // Update
+            g_windowContext.resizePending = false;
+            if (!ResizeSwapChain(g_windowContext.pendingSize[0], g_windowContext.pendingSize[1]))
             {
-                auto& r = g_renderer;
+                OutputDebugStringA("ResizeSwapChain failed\n");
+                break;
+            }
+            g_windowContext.windowResolution = Vector2(static_cast<float>(g_windowContext.pendingSize[0]), static_cast<float>(g_windowContext.pendingSize[1]));
+        }
 
-                // update constantBuffer
-                r.cpuConstantData.world =
-                    Matrix::CreateScale(r.triScale.x, r.triScale.y, 1.f) *
-                    Matrix::CreateRotationZ(r.triRotation) *
-                    Matrix::CreateTranslation(r.triPosition.x, r.triPosition.y, 0.f);
+        uint64_t frameBeginNs     = NowNanoseconds();
+        g_windowContext.deltaTime = TickFrameTimer(g_windowContext.frameTimer, frameBeginNs);
+        PROFILE_FRAME(g_windowContext.frameTimer.frameCount);
 
-                UpdateConstantBuffer(
-                    &r.cpuConstantData,
-                    sizeof(r.cpuConstantData),
-                    r.constantBuffer);
+        ResetLinearAllocator(g_windowContext.frameAllocator);
+        g_windowContext.lastFrameHeap = g_windowContext.frameHeap;
+        g_windowContext.frameHeap     = {};
+
+        // Switch threading mode; the scene moves to or from the simulation thread
+        if (g_windowContext.threadedSimulation != (g_snapshot != nullptr))
+        {
+            if (g_windowContext.inputCapture.file && !EndInputCapture(g_windowContext.inputCapture))
+                OutputDebugStringA("EndInputCapture failed\n");
+
+            if (g_snapshot)
+            {
+                StopSimulationThread(g_simulation);
+                g_scene    = g_simulation.scene;
+                g_snapshot = nullptr;
+            }
+            else
+            {
+                StartSimulationThread(g_simulation, g_scene, g_renderer.resources.instanceCapacity, g_windowContext.simulationFrameLag, 0.f);
+                g_snapshot = &AcquireSimulationSnapshot(g_simulation);
+            }
+        }
 
-                // keyboard input
-                if (g_windowContext.isKeyDown['W'])
-                    r.triPosition.y += 1.f * g_windowContext.deltaTime;
+        PollShaderBuilds();
+        BeginConstantFrame();
 
-                if (g_windowContext.isKeyDown['S'])
-                    r.triPosition.y -= 1.f * g_windowContext.deltaTime;
+        // Update
+        size_t instanceCount = 0;
+        {
+            PROFILE_SCOPE("Update");
+            HeapPhaseScope heapPhase(g_windowContext.frameHeap, "Update");
 
-                if (g_windowContext.isKeyDown['A'])
-                    r.triPosition.x -= 1.f * g_windowContext.deltaTime;
+            ConsumeInputEvents(g_windowContext.inputTracker, g_windowContext.inputQueue, frameBeginNs, g_windowContext.frameInput);
 
-                if (g_windowContext.isKeyDown['D'])
-                    r.triPosition.x += 1.f * g_windowContext.deltaTime;
+            if (g_snapshot)
+            {
+                // the simulation thread updates, we only upload its latest snapshot;
+                // it steps on whole frames, so taps are stretched to one
+                bool keys[256];
+                KeysFromFrameInput(g_windowContext.frameInput, keys);
+                PostSimulationInput(g_simulation, keys, g_windowContext.hasControlEdits ? &g_windowContext.controlEdits : nullptr);
+                g_windowContext.hasControlEdits = false;
+
+                g_snapshot = &AcquireSimulationSnapshot(g_simulation);
+                if (g_snapshot->quitRequested)
+                    g_windowContext.isRunning = false;
 
-                if (g_windowContext.isKeyDown[VK_UP])
-                    r.triScale.y += 1.f * g_windowContext.deltaTime;
+                UploadSceneSnapshot(g_renderer.stateTracker, g_renderer.resources, *g_snapshot);
+                instanceCount = g_snapshot->instances.size();
+            }
+            else
+            {
+                if (g_windowContext.captureRequested)
+                {
+                    g_windowContext.captureRequested = false;
+
+                    SceneControls controls = GetSceneControls(g_scene);
+                    if (BeginInputCapture(g_windowContext.inputCapture, "input_capture.bin", controls, g_scene.instanceRadius))
+                    {
+                        ResetCaptureScene(g_scene, controls, g_scene.instanceRadius);
+                        ReserveTransformGraph(g_scene.transforms, kFirstInstanceNode + g_renderer.resources.instanceCapacity);
+                    }
+                    else
+                        OutputDebugStringA("BeginInputCapture failed\n");
+                }
+
+                UpdateSceneInput(g_scene, g_windowContext.frameInput, g_windowContext.deltaTime);
+
+                InputCaptureFrame& record = g_windowContext.captureFrame;
+                record.deltaTime          = g_windowContext.deltaTime;
+                record.input              = g_windowContext.frameInput;
+                record.hasControls        = false;
+                if (g_scene.quitRequested)
+                    g_windowContext.isRunning = false;
 
-                if (g_windowContext.isKeyDown[VK_DOWN])
-                    r.triScale.y -= 1.f * g_windowContext.deltaTime;
+                if (g_windowContext.pickPending)
+                {
+                    // pixel center -> clip space, which is the scene's world space;
+                    // the upscale stretches the scene over the whole window
+                    const RenderViewport& vp = g_renderer.outputViewport;
 
-                if (g_windowContext.isKeyDown[VK_LEFT])
-                    r.triScale.x -= 1.f * g_windowContext.deltaTime;
+                    float    x     = 2.f * (g_windowContext.pickPixel[0] + 0.5f - vp.x) / vp.width - 1.f;
+                    float    y     = 1.f - 2.f * (g_windowContext.pickPixel[1] + 0.5f - vp.y) / vp.height;
+                    uint32_t index = 0;
 
-                if (g_windowContext.isKeyDown[VK_RIGHT])
-                    r.triScale.x += 1.f * g_windowContext.deltaTime;
+                    g_windowContext.pickedInstance = PickSceneInstance(g_scene, x, y, index) ? static_cast<int>(index) : -1;
+                    g_windowContext.pickPending    = false;
+                }
 
-                if (g_windowContext.isKeyDown[VK_SPACE])
-                    r.triRotation -= 1.f * g_windowContext.deltaTime;
+                UploadScene(g_renderer.stateTracker, g_renderer.resources, g_scene);
+                instanceCount = g_scene.drawnInstances;
+            }
+        }
 
-                if (g_windowContext.isKeyDown[VK_CONTROL])
-                    r.triRotation += 1.f * g_windowContext.deltaTime;
+        // Rendering: the scene at the dynamic size, then upscaled; the overlay
+        // and imgui draw on the back buffer at full size
+        {
+            PROFILE_SCOPE("Rendering");
+            HeapPhaseScope heapPhase(g_windowContext.frameHeap, "Rendering");
 
-                if (g_windowContext.isKeyDown[VK_ESCAPE])
-                    g_windowContext.isRunning = false;
+            uint32_t renderWidth  = 0;
+            uint32_t renderHeight = 0;
+            CurrentRenderSize(renderWidth, renderHeight);
+            if (!g_renderer.upscaleReady)
+            {
+                renderWidth  = g_renderer.dynamicResolution.outputWidth;
+                renderHeight = g_renderer.dynamicResolution.outputHeight;
             }
+            g_renderer.resources.viewport = RenderViewport { 0.f, 0.f, static_cast<float>(renderWidth), static_cast<float>(renderHeight), 0.f, 1.f };
 
-            // Rendering
+            const ConstantBuffer& sceneConstants = g_snapshot ? g_snapshot->constants : g_scene.cpuConstantData;
+
+            BeginGpuTimer();
+            ConstantRange triangleConstants = RenderScene(g_renderer.stateTracker, g_renderer.resources, sceneConstants, instanceCount, g_renderer.drawBucket);
+            UpscaleToBackBuffer(renderWidth, renderHeight);
+            EndGpuTimer();
+
+            if (g_windowContext.showOverlay)
             {
-                // Input Assembler
-                auto& r = g_renderer;
-                auto  c = r.context;
-
-                c->IASetInputLayout(r.inputLayout.Get());
-                c->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-                c->IASetVertexBuffers(
-                    0,
-                    1,
-                    r.vertexBuffer.GetAddressOf(),
-                    &r.vertexStride,
-                    &r.vertexOffset);
-
-                c->IASetIndexBuffer(
-                    r.indexBuffer.Get(),
-                    DXGI_FORMAT_R32_UINT,
-                    0);
-
-                // Vertex Shader
-                c->VSSetShader(r.vertexShader.Get(), nullptr, 0);
-                c->VSSetConstantBuffers(0, 1, r.constantBuffer.GetAddressOf());
-
-                // Rasterizer
-                c->RSSetViewports(1, &r.viewport);
-
-                // Pixel Shader
-                c->PSSetShader(g_renderer.pixelShader.Get(), nullptr, 0);
-
-                // Output Merger
-                c->OMSetRenderTargets(1, g_renderer.renderTargetView.GetAddressOf(), nullptr);
-                FLOAT clearColor[] = { 0.f, 0.f, 0.f, 1.f };
-                c->ClearRenderTargetView(g_renderer.renderTargetView.Get(), clearColor);
-                c->DrawIndexed(_countof(g_triangleIndices), 0, 0);
-                //c->Draw(_countof(g_triangleVertices), 0);
+                RenderResources overlayResources  = g_renderer.resources;
+                overlayResources.viewport         = g_renderer.outputViewport;
+                overlayResources.renderTargetView = g_renderer.renderTargetView.Get();
+
+                float* frameTimesMs   = LinearAllocateArray<float>(g_windowContext.frameAllocator, 256);
+                size_t frameTimeCount = frameTimesMs ? CopyFrameTimesMs(g_windowContext.frameTimer, frameTimesMs, 256) : 0;
+                RenderDebugOverlay(g_renderer.batcher,
+                                   overlayResources,
+                                   triangleConstants,
+                                   reinterpret_cast<const BatchVertex*>(g_triangleVertices),
+                                   g_renderer.sceneFromMesh ? 0 : _countof(g_triangleVertices),
+                                   frameTimesMs,
+                                   frameTimeCount);
             }
 
-            // Render Imgui
+            // imgui draws next; its buffers must not be mapped
+            FlushBatcher(g_renderer.batcher);
+        }
+
+        // Render Imgui
+        {
+            PROFILE_SCOPE("RenderImgui");
+            HeapPhaseScope heapPhase(g_windowContext.frameHeap, "RenderImgui");
+
             RenderImgui();
 
-            // Present
-            g_renderer.swapChain->Present(1, 0);
+            // its state restore rebinds constant buffers without their offsets
+            if (g_renderer.resources.constantArena)
+                g_renderer.stateTracker.Invalidate();
+        }
+
+        if (g_windowContext.inputCapture.file && !g_snapshot && !WriteInputCaptureFrame(g_windowContext.inputCapture, g_windowContext.captureFrame))
+            OutputDebugStringA("WriteInputCaptureFrame failed\n");
+
+        // Present
+        {
+            PROFILE_SCOPE("Present");
+            HeapPhaseScope heapPhase(g_windowContext.frameHeap, "Present");
+
+            // the frame's work is submitted here; what follows is the vsync wait
+            RecordInputSubmit(g_windowContext.inputTracker, NowNanoseconds());
+            g_renderer.swapChain->Present(g_windowContext.vsync ? 1 : 0, 0);
         }
+
+        if (!g_windowContext.startupLogged)
+        {
+            g_windowContext.startupLogged = true;
+            MarkStartupPhase(startup, "First frame", NowNanoseconds());
+
+            char line[128];
+            for (uint32_t i = 0; i < startup.count; ++i)
+            {
+                sprintf_s(line, "Startup %-18s %8.2f ms\n", startup.names[i], startup.ms[i]);
+                OutputDebugStringA(line);
+            }
+            sprintf_s(line, "Startup total to first present %.2f ms\n", StartupTotalMs(startup));
+            OutputDebugStringA(line);
+        }
+
+        EndConstantFrame();
+
+        // imgui_impl_dx11 restores the state it touches, so otherwise the shadow stays valid across frames
+        g_renderer.stateTracker.EndFrame();
+        EndBatcherFrame(g_renderer.batcher);
+
+        // Profiler: drain every frame, keep events only while capturing
+        if (g_windowContext.profileFramesLeft > 0)
+        {
+            ProfilerCollect(g_windowContext.profileCapture);
+            if (--g_windowContext.profileFramesLeft == 0)
+            {
+                if (!ExportChromeTrace(g_windowContext.profileCapture, "profile_trace.json", g_windowContext.profileFirstFrame, UINT64_MAX))
+                    OutputDebugStringA("ExportChromeTrace failed\n");
+                g_windowContext.profileCapture = {};
+            }
+        }
+        else
+            ProfilerDiscard();
     }
 
+    StopSimulationThread(g_simulation);
+    StopJobSystem(g_jobs);
+    if (!g_renderer.shadersSettled)
+    {
+        StopShaderBuilder(g_renderer.shaderBuilder);
+        SettleShaderBuilds();
+    }
+    if (g_windowContext.inputCapture.file && !EndInputCapture(g_windowContext.inputCapture))
+        OutputDebugStringA("EndInputCapture failed\n");
+    timeEndPeriod(1);
+
     ImGui_ImplDX11_Shutdown();
     ImGui_ImplWin32_Shutdown();
 
@@ -323,7 +648,14 @@ bool Init()
     }
 
     g_windowContext.isRunning = true;
-    std::fill_n(g_windowContext.isKeyDown, _countof(g_windowContext.isKeyDown), false);
+
+    InitFrameTimer(g_windowContext.frameTimer, 1024);
+    InitLinearAllocator(g_windowContext.frameAllocator, 64 * 1024);
+    InitFramePacer(g_windowContext.pacer, &g_windowContext.pacerClock, 0.0, 1024);
+
+    // 1 ms scheduler ticks, so the pacer's sleeps overshoot by less
+    timeBeginPeriod(1);
+    InitInputTracker(g_windowContext.inputTracker, NowNanoseconds(), 1024);
 
     return TRUE;
 }
@@ -389,12 +721,12 @@ bool InitD3D()
 
     // Swap Chain
 
-    UINT sampleQuality = 0;
+    // MSAA lives on the scene target; the back buffer only receives the upscale
     if (D3DCheckFail(
             g_renderer.device->CheckMultisampleQualityLevels(
                 DXGI_FORMAT_R8G8B8A8_UNORM,
                 4,
-                &sampleQuality),
+                &g_renderer.sampleQuality),
             L"CheckMultisampleQualityLevels Fail"))
     {
         return false;
@@ -407,8 +739,8 @@ bool InitD3D()
     sd.BufferDesc.Width                   = width;
     sd.BufferDesc.Height                  = height;
     sd.Windowed                           = TRUE;
-    sd.SampleDesc.Count                   = 4;
-    sd.SampleDesc.Quality                 = sampleQuality - 1;
+    sd.SampleDesc.Count                   = 1;
+    sd.SampleDesc.Quality                 = 0;
     sd.OutputWindow                       = g_windowContext.hWnd;
     sd.BufferUsage                        = DXGI_USAGE_RENDER_TARGET_OUTPUT;
     sd.BufferDesc.Format                  = DXGI_FORMAT_R8G8B8A8_UNORM;
@@ -417,17 +749,24 @@ bool InitD3D()
     sd.SwapEffect                         = DXGI_SWAP_EFFECT_DISCARD;
     sd.Flags                              = 0;
 
-    ComPtr<IDXGIDevice> dxgiDevice;
     if (D3DCheckFail(
-            g_renderer.device.As(&dxgiDevice),
+            g_renderer.device.As(&g_renderer.dxgiDevice),
             L"IDXGIDevice Fail"))
     {
         return false;
     }
 
+    // frames the CPU may queue ahead of the GPU
+    if (D3DCheckFail(
+            g_renderer.dxgiDevice->SetMaximumFrameLatency(g_windowContext.pacer.maxFramesInFlight),
+            L"SetMaximumFrameLatency Fail"))
+    {
+        return false;
+    }
+
     ComPtr<IDXGIAdapter> dxgiAdapter;
     if (D3DCheckFail(
-            dxgiDevice->GetAdapter(&dxgiAdapter),
+            g_renderer.dxgiDevice->GetAdapter(&dxgiAdapter),
             L"IDXGIDevice::GetAdapter Fail"))
     {
         return false;
@@ -448,81 +787,104 @@ bool InitD3D()
         return false;
     }
 
-    // Render Target
-    ComPtr<ID3D11Texture2D> backBuffer;
-    if (D3DCheckFail(
-            g_renderer.swapChain->GetBuffer(0, __uuidof(ID3D11Texture2D), &backBuffer),
-            L"GetBuffer Fail"))
+    MarkStartupPhase(g_windowContext.startup, "Device", NowNanoseconds());
+
+    // Render Targets
+    InitDynamicResolution(g_renderer.dynamicResolution, DynamicResolutionSettings {}, static_cast<uint32_t>(width), static_cast<uint32_t>(height));
+    if (!CreateSizeDependentTargets(static_cast<UINT>(width), static_cast<UINT>(height)))
     {
         return false;
     }
 
-    g_renderer.viewport = D3D11_VIEWPORT {
-        0.f,
-        0.f,
-        width,
-        height,
-        0.f,
-        1.f
-    };
-
-    if (D3DCheckFail(
-            g_renderer.device->CreateRenderTargetView(
-                backBuffer.Get(),
-                nullptr,
-                g_renderer.renderTargetView.GetAddressOf()),
-            L"CreateRenderTargetView Fail"))
+    // Scene mesh: the blobs are stored packed, so the mapped file goes to
+    // CreateBuffer as is. Without one the built-in triangle is packed here.
+    MeshView mesh;
+    if (OpenMeshFile(mesh, "scene.mesh", true))
     {
-        return false;
+        g_renderer.sceneFormat   = mesh.vertexFormat;
+        g_renderer.sceneFromMesh = true;
+        g_scene.instanceRadius   = MeshBoundingRadius(mesh.header);
     }
+    else
+        OutputDebugStringA("scene.mesh missing or invalid, using the built-in triangle\n");
+
+    // the input layouts need the scene format; everything below overlaps the compiles
+    QueueShaderBuilds();
+    MarkStartupPhase(g_windowContext.startup, "Shaders queued", NowNanoseconds());
 
     // Vertex Buffer
     {
         D3D11_BUFFER_DESC desc = {};
         ZeroMemory(&desc, sizeof(D3D11_BUFFER_DESC));
+
+        // the triangle is authored as float Vertex, uploaded in the scene's packed layout
+        const VertexLayout&  layout = GetVertexLayout(g_renderer.sceneFormat);
+        std::vector<uint8_t> packed;
+        if (!g_renderer.sceneFromMesh)
+        {
+            packed.resize(layout.stride * _countof(g_triangleVertices));
+            PackVertices(g_renderer.sceneFormat, &g_triangleVertices[0].posL.x, _countof(g_triangleVertices), packed.data());
+        }
+
         desc.BindFlags           = D3D11_BIND_VERTEX_BUFFER;
-        desc.ByteWidth           = sizeof(Vertex) * _countof(g_triangleVertices);
+        desc.ByteWidth           = static_cast<UINT>(g_renderer.sceneFromMesh ? mesh.vertexBytes : packed.size());
         desc.Usage               = D3D11_USAGE_IMMUTABLE;
         desc.CPUAccessFlags      = 0;
         desc.MiscFlags           = 0;
         desc.StructureByteStride = 0;
 
         D3D11_SUBRESOURCE_DATA initData = {};
-        initData.pSysMem                = g_triangleVertices;
+        initData.pSysMem                = g_renderer.sceneFromMesh ? mesh.vertices : packed.data();
 
         if (D3DCheckFail(
                 g_renderer.device->CreateBuffer(&desc, &initData, g_renderer.vertexBuffer.GetAddressOf()),
                 L"CreateBuffer Fail"))
         {
+            CloseMeshFile(mesh);
             return false;
         }
 
-        g_renderer.vertexStride = sizeof(Vertex);
-        g_renderer.vertexOffset = 0;
+        g_renderer.resources.vertexStride = layout.stride;
+        g_renderer.resources.vertexOffset = 0;
     }
 
     // Index Buffer
     {
         D3D11_BUFFER_DESC desc = {};
         ZeroMemory(&desc, sizeof(D3D11_BUFFER_DESC));
+
+        // 16-bit whenever the vertex count allows it; the mesh converter chose already
+        IndexFormat          format = g_renderer.sceneFromMesh ? mesh.indexFormat : SelectIndexFormat(_countof(g_triangleVertices));
+        std::vector<uint8_t> packed;
+        if (!g_renderer.sceneFromMesh)
+        {
+            packed.resize(IndexFormatSize(format) * _countof(g_triangleIndices));
+            PackIndices(g_triangleIndices, _countof(g_triangleIndices), format, packed.data());
+        }
+
         desc.BindFlags           = D3D11_BIND_INDEX_BUFFER;
-        desc.ByteWidth           = sizeof(UINT) * _countof(g_triangleIndices);
+        desc.ByteWidth           = static_cast<UINT>(g_renderer.sceneFromMesh ? mesh.indexBytes : packed.size());
         desc.Usage               = D3D11_USAGE_IMMUTABLE;
         desc.CPUAccessFlags      = 0;
         desc.MiscFlags           = 0;
         desc.StructureByteStride = 0;
 
         D3D11_SUBRESOURCE_DATA initData = {};
-        initData.pSysMem                = g_triangleIndices;
+        initData.pSysMem                = g_renderer.sceneFromMesh ? mesh.indices : packed.data();
 
-        if (D3DCheckFail(
-                g_renderer.device->CreateBuffer(&desc, &initData, g_renderer.indexBuffer.GetAddressOf()),
-                L"CreateBuffer Fail"))
+        bool failed = D3DCheckFail(
+            g_renderer.device->CreateBuffer(&desc, &initData, g_renderer.indexBuffer.GetAddressOf()),
+            L"CreateBuffer Fail");
+
+        g_renderer.resources.indexCount  = g_renderer.sceneFromMesh ? static_cast<uint32_t>(mesh.header.indexCount) : _countof(g_triangleIndices);
+        g_renderer.resources.indexFormat = format;
+
+        // immutable buffers own a copy now
+        CloseMeshFile(mesh);
+        if (failed)
         {
             return false;
         }
-
-        g_renderer.indexCount = _countof(g_triangleIndices);
     }
 
     // Constant Buffer
@@ -545,115 +907,203 @@ bool InitD3D()
         }
     }
 
-    const char* shaderCode = R"(
-        cbuffer cb : register(b0)
+    // Constant arena: offsets need D3D11.1; without NO_OVERWRITE maps on
+    // constant buffers it falls back to one discard per frame
+    {
+        D3D11_FEATURE_DATA_D3D11_OPTIONS options = {};
+        if (SUCCEEDED(g_renderer.context.As(&g_renderer.context1)) &&
+            SUCCEEDED(g_renderer.device->CheckFeatureSupport(D3D11_FEATURE_D3D11_OPTIONS, &options, sizeof(options))) &&
+            options.ConstantBufferOffsetting)
         {
-            row_major matrix world;
+            D3D11_BUFFER_DESC desc = {};
+            desc.BindFlags         = D3D11_BIND_CONSTANT_BUFFER;
+            desc.ByteWidth         = kConstantArenaBytes;
+            desc.Usage             = D3D11_USAGE_DYNAMIC;
+            desc.CPUAccessFlags    = D3D11_CPU_ACCESS_WRITE;
+
+            if (D3DCheckFail(
+                    g_renderer.device->CreateBuffer(&desc, nullptr, g_renderer.constantArenaBuffer.GetAddressOf()),
+                    L"CreateBuffer Fail"))
+            {
+                return false;
+            }
+
+            D3D11_QUERY_DESC queryDesc = {};
+            queryDesc.Query            = D3D11_QUERY_EVENT;
+            for (int i = 0; i < kFrameFences; ++i)
+            {
+                if (D3DCheckFail(
+                        g_renderer.device->CreateQuery(&queryDesc, g_renderer.frameFence[i].GetAddressOf()),
+                        L"CreateQuery Fail"))
+                {
+                    return false;
+                }
+            }
+
+            InitConstantArena(g_renderer.constantArena,
+                              g_renderer.constantArenaBuffer.Get(),
+                              kConstantArenaBytes,
+                              !options.MapNoOverwriteOnDynamicConstantBuffer);
         }
+        else
+            OutputDebugStringA("No constant buffer offsetting, one constant buffer per draw\n");
+    }
 
-        struct VS_INPUT
-        {
-            float2 posL : POSITION;
-            float3 color : COLOR;
-        };
+    // Instance Buffer
+    {
+        D3D11_BUFFER_DESC desc = {};
+        ZeroMemory(&desc, sizeof(D3D11_BUFFER_DESC));
 
-        struct PS_INPUT
+        desc.BindFlags           = D3D11_BIND_VERTEX_BUFFER;
+        desc.ByteWidth           = sizeof(InstanceData) * g_renderer.resources.instanceCapacity;
+        desc.Usage               = D3D11_USAGE_DEFAULT;   // UpdateSubresource on the instances that moved
+        desc.CPUAccessFlags      = 0;
+        desc.MiscFlags           = 0;
+        desc.StructureByteStride = 0;
+
+        if (D3DCheckFail(
+                g_renderer.device->CreateBuffer(&desc, nullptr, g_renderer.instanceBuffer.GetAddressOf()),
+                L"CreateBuffer Fail"))
         {
-            float4 posH : SV_POSITION;
-            float3 color : COLOR;
-        };
+            return false;
+        }
 
-        PS_INPUT VSmain(VS_INPUT input)
+        ReserveTransformGraph(g_scene.transforms, kFirstInstanceNode + g_renderer.resources.instanceCapacity);
+    }
+
+    // Batcher rings: appended to with NO_OVERWRITE, DISCARD when they wrap
+    {
+        D3D11_BUFFER_DESC desc = {};
+        ZeroMemory(&desc, sizeof(D3D11_BUFFER_DESC));
+
+        desc.BindFlags           = D3D11_BIND_VERTEX_BUFFER;
+        desc.ByteWidth           = sizeof(BatchVertex) * kBatchVertexCapacity;
+        desc.Usage               = D3D11_USAGE_DYNAMIC;
+        desc.CPUAccessFlags      = D3D11_CPU_ACCESS_WRITE;
+        desc.MiscFlags           = 0;
+        desc.StructureByteStride = 0;
+
+        if (D3DCheckFail(
+                g_renderer.device->CreateBuffer(&desc, nullptr, g_renderer.batchVertexBuffer.GetAddressOf()),
+                L"CreateBuffer Fail"))
         {
-            PS_INPUT output;
-            output.posH = mul(float4(input.posL, 0.f, 1.f), world);
-            output.color = input.color;
-            return output;
+            return false;
         }
 
-        float4 PSmain(PS_INPUT input) : SV_TARGET
+        desc.BindFlags = D3D11_BIND_INDEX_BUFFER;
+        desc.ByteWidth = sizeof(uint32_t) * kBatchIndexCapacity;
+
+        if (D3DCheckFail(
+                g_renderer.device->CreateBuffer(&desc, nullptr, g_renderer.batchIndexBuffer.GetAddressOf()),
+                L"CreateBuffer Fail"))
         {
-            return float4(input.color, 1.f);
+            return false;
         }
-    )";
 
-    // Vertex Shader
-    ComPtr<ID3DBlob> shaderBlob;
-    if (D3DCheckFail(
-            D3DCompile(shaderCode,
-                       strlen(shaderCode),
-                       nullptr,
-                       nullptr,
-                       nullptr,
-                       "VSmain",
-                       "vs_5_0",
-                       0,
-                       0,
-                       &shaderBlob,
-                       nullptr),
-            L"D3DCompile Fail"))
-    {
-        return false;
+        desc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+        desc.ByteWidth = sizeof(ConstantBuffer);
+
+        if (D3DCheckFail(
+                g_renderer.device->CreateBuffer(&desc, nullptr, g_renderer.overlayConstantBuffer.GetAddressOf()),
+                L"CreateBuffer Fail"))
+        {
+            return false;
+        }
     }
 
-    if (D3DCheckFail(
-            g_renderer.device->CreateVertexShader(
-                shaderBlob->GetBufferPointer(),
-                shaderBlob->GetBufferSize(),
-                nullptr,
-                g_renderer.vertexShader.GetAddressOf()),
-            L"CreateVertexShader Fail"))
+    // Upscale: constants, bilinear sampler
     {
-        return false;
-    }
+        D3D11_BUFFER_DESC desc = {};
+        ZeroMemory(&desc, sizeof(D3D11_BUFFER_DESC));
 
-    // Input Layout
-    D3D11_INPUT_ELEMENT_DESC inputDesc[] = {
-        { "POSITION", 0, DXGI_FORMAT_R32G32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 },
-        { "COLOR", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 }
-    };
+        desc.BindFlags           = D3D11_BIND_CONSTANT_BUFFER;
+        desc.ByteWidth           = sizeof(UpscaleConstants);
+        desc.Usage               = D3D11_USAGE_DYNAMIC;
+        desc.CPUAccessFlags      = D3D11_CPU_ACCESS_WRITE;
+        desc.MiscFlags           = 0;
+        desc.StructureByteStride = 0;
 
-    if (D3DCheckFail(
-            g_renderer.device->CreateInputLayout(
-                inputDesc,
-                _countof(inputDesc),
-                shaderBlob->GetBufferPointer(),
-                shaderBlob->GetBufferSize(),
-                g_renderer.inputLayout.GetAddressOf()),
-            L"CreateInputLayout Fail"))
-    {
-        return false;
+        if (D3DCheckFail(
+                g_renderer.device->CreateBuffer(&desc, nullptr, g_renderer.upscaleConstantBuffer.GetAddressOf()),
+                L"CreateBuffer Fail"))
+        {
+            return false;
+        }
+
+        D3D11_SAMPLER_DESC samplerDesc = {};
+        samplerDesc.Filter             = D3D11_FILTER_MIN_MAG_MIP_LINEAR;
+        samplerDesc.AddressU           = D3D11_TEXTURE_ADDRESS_CLAMP;
+        samplerDesc.AddressV           = D3D11_TEXTURE_ADDRESS_CLAMP;
+        samplerDesc.AddressW           = D3D11_TEXTURE_ADDRESS_CLAMP;
+        samplerDesc.ComparisonFunc     = D3D11_COMPARISON_NEVER;
+        samplerDesc.MaxLOD             = D3D11_FLOAT32_MAX;
+
+        if (D3DCheckFail(
+                g_renderer.device->CreateSamplerState(&samplerDesc, g_renderer.linearSampler.GetAddressOf()),
+                L"CreateSamplerState Fail"))
+        {
+            return false;
+        }
     }
 
-    // Pixel Shader
-    if (D3DCheckFail(
-            D3DCompile(
-                shaderCode,
-                strlen(shaderCode),
-                nullptr,
-                nullptr,
-                nullptr,
-                "PSmain",
-                "ps_5_0",
-                0,
-                0,
-                &shaderBlob,
-                nullptr),
-            L"D3DCompile Fail"))
+    // GPU timer queries
+    for (int i = 0; i < kGpuTimerFrames; ++i)
     {
-        return false;
+        D3D11_QUERY_DESC queryDesc = {};
+        queryDesc.Query            = D3D11_QUERY_TIMESTAMP_DISJOINT;
+
+        if (D3DCheckFail(
+                g_renderer.device->CreateQuery(&queryDesc, g_renderer.gpuDisjoint[i].GetAddressOf()),
+                L"CreateQuery Fail"))
+        {
+            return false;
+        }
+
+        queryDesc.Query = D3D11_QUERY_TIMESTAMP;
+
+        if (D3DCheckFail(g_renderer.device->CreateQuery(&queryDesc, g_renderer.gpuBegin[i].GetAddressOf()), L"CreateQuery Fail") ||
+            D3DCheckFail(g_renderer.device->CreateQuery(&queryDesc, g_renderer.gpuEnd[i].GetAddressOf()), L"CreateQuery Fail"))
+        {
+            return false;
+        }
     }
 
-    if (D3DCheckFail(
-            g_renderer.device->CreatePixelShader(
-                shaderBlob->GetBufferPointer(),
-                shaderBlob->GetBufferSize(),
-                nullptr,
-                g_renderer.pixelShader.GetAddressOf()),
-            L"CreatePixelShader Fail"))
+    MarkStartupPhase(g_windowContext.startup, "Resources", NowNanoseconds());
+
+    // The scene and the batcher cannot draw without these
+    if (!WaitForCriticalShaders(g_renderer.shaderBuilder))
     {
+        LogShaderBuildFailures();
         return false;
     }
+    MarkStartupPhase(g_windowContext.startup, "Critical shaders", NowNanoseconds());
+
+    // Hand the raw objects to the portable submission code
+    g_renderer.renderContext.context  = g_renderer.context.Get();
+    g_renderer.renderContext.context1 = g_renderer.context1.Get();
+    g_renderer.stateTracker.inner     = &g_renderer.renderContext;
+
+    auto& res                 = g_renderer.resources;
+    res.inputLayout           = g_renderer.inputLayout.Get();
+    res.vertexShader          = g_renderer.vertexShader.Get();
+    res.pixelShader           = g_renderer.pixelShader.Get();
+    res.vertexBuffer          = g_renderer.vertexBuffer.Get();
+    res.indexBuffer           = g_renderer.indexBuffer.Get();
+    res.constantBuffer        = g_renderer.constantBuffer.Get();
+    res.instanceBuffer        = g_renderer.instanceBuffer.Get();
+    res.overlayConstantBuffer = g_renderer.overlayConstantBuffer.Get();
+    res.constantArena         = g_renderer.constantArenaBuffer ? &g_renderer.constantArena : nullptr;
+
+    PrimitiveBatcher& batcher = g_renderer.batcher;
+    InitPrimitiveBatcher(batcher,
+                         &g_renderer.stateTracker,
+                         g_renderer.batchVertexBuffer.Get(),
+                         kBatchVertexCapacity,
+                         g_renderer.batchIndexBuffer.Get(),
+                         kBatchIndexCapacity);
+    batcher.inputLayout  = g_renderer.batchInputLayout.Get();
+    batcher.vertexShader = res.vertexShader;
+    batcher.pixelShader  = res.pixelShader;
 
     return true;
 }
@@ -704,11 +1154,28 @@ LRESULT CALLBACK WndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam)
             return DefWindowProc(hWnd, message, wParam, lParam);
 
         case WM_KEYDOWN:
-            g_windowContext.isKeyDown[wParam] = true;
+        case WM_KEYUP:
+            if (!g_windowContext.inputQueue.Push(InputEvent { NowNanoseconds(), static_cast<uint8_t>(wParam), message == WM_KEYDOWN }))
+                ++g_windowContext.droppedInputEvents;
             break;
 
-        case WM_KEYUP:
-            g_windowContext.isKeyDown[wParam] = false;
+        case WM_SIZE:
+            g_windowContext.minimized = wParam == SIZE_MINIMIZED;
+            if (!g_windowContext.minimized && LOWORD(lParam) > 0 && HIWORD(lParam) > 0)
+            {
+                g_windowContext.pendingSize[0] = LOWORD(lParam);
+                g_windowContext.pendingSize[1] = HIWORD(lParam);
+                g_windowContext.resizePending  = true;
+            }
+            break;
+
+        case WM_LBUTTONDOWN:
+            if (!ImGui::GetIO().WantCaptureMouse)
+            {
+                g_windowContext.pickPixel[0] = GET_X_LPARAM(lParam);
+                g_windowContext.pickPixel[1] = GET_Y_LPARAM(lParam);
+                g_windowContext.pickPending  = true;
+            }
             break;
     }
     return 0;
@@ -738,34 +1205,560 @@ bool D3DCheckFail(HRESULT hr, const wchar_t* msg)
 {
     if (FAILED(hr))
     {
-        _com_error         err(hr);
-        LPCTSTR            errMsg = err.ErrorMessage();
-        std::wstringstream wss;
-        wss << L"Error: " << errMsg << L"\n"
-            << msg << L"\n";
-        OutputDebugString(wss.str().c_str());
+        _com_error err(hr);
+        wchar_t    text[512];
+        swprintf_s(text, L"Error: %s\n%s\n", err.ErrorMessage(), msg);
+        OutputDebugStringW(text);
         return true;
     }
     return false;
 }
 
-bool UpdateConstantBuffer(void* data, size_t size, ComPtr<ID3D11Buffer>& buffer)
+bool CreateSizeDependentTargets(UINT width, UINT height)
 {
-    D3D11_MAPPED_SUBRESOURCE mappedResource;
+    ComPtr<ID3D11Texture2D>& backBuffer = g_renderer.backBuffer;
     if (D3DCheckFail(
-            g_renderer.context->Map(buffer.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedResource),
-            L"Map Fail"))
+            g_renderer.swapChain->GetBuffer(0, __uuidof(ID3D11Texture2D), &backBuffer),
+            L"GetBuffer Fail"))
     {
         return false;
     }
 
-    memcpy(mappedResource.pData, data, size);
+    if (D3DCheckFail(
+            g_renderer.device->CreateRenderTargetView(
+                backBuffer.Get(),
+                nullptr,
+                g_renderer.renderTargetView.GetAddressOf()),
+            L"CreateRenderTargetView Fail"))
+    {
+        return false;
+    }
 
-    g_renderer.context->Unmap(buffer.Get(), 0);
+    D3D11_TEXTURE2D_DESC desc = {};
+    desc.Width                = width;
+    desc.Height               = height;
+    desc.MipLevels            = 1;
+    desc.ArraySize            = 1;
+    desc.Format               = DXGI_FORMAT_R8G8B8A8_UNORM;
+    desc.SampleDesc.Count     = 4;
+    desc.SampleDesc.Quality   = g_renderer.sampleQuality - 1;
+    desc.Usage                = D3D11_USAGE_DEFAULT;
+    desc.BindFlags            = D3D11_BIND_RENDER_TARGET;
+
+    if (D3DCheckFail(
+            g_renderer.device->CreateTexture2D(&desc, nullptr, g_renderer.sceneTarget.GetAddressOf()),
+            L"CreateTexture2D Fail") ||
+        D3DCheckFail(
+            g_renderer.device->CreateRenderTargetView(g_renderer.sceneTarget.Get(), nullptr, g_renderer.sceneTargetView.GetAddressOf()),
+            L"CreateRenderTargetView Fail"))
+    {
+        return false;
+    }
+
+    desc.SampleDesc.Count   = 1;
+    desc.SampleDesc.Quality = 0;
+    desc.BindFlags          = D3D11_BIND_SHADER_RESOURCE;
+
+    if (D3DCheckFail(
+            g_renderer.device->CreateTexture2D(&desc, nullptr, g_renderer.resolvedTarget.GetAddressOf()),
+            L"CreateTexture2D Fail") ||
+        D3DCheckFail(
+            g_renderer.device->CreateShaderResourceView(g_renderer.resolvedTarget.Get(), nullptr, g_renderer.resolvedView.GetAddressOf()),
+            L"CreateShaderResourceView Fail"))
+    {
+        return false;
+    }
+
+    g_renderer.outputViewport = RenderViewport {
+        0.f,
+        0.f,
+        static_cast<float>(width),
+        static_cast<float>(height),
+        0.f,
+        1.f
+    };
+    g_renderer.resources.viewport         = g_renderer.outputViewport;
+    g_renderer.resources.renderTargetView = g_renderer.sceneTargetView.Get();
+    SetDynamicResolutionOutput(g_renderer.dynamicResolution, width, height);
+
+    return true;
+}
+
+bool ResizeSwapChain(UINT width, UINT height)
+{
+    // ResizeBuffers fails while any view of the old buffers is alive or bound
+    ID3D11ShaderResourceView* nullView = nullptr;
+    g_renderer.context->OMSetRenderTargets(0, nullptr, nullptr);
+    g_renderer.context->PSSetShaderResources(0, 1, &nullView);
+    g_renderer.stateTracker.Invalidate();
+
+    g_renderer.resources.renderTargetView = nullptr;
+    g_renderer.renderTargetView.Reset();
+    g_renderer.backBuffer.Reset();
+    g_renderer.sceneTargetView.Reset();
+    g_renderer.sceneTarget.Reset();
+    g_renderer.resolvedView.Reset();
+    g_renderer.resolvedTarget.Reset();
+
+    if (D3DCheckFail(
+            g_renderer.swapChain->ResizeBuffers(0, width, height, DXGI_FORMAT_UNKNOWN, 0),
+            L"ResizeBuffers Fail"))
+    {
+        return false;
+    }
+
+    return CreateSizeDependentTargets(width, height);
+}
+
+void CurrentRenderSize(uint32_t& width, uint32_t& height)
+{
+    if (g_renderer.dynamicResolutionEnabled)
+        DynamicRenderSize(g_renderer.dynamicResolution, width, height);
+    else
+    {
+        width  = g_renderer.dynamicResolution.outputWidth;
+        height = g_renderer.dynamicResolution.outputHeight;
+    }
+}
+
+void UpscaleToBackBuffer(uint32_t renderWidth, uint32_t renderHeight)
+{
+    PROFILE_SCOPE("Upscale");
+
+    ID3D11DeviceContext*  context = g_renderer.context.Get();
+    StateTrackingContext& tracker = g_renderer.stateTracker;
+    const RenderViewport& output  = g_renderer.outputViewport;
+
+    // fallback while the upscale shaders build: the scene was rendered at full size;
+    // the back buffer still has to be bound for the overlay and imgui
+    if (!g_renderer.upscaleReady)
+    {
+        context->ResolveSubresource(g_renderer.backBuffer.Get(), 0, g_renderer.sceneTarget.Get(), 0, DXGI_FORMAT_R8G8B8A8_UNORM);
+        tracker.SetRenderTarget(g_renderer.renderTargetView.Get());
+        tracker.SetViewport(output);
+        return;
+    }
+
+    context->ResolveSubresource(g_renderer.resolvedTarget.Get(), 0, g_renderer.sceneTarget.Get(), 0, DXGI_FORMAT_R8G8B8A8_UNORM);
+
+    // only the rendered corner is sampled; the clamp keeps bilinear taps off
+    // the stale texels next to it
+    UpscaleConstants constants;
+    constants.uvScale[0] = renderWidth / output.width;
+    constants.uvScale[1] = renderHeight / output.height;
+    constants.uvClamp[0] = (renderWidth - 0.5f) / output.width;
+    constants.uvClamp[1] = (renderHeight - 0.5f) / output.height;
+    UpdateConstantBuffer(tracker, g_renderer.upscaleConstantBuffer.Get(), &constants, sizeof(constants));
+
+    tracker.SetRenderTarget(g_renderer.renderTargetView.Get());
+    tracker.SetViewport(output);
+    tracker.SetPrimitiveTopology(PrimitiveTopology::TriangleList);
+    tracker.SetInputLayout(nullptr);
+    tracker.SetVertexShader(g_renderer.upscaleVertexShader.Get());
+    tracker.SetVSConstantBuffer(1, g_renderer.upscaleConstantBuffer.Get());
+    tracker.SetPixelShader(g_renderer.upscalePixelShader.Get());
+
+    // texture, sampler and the non-indexed draw are outside IRenderContext and
+    // not shadowed, so they go to the device directly
+    ID3D11ShaderResourceView* view    = g_renderer.resolvedView.Get();
+    ID3D11SamplerState*       sampler = g_renderer.linearSampler.Get();
+    context->PSSetShaderResources(0, 1, &view);
+    context->PSSetSamplers(0, 1, &sampler);
+    context->Draw(3, 0);
+
+    view = nullptr;
+    context->PSSetShaderResources(0, 1, &view);
+}
+
+void BeginGpuTimer()
+{
+    int slot = static_cast<int>(g_renderer.gpuTimerFrames % kGpuTimerFrames);
+
+    g_renderer.gpuTimerLevel[slot] = g_renderer.dynamicResolutionEnabled && g_renderer.upscaleReady ? g_renderer.dynamicResolution.level : -1;
+    g_renderer.context->Begin(g_renderer.gpuDisjoint[slot].Get());
+    g_renderer.context->End(g_renderer.gpuBegin[slot].Get());
+}
+
+void EndGpuTimer()
+{
+    ID3D11DeviceContext* context = g_renderer.context.Get();
+
+    int slot = static_cast<int>(g_renderer.gpuTimerFrames++ % kGpuTimerFrames);
+    context->End(g_renderer.gpuEnd[slot].Get());
+    context->End(g_renderer.gpuDisjoint[slot].Get());
+
+    // oldest slot; one that is not ready yet is simply skipped
+    if (g_renderer.gpuTimerFrames < kGpuTimerFrames)
+        return;
+
+    slot = static_cast<int>(g_renderer.gpuTimerFrames % kGpuTimerFrames);
+
+    D3D11_QUERY_DATA_TIMESTAMP_DISJOINT disjoint;
+    UINT64                              begin = 0;
+    UINT64                              end   = 0;
+    if (context->GetData(g_renderer.gpuDisjoint[slot].Get(), &disjoint, sizeof(disjoint), D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK ||
+        context->GetData(g_renderer.gpuBegin[slot].Get(), &begin, sizeof(begin), D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK ||
+        context->GetData(g_renderer.gpuEnd[slot].Get(), &end, sizeof(end), D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK ||
+        disjoint.Disjoint)
+    {
+        return;
+    }
+
+    g_renderer.gpuFrameMs = static_cast<float>(static_cast<double>(end - begin) * 1000.0 / disjoint.Frequency);
+
+    // a frame timed at another scale says nothing about the current one
+    if (g_renderer.dynamicResolutionEnabled && g_renderer.gpuTimerLevel[slot] == g_renderer.dynamicResolution.level)
+        UpdateDynamicResolution(g_renderer.dynamicResolution, g_renderer.gpuFrameMs);
+}
+
+void BeginConstantFrame()
+{
+    if (!g_renderer.resources.constantArena)
+        return;
+
+    ID3D11DeviceContext* context = g_renderer.context.Get();
+    uint64_t             frame   = ++g_renderer.arenaFrame;
+
+    // fences signal in order; wait only when the oldest one's slot is needed for this frame
+    while (g_renderer.completedFrame + 1 < frame)
+    {
+        bool         mustWait = g_renderer.completedFrame + kFrameFences < frame;
+        ID3D11Query* fence    = g_renderer.frameFence[(g_renderer.completedFrame + 1) % kFrameFences].Get();
+
+        BOOL    done = FALSE;
+        HRESULT hr   = context->GetData(fence, &done, sizeof(done), mustWait ? 0 : D3D11_ASYNC_GETDATA_DONOTFLUSH);
+        if (hr == S_OK)
+            ++g_renderer.completedFrame;
+        else if (hr != S_FALSE || !mustWait)
+            break;
+    }
+
+    BeginConstantArenaFrame(g_renderer.constantArena, frame, g_renderer.completedFrame);
+}
+
+void EndConstantFrame()
+{
+    if (!g_renderer.resources.constantArena)
+        return;
+
+    EndConstantArenaFrame(g_renderer.constantArena);
+    g_renderer.context->End(g_renderer.frameFence[g_renderer.arenaFrame % kFrameFences].Get());
+}
+
+// every shader of the demo, one entry point each
+const char* g_shaderCode = R"(
+    cbuffer cb : register(b0)
+    {
+        row_major matrix world;
+    }
+
+    struct VS_INPUT
+    {
+        float2 posL : POSITION;
+        float3 color : COLOR;
+    };
+
+    struct PS_INPUT
+    {
+        float4 posH : SV_POSITION;
+        float3 color : COLOR;
+    };
+
+    struct VS_INSTANCED_INPUT
+    {
+        float2 posL : POSITION;
+        float3 color : COLOR;
+        row_major float4x4 world : WORLD;
+    };
+
+    PS_INPUT VSmain(VS_INPUT input)
+    {
+        PS_INPUT output;
+        output.posH = mul(float4(input.posL, 0.f, 1.f), world);
+        output.color = input.color;
+        return output;
+    }
+
+    PS_INPUT VSmainInstanced(VS_INSTANCED_INPUT input)
+    {
+        PS_INPUT output;
+        output.posH = mul(float4(input.posL, 0.f, 1.f), input.world);
+        output.color = input.color;
+        return output;
+    }
+
+    float4 PSmain(PS_INPUT input) : SV_TARGET
+    {
+        return float4(input.color, 1.f);
+    }
+
+    cbuffer upscale : register(b1)
+    {
+        float2 uvScale;
+        float2 uvClamp;
+    }
+
+    Texture2D    sceneTexture : register(t0);
+    SamplerState linearSampler : register(s0);
+
+    struct UPSCALE_INPUT
+    {
+        float4 posH : SV_POSITION;
+        float2 uv : TEXCOORD0;
+        nointerpolation float2 uvClamp : TEXCOORD1;
+    };
+
+    // one triangle covering the viewport, no vertex buffer
+    UPSCALE_INPUT VSupscale(uint id : SV_VertexID)
+    {
+        float2 corner = float2((id << 1) & 2, id & 2);
+
+        UPSCALE_INPUT output;
+        output.posH = float4(corner * float2(2.f, -2.f) + float2(-1.f, 1.f), 0.f, 1.f);
+        output.uv = corner * uvScale;
+        output.uvClamp = uvClamp;
+        return output;
+    }
+
+    float4 PSupscale(UPSCALE_INPUT input) : SV_TARGET
+    {
+        return sceneTexture.Sample(linearSampler, min(input.uv, input.uvClamp));
+    }
+)";
+
+// Shader objects, created on the builder threads: the device creates from any
+// thread, the immediate context is not touched.
+
+bool CreateSceneShaderObjects(void* user, const ShaderBuild& build, std::string& errors)
+{
+    D3DRenderer& r = *static_cast<D3DRenderer*>(user);
+
+    if (D3DCheckFail(
+            r.device->CreateVertexShader(
+                build.bytecode.data(),
+                build.bytecode.size(),
+                nullptr,
+                r.vertexShader.GetAddressOf()),
+            L"CreateVertexShader Fail"))
+    {
+        errors = "CreateVertexShader failed\n";
+        return false;
+    }
+
+    // Input Layout
+    const VertexLayout&      sceneLayout = GetVertexLayout(r.sceneFormat);
+    D3D11_INPUT_ELEMENT_DESC inputDesc[VertexLayout::kMaxElements];
+    BuildInputElements(sceneLayout, inputDesc);
+
+    if (D3DCheckFail(
+            r.device->CreateInputLayout(
+                inputDesc,
+                sceneLayout.elementCount,
+                build.bytecode.data(),
+                build.bytecode.size(),
+                r.inputLayout.GetAddressOf()),
+            L"CreateInputLayout Fail"))
+    {
+        errors = "CreateInputLayout failed\n";
+        return false;
+    }
+
+    // the batcher writes float vertices whatever the scene uses
+    const VertexLayout&      batchLayout = GetVertexLayout(VertexFormat::Float32);
+    D3D11_INPUT_ELEMENT_DESC batchInputDesc[VertexLayout::kMaxElements];
+    BuildInputElements(batchLayout, batchInputDesc);
+
+    if (D3DCheckFail(
+            r.device->CreateInputLayout(
+                batchInputDesc,
+                batchLayout.elementCount,
+                build.bytecode.data(),
+                build.bytecode.size(),
+                r.batchInputLayout.GetAddressOf()),
+            L"CreateInputLayout Fail"))
+    {
+        errors = "CreateInputLayout failed\n";
+        return false;
+    }
 
     return true;
 }
 
+bool CreateInstancedShaderObjects(void* user, const ShaderBuild& build, std::string& errors)
+{
+    D3DRenderer& r = *static_cast<D3DRenderer*>(user);
+
+    if (D3DCheckFail(
+            r.device->CreateVertexShader(
+                build.bytecode.data(),
+                build.bytecode.size(),
+                nullptr,
+                r.instancedVertexShader.GetAddressOf()),
+            L"CreateVertexShader Fail"))
+    {
+        errors = "CreateVertexShader failed\n";
+        return false;
+    }
+
+    // Instanced Input Layout: slot 0 per vertex, slot 1 per instance
+    D3D11_INPUT_ELEMENT_DESC instancedInputDesc[] = {
+        {},
+        {},
+        { "WORLD", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 0, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+        { "WORLD", 1, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 16, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+        { "WORLD", 2, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 32, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+        { "WORLD", 3, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 48, D3D11_INPUT_PER_INSTANCE_DATA, 1 }
+    };
+    static_assert(VertexLayout::kMaxElements == 2, "per-vertex elements fill the first two entries");
+    BuildInputElements(GetVertexLayout(r.sceneFormat), instancedInputDesc);
+
+    if (D3DCheckFail(
+            r.device->CreateInputLayout(
+                instancedInputDesc,
+                _countof(instancedInputDesc),
+                build.bytecode.data(),
+                build.bytecode.size(),
+                r.instancedInputLayout.GetAddressOf()),
+            L"CreateInputLayout Fail"))
+    {
+        errors = "CreateInputLayout failed\n";
+        return false;
+    }
+
+    return true;
+}
+
+// user: the ComPtr<ID3D11VertexShader> to fill
+bool CreateVertexShaderObject(void* user, const ShaderBuild& build, std::string& errors)
+{
+    auto& shader = *static_cast<ComPtr<ID3D11VertexShader>*>(user);
+
+    if (D3DCheckFail(
+            g_renderer.device->CreateVertexShader(build.bytecode.data(), build.bytecode.size(), nullptr, shader.GetAddressOf()),
+            L"CreateVertexShader Fail"))
+    {
+        errors = "CreateVertexShader failed\n";
+        return false;
+    }
+    return true;
+}
+
+// user: the ComPtr<ID3D11PixelShader> to fill
+bool CreatePixelShaderObject(void* user, const ShaderBuild& build, std::string& errors)
+{
+    auto& shader = *static_cast<ComPtr<ID3D11PixelShader>*>(user);
+
+    if (D3DCheckFail(
+            g_renderer.device->CreatePixelShader(build.bytecode.data(), build.bytecode.size(), nullptr, shader.GetAddressOf()),
+            L"CreatePixelShader Fail"))
+    {
+        errors = "CreatePixelShader failed\n";
+        return false;
+    }
+    return true;
+}
+
+void QueueShaderBuilds()
+{
+    // Shader bytecode cache, D3DCompile only runs on a miss
+    OpenShaderCache(g_renderer.shaderCache, "shader_cache.bin", 4 << 20);
+
+    AsyncShaderBuilder& builder = g_renderer.shaderBuilder;
+    StartShaderBuilder(builder, g_renderer.shaderCompiler, &g_renderer.shaderCache, 0);
+
+    ShaderCompileRequest request;
+    request.source     = g_shaderCode;
+    request.sourceSize = strlen(g_shaderCode);
+
+    // Critical: the scene triangle and the batcher draw with these
+    request.entryPoint = "VSmain";
+    request.target     = "vs_5_0";
+    QueueShaderBuild(builder, "Scene VS", request, true, CreateSceneShaderObjects, &g_renderer);
+
+    request.entryPoint = "PSmain";
+    request.target     = "ps_5_0";
+    QueueShaderBuild(builder, "Scene PS", request, true, CreatePixelShaderObject, &g_renderer.pixelShader);
+
+    // Deferred: instances are skipped and the upscale is a plain resolve until these are ready
+    request.entryPoint         = "VSmainInstanced";
+    request.target             = "vs_5_0";
+    g_renderer.instancedBuild  = &QueueShaderBuild(builder, "Instanced VS", request, false, CreateInstancedShaderObjects, &g_renderer);
+
+    request.entryPoint         = "VSupscale";
+    request.target             = "vs_5_0";
+    g_renderer.upscaleBuild[0] = &QueueShaderBuild(builder, "Upscale VS", request, false, CreateVertexShaderObject, &g_renderer.upscaleVertexShader);
+
+    request.entryPoint         = "PSupscale";
+    request.target             = "ps_5_0";
+    g_renderer.upscaleBuild[1] = &QueueShaderBuild(builder, "Upscale PS", request, false, CreatePixelShaderObject, &g_renderer.upscalePixelShader);
+}
+
+void PollShaderBuilds()
+{
+    if (g_renderer.shadersSettled)
+        return;
+
+    // first, so a build that finishes meanwhile is still swapped in below
+    bool allDone = CollectShaderBuilds(g_renderer.shaderBuilder);
+
+    RenderResources& res = g_renderer.resources;
+    if (!res.instancedVertexShader && IsShaderBuildReady(*g_renderer.instancedBuild))
+    {
+        res.instancedInputLayout  = g_renderer.instancedInputLayout.Get();
+        res.instancedVertexShader = g_renderer.instancedVertexShader.Get();
+    }
+    g_renderer.upscaleReady = IsShaderBuildReady(*g_renderer.upscaleBuild[0]) && IsShaderBuildReady(*g_renderer.upscaleBuild[1]);
+
+    if (allDone)
+    {
+        StopShaderBuilder(g_renderer.shaderBuilder);
+        SettleShaderBuilds();
+    }
+}
+
+// Every build done and the builder stopped: save the cache, log the totals.
+void SettleShaderBuilds()
+{
+    g_renderer.shadersSettled = true;
+    LogShaderBuildFailures();
+
+    const StartupTimer& startup     = g_windowContext.startup;
+    uint64_t            lastReadyNs = startup.beginNs;
+    for (const auto& build : g_renderer.shaderBuilder.builds)
+        lastReadyNs = std::max(lastReadyNs, build->readyNs);
+    g_windowContext.allShadersMs = (lastReadyNs - startup.beginNs) / 1e6;
+
+    // a failed save only costs a recompile next start
+    ShaderCache& shaderCache = g_renderer.shaderCache;
+    if (!SaveShaderCache(shaderCache))
+        OutputDebugStringA("SaveShaderCache failed\n");
+
+    char cacheLog[160];
+    sprintf_s(cacheLog,
+              "Shader cache: %u hits, %u misses, %u corrupt, %.2f ms compiling; all shaders ready %.2f ms after start\n",
+              shaderCache.stats.hits,
+              shaderCache.stats.misses,
+              shaderCache.stats.corrupt,
+              shaderCache.stats.compileMs,
+              g_windowContext.allShadersMs);
+    OutputDebugStringA(cacheLog);
+    CloseShaderCache(shaderCache);
+}
+
+void LogShaderBuildFailures()
+{
+    for (const auto& build : g_renderer.shaderBuilder.builds)
+    {
+        if (!IsShaderBuildDone(*build) || IsShaderBuildReady(*build))
+            continue;
+
+        OutputDebugStringA("Shader build failed: ");
+        OutputDebugStringA(build->name);
+        OutputDebugStringA("\n");
+        OutputDebugStringA(build->errors.c_str());
+    }
+}
+
 void RenderImgui()
 {
     ImGui_ImplDX11_NewFrame();
@@ -775,13 +1768,179 @@ void RenderImgui()
     {
         ImGui::Begin("Triangle");
 
-        ImGui::SliderFloat2("Position", &g_renderer.triPosition.x, -1.f, 1.f);
-        ImGui::SliderFloat2("Scale", &g_renderer.triScale.x, 0.f, 1.f);
-        ImGui::SliderAngle("Rotation", &g_renderer.triRotation);
+        // with the simulation thread running the UI shows the snapshot and posts edits back
+        SceneControls controls = g_snapshot ? g_snapshot->controls : GetSceneControls(g_scene);
+        bool          edited   = false;
+
+        edited |= ImGui::SliderFloat2("Position", controls.triPosition, -1.f, 1.f);
+        edited |= ImGui::SliderFloat2("Scale", controls.triScale, 0.f, 1.f);
+        edited |= ImGui::SliderAngle("Rotation", &controls.triRotation);
+
+        ImGui::Separator();
+        edited |= ImGui::SliderInt("Instances", &controls.requestedInstanceCount, 0, kMaxSceneInstances);
+        edited |= ImGui::SliderFloat("Spin speed", &controls.instanceSpinSpeed, -5.f, 5.f);
+        edited |= ImGui::SliderFloat("Layout extent", &controls.instanceExtent, 0.1f, 16.f);
+        edited |= ImGui::Checkbox("Cull instances", &controls.cullInstances);
+
+        if (edited && g_snapshot)
+        {
+            g_windowContext.controlEdits    = controls;
+            g_windowContext.hasControlEdits = true;
+        }
+        else if (edited)
+        {
+            // replayed after the update, same as here
+            ApplySceneControls(g_scene, controls);
+            g_windowContext.captureFrame.hasControls = true;
+            g_windowContext.captureFrame.controls    = controls;
+        }
+
+        ImGui::Separator();
+        ImGui::Checkbox("Simulation thread", &g_windowContext.threadedSimulation);
+        if (ImGui::SliderInt("Frame lag", &g_windowContext.simulationFrameLag, 0, 2))
+            SetSimulationFrameLag(g_simulation, g_windowContext.simulationFrameLag);
+        if (g_snapshot)
+            ImGui::Text("Snapshot %llu, skipped %llu", g_snapshot->frame, g_simulation.skippedSnapshots);
+
+        if (g_snapshot)
+            ImGui::TextUnformatted("The job system needs the simulation on this thread");
+        else
+        {
+            bool splitInstances = g_scene.jobs != nullptr;
+            if (ImGui::Checkbox("Job system", &splitInstances))
+                g_scene.jobs = splitInstances ? &g_jobs : nullptr;
+        }
+        ImGui::Text("%u workers, %llu jobs, %llu steals", g_jobs.workerCount, JobsRun(g_jobs), JobSteals(g_jobs));
+
+        ImGui::Separator();
+        InputCaptureWriter& capture = g_windowContext.inputCapture;
+        if (g_snapshot)
+            ImGui::TextUnformatted("Input capture needs the simulation on this thread");
+        else if (capture.file)
+        {
+            ImGui::Text("Capturing %u frames, %llu bytes", capture.frames, capture.bytes);
+            if (ImGui::Button("Stop capture") && !EndInputCapture(capture))
+                OutputDebugStringA("EndInputCapture failed\n");
+        }
+        else if (ImGui::Button("Capture input (restarts the scene)"))
+            g_windowContext.captureRequested = true;
+
+        ImGui::Separator();
+        LinearAllocator& scratch = g_windowContext.frameAllocator;
+        FrameTimeStats   latency = ComputeFrameTimeStats(g_windowContext.inputTracker.latency, scratch);
+        ImGui::Text("Input to submit: p50 %.2f  p95 %.2f  max %.2f ms", latency.p50Ms, latency.p95Ms, latency.maxMs);
+        ImGui::Text("Input events %llu, dropped %llu", g_windowContext.inputTracker.consumed, g_windowContext.droppedInputEvents);
+
+        ImGui::Separator();
+        ImGui::Text("Drawn instances %zu", g_snapshot ? g_snapshot->instances.size() : g_scene.drawnInstances);
+        if (g_snapshot)
+            ImGui::TextUnformatted("Picking needs the simulation on this thread");
+        else if (g_windowContext.pickedInstance >= 0)
+            ImGui::Text("Picked instance %d", g_windowContext.pickedInstance);
+        else
+            ImGui::TextUnformatted("Click an instance to pick it");
+
+        ImGui::Separator();
+        FramePacer& pacer     = g_windowContext.pacer;
+        float       targetFps = static_cast<float>(pacer.targetFps);
+        ImGui::Checkbox("VSync", &g_windowContext.vsync);
+        if (ImGui::SliderFloat("Target FPS (0 = uncapped)", &targetFps, 0.f, 480.f, "%.0f"))
+            SetFramePacerTarget(pacer, targetFps);
+        if (ImGui::SliderInt("Max frames in flight", &pacer.maxFramesInFlight, 1, 3))
+            g_renderer.dxgiDevice->SetMaximumFrameLatency(pacer.maxFramesInFlight);
+
+        FrameTimeStats intervals = ComputeFrameTimeStats(pacer.intervals, scratch);
+        FrameTimeStats lateness  = ComputeFrameTimeStats(pacer.lateness, scratch);
+        ImGui::Text("Interval p50 %.3f  p99 %.3f ms, late p99 %.3f  max %.3f ms", intervals.p50Ms, intervals.p99Ms, lateness.p99Ms, lateness.maxMs);
+        ImGui::Text("Missed %llu, sleep slack %.2f ms", pacer.missedDeadlines, pacer.sleepSlackNs / 1e6);
+
+        ImGui::Separator();
+        DynamicResolution& dynamicResolution = g_renderer.dynamicResolution;
+        uint32_t           renderWidth       = 0;
+        uint32_t           renderHeight      = 0;
+        CurrentRenderSize(renderWidth, renderHeight);
+        ImGui::Checkbox("Dynamic resolution", &g_renderer.dynamicResolutionEnabled);
+        ImGui::SliderFloat("GPU budget ms", &dynamicResolution.settings.budgetMs, 0.5f, 33.f);
+        ImGui::Text("Render %ux%u of %ux%u, GPU %.3f ms", renderWidth, renderHeight, dynamicResolution.outputWidth, dynamicResolution.outputHeight, g_renderer.gpuFrameMs);
+        ImGui::Text("Scale %.2f, lowered %llu, raised %llu", DynamicResolutionScale(dynamicResolution), dynamicResolution.lowered, dynamicResolution.raised);
+
+        ImGui::Separator();
+        const StartupTimer& startup = g_windowContext.startup;
+        for (uint32_t i = 0; i < startup.count; ++i)
+            ImGui::Text("Startup %-18s %8.2f ms", startup.names[i], startup.ms[i]);
+        if (g_renderer.shadersSettled)
+            ImGui::Text("First present %.2f ms, all shaders %.2f ms", StartupTotalMs(startup), g_windowContext.allShadersMs);
+        else
+            ImGui::Text("First present %.2f ms, shaders still building", StartupTotalMs(startup));
+
+        ImGui::Separator();
+        FrameTimeStats stats = ComputeFrameTimeStats(g_windowContext.frameTimer, scratch);
+        ImGui::Text("Delta time: %.3f ms", g_windowContext.deltaTime * 1000.f);
+        ImGui::Text("FPS (mean of %zu): %.2f", stats.samples, stats.meanMs > 0.0 ? 1000.0 / stats.meanMs : 0.0);
+        ImGui::Text("p50 %.3f  p95 %.3f  p99 %.3f  max %.3f ms", stats.p50Ms, stats.p95Ms, stats.p99Ms, stats.maxMs);
+
+        float* frameTimesMs   = LinearAllocateArray<float>(scratch, 256);
+        size_t frameTimeCount = frameTimesMs ? CopyFrameTimesMs(g_windowContext.frameTimer, frameTimesMs, 256) : 0;
+        ImGui::PlotLines("Frame ms",
+                         frameTimesMs,
+                         static_cast<int>(frameTimeCount),
+                         0,
+                         nullptr,
+                         0.f,
+                         static_cast<float>(stats.p99Ms * 2.0),
+                         ImVec2(0.f, 80.f));
+
+        // 0.5 ms buckets
+        uint32_t bucketCounts[64];
+        float    histogramCounts[64];
+        CountFrameTimeBuckets(g_windowContext.frameTimer, 0.5, bucketCounts, _countof(bucketCounts));
+        for (size_t i = 0; i < _countof(bucketCounts); ++i)
+            histogramCounts[i] = static_cast<float>(bucketCounts[i]);
+        ImGui::PlotHistogram("Histogram", histogramCounts, _countof(histogramCounts), 0, nullptr, 0.f, FLT_MAX, ImVec2(0.f, 80.f));
+
+        if (ImGui::Button("Export CSV"))
+            ExportFrameTimesCSV(g_windowContext.frameTimer, "frame_times.csv");
+        ImGui::SameLine();
+        if (ImGui::Button("Export JSON"))
+            ExportFrameTimesJSON(g_windowContext.frameTimer, "frame_times.json");
 
         ImGui::Separator();
-        ImGui::Text("Delta time: %.3f sec", g_windowContext.deltaTime);
-        ImGui::Text("FPS: %.2f", 1 / g_windowContext.deltaTime);
+        const HeapPhaseStats& heap = g_windowContext.lastFrameHeap;
+        ImGui::Text("Heap allocations last frame: %llu", TotalHeapAllocations(heap));
+        for (uint32_t i = 0; i < heap.count; ++i)
+            ImGui::Text("  %s %llu (%llu bytes)", heap.names[i], heap.allocations[i], heap.bytes[i]);
+        ImGui::Text("Frame scratch %zu / %zu bytes, %llu failed", g_windowContext.frameAllocator.peak, g_windowContext.frameAllocator.capacity, g_windowContext.frameAllocator.failures);
+
+        ImGui::Separator();
+        const BindStats& binds = g_renderer.stateTracker.frame;
+        ImGui::Text("Binds issued %llu  elided %llu", TotalIssued(binds), TotalElided(binds));
+        if (g_renderer.resources.constantArena)
+        {
+            const ConstantArena& arena = g_renderer.constantArena;
+            ImGui::Text("Constant arena: %llu blocks, %llu maps, %llu bytes%s",
+                        arena.frame.blocks,
+                        arena.frame.maps,
+                        arena.frame.bytes,
+                        arena.discardEachFrame ? " (discard per frame)" : "");
+        }
+        else
+            ImGui::TextUnformatted("Constant arena unsupported, per-draw constant buffers");
+
+        ImGui::Separator();
+        const BatcherStats& batch = g_renderer.batcher.frame;
+        ImGui::Checkbox("Debug overlay", &g_windowContext.showOverlay);
+        ImGui::Text("Batched %llu vertices in %llu draws, %llu ring wraps", batch.vertices, batch.draws, g_renderer.batcher.vertexRing.wraps);
+
+        ImGui::Separator();
+        if (g_windowContext.profileFramesLeft > 0)
+            ImGui::Text("Capturing... %d frames left", g_windowContext.profileFramesLeft);
+        else if (ImGui::Button("Capture 120 frames"))
+        {
+            // the current frame is the first one collected
+            g_windowContext.profileCapture    = {};
+            g_windowContext.profileFirstFrame = g_windowContext.frameTimer.frameCount;
+            g_windowContext.profileFramesLeft = 120;
+        }
 
         ImGui::End();
     }
@@ -0,0 +1,83 @@
+#include "FrameAllocator.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+    uintptr_t AlignUp(uintptr_t value, size_t alignment)
+    {
+        return (value + alignment - 1) & ~static_cast<uintptr_t>(alignment - 1);
+    }
+}   // namespace
+
+void InitLinearAllocator(LinearAllocator& allocator, size_t capacity)
+{
+    allocator          = LinearAllocator {};
+    allocator.storage  = std::make_unique<uint8_t[]>(capacity);
+    allocator.capacity = capacity;
+}
+
+void* LinearAllocate(LinearAllocator& allocator, size_t size, size_t alignment)
+{
+    // align the address, not the offset: the block itself is only new[]-aligned
+    uintptr_t base  = reinterpret_cast<uintptr_t>(allocator.storage.get());
+    uintptr_t begin = AlignUp(base + allocator.used, alignment);
+    if (begin + size > base + allocator.capacity)
+    {
+        ++allocator.failures;
+        return nullptr;
+    }
+
+    allocator.used = begin + size - base;
+    allocator.peak = std::max(allocator.peak, allocator.used);
+    return reinterpret_cast<void*>(begin);
+}
+
+void ResetLinearAllocator(LinearAllocator& allocator)
+{
+    allocator.used = 0;
+}
+
+void InitPoolAllocator(PoolAllocator& pool, size_t objectSize, size_t objectAlignment, uint32_t capacity)
+{
+    size_t alignment = std::max(objectAlignment, alignof(uint32_t));
+
+    pool          = PoolAllocator {};
+    pool.slotSize = AlignUp(std::max(objectSize, sizeof(uint32_t)), alignment);
+    pool.capacity = capacity;
+    pool.storage  = std::make_unique<uint8_t[]>(pool.slotSize * capacity + alignment - 1);
+    pool.slots    = reinterpret_cast<uint8_t*>(AlignUp(reinterpret_cast<uintptr_t>(pool.storage.get()), alignment));
+
+    // every free slot holds the index of the next one
+    for (uint32_t i = 0; i < capacity; ++i)
+    {
+        uint32_t next = i + 1;
+        std::memcpy(pool.slots + i * pool.slotSize, &next, sizeof(next));
+    }
+    pool.freeHead = 0;
+}
+
+void* PoolAllocate(PoolAllocator& pool)
+{
+    if (pool.freeHead == pool.capacity)
+    {
+        ++pool.failures;
+        return nullptr;
+    }
+
+    uint8_t* slot = pool.slots + pool.freeHead * pool.slotSize;
+    std::memcpy(&pool.freeHead, slot, sizeof(pool.freeHead));
+
+    ++pool.live;
+    pool.peak = std::max(pool.peak, pool.live);
+    return slot;
+}
+
+void PoolFree(PoolAllocator& pool, void* p)
+{
+    uint8_t* slot = static_cast<uint8_t*>(p);
+    std::memcpy(slot, &pool.freeHead, sizeof(pool.freeHead));
+    pool.freeHead = static_cast<uint32_t>((slot - pool.slots) / pool.slotSize);
+    --pool.live;
+}
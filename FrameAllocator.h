@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <utility>
+
+// Bump allocator over one block reserved up front. Everything is released at
+// once by ResetLinearAllocator, normally at the frame boundary. Nothing is
+// destroyed, so only trivially destructible data belongs here.
+struct LinearAllocator
+{
+    std::unique_ptr<uint8_t[]> storage;
+    size_t                     capacity = 0;
+    size_t                     used     = 0;
+    size_t                     peak     = 0;   // high-water mark across resets
+    uint64_t                   failures = 0;   // requests that did not fit
+};
+
+void InitLinearAllocator(LinearAllocator& allocator, size_t capacity);
+
+// nullptr when the block is full; the caller falls back or drops the work.
+void* LinearAllocate(LinearAllocator& allocator, size_t size, size_t alignment);
+
+void ResetLinearAllocator(LinearAllocator& allocator);
+
+template<typename T>
+T* LinearAllocateArray(LinearAllocator& allocator, size_t count)
+{
+    return static_cast<T*>(LinearAllocate(allocator, sizeof(T) * count, alignof(T)));
+}
+
+// Fixed-size slots carved from one block and recycled through a free list
+// threaded through the free slots, for render objects created and destroyed
+// at run time without touching the heap.
+struct PoolAllocator
+{
+    std::unique_ptr<uint8_t[]> storage;
+    uint8_t*                   slots    = nullptr;   // first slot, aligned
+    size_t                     slotSize = 0;
+    uint32_t                   capacity = 0;
+    uint32_t                   freeHead = 0;   // capacity when every slot is taken
+    uint32_t                   live     = 0;
+    uint32_t                   peak     = 0;
+    uint64_t                   failures = 0;
+};
+
+void InitPoolAllocator(PoolAllocator& pool, size_t objectSize, size_t objectAlignment, uint32_t capacity);
+
+// nullptr when every slot is taken.
+void* PoolAllocate(PoolAllocator& pool);
+
+// `p` must come from this pool.
+void PoolFree(PoolAllocator& pool, void* p);
+
+template<typename T, typename... Args>
+T* PoolCreate(PoolAllocator& pool, Args&&... args)
+{
+    void* p = PoolAllocate(pool);
+    return p ? new (p) T(std::forward<Args>(args)...) : nullptr;
+}
+
+template<typename T>
+void PoolDestroy(PoolAllocator& pool, T* object)
+{
+    if (!object)
+        return;
+
+    object->~T();
+    PoolFree(pool, object);
+}
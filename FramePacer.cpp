@@ -0,0 +1,86 @@
+#include "FramePacer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+uint64_t SystemPacerClock::NowNs()
+{
+    return NowNanoseconds();
+}
+
+void SystemPacerClock::SleepNs(uint64_t ns)
+{
+    std::this_thread::sleep_for(std::chrono::nanoseconds(ns));
+}
+
+void InitFramePacer(FramePacer& pacer, IPacerClock* clock, double targetFps, size_t historyFrames)
+{
+    pacer.clock           = clock;
+    pacer.targetFps       = targetFps;
+    pacer.nextDeadlineNs  = 0;
+    pacer.sleepSlackNs    = kPacerInitialSlackNs;
+    pacer.missedDeadlines = 0;
+    pacer.spunNs          = 0;
+    pacer.overshootCursor = 0;
+    std::fill(std::begin(pacer.recentOvershootNs), std::end(pacer.recentOvershootNs), kPacerInitialSlackNs);
+    InitFrameTimer(pacer.intervals, historyFrames);
+    InitFrameTimer(pacer.lateness, historyFrames);
+}
+
+void SetFramePacerTarget(FramePacer& pacer, double targetFps)
+{
+    pacer.targetFps      = targetFps;
+    pacer.nextDeadlineNs = 0;
+}
+
+uint64_t WaitForNextFrame(FramePacer& pacer)
+{
+    IPacerClock& clock = *pacer.clock;
+
+    if (pacer.targetFps <= 0.0)
+    {
+        uint64_t now = clock.NowNs();
+        TickFrameTimer(pacer.intervals, now);
+        return now;
+    }
+
+    uint64_t period = static_cast<uint64_t>(1e9 / pacer.targetFps);
+    uint64_t now    = clock.NowNs();
+
+    if (pacer.nextDeadlineNs == 0)
+        pacer.nextDeadlineNs = now;
+    else if (now > pacer.nextDeadlineNs + period)
+    {
+        ++pacer.missedDeadlines;
+        pacer.nextDeadlineNs = now;
+    }
+
+    uint64_t deadline = pacer.nextDeadlineNs;
+
+    // sleep the bulk, then learn from how late the sleep came back
+    if (deadline > now + pacer.sleepSlackNs)
+    {
+        uint64_t request = deadline - now - pacer.sleepSlackNs;
+        clock.SleepNs(request);
+
+        uint64_t woke = clock.NowNs();
+
+        pacer.recentOvershootNs[pacer.overshootCursor++ % kPacerOvershootWindow] = woke - now > request ? woke - now - request : 0;
+
+        uint64_t worst     = *std::max_element(std::begin(pacer.recentOvershootNs), std::end(pacer.recentOvershootNs));
+        pacer.sleepSlackNs = std::max(worst + worst / 2, kPacerMinSlackNs);
+        now                = woke;
+    }
+
+    uint64_t spinBegin = now;
+    while (now < deadline)
+        now = clock.NowNs();
+    pacer.spunNs += now - spinBegin;
+
+    RecordFrameTime(pacer.lateness, now - deadline);
+    TickFrameTimer(pacer.intervals, now);
+
+    pacer.nextDeadlineNs = deadline + period;
+    return now;
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "FrameTimer.h"
+
+#include <cstdint>
+
+// Time source the pacer waits on, so tests can drive it with a fake clock.
+struct IPacerClock
+{
+    virtual ~IPacerClock() = default;
+
+    virtual uint64_t NowNs() = 0;
+
+    // May oversleep (by a scheduler tick or more on Windows); never undersleeps.
+    virtual void SleepNs(uint64_t ns) = 0;
+};
+
+// NowNanoseconds() and std::this_thread::sleep_for.
+struct SystemPacerClock : IPacerClock
+{
+    uint64_t NowNs() override;
+    void     SleepNs(uint64_t ns) override;
+};
+
+constexpr uint64_t kPacerInitialSlackNs  = 2000000;   // 2 ms
+constexpr uint64_t kPacerMinSlackNs      = 200000;    // 0.2 ms
+constexpr uint32_t kPacerOvershootWindow = 64;
+
+// Holds frames to a target rate with absolute deadlines: each frame starts at
+// the previous deadline plus the period, so waits do not accumulate error.
+// The wait sleeps until the deadline minus sleepSlackNs and spins the rest;
+// the slack is the largest oversleep of the last kPacerOvershootWindow sleeps
+// plus half again, so sleeps rarely overshoot the deadline.
+// A frame that misses its deadline by more than a period restarts the
+// schedule from now instead of running a burst of short frames to catch up.
+struct FramePacer
+{
+    IPacerClock* clock = nullptr;
+
+    double targetFps         = 0.0;   // 0 = uncapped
+    int    maxFramesInFlight = 1;     // applied by the renderer; kept here with the other pacing knobs
+
+    uint64_t nextDeadlineNs = 0;   // 0 until the first wait
+    uint64_t sleepSlackNs   = 0;
+
+    uint64_t recentOvershootNs[kPacerOvershootWindow] = {};
+    uint32_t overshootCursor                          = 0;
+
+    // results
+    FrameTimer intervals;   // wake to wake
+    FrameTimer lateness;    // wake minus deadline, paced frames only
+    uint64_t   missedDeadlines = 0;
+    uint64_t   spunNs          = 0;   // total time spent spinning
+};
+
+void InitFramePacer(FramePacer& pacer, IPacerClock* clock, double targetFps, size_t historyFrames);
+
+// Changes the rate; the schedule restarts on the next wait.
+void SetFramePacerTarget(FramePacer& pacer, double targetFps);
+
+// Blocks until the next frame may start and returns that time. Uncapped it
+// returns at once.
+uint64_t WaitForNextFrame(FramePacer& pacer);
@@ -0,0 +1,226 @@
+#include "FrameTimer.h"
+#include "FrameAllocator.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+
+namespace
+{
+    double ToMs(uint64_t ns)
+    {
+        return ns / 1e6;
+    }
+
+    // i-th sample, oldest first.
+    uint64_t HistorySample(const FrameTimer& timer, size_t i)
+    {
+        size_t capacity = timer.history.size();
+        size_t first    = (timer.head + capacity - timer.samples) % std::max<size_t>(capacity, 1);
+        return timer.history[(first + i) % capacity];
+    }
+
+    std::vector<uint64_t> OrderedHistory(const FrameTimer& timer)
+    {
+        std::vector<uint64_t> ordered(timer.samples);
+        for (size_t i = 0; i < timer.samples; ++i)
+            ordered[i] = HistorySample(timer, i);
+        return ordered;
+    }
+
+    // Nearest-rank percentile on sorted data.
+    uint64_t Percentile(const uint64_t* sorted, size_t count, double p)
+    {
+        size_t rank = static_cast<size_t>(std::ceil(p / 100.0 * count));
+        rank        = std::min(std::max<size_t>(rank, 1), count);
+        return sorted[rank - 1];
+    }
+
+    // Sorts `samples` in place.
+    FrameTimeStats StatsOfSamples(uint64_t* samples, size_t count)
+    {
+        std::sort(samples, samples + count);
+
+        uint64_t sum = 0;
+        for (size_t i = 0; i < count; ++i)
+            sum += samples[i];
+
+        FrameTimeStats stats;
+        stats.samples = count;
+        stats.meanMs  = ToMs(sum) / count;
+        stats.minMs   = ToMs(samples[0]);
+        stats.p50Ms   = ToMs(Percentile(samples, count, 50.0));
+        stats.p95Ms   = ToMs(Percentile(samples, count, 95.0));
+        stats.p99Ms   = ToMs(Percentile(samples, count, 99.0));
+        stats.maxMs   = ToMs(samples[count - 1]);
+        return stats;
+    }
+}   // namespace
+
+uint64_t NowNanoseconds()
+{
+    return static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch())
+            .count());
+}
+
+void InitFrameTimer(FrameTimer& timer, size_t historyFrames)
+{
+    timer = {};
+    timer.history.assign(std::max<size_t>(historyFrames, 1), 0);
+}
+
+float TickFrameTimer(FrameTimer& timer, uint64_t nowNs)
+{
+    uint64_t frameNs = timer.frameCount > 0 && nowNs > timer.prevTimestampNs ? nowNs - timer.prevTimestampNs : 0;
+    bool     first   = timer.frameCount == 0;
+
+    timer.prevTimestampNs = nowNs;
+    ++timer.frameCount;
+
+    if (first)
+        return 0.f;
+
+    RecordFrameTime(timer, frameNs);
+    return static_cast<float>(frameNs / 1e9);
+}
+
+void RecordFrameTime(FrameTimer& timer, uint64_t frameTimeNs)
+{
+    if (timer.history.empty())
+        timer.history.assign(1, 0);
+
+    timer.history[timer.head] = frameTimeNs;
+    timer.head                = (timer.head + 1) % timer.history.size();
+    timer.samples             = std::min(timer.samples + 1, timer.history.size());
+}
+
+size_t CopyFrameTimesMs(const FrameTimer& timer, float* out, size_t maxCount)
+{
+    size_t count = std::min(maxCount, timer.samples);
+    size_t skip  = timer.samples - count;
+    for (size_t i = 0; i < count; ++i)
+        out[i] = static_cast<float>(ToMs(HistorySample(timer, skip + i)));
+
+    return count;
+}
+
+FrameTimeStats ComputeFrameTimeStats(const FrameTimer& timer)
+{
+    if (timer.samples == 0)
+        return FrameTimeStats {};
+
+    std::vector<uint64_t> sorted = OrderedHistory(timer);
+    return StatsOfSamples(sorted.data(), sorted.size());
+}
+
+FrameTimeStats ComputeFrameTimeStats(const FrameTimer& timer, LinearAllocator& scratch)
+{
+    uint64_t* sorted = LinearAllocateArray<uint64_t>(scratch, timer.samples);
+    if (timer.samples == 0 || !sorted)
+        return FrameTimeStats {};
+
+    for (size_t i = 0; i < timer.samples; ++i)
+        sorted[i] = HistorySample(timer, i);
+    return StatsOfSamples(sorted, timer.samples);
+}
+
+FrameTimeHistogram ComputeFrameTimeHistogram(const FrameTimer& timer, double bucketMs, size_t bucketCount)
+{
+    FrameTimeHistogram histogram;
+    histogram.bucketMs = bucketMs;
+    histogram.counts.assign(std::max<size_t>(bucketCount, 1), 0);
+    CountFrameTimeBuckets(timer, bucketMs, histogram.counts.data(), histogram.counts.size());
+    return histogram;
+}
+
+void CountFrameTimeBuckets(const FrameTimer& timer, double bucketMs, uint32_t* counts, size_t bucketCount)
+{
+    std::fill(counts, counts + bucketCount, 0u);
+    if (bucketCount == 0)
+        return;
+
+    for (size_t i = 0; i < timer.samples; ++i)
+    {
+        size_t bucket = static_cast<size_t>(ToMs(HistorySample(timer, i)) / bucketMs);
+        ++counts[std::min(bucket, bucketCount - 1)];
+    }
+}
+
+bool ExportFrameTimesCSV(const FrameTimer& timer, const char* path)
+{
+    FILE* file = std::fopen(path, "w");
+    if (!file)
+        return false;
+
+    std::fprintf(file, "frame,ms\n");
+
+    std::vector<uint64_t> ordered = OrderedHistory(timer);
+    for (size_t i = 0; i < ordered.size(); ++i)
+        std::fprintf(file, "%zu,%.6f\n", i, ToMs(ordered[i]));
+
+    bool ok = std::ferror(file) == 0;
+    std::fclose(file);
+    return ok;
+}
+
+bool ExportFrameTimesJSON(const FrameTimer& timer, const char* path)
+{
+    FILE* file = std::fopen(path, "w");
+    if (!file)
+        return false;
+
+    FrameTimeStats     stats     = ComputeFrameTimeStats(timer);
+    FrameTimeHistogram histogram = ComputeFrameTimeHistogram(timer, 1.0, 50);
+
+    std::fprintf(file, "{\n");
+    std::fprintf(file, "  \"samples\": %zu,\n", stats.samples);
+    std::fprintf(file,
+                 "  \"ms\": { \"mean\": %.6f, \"min\": %.6f, \"p50\": %.6f, \"p95\": %.6f, \"p99\": %.6f, \"max\": %.6f },\n",
+                 stats.meanMs,
+                 stats.minMs,
+                 stats.p50Ms,
+                 stats.p95Ms,
+                 stats.p99Ms,
+                 stats.maxMs);
+
+    std::fprintf(file, "  \"histogram\": { \"bucketMs\": %.3f, \"counts\": [", histogram.bucketMs);
+    for (size_t i = 0; i < histogram.counts.size(); ++i)
+        std::fprintf(file, "%s%u", i ? ", " : "", histogram.counts[i]);
+    std::fprintf(file, "] },\n");
+
+    std::fprintf(file, "  \"frameTimesMs\": [");
+    std::vector<uint64_t> ordered = OrderedHistory(timer);
+    for (size_t i = 0; i < ordered.size(); ++i)
+        std::fprintf(file, "%s%.6f", i ? ", " : "", ToMs(ordered[i]));
+    std::fprintf(file, "]\n}\n");
+
+    bool ok = std::ferror(file) == 0;
+    std::fclose(file);
+    return ok;
+}
+
+void BeginStartupTimer(StartupTimer& timer, uint64_t nowNs)
+{
+    timer         = StartupTimer {};
+    timer.beginNs = nowNs;
+    timer.lastNs  = nowNs;
+}
+
+void MarkStartupPhase(StartupTimer& timer, const char* name, uint64_t nowNs)
+{
+    if (timer.count < StartupTimer::kMaxPhases)
+    {
+        timer.names[timer.count] = name;
+        timer.ms[timer.count]    = ToMs(nowNs - timer.lastNs);
+        ++timer.count;
+    }
+    timer.lastNs = nowNs;
+}
+
+double StartupTotalMs(const StartupTimer& timer)
+{
+    return ToMs(timer.lastNs - timer.beginNs);
+}
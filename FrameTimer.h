@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+struct LinearAllocator;
+
+// Monotonic clock in nanoseconds (steady_clock).
+uint64_t NowNanoseconds();
+
+// 64-bit nanosecond frame timing with a rolling history of frame times.
+struct FrameTimer
+{
+    uint64_t prevTimestampNs = 0;
+    uint64_t frameCount      = 0;   // ticks since init, including the first
+
+    std::vector<uint64_t> history;   // ring of frame times in ns
+    size_t                head    = 0;
+    size_t                samples = 0;
+};
+
+struct FrameTimeStats
+{
+    size_t samples = 0;
+    double meanMs  = 0.0;
+    double minMs   = 0.0;
+    double p50Ms   = 0.0;
+    double p95Ms   = 0.0;
+    double p99Ms   = 0.0;
+    double maxMs   = 0.0;
+};
+
+struct FrameTimeHistogram
+{
+    double                bucketMs = 1.0;
+    std::vector<uint32_t> counts;   // last bucket also holds everything above
+};
+
+void InitFrameTimer(FrameTimer& timer, size_t historyFrames);
+
+// Closes the frame ending at nowNs and returns its length in seconds.
+// The first tick only sets the reference point and returns 0.
+float TickFrameTimer(FrameTimer& timer, uint64_t nowNs);
+
+// Adds a measured duration directly, e.g. a CPU-only frame in a benchmark.
+void RecordFrameTime(FrameTimer& timer, uint64_t frameTimeNs);
+
+// Oldest first; returns the number written (at most maxCount, newest kept).
+size_t CopyFrameTimesMs(const FrameTimer& timer, float* out, size_t maxCount);
+
+FrameTimeStats     ComputeFrameTimeStats(const FrameTimer& timer);
+FrameTimeHistogram ComputeFrameTimeHistogram(const FrameTimer& timer, double bucketMs, size_t bucketCount);
+
+// Heap-free forms for per-frame use: the sort copy comes from `scratch` (empty
+// stats if it does not fit), the histogram goes into `counts`.
+FrameTimeStats ComputeFrameTimeStats(const FrameTimer& timer, LinearAllocator& scratch);
+void           CountFrameTimeBuckets(const FrameTimer& timer, double bucketMs, uint32_t* counts, size_t bucketCount);
+
+bool ExportFrameTimesCSV(const FrameTimer& timer, const char* path);
+bool ExportFrameTimesJSON(const FrameTimer& timer, const char* path);
+
+// Wall time of the named phases of startup, in order.
+struct StartupTimer
+{
+    static constexpr uint32_t kMaxPhases = 16;
+
+    const char* names[kMaxPhases] = {};
+    double      ms[kMaxPhases]    = {};
+    uint32_t    count             = 0;
+    uint64_t    beginNs           = 0;
+    uint64_t    lastNs            = 0;
+};
+
+void BeginStartupTimer(StartupTimer& timer, uint64_t nowNs);
+
+// Ends the phase running since the previous mark (or the begin) as `name`.
+// Marks past kMaxPhases only move the start of the next phase.
+void MarkStartupPhase(StartupTimer& timer, const char* name, uint64_t nowNs);
+
+// Begin to the last mark.
+double StartupTotalMs(const StartupTimer& timer);
@@ -0,0 +1,486 @@
+// Runs the update + submission loop against NullRenderContext: no window, no
+// GPU. Frame time here is a lower bound on the CPU cost of a frame.
+// Linux: cmake -S . -B build && cmake --build build, or
+//        g++ -O2 -std=c++20 HeadlessRunner.cpp HeapCounter.cpp Scene.cpp TransformGraph.cpp ConstantArena.cpp FrameAllocator.cpp InputCapture.cpp NullRenderContext.cpp InstanceBuffer.cpp JobSystem.cpp AffineKernel.cpp MappedFile.cpp MeshFile.cpp SpatialGrid.cpp FramePacer.cpp FrameTimer.cpp InputEvents.cpp Profiler.cpp StateTrackingContext.cpp DrawBucket.cpp SimulationThread.cpp PrimitiveBatcher.cpp VertexFormat.cpp -pthread -o headless
+//   --frames <n>      frames to run (default 1000)
+//   --instances <n>   instanced triangles (default 10000)
+//   --dt <seconds>    fixed delta time (default 1/60)
+//   --csv <path>      export per-frame CPU times
+//   --json <path>     export frame time statistics and samples
+//   --trace <path>    export a Chrome trace of the last 120 frames
+//   --no-state-tracking  submit straight to the null device, redundant binds included
+//   --threaded        run UpdateScene on a simulation thread (frame time is then render side only)
+//   --lag <n>         simulation frame lag with --threaded (default 0)
+//   --overlay         draw the debug overlay through the primitive batcher
+//   --mesh <path>     size the scene buffers from a mesh file instead of the triangle
+//   --extent <f>      half size of the instance layout; past 1 instances leave the view (default 1)
+//   --no-cull         draw every instance instead of the ones the spatial grid finds on screen
+//   --spin <f>        instance spin speed in radians per second; 0 leaves them still (default 1)
+//   --fps <f>         pace frames to this rate with the hybrid sleep/spin wait (default uncapped)
+//   --capture <path>  record each frame's delta time, keys and UI edits
+//   --replay <path>   drive the update from a capture instead of the script and --dt;
+//                     its frame count and starting controls replace --frames/--instances/--extent/--no-cull/--spin
+//   --jobs <n>        split the instance passes over n threads of the job system (0 = one per hardware thread)
+
+#include "FramePacer.h"
+#include "FrameTimer.h"
+#include "HeapCounter.h"
+#include "InputCapture.h"
+#include "JobSystem.h"
+#include "MeshFile.h"
+#include "NullRenderContext.h"
+#include "Profiler.h"
+#include "Scene.h"
+#include "SimulationThread.h"
+#include "StateTrackingContext.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+struct HeadlessOptions
+{
+    int         frames      = 1000;
+    int         instances   = 10000;
+    float       deltaTime   = 1.f / 60.f;
+    const char* csvPath     = nullptr;
+    const char* jsonPath    = nullptr;
+    const char* tracePath   = nullptr;
+    bool        tracking    = true;
+    bool        threaded    = false;
+    int         frameLag    = 0;
+    bool        overlay     = false;
+    const char* meshPath    = nullptr;
+    float       extent      = 1.f;
+    bool        cull        = true;
+    float       spin        = 1.f;
+    double      fps         = 0.0;
+    const char* capturePath = nullptr;
+    const char* replayPath  = nullptr;
+    int         jobThreads  = -1;   // no job system
+};
+
+bool ParseHeadlessOptions(int argc, char** argv, HeadlessOptions& options)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        bool hasValue = i + 1 < argc;
+        if (std::strcmp(argv[i], "--frames") == 0 && hasValue)
+            options.frames = std::atoi(argv[++i]);
+        else if (std::strcmp(argv[i], "--instances") == 0 && hasValue)
+            options.instances = std::atoi(argv[++i]);
+        else if (std::strcmp(argv[i], "--dt") == 0 && hasValue)
+            options.deltaTime = static_cast<float>(std::atof(argv[++i]));
+        else if (std::strcmp(argv[i], "--csv") == 0 && hasValue)
+            options.csvPath = argv[++i];
+        else if (std::strcmp(argv[i], "--json") == 0 && hasValue)
+            options.jsonPath = argv[++i];
+        else if (std::strcmp(argv[i], "--trace") == 0 && hasValue)
+            options.tracePath = argv[++i];
+        else if (std::strcmp(argv[i], "--no-state-tracking") == 0)
+            options.tracking = false;
+        else if (std::strcmp(argv[i], "--threaded") == 0)
+            options.threaded = true;
+        else if (std::strcmp(argv[i], "--lag") == 0 && hasValue)
+            options.frameLag = std::atoi(argv[++i]);
+        else if (std::strcmp(argv[i], "--overlay") == 0)
+            options.overlay = true;
+        else if (std::strcmp(argv[i], "--mesh") == 0 && hasValue)
+            options.meshPath = argv[++i];
+        else if (std::strcmp(argv[i], "--extent") == 0 && hasValue)
+            options.extent = static_cast<float>(std::atof(argv[++i]));
+        else if (std::strcmp(argv[i], "--no-cull") == 0)
+            options.cull = false;
+        else if (std::strcmp(argv[i], "--spin") == 0 && hasValue)
+            options.spin = static_cast<float>(std::atof(argv[++i]));
+        else if (std::strcmp(argv[i], "--fps") == 0 && hasValue)
+            options.fps = std::atof(argv[++i]);
+        else if (std::strcmp(argv[i], "--capture") == 0 && hasValue)
+            options.capturePath = argv[++i];
+        else if (std::strcmp(argv[i], "--replay") == 0 && hasValue)
+            options.replayPath = argv[++i];
+        else if (std::strcmp(argv[i], "--jobs") == 0 && hasValue)
+            options.jobThreads = std::atoi(argv[++i]);
+        else
+        {
+            std::fprintf(stderr, "unknown option %s\n", argv[i]);
+            return false;
+        }
+    }
+
+    // the simulation thread steps on whole-frame keys, which a capture cannot replay exactly
+    if (options.threaded && (options.capturePath || options.replayPath))
+    {
+        std::fprintf(stderr, "--capture and --replay need the update on the main thread\n");
+        return false;
+    }
+    return true;
+}
+
+// Resources backed by the null device, shaped like the ones InitD3D creates.
+// With a mesh the scene buffers take its layout and counts.
+RenderResources CreateNullResources(NullRenderContext& device, int width, int height, const MeshView* mesh)
+{
+    RenderResources res;
+    res.inputLayout           = device.CreateObject();
+    res.instancedInputLayout  = device.CreateObject();
+    res.vertexShader          = device.CreateObject();
+    res.instancedVertexShader = device.CreateObject();
+    res.pixelShader           = device.CreateObject();
+    res.renderTargetView      = device.CreateObject();
+    res.vertexStride          = GetVertexLayout(mesh ? mesh->vertexFormat : kSceneVertexFormat).stride;
+    res.indexFormat           = mesh ? mesh->indexFormat : SelectIndexFormat(3);
+    res.vertexBuffer          = device.CreateBuffer(mesh ? mesh->vertexBytes : res.vertexStride * 3);
+    res.indexBuffer           = device.CreateBuffer(mesh ? mesh->indexBytes : IndexFormatSize(res.indexFormat) * 3);
+    res.constantBuffer        = device.CreateBuffer(sizeof(ConstantBuffer));
+    res.instanceBuffer        = device.CreateBuffer(sizeof(InstanceData) * res.instanceCapacity);
+    res.overlayConstantBuffer = device.CreateBuffer(sizeof(ConstantBuffer));
+    res.indexCount            = mesh ? static_cast<uint32_t>(mesh->header.indexCount) : 3;
+    res.viewport              = RenderViewport { 0.f, 0.f, static_cast<float>(width), static_cast<float>(height), 0.f, 1.f };
+    return res;
+}
+
+// Scripted stand-in for the keyboard, as events stamped inside [beginNs,
+// endNs): holds each movement key for 30 frames, switching a quarter into the
+// frame, and taps another key for a tenth of a frame every 45 frames.
+void ScriptedEvents(int frame, uint64_t beginNs, uint64_t endNs, InputQueue& queue)
+{
+    static const uint8_t script[] = { 'W', 'D', 'S', 'A', KEY_UP, KEY_RIGHT, KEY_DOWN, KEY_LEFT, KEY_SPACE, KEY_CONTROL };
+
+    uint64_t span = endNs - beginNs;
+    uint8_t  held = script[(frame / 30) % sizeof(script)];
+    if (frame % 30 == 0)
+    {
+        if (frame > 0)
+            queue.Push(InputEvent { beginNs + span / 4, script[(frame / 30 - 1) % sizeof(script)], false });
+        queue.Push(InputEvent { beginNs + span / 4, held, true });
+    }
+    if (frame % 45 == 7)
+    {
+        uint8_t tap = held == 'A' ? 'D' : 'A';
+        queue.Push(InputEvent { beginNs + span / 2, tap, true });
+        queue.Push(InputEvent { beginNs + span * 6 / 10, tap, false });
+    }
+}
+
+int main(int argc, char** argv)
+{
+    HeadlessOptions options;
+    if (!ParseHeadlessOptions(argc, argv, options))
+        return 1;
+
+    MeshView mesh;
+    uint64_t meshBegin = NowNanoseconds();
+    if (options.meshPath && !OpenMeshFile(mesh, options.meshPath, true))
+    {
+        std::fprintf(stderr, "failed to load %s\n", options.meshPath);
+        return 1;
+    }
+    double meshMs = (NowNanoseconds() - meshBegin) / 1e6;
+
+    NullRenderContext device;
+    RenderResources   resources = CreateNullResources(device, 1280, 720, options.meshPath ? &mesh : nullptr);
+
+    StateTrackingContext tracker;
+    tracker.inner = &device;
+
+    DrawBucket bucket;
+
+    // same size as InitD3D; the null device "completes" each frame two frames later
+    ConstantArena constantArena;
+    InitConstantArena(constantArena, device.CreateBuffer(1 << 16), 1 << 16, false);
+    resources.constantArena = &constantArena;
+
+    IRenderContext& context = options.tracking ? static_cast<IRenderContext&>(tracker) : device;
+
+    // same ring sizes as InitD3D
+    PrimitiveBatcher batcher;
+    InitPrimitiveBatcher(batcher,
+                         &context,
+                         device.CreateBuffer(sizeof(BatchVertex) << 16),
+                         1 << 16,
+                         device.CreateBuffer(sizeof(uint32_t) * (3 << 15)),
+                         3 << 15);
+    batcher.inputLayout  = device.CreateObject();   // float layout, like InitD3D's batchInputLayout
+    batcher.vertexShader = resources.vertexShader;
+    batcher.pixelShader  = resources.pixelShader;
+
+    const BatchVertex triangle[3] = {
+        { -0.5f, 0.f, 1.f, 0.f, 0.f },
+        { 0.f, 0.5f, 0.f, 0.f, 1.f },
+        { 0.5f, 0.f, 0.f, 1.f, 0.f },
+    };
+    float frameTimesMs[256];
+
+    SceneState scene;
+    scene.requestedInstanceCount = options.instances;
+    scene.instanceExtent         = options.extent;
+    scene.cullInstances          = options.cull;
+    scene.instanceSpinSpeed      = options.spin;
+    if (options.meshPath)
+        scene.instanceRadius = MeshBoundingRadius(mesh.header);
+
+    InputCaptureReader replay;
+    InputCaptureWriter recording;
+    InputCaptureFrame  captured;
+    if (options.replayPath)
+    {
+        if (!OpenInputCapture(replay, options.replayPath))
+        {
+            std::fprintf(stderr, "failed to load %s\n", options.replayPath);
+            return 1;
+        }
+        ResetCaptureScene(scene, CaptureControlsToScene(replay.header.initial), replay.header.instanceRadius);
+        options.frames = static_cast<int>(replay.header.frameCount);
+    }
+    if (options.capturePath && !BeginInputCapture(recording, options.capturePath, GetSceneControls(scene), scene.instanceRadius))
+    {
+        std::fprintf(stderr, "failed to create %s\n", options.capturePath);
+        return 1;
+    }
+
+    JobSystem jobs;
+    if (options.jobThreads >= 0)
+    {
+        StartJobSystem(jobs, static_cast<uint32_t>(options.jobThreads));
+        scene.jobs = &jobs;
+    }
+
+    FrameTimer timer;
+    InitFrameTimer(timer, options.frames > 0 ? options.frames : 1);
+
+    InputQueue    inputQueue;
+    InputTracker  input;
+    KeyFrameInput frameInput;
+    bool          keys[256] = {};
+    InitInputTracker(input, NowNanoseconds(), options.frames > 0 ? options.frames : 1);
+
+    SimulationThread simulation;
+    if (options.threaded)
+        StartSimulationThread(simulation, scene, resources.instanceCapacity, options.frameLag, options.deltaTime);
+
+    SystemPacerClock clock;
+    FramePacer       pacer;
+    InitFramePacer(pacer, &clock, options.fps, options.frames > 0 ? options.frames : 1);
+
+    PROFILE_THREAD("Main");
+    ProfileCapture capture;
+
+    // the first frames grow the buckets and staging to size; after that a frame
+    // should not touch the heap on this thread
+    constexpr int  kHeapWarmupFrames = 8;
+    HeapPhaseStats warmupHeap;
+    HeapPhaseStats steadyHeap;
+
+    uint64_t drawnInstances = 0;
+
+    for (int frame = 0; frame < options.frames; ++frame)
+    {
+        WaitForNextFrame(pacer);
+
+        if (options.replayPath && !ReadInputCaptureFrame(replay, captured))
+        {
+            std::fprintf(stderr, "%s: bad record at frame %d\n", options.replayPath, frame);
+            return 1;
+        }
+
+        HeapPhaseStats& heap = frame < kHeapWarmupFrames ? warmupHeap : steadyHeap;
+
+        // this frame's input arrived during the previous one
+        uint64_t begin = NowNanoseconds();
+        if (!options.replayPath)
+            ScriptedEvents(frame, input.intervalBeginNs, begin, inputQueue);
+        {
+            PROFILE_FRAME(frame);
+            PROFILE_SCOPE("Frame");
+
+            {
+                HeapPhaseScope phase(heap, "input");
+                ConsumeInputEvents(input, inputQueue, begin, frameInput);
+                if (options.replayPath)
+                    frameInput = captured.input;
+            }
+
+            uint64_t arenaFrame = static_cast<uint64_t>(frame) + 1;
+            BeginConstantArenaFrame(constantArena, arenaFrame, arenaFrame > 2 ? arenaFrame - 2 : 0);
+
+            ConstantRange triangleConstants;
+
+            if (options.threaded)
+            {
+                const SceneSnapshot* snapshot = nullptr;
+                {
+                    HeapPhaseScope phase(heap, "update");
+                    KeysFromFrameInput(frameInput, keys);
+                    PostSimulationInput(simulation, keys, nullptr);
+                    snapshot = &AcquireSimulationSnapshot(simulation);
+                }
+
+                HeapPhaseScope phase(heap, "render");
+                UploadSceneSnapshot(context, resources, *snapshot);
+                triangleConstants = RenderScene(context, resources, snapshot->constants, snapshot->instances.size(), bucket);
+                drawnInstances += snapshot->instances.size();
+            }
+            else
+            {
+                {
+                    HeapPhaseScope phase(heap, "update");
+                    UpdateSceneInput(scene, frameInput, options.replayPath ? captured.deltaTime : options.deltaTime);
+                }
+
+                HeapPhaseScope phase(heap, "render");
+                UploadScene(context, resources, scene);
+                triangleConstants = RenderScene(context, resources, scene.cpuConstantData, scene.drawnInstances, bucket);
+                drawnInstances += scene.drawnInstances;
+
+                // UI edits land after the frame's draws, as in the window
+                if (options.replayPath && captured.hasControls)
+                    ApplySceneControls(scene, captured.controls);
+            }
+
+            if (options.overlay)
+            {
+                HeapPhaseScope phase(heap, "overlay");
+                size_t         frameCount = CopyFrameTimesMs(timer, frameTimesMs, 256);
+                RenderDebugOverlay(batcher, resources, triangleConstants, triangle, 3, frameTimesMs, frameCount);
+                EndBatcherFrame(batcher);
+            }
+            EndConstantArenaFrame(constantArena);
+        }
+        uint64_t end = NowNanoseconds();
+        RecordFrameTime(timer, end - begin);
+        RecordInputSubmit(input, end);
+
+        if (options.capturePath)
+        {
+            if (!options.replayPath)
+            {
+                captured.deltaTime   = options.deltaTime;
+                captured.input       = frameInput;
+                captured.hasControls = false;
+            }
+            WriteInputCaptureFrame(recording, captured);
+        }
+
+        HeapPhaseScope phase(heap, "end");
+        device.EndFrame();
+        tracker.EndFrame();
+
+        // drain every frame so the rings never overflow; keep only what gets exported
+        if (!options.tracePath || frame + 120 < options.frames)
+            ProfilerDiscard();
+        else
+            ProfilerCollect(capture);
+    }
+
+    if (options.threaded)
+    {
+        StopSimulationThread(simulation);
+        scene = simulation.scene;
+    }
+
+    StopJobSystem(jobs);
+
+    CloseInputCapture(replay);
+    if (options.capturePath && !EndInputCapture(recording))
+        std::fprintf(stderr, "failed to write %s\n", options.capturePath);
+
+    if (options.tracePath && !ExportChromeTrace(capture, options.tracePath, options.frames > 120 ? options.frames - 120 : 0, UINT64_MAX))
+        std::fprintf(stderr, "failed to write %s\n", options.tracePath);
+
+    if (options.csvPath && !ExportFrameTimesCSV(timer, options.csvPath))
+        std::fprintf(stderr, "failed to write %s\n", options.csvPath);
+
+    if (options.jsonPath && !ExportFrameTimesJSON(timer, options.jsonPath))
+        std::fprintf(stderr, "failed to write %s\n", options.jsonPath);
+
+    FrameTimeStats stats   = ComputeFrameTimeStats(timer);
+    FrameTimeStats latency = ComputeFrameTimeStats(input.latency);
+
+    double frames = options.frames > 0 ? options.frames : 1;
+
+    const SubmissionStats& t = device.total;
+    std::printf("frames          %d\n", options.frames);
+    std::printf("instances       %d  extent %.2f  %s, %.0f drawn per frame\n",
+                options.instances,
+                options.extent,
+                options.cull ? "culled" : "not culled",
+                drawnInstances / frames);
+    std::printf("cpu frame ms    mean %.4f  p50 %.4f  p95 %.4f  p99 %.4f  max %.4f\n",
+                stats.meanMs,
+                stats.p50Ms,
+                stats.p95Ms,
+                stats.p99Ms,
+                stats.maxMs);
+    std::printf("per frame       binds %.1f  maps %.1f  updates %.1f  bytes %.0f  draws %.1f  instances %.0f  clears %.1f\n",
+                t.binds / frames,
+                t.maps / frames,
+                t.updates / frames,
+                t.bytesUploaded / frames,
+                t.draws / frames,
+                t.instances / frames,
+                t.clears / frames);
+    std::printf("input to submit %llu events  p50 %.4f  p95 %.4f  max %.4f ms\n",
+                static_cast<unsigned long long>(input.consumed),
+                latency.p50Ms,
+                latency.p95Ms,
+                latency.maxMs);
+    if (options.fps > 0.0)
+    {
+        FrameTimeStats intervals = ComputeFrameTimeStats(pacer.intervals);
+        FrameTimeStats lateness  = ComputeFrameTimeStats(pacer.lateness);
+        std::printf("pacing          %.1f fps  interval p50 %.4f  p99 %.4f  late p99 %.4f  max %.4f ms  missed %llu  spun %.1f ms\n",
+                    options.fps,
+                    intervals.p50Ms,
+                    intervals.p99Ms,
+                    lateness.p99Ms,
+                    lateness.maxMs,
+                    static_cast<unsigned long long>(pacer.missedDeadlines),
+                    pacer.spunNs / 1e6);
+    }
+    if (options.threaded)
+        std::printf("simulation      lag %d  skipped snapshots %llu\n", options.frameLag, static_cast<unsigned long long>(simulation.skippedSnapshots));
+    if (options.jobThreads >= 0)
+        std::printf("job system      %u threads  jobs %.1f  steals %.1f per frame%s\n",
+                    jobs.workerCount,
+                    JobsRun(jobs) / frames,
+                    JobSteals(jobs) / frames,
+                    options.threaded ? " (the simulation thread runs them inline)" : "");
+    if (options.tracking)
+        std::printf("state tracking  issued %.1f  elided %.1f per frame\n", TotalIssued(tracker.total) / frames, TotalElided(tracker.total) / frames);
+    std::printf("constant arena  blocks %.1f  maps %.1f  bytes %.0f per frame  full %llu\n",
+                constantArena.total.blocks / frames,
+                constantArena.total.maps / frames,
+                constantArena.total.bytes / frames,
+                static_cast<unsigned long long>(constantArena.total.full));
+    if (options.frames > kHeapWarmupFrames)
+    {
+        double steadyFrames = options.frames - kHeapWarmupFrames;
+        std::printf("heap per frame  ");
+        for (uint32_t i = 0; i < steadyHeap.count; ++i)
+            std::printf("%s %.2f (%.0f B)  ", steadyHeap.names[i], steadyHeap.allocations[i] / steadyFrames, steadyHeap.bytes[i] / steadyFrames);
+        std::printf("after %d warm-up frames\n", kHeapWarmupFrames);
+    }
+    if (options.overlay)
+        std::printf("overlay         draws %.1f  vertices %.0f  ring flushes %.1f  state flushes %.1f per frame\n",
+                    batcher.total.draws / frames,
+                    batcher.total.vertices / frames,
+                    batcher.total.ringFlushes / frames,
+                    batcher.total.stateFlushes / frames);
+    if (options.meshPath)
+        std::printf("mesh            %s  %llu vertices  %llu indices  %s  opened in %.3f ms\n",
+                    options.meshPath,
+                    static_cast<unsigned long long>(mesh.header.vertexCount),
+                    static_cast<unsigned long long>(mesh.header.indexCount),
+                    VertexFormatName(mesh.vertexFormat),
+                    meshMs);
+    if (options.capturePath)
+        std::printf("capture         %s  %u frames  %llu bytes\n", options.capturePath, recording.frames, static_cast<unsigned long long>(recording.bytes));
+    if (options.replayPath)
+        std::printf("replay          %s  %u frames\n", options.replayPath, replay.framesRead);
+    std::printf("final position  %.4f %.4f\n", scene.triPosition[0], scene.triPosition[1]);
+    std::printf("state hash      %016llx\n", static_cast<unsigned long long>(HashSceneState(scene)));
+
+    CloseMeshFile(mesh);
+    return 0;
+}
@@ -0,0 +1,123 @@
+#include "HeapCounter.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+namespace
+{
+    std::atomic<uint64_t> g_allocations { 0 };
+    std::atomic<uint64_t> g_bytes { 0 };
+
+    thread_local uint64_t t_allocations = 0;
+    thread_local uint64_t t_bytes       = 0;
+
+    void Count(size_t size)
+    {
+        g_allocations.fetch_add(1, std::memory_order_relaxed);
+        g_bytes.fetch_add(size, std::memory_order_relaxed);
+        ++t_allocations;
+        t_bytes += size;
+    }
+}   // namespace
+
+// array and nothrow forms forward to these by default
+void* operator new(size_t size)
+{
+    Count(size);
+    if (void* p = std::malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+    std::free(p);
+}
+
+// over-aligned types (alignas(64) draw lists): the malloc pointer sits just
+// below the aligned block
+void* operator new(size_t size, std::align_val_t alignment)
+{
+    Count(size);
+
+    size_t align = static_cast<size_t>(alignment);
+    void*  raw   = std::malloc(size + align + sizeof(void*));
+    if (!raw)
+        throw std::bad_alloc();
+
+    uintptr_t aligned = (reinterpret_cast<uintptr_t>(raw) + sizeof(void*) + align - 1) & ~static_cast<uintptr_t>(align - 1);
+    reinterpret_cast<void**>(aligned)[-1] = raw;
+    return reinterpret_cast<void*>(aligned);
+}
+
+void operator delete(void* p, std::align_val_t) noexcept
+{
+    if (p)
+        std::free(static_cast<void**>(p)[-1]);
+}
+
+void operator delete(void* p, size_t, std::align_val_t) noexcept
+{
+    if (p)
+        std::free(static_cast<void**>(p)[-1]);
+}
+
+uint64_t HeapAllocationCount()
+{
+    return g_allocations.load(std::memory_order_relaxed);
+}
+
+uint64_t HeapAllocatedBytes()
+{
+    return g_bytes.load(std::memory_order_relaxed);
+}
+
+uint64_t HeapThreadAllocationCount()
+{
+    return t_allocations;
+}
+
+uint64_t HeapThreadAllocatedBytes()
+{
+    return t_bytes;
+}
+
+uint64_t TotalHeapAllocations(const HeapPhaseStats& stats)
+{
+    uint64_t total = 0;
+    for (uint32_t i = 0; i < stats.count; ++i)
+        total += stats.allocations[i];
+    return total;
+}
+
+HeapPhaseScope::HeapPhaseScope(HeapPhaseStats& phases, const char* phaseName)
+    : stats(phases)
+    , name(phaseName)
+    , allocations(t_allocations)
+    , bytes(t_bytes)
+{
+}
+
+HeapPhaseScope::~HeapPhaseScope()
+{
+    uint32_t phase = 0;
+    while (phase < stats.count && std::strcmp(stats.names[phase], name) != 0)
+        ++phase;
+
+    if (phase == stats.count)
+    {
+        if (stats.count == HeapPhaseStats::kMaxPhases)
+            return;
+        stats.names[stats.count++] = name;
+    }
+
+    stats.allocations[phase] += t_allocations - allocations;
+    stats.bytes[phase] += t_bytes - bytes;
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstdint>
+
+// Totals since startup, from the replacement global operator new in
+// HeapCounter.cpp. Link that file only into the tools that want the counts;
+// everything else keeps the standard allocator.
+uint64_t HeapAllocationCount();
+uint64_t HeapAllocatedBytes();
+
+// Same for the calling thread only, so a phase measured on one thread is not
+// charged for what another thread allocates meanwhile.
+uint64_t HeapThreadAllocationCount();
+uint64_t HeapThreadAllocatedBytes();
+
+// Heap traffic of the named phases of one frame on one thread; reset it with
+// `= {}` at the frame boundary.
+struct HeapPhaseStats
+{
+    static constexpr uint32_t kMaxPhases = 8;
+
+    const char* names[kMaxPhases]       = {};
+    uint64_t    allocations[kMaxPhases] = {};
+    uint64_t    bytes[kMaxPhases]       = {};
+    uint32_t    count                   = 0;
+};
+
+uint64_t TotalHeapAllocations(const HeapPhaseStats& stats);
+
+// Charges the calling thread's allocations during its lifetime to `name`.
+// Phases past kMaxPhases are not recorded.
+struct HeapPhaseScope
+{
+    HeapPhaseScope(HeapPhaseStats& stats, const char* name);
+    ~HeapPhaseScope();
+
+    HeapPhaseScope(const HeapPhaseScope&)            = delete;
+    HeapPhaseScope& operator=(const HeapPhaseScope&) = delete;
+
+private:
+    HeapPhaseStats& stats;
+    const char*     name;
+    uint64_t        allocations;
+    uint64_t        bytes;
+};
@@ -0,0 +1,181 @@
+#include "InputCapture.h"
+
+#include <cstddef>
+#include <cstring>
+#include <utility>
+
+namespace
+{
+    InputCaptureControls ControlsToCapture(const SceneControls& controls)
+    {
+        InputCaptureControls out = {};
+        std::memcpy(out.triPosition, controls.triPosition, sizeof(out.triPosition));
+        std::memcpy(out.triScale, controls.triScale, sizeof(out.triScale));
+        out.triRotation            = controls.triRotation;
+        out.requestedInstanceCount = controls.requestedInstanceCount;
+        out.instanceSpinSpeed      = controls.instanceSpinSpeed;
+        out.instanceExtent         = controls.instanceExtent;
+        out.cullInstances          = controls.cullInstances ? 1 : 0;
+        return out;
+    }
+
+    bool Write(InputCaptureWriter& writer, const void* data, size_t size)
+    {
+        writer.bytes += size;
+        return std::fwrite(data, 1, size, writer.file) == size;
+    }
+
+    // Copies the next `size` bytes out of the mapping; false past its end.
+    bool Read(InputCaptureReader& reader, void* data, size_t size)
+    {
+        if (reader.file.size - reader.cursor < size)
+            return false;
+
+        std::memcpy(data, reader.file.data + reader.cursor, size);
+        reader.cursor += size;
+        return true;
+    }
+}   // namespace
+
+SceneControls CaptureControlsToScene(const InputCaptureControls& controls)
+{
+    SceneControls out;
+    std::memcpy(out.triPosition, controls.triPosition, sizeof(out.triPosition));
+    std::memcpy(out.triScale, controls.triScale, sizeof(out.triScale));
+    out.triRotation            = controls.triRotation;
+    out.requestedInstanceCount = controls.requestedInstanceCount;
+    out.instanceSpinSpeed      = controls.instanceSpinSpeed;
+    out.instanceExtent         = controls.instanceExtent;
+    out.cullInstances          = controls.cullInstances != 0;
+    return out;
+}
+
+bool BeginInputCapture(InputCaptureWriter& writer, const char* path, const SceneControls& initial, float instanceRadius)
+{
+    writer.file = std::fopen(path, "wb");
+    if (!writer.file)
+        return false;
+
+    writer.previous = KeyFrameInput {};
+    writer.frames   = 0;
+    writer.bytes    = 0;
+
+    InputCaptureHeader header = {};
+    header.magic              = kInputCaptureMagic;
+    header.version            = kInputCaptureVersion;
+    header.instanceRadius     = instanceRadius;
+    header.initial            = ControlsToCapture(initial);
+    return Write(writer, &header, sizeof(header));
+}
+
+bool WriteInputCaptureFrame(InputCaptureWriter& writer, const InputCaptureFrame& frame)
+{
+    InputCaptureKey changes[256];
+    uint16_t        changeCount = 0;
+    for (int key = 0; key < 256; ++key)
+    {
+        if (frame.input.heldFraction[key] == writer.previous.heldFraction[key] && frame.input.pressed[key] == writer.previous.pressed[key])
+            continue;
+
+        InputCaptureKey& change = changes[changeCount++];
+        change                  = {};
+        change.key              = static_cast<uint8_t>(key);
+        change.pressed          = frame.input.pressed[key] ? 1 : 0;
+        change.heldFraction     = frame.input.heldFraction[key];
+    }
+    writer.previous = frame.input;
+
+    InputCaptureFrameHeader header = {};
+    header.deltaTime               = frame.deltaTime;
+    header.keyChanges              = changeCount;
+    header.hasControls             = frame.hasControls ? 1 : 0;
+
+    bool ok = Write(writer, &header, sizeof(header)) && Write(writer, changes, sizeof(InputCaptureKey) * changeCount);
+    if (frame.hasControls)
+    {
+        InputCaptureControls controls = ControlsToCapture(frame.controls);
+        ok                            = ok && Write(writer, &controls, sizeof(controls));
+    }
+
+    ++writer.frames;
+    return ok;
+}
+
+bool EndInputCapture(InputCaptureWriter& writer)
+{
+    if (!writer.file)
+        return false;
+
+    bool ok = std::fseek(writer.file, offsetof(InputCaptureHeader, frameCount), SEEK_SET) == 0;
+    ok      = ok && std::fwrite(&writer.frames, sizeof(writer.frames), 1, writer.file) == 1;
+    ok      = ok && std::ferror(writer.file) == 0;
+    ok      = std::fclose(writer.file) == 0 && ok;
+
+    writer.file = nullptr;
+    return ok;
+}
+
+bool OpenInputCapture(InputCaptureReader& reader, const char* path)
+{
+    if (!OpenMappedFile(reader.file, path))
+        return false;
+
+    reader.cursor     = 0;
+    reader.framesRead = 0;
+    reader.current    = KeyFrameInput {};
+    if (!Read(reader, &reader.header, sizeof(reader.header)) ||
+        reader.header.magic != kInputCaptureMagic ||
+        reader.header.version != kInputCaptureVersion)
+    {
+        CloseInputCapture(reader);
+        return false;
+    }
+    return true;
+}
+
+bool ReadInputCaptureFrame(InputCaptureReader& reader, InputCaptureFrame& frame)
+{
+    if (reader.framesRead == reader.header.frameCount)
+        return false;
+
+    InputCaptureFrameHeader header;
+    if (!Read(reader, &header, sizeof(header)))
+        return false;
+
+    for (uint16_t i = 0; i < header.keyChanges; ++i)
+    {
+        InputCaptureKey change;
+        if (!Read(reader, &change, sizeof(change)))
+            return false;
+
+        reader.current.heldFraction[change.key] = change.heldFraction;
+        reader.current.pressed[change.key]      = change.pressed != 0;
+    }
+
+    InputCaptureControls controls = {};
+    if (header.hasControls && !Read(reader, &controls, sizeof(controls)))
+        return false;
+
+    frame.deltaTime   = header.deltaTime;
+    frame.input       = reader.current;
+    frame.hasControls = header.hasControls != 0;
+    if (frame.hasControls)
+        frame.controls = CaptureControlsToScene(controls);
+
+    ++reader.framesRead;
+    return true;
+}
+
+void CloseInputCapture(InputCaptureReader& reader)
+{
+    CloseMappedFile(reader.file);
+}
+
+void ResetCaptureScene(SceneState& scene, const SceneControls& controls, float instanceRadius)
+{
+    SceneState fresh;
+    fresh.instanceRadius = instanceRadius;
+    fresh.jobs           = scene.jobs;   // a setting of the app, not of the capture
+    ApplySceneControls(fresh, controls);
+    scene = std::move(fresh);
+}
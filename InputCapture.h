@@ -0,0 +1,111 @@
+#pragma once
+
+#include "InputEvents.h"
+#include "MappedFile.h"
+#include "Scene.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+
+// Binary log of everything that drives the scene update, so a session can be
+// replayed without a window and give the same state on the same build:
+//
+//   InputCaptureHeader                 the controls the scene starts from
+//   per frame:
+//     InputCaptureFrameHeader
+//     InputCaptureKey * keyChanges     keys whose held fraction or press changed
+//     InputCaptureControls             when hasControls: the UI edit of that frame
+//
+// Keys are stored as changes against the previous frame, so a frame with the
+// same keys as the last one costs 8 bytes.
+constexpr uint32_t kInputCaptureMagic   = 0x50414349;   // "ICAP"
+constexpr uint32_t kInputCaptureVersion = 1;
+
+// SceneControls with a fixed layout and no padding.
+struct InputCaptureControls
+{
+    float    triPosition[2];
+    float    triScale[2];
+    float    triRotation;
+    int32_t  requestedInstanceCount;
+    float    instanceSpinSpeed;
+    float    instanceExtent;
+    uint32_t cullInstances;
+};
+
+struct InputCaptureHeader
+{
+    uint32_t             magic;
+    uint32_t             version;
+    uint32_t             frameCount;   // patched when the capture ends
+    float                instanceRadius;
+    InputCaptureControls initial;
+};
+
+struct InputCaptureFrameHeader
+{
+    float    deltaTime;
+    uint16_t keyChanges;
+    uint8_t  hasControls;
+    uint8_t  reserved;   // zero
+};
+
+struct InputCaptureKey
+{
+    uint8_t  key;
+    uint8_t  pressed;
+    uint16_t reserved;   // zero
+    float    heldFraction;
+};
+
+static_assert(sizeof(InputCaptureControls) == 36 && sizeof(InputCaptureHeader) == 52, "file layout");
+static_assert(sizeof(InputCaptureFrameHeader) == 8 && sizeof(InputCaptureKey) == 8, "file layout");
+
+// One frame of the update loop: UpdateSceneInput(input, deltaTime), then the
+// UI edit if there was one.
+struct InputCaptureFrame
+{
+    float         deltaTime = 0.f;
+    KeyFrameInput input;
+    bool          hasControls = false;
+    SceneControls controls;
+};
+
+struct InputCaptureWriter
+{
+    FILE*         file = nullptr;
+    KeyFrameInput previous;
+    uint32_t      frames = 0;
+    uint64_t      bytes  = 0;
+};
+
+// Starts a capture from a scene in the state ResetCaptureScene gives for
+// `initial` and `instanceRadius`.
+bool BeginInputCapture(InputCaptureWriter& writer, const char* path, const SceneControls& initial, float instanceRadius);
+bool WriteInputCaptureFrame(InputCaptureWriter& writer, const InputCaptureFrame& frame);
+
+// Patches the frame count and closes; false if any write failed.
+bool EndInputCapture(InputCaptureWriter& writer);
+
+struct InputCaptureReader
+{
+    MappedFile         file;
+    InputCaptureHeader header     = {};
+    size_t             cursor     = 0;
+    uint32_t           framesRead = 0;
+    KeyFrameInput      current;
+};
+
+// False if the file is missing or not a capture of this version.
+bool OpenInputCapture(InputCaptureReader& reader, const char* path);
+
+// False after the last frame or at a truncated or malformed record.
+bool ReadInputCaptureFrame(InputCaptureReader& reader, InputCaptureFrame& frame);
+void CloseInputCapture(InputCaptureReader& reader);
+
+// Fresh scene with the given controls: what a capture starts from and a
+// replay rebuilds before its first frame.
+void ResetCaptureScene(SceneState& scene, const SceneControls& controls, float instanceRadius);
+
+SceneControls CaptureControlsToScene(const InputCaptureControls& controls);
@@ -0,0 +1,78 @@
+#include "InputEvents.h"
+
+#include <algorithm>
+
+void InitInputTracker(InputTracker& tracker, uint64_t nowNs, size_t latencyHistory)
+{
+    std::fill(std::begin(tracker.down), std::end(tracker.down), false);
+    std::fill(std::begin(tracker.downSinceNs), std::end(tracker.downSinceNs), nowNs);
+    tracker.intervalBeginNs = nowNs;
+    tracker.pending.clear();
+    tracker.consumed = 0;
+    InitFrameTimer(tracker.latency, latencyHistory);
+}
+
+void ConsumeInputEvents(InputTracker& tracker, InputQueue& queue, uint64_t endNs, KeyFrameInput& frame)
+{
+    uint64_t beginNs = tracker.intervalBeginNs;
+    endNs            = std::max(endNs, beginNs);
+
+    uint64_t heldNs[256] = {};
+    std::fill(std::begin(frame.pressed), std::end(frame.pressed), false);
+
+    InputEvent event;
+    while (queue.Pop(event))
+    {
+        uint64_t t   = std::clamp(event.timestampNs, beginNs, endNs);
+        uint8_t  key = event.key;
+
+        if (event.down && !tracker.down[key])
+        {
+            tracker.down[key]        = true;
+            tracker.downSinceNs[key] = t;
+            frame.pressed[key]       = true;
+        }
+        else if (!event.down && tracker.down[key])
+        {
+            heldNs[key] += t - tracker.downSinceNs[key];
+            tracker.down[key] = false;
+        }
+
+        tracker.pending.push_back(event);
+        ++tracker.consumed;
+    }
+
+    // keys still down are held to the end and carry over from there
+    for (int key = 0; key < 256; ++key)
+    {
+        if (tracker.down[key])
+        {
+            heldNs[key] += endNs - tracker.downSinceNs[key];
+            tracker.downSinceNs[key] = endNs;
+        }
+    }
+
+    uint64_t spanNs = endNs - beginNs;
+    for (int key = 0; key < 256; ++key)
+    {
+        if (spanNs)
+            frame.heldFraction[key] = static_cast<float>(static_cast<double>(heldNs[key]) / spanNs);
+        else
+            frame.heldFraction[key] = tracker.down[key] || frame.pressed[key] ? 1.f : 0.f;
+    }
+
+    tracker.intervalBeginNs = endNs;
+}
+
+void RecordInputSubmit(InputTracker& tracker, uint64_t submitNs)
+{
+    for (const InputEvent& event : tracker.pending)
+        RecordFrameTime(tracker.latency, submitNs > event.timestampNs ? submitNs - event.timestampNs : 0);
+    tracker.pending.clear();
+}
+
+void KeysFromFrameInput(const KeyFrameInput& frame, bool keys[256])
+{
+    for (int key = 0; key < 256; ++key)
+        keys[key] = frame.heldFraction[key] > 0.f || frame.pressed[key];
+}
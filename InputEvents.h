@@ -0,0 +1,53 @@
+#pragma once
+
+#include "FrameTimer.h"
+#include "SpscQueue.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// One key transition, stamped with NowNanoseconds() when the window procedure
+// saw it. Auto-repeat arrives as further downs and is ignored.
+struct InputEvent
+{
+    uint64_t timestampNs = 0;
+    uint8_t  key         = 0;   // virtual-key code
+    bool     down        = false;
+};
+
+// Window procedure -> update. Sized for far more events than a frame sees.
+using InputQueue = SpscQueue<InputEvent, 1024>;
+
+// What each key did over one frame interval.
+struct KeyFrameInput
+{
+    float heldFraction[256] = {};   // share of the interval the key was down, 0..1
+    bool  pressed[256]      = {};   // went down during the interval, however briefly
+};
+
+// Consumer-side key state rebuilt from the event stream, and the events'
+// latency from timestamp to submit.
+struct InputTracker
+{
+    bool     down[256]        = {};   // at the end of the last interval
+    uint64_t downSinceNs[256] = {};
+    uint64_t intervalBeginNs  = 0;
+
+    std::vector<InputEvent> pending;     // consumed, submit not yet recorded
+    FrameTimer              latency;     // input-to-submit times, reusing the frame time ring
+    uint64_t                consumed = 0;
+};
+
+void InitInputTracker(InputTracker& tracker, uint64_t nowNs, size_t latencyHistory);
+
+// Drains `queue` and fills `frame` for the interval from the previous call to
+// endNs. Events stamped outside it (late arrivals) are clamped into it.
+void ConsumeInputEvents(InputTracker& tracker, InputQueue& queue, uint64_t endNs, KeyFrameInput& frame);
+
+// Closes the latency of every event consumed since the last call: the frame
+// built from them was submitted at submitNs.
+void RecordInputSubmit(InputTracker& tracker, uint64_t submitNs);
+
+// Held keys, or ones tapped within the frame, as a plain key array.
+void KeysFromFrameInput(const KeyFrameInput& frame, bool keys[256]);
@@ -0,0 +1,110 @@
+#include "InstanceBuffer.h"
+#include "AffineKernel.h"
+
+#include <cassert>
+#include <cmath>
+
+size_t InstanceCount(const InstanceTransforms& transforms)
+{
+    return transforms.positionX.size();
+}
+
+void ClearInstances(InstanceTransforms& transforms)
+{
+    transforms.positionX.clear();
+    transforms.positionY.clear();
+    transforms.scaleX.clear();
+    transforms.scaleY.clear();
+    transforms.rotation.clear();
+}
+
+void ReserveInstances(InstanceTransforms& transforms, size_t capacity)
+{
+    transforms.positionX.reserve(capacity);
+    transforms.positionY.reserve(capacity);
+    transforms.scaleX.reserve(capacity);
+    transforms.scaleY.reserve(capacity);
+    transforms.rotation.reserve(capacity);
+}
+
+size_t AddInstance(InstanceTransforms& transforms, float x, float y, float scaleX, float scaleY, float rotation)
+{
+    transforms.positionX.push_back(x);
+    transforms.positionY.push_back(y);
+    transforms.scaleX.push_back(scaleX);
+    transforms.scaleY.push_back(scaleY);
+    transforms.rotation.push_back(rotation);
+    return transforms.positionX.size() - 1;
+}
+
+void LayoutInstanceGrid(InstanceTransforms& transforms, size_t count, float extent)
+{
+    ClearInstances(transforms);
+    if (count == 0)
+        return;
+
+    ReserveInstances(transforms, count);
+
+    size_t side = static_cast<size_t>(std::ceil(std::sqrt(static_cast<double>(count))));
+    float  cell = 2.f * extent / side;
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        float x = -extent + cell * (i % side + 0.5f);
+        float y = -extent + cell * (i / side + 0.5f);
+        AddInstance(transforms, x, y, cell, cell, 0.37f * i);
+    }
+}
+
+void RotateInstances(InstanceTransforms& transforms, float angle)
+{
+    RotateInstanceRange(transforms, 0, InstanceCount(transforms), angle);
+}
+
+void RotateInstanceRange(InstanceTransforms& transforms, size_t first, size_t count, float angle)
+{
+    assert(first + count <= InstanceCount(transforms));
+
+    // keep angles small so the polynomial sin/cos stays accurate
+    constexpr float twoPi    = 6.28318530718f;
+    float*          rotation = transforms.rotation.data() + first;
+    for (size_t i = 0; i < count; ++i)
+        rotation[i] = std::remainder(rotation[i] + angle, twoPi);
+}
+
+void PackInstances(const InstanceTransforms& transforms, size_t first, size_t count, InstanceData* out)
+{
+    assert(first + count <= InstanceCount(transforms));
+
+    BuildAffineMatrices(transforms.positionX.data() + first,
+                        transforms.positionY.data() + first,
+                        transforms.scaleX.data() + first,
+                        transforms.scaleY.data() + first,
+                        transforms.rotation.data() + first,
+                        count,
+                        out->world);
+}
+
+void PackInstancesIndexed(const InstanceTransforms& transforms, const uint32_t* indices, size_t count, InstanceData* out)
+{
+    // gathered into small SoA chunks so the matrix kernel still streams
+    constexpr size_t kChunk = 256;
+    float            posX[kChunk], posY[kChunk], scaleX[kChunk], scaleY[kChunk], rotation[kChunk];
+
+    for (size_t first = 0; first < count; first += kChunk)
+    {
+        size_t n = count - first < kChunk ? count - first : kChunk;
+        for (size_t i = 0; i < n; ++i)
+        {
+            uint32_t index = indices[first + i];
+            assert(index < InstanceCount(transforms));
+
+            posX[i]     = transforms.positionX[index];
+            posY[i]     = transforms.positionY[index];
+            scaleX[i]   = transforms.scaleX[index];
+            scaleY[i]   = transforms.scaleY[index];
+            rotation[i] = transforms.rotation[index];
+        }
+        BuildAffineMatrices(posX, posY, scaleX, scaleY, rotation, n, out[first].world);
+    }
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Per-instance transforms, stored as structure-of-arrays so the packing pass
+// streams each component linearly.
+struct InstanceTransforms
+{
+    std::vector<float> positionX;
+    std::vector<float> positionY;
+    std::vector<float> scaleX;
+    std::vector<float> scaleY;
+    std::vector<float> rotation;
+};
+
+// GPU layout of one instance: row-major world matrix, bound as WORLD0..WORLD3.
+struct InstanceData
+{
+    float world[16];   // 64 bytes
+};
+
+size_t InstanceCount(const InstanceTransforms& transforms);
+void   ClearInstances(InstanceTransforms& transforms);
+void   ReserveInstances(InstanceTransforms& transforms, size_t capacity);
+size_t AddInstance(InstanceTransforms& transforms, float x, float y, float scaleX, float scaleY, float rotation);
+
+// Fills [-extent, extent]^2 with `count` instances on a square grid.
+void LayoutInstanceGrid(InstanceTransforms& transforms, size_t count, float extent);
+
+void RotateInstances(InstanceTransforms& transforms, float angle);
+void RotateInstanceRange(InstanceTransforms& transforms, size_t first, size_t count, float angle);
+
+// Writes world matrices for [first, first + count) into `out` (count entries).
+void PackInstances(const InstanceTransforms& transforms, size_t first, size_t count, InstanceData* out);
+
+// Same for the instances listed in `indices` (a culled subset), in list order.
+void PackInstancesIndexed(const InstanceTransforms& transforms, const uint32_t* indices, size_t count, InstanceData* out);
@@ -0,0 +1,369 @@
+#include "JobSystem.h"
+#include "Profiler.h"
+
+#include <algorithm>
+
+namespace
+{
+    constexpr int64_t  kDequeMask  = kJobsPerWorker - 1;
+    constexpr uint32_t kIdleSpins  = 64;   // empty rounds before a worker sleeps
+
+    static_assert((kJobsPerWorker & (kJobsPerWorker - 1)) == 0, "deque size must be a power of two");
+
+    thread_local JobSystem* t_system = nullptr;
+    thread_local uint32_t   t_worker = 0;
+
+    // Owner only. False when full.
+    bool PushBottom(JobDeque& deque, Job* job)
+    {
+        int64_t b = deque.bottom.load(std::memory_order_relaxed);
+        int64_t t = deque.top.load(std::memory_order_acquire);
+        if (b - t >= static_cast<int64_t>(kJobsPerWorker))
+            return false;
+
+        deque.slots[b & kDequeMask].store(job, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        deque.bottom.store(b + 1, std::memory_order_relaxed);
+        return true;
+    }
+
+    // Owner only, newest first.
+    Job* PopBottom(JobDeque& deque)
+    {
+        int64_t b = deque.bottom.load(std::memory_order_relaxed) - 1;
+        deque.bottom.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t t = deque.top.load(std::memory_order_relaxed);
+
+        if (t > b)
+        {
+            deque.bottom.store(b + 1, std::memory_order_relaxed);
+            return nullptr;
+        }
+
+        Job* job = deque.slots[b & kDequeMask].load(std::memory_order_relaxed);
+        if (t == b)
+        {
+            // last one: race the thieves for it
+            if (!deque.top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+                job = nullptr;
+            deque.bottom.store(b + 1, std::memory_order_relaxed);
+        }
+        return job;
+    }
+
+    // Any thread, oldest first. Null when empty or another thief won.
+    Job* StealTop(JobDeque& deque)
+    {
+        int64_t t = deque.top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t b = deque.bottom.load(std::memory_order_acquire);
+        if (t >= b)
+            return nullptr;
+
+        Job* job = deque.slots[t & kDequeMask].load(std::memory_order_relaxed);
+        if (!deque.top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+            return nullptr;
+        return job;
+    }
+
+    bool RunOneJob(JobSystem& system);
+
+    Job* AllocateJob(JobSystem& system)
+    {
+        JobWorker& worker = system.workers[t_worker];
+        Job&       job    = worker.jobs[worker.nextJob++ % kJobsPerWorker];
+
+        // the ring came round to a job still queued or running; help until it is done
+        while (job.inUse.load(std::memory_order_acquire))
+        {
+            if (!RunOneJob(system))
+                std::this_thread::yield();
+        }
+
+        job.inUse.store(true, std::memory_order_relaxed);
+        job.next = nullptr;
+        return &job;
+    }
+
+    void ExecuteJob(JobSystem& system, Job& job);
+
+    void PushJob(JobSystem& system, Job* job)
+    {
+        system.queued.fetch_add(1);
+        if (!PushBottom(system.workers[t_worker].deque, job))
+        {
+            system.queued.fetch_sub(1);
+            ExecuteJob(system, *job);
+            return;
+        }
+
+        if (system.sleeping.load() > 0)
+        {
+            std::lock_guard<std::mutex> lock(system.mutex);
+            system.wake.notify_one();
+        }
+    }
+
+    void ReleaseContinuations(JobSystem& system, JobCounter& counter)
+    {
+        Job* job = counter.continuations.exchange(nullptr);
+        while (job)
+        {
+            Job* next = job->next;
+            PushJob(system, job);
+            job = next;
+        }
+    }
+
+    void FinishJob(JobSystem& system, JobCounter& counter)
+    {
+        // the waiter may return as soon as pending hits zero; signalling keeps
+        // it waiting until the continuations are out
+        counter.signalling.fetch_add(1);
+        if (counter.pending.fetch_sub(1) == 1)
+            ReleaseContinuations(system, counter);
+        counter.signalling.fetch_sub(1);
+    }
+
+    void ExecuteJob(JobSystem& system, Job& job)
+    {
+        JobFunction function = job.function;
+        void*       data     = job.data;
+        uint32_t    begin    = job.begin;
+        uint32_t    end      = job.end;
+        uint32_t    grain    = job.grain;
+        JobCounter* counter  = job.counter;
+        job.inUse.store(false, std::memory_order_release);
+
+        // hand the upper half to the deque, where thieves take the biggest pieces first
+        while (grain > 0 && end - begin > grain)
+        {
+            uint32_t middle = begin + (end - begin) / 2;
+            if (counter)
+                counter->pending.fetch_add(1);
+
+            Job* half      = AllocateJob(system);
+            half->function = function;
+            half->data     = data;
+            half->begin    = middle;
+            half->end      = end;
+            half->grain    = grain;
+            half->counter  = counter;
+            PushJob(system, half);
+
+            end = middle;
+        }
+
+        function(data, begin, end);
+        if (counter)
+            FinishJob(system, *counter);
+    }
+
+    bool RunOneJob(JobSystem& system)
+    {
+        JobWorker& worker = system.workers[t_worker];
+        Job*       job    = PopBottom(worker.deque);
+        bool       stolen = false;
+
+        if (!job && system.workerCount > 1)
+        {
+            // xorshift: a different first victim each time keeps thieves apart
+            worker.random ^= worker.random << 13;
+            worker.random ^= worker.random >> 17;
+            worker.random ^= worker.random << 5;
+
+            uint32_t first = worker.random % system.workerCount;
+            for (uint32_t i = 0; i < system.workerCount && !job; ++i)
+            {
+                uint32_t victim = (first + i) % system.workerCount;
+                if (victim != t_worker)
+                    job = StealTop(system.workers[victim].deque);
+            }
+            stolen = job != nullptr;
+        }
+
+        if (!job)
+            return false;
+
+        system.queued.fetch_sub(1);
+        worker.stats.jobs.fetch_add(1, std::memory_order_relaxed);
+        if (stolen)
+            worker.stats.steals.fetch_add(1, std::memory_order_relaxed);
+
+        ExecuteJob(system, *job);
+        return true;
+    }
+
+    void WorkerMain(JobSystem& system, uint32_t index)
+    {
+        PROFILE_THREAD("JobWorker");
+
+        t_system = &system;
+        t_worker = index;
+
+        uint32_t idle = 0;
+        while (true)
+        {
+            if (RunOneJob(system))
+            {
+                idle = 0;
+                continue;
+            }
+
+            // a stop still drains the deques
+            if (!system.running.load() && system.queued.load() == 0)
+                break;
+
+            if (++idle < kIdleSpins)
+            {
+                std::this_thread::yield();
+                continue;
+            }
+
+            // pushers check `sleeping` after bumping `queued`, we check `queued`
+            // after bumping `sleeping`: one of us sees the other
+            std::unique_lock<std::mutex> lock(system.mutex);
+            system.sleeping.fetch_add(1);
+            system.workers[index].stats.sleeps.fetch_add(1, std::memory_order_relaxed);
+            system.wake.wait(lock, [&]() { return system.queued.load() > 0 || !system.running.load(); });
+            system.sleeping.fetch_sub(1);
+            idle = 0;
+        }
+
+        t_system = nullptr;
+    }
+}   // namespace
+
+void StartJobSystem(JobSystem& system, uint32_t threadCount)
+{
+    StopJobSystem(system);
+
+    if (threadCount == 0)
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+
+    system.workers     = std::make_unique<JobWorker[]>(threadCount);
+    system.workerCount = threadCount;
+    system.queued      = 0;
+    system.sleeping    = 0;
+    system.running     = true;
+
+    for (uint32_t i = 0; i < threadCount; ++i)
+        system.workers[i].random = 2654435761u * (i + 1);
+
+    t_system = &system;
+    t_worker = 0;
+
+    for (uint32_t i = 1; i < threadCount; ++i)
+        system.workers[i].thread = std::thread(WorkerMain, std::ref(system), i);
+}
+
+void StopJobSystem(JobSystem& system)
+{
+    if (!system.running.load())
+        return;
+
+    if (IsJobThread(system))
+    {
+        while (RunOneJob(system))
+        {
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(system.mutex);
+        system.running = false;
+    }
+    system.wake.notify_all();
+
+    for (uint32_t i = 1; i < system.workerCount; ++i)
+    {
+        if (system.workers[i].thread.joinable())
+            system.workers[i].thread.join();
+    }
+
+    if (t_system == &system)
+        t_system = nullptr;
+}
+
+bool IsJobThread(const JobSystem& system)
+{
+    return t_system == &system && system.running.load(std::memory_order_relaxed);
+}
+
+void SubmitJob(JobSystem& system, JobFunction function, void* data, uint32_t begin, uint32_t end, uint32_t grain, JobCounter* counter)
+{
+    if (!IsJobThread(system))
+    {
+        function(data, begin, end);
+        return;
+    }
+
+    if (counter)
+        counter->pending.fetch_add(1);
+
+    Job* job      = AllocateJob(system);
+    job->function = function;
+    job->data     = data;
+    job->begin    = begin;
+    job->end      = end;
+    job->grain    = grain;
+    job->counter  = counter;
+    PushJob(system, job);
+}
+
+void SubmitJobAfter(JobSystem& system, JobCounter& dependency, JobFunction function, void* data, uint32_t begin, uint32_t end, uint32_t grain, JobCounter* counter)
+{
+    // elsewhere every dependency already ran inline
+    if (!IsJobThread(system))
+    {
+        function(data, begin, end);
+        return;
+    }
+
+    if (counter)
+        counter->pending.fetch_add(1);
+
+    Job* job      = AllocateJob(system);
+    job->function = function;
+    job->data     = data;
+    job->begin    = begin;
+    job->end      = end;
+    job->grain    = grain;
+    job->counter  = counter;
+
+    Job* head = dependency.continuations.load();
+    do
+        job->next = head;
+    while (!dependency.continuations.compare_exchange_weak(head, job));
+
+    // the last dependency may have finished before the job was on the list
+    if (dependency.pending.load() == 0)
+        ReleaseContinuations(system, dependency);
+}
+
+void WaitForCounter(JobSystem& system, JobCounter& counter)
+{
+    bool helps = IsJobThread(system);
+    while (counter.pending.load() != 0 || counter.signalling.load() != 0)
+    {
+        if (!helps || !RunOneJob(system))
+            std::this_thread::yield();
+    }
+}
+
+uint64_t JobsRun(const JobSystem& system)
+{
+    uint64_t total = 0;
+    for (uint32_t i = 0; i < system.workerCount; ++i)
+        total += system.workers[i].stats.jobs.load(std::memory_order_relaxed);
+    return total;
+}
+
+uint64_t JobSteals(const JobSystem& system)
+{
+    uint64_t total = 0;
+    for (uint32_t i = 0; i < system.workerCount; ++i)
+        total += system.workers[i].stats.steals.load(std::memory_order_relaxed);
+    return total;
+}
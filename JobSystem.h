@@ -0,0 +1,128 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+
+constexpr uint32_t kJobsPerWorker = 4096;   // jobs a thread can have allocated and not yet run
+
+// Runs [begin, end) of whatever `data` describes.
+using JobFunction = void (*)(void* data, uint32_t begin, uint32_t end);
+
+struct Job;
+
+// Dependency counter: jobs submitted with it count up, each finished job
+// counts down. Jobs submitted after it run once it is back at zero; register
+// them after the jobs they wait for, a counter at zero counts as done. Wait
+// for a counter before it goes out of scope, even when only its
+// continuations matter.
+struct JobCounter
+{
+    std::atomic<uint32_t> pending { 0 };
+    std::atomic<uint32_t> signalling { 0 };   // finishers still touching the counter
+    std::atomic<Job*>     continuations { nullptr };
+};
+
+struct Job
+{
+    JobFunction function = nullptr;
+    void*       data     = nullptr;
+    uint32_t    begin    = 0;
+    uint32_t    end      = 0;
+    uint32_t    grain    = 0;   // ranges wider than this split in two, 0 never splits
+    JobCounter* counter  = nullptr;
+    Job*        next     = nullptr;   // in a counter's continuation list
+
+    std::atomic<bool> inUse { false };
+};
+
+// Chase-Lev work-stealing deque of fixed size: the owner pushes and pops at
+// the bottom, thieves take from the top, no locks.
+struct JobDeque
+{
+    std::atomic<int64_t> top { 0 };
+    std::atomic<int64_t> bottom { 0 };
+    std::atomic<Job*>    slots[kJobsPerWorker];
+};
+
+// Written by the owning thread, read anywhere.
+struct JobWorkerStats
+{
+    std::atomic<uint64_t> jobs { 0 };     // run by this thread
+    std::atomic<uint64_t> steals { 0 };   // of them taken from another deque
+    std::atomic<uint64_t> sleeps { 0 };
+};
+
+struct alignas(64) JobWorker
+{
+    JobDeque       deque;
+    Job            jobs[kJobsPerWorker];   // ring, reused in order
+    uint32_t       nextJob = 0;
+    uint32_t       random  = 0;   // steal victim order
+    JobWorkerStats stats;
+    std::thread    thread;
+};
+
+// Work-stealing job scheduler. The thread that starts it is worker 0 and runs
+// jobs while it waits; the others get a thread each. Submitting and waiting
+// is for those threads only: from any other thread ParallelFor runs inline.
+// Idle workers spin for a while, then sleep until something is queued.
+struct JobSystem
+{
+    std::unique_ptr<JobWorker[]> workers;
+    uint32_t                     workerCount = 0;
+
+    std::atomic<uint32_t>   queued { 0 };   // jobs sitting in deques
+    std::atomic<uint32_t>   sleeping { 0 };
+    std::atomic<bool>       running { false };
+    std::mutex              mutex;
+    std::condition_variable wake;
+};
+
+// threadCount 0 = one per hardware thread. Stops a running system first.
+void StartJobSystem(JobSystem& system, uint32_t threadCount);
+
+// Runs what is still queued, then joins the workers.
+void StopJobSystem(JobSystem& system);
+
+// Whether the calling thread can submit to `system`.
+bool IsJobThread(const JobSystem& system);
+
+// Queues function(data, begin, end). With grain > 0 the range is split in
+// halves across workers until no wider than grain. `counter` may be null.
+void SubmitJob(JobSystem& system, JobFunction function, void* data, uint32_t begin, uint32_t end, uint32_t grain, JobCounter* counter);
+
+// Same, queued once `dependency` reaches zero.
+void SubmitJobAfter(JobSystem& system, JobCounter& dependency, JobFunction function, void* data, uint32_t begin, uint32_t end, uint32_t grain, JobCounter* counter);
+
+// Runs queued jobs until `counter` reaches zero.
+void WaitForCounter(JobSystem& system, JobCounter& counter);
+
+// fn(begin, end) over [0, count) in pieces of at most `grain`, spread across
+// the workers; returns when all of them are done.
+template<typename Fn>
+void ParallelFor(JobSystem& system, uint32_t count, uint32_t grain, Fn&& fn)
+{
+    if (count == 0)
+        return;
+    if (count <= grain || system.workerCount < 2 || !IsJobThread(system))
+    {
+        fn(0u, count);
+        return;
+    }
+
+    using Body      = std::remove_reference_t<Fn>;
+    JobFunction run = [](void* data, uint32_t begin, uint32_t end) { (*static_cast<Body*>(data))(begin, end); };
+
+    JobCounter counter;
+    SubmitJob(system, run, const_cast<void*>(static_cast<const void*>(&fn)), 0, count, grain, &counter);
+    WaitForCounter(system, counter);
+}
+
+// Totals over every worker.
+uint64_t JobsRun(const JobSystem& system);
+uint64_t JobSteals(const JobSystem& system);
@@ -0,0 +1,109 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#    define WIN32_LEAN_AND_MEAN
+#    include <windows.h>
+#else
+#    include <fcntl.h>
+#    include <sys/mman.h>
+#    include <sys/stat.h>
+#    include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+bool OpenMappedFile(MappedFile& mapped, const char* path)
+{
+    CloseMappedFile(mapped);
+
+    HANDLE file = ::CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER size = {};
+    if (!::GetFileSizeEx(file, &size))
+    {
+        ::CloseHandle(file);
+        return false;
+    }
+
+    mapped.file = file;
+    if (size.QuadPart == 0)
+        return true;
+
+    HANDLE mapping = ::CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!mapping)
+    {
+        CloseMappedFile(mapped);
+        return false;
+    }
+    mapped.mapping = mapping;
+
+    void* view = ::MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!view)
+    {
+        CloseMappedFile(mapped);
+        return false;
+    }
+
+    mapped.data = static_cast<const uint8_t*>(view);
+    mapped.size = static_cast<size_t>(size.QuadPart);
+    return true;
+}
+
+void CloseMappedFile(MappedFile& mapped)
+{
+    if (mapped.data)
+        ::UnmapViewOfFile(mapped.data);
+    if (mapped.mapping)
+        ::CloseHandle(mapped.mapping);
+    if (mapped.file)
+        ::CloseHandle(mapped.file);
+
+    mapped = {};
+}
+
+#else
+
+bool OpenMappedFile(MappedFile& mapped, const char* path)
+{
+    CloseMappedFile(mapped);
+
+    int fd = ::open(path, O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    struct stat info = {};
+    if (::fstat(fd, &info) != 0)
+    {
+        ::close(fd);
+        return false;
+    }
+
+    mapped.fd = fd;
+    if (info.st_size == 0)
+        return true;
+
+    void* view = ::mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    if (view == MAP_FAILED)
+    {
+        CloseMappedFile(mapped);
+        return false;
+    }
+
+    mapped.data = static_cast<const uint8_t*>(view);
+    mapped.size = static_cast<size_t>(info.st_size);
+    return true;
+}
+
+void CloseMappedFile(MappedFile& mapped)
+{
+    if (mapped.data)
+        ::munmap(const_cast<uint8_t*>(mapped.data), mapped.size);
+    if (mapped.fd >= 0)
+        ::close(mapped.fd);
+
+    mapped = {};
+}
+
+#endif
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Read-only memory mapping of a whole file.
+struct MappedFile
+{
+    const uint8_t* data = nullptr;
+    size_t         size = 0;
+
+#ifdef _WIN32
+    void* file    = nullptr;   // HANDLE
+    void* mapping = nullptr;   // HANDLE
+#else
+    int fd = -1;
+#endif
+};
+
+// False if the file is missing or cannot be mapped. Empty files map to size 0.
+bool OpenMappedFile(MappedFile& mapped, const char* path);
+void CloseMappedFile(MappedFile& mapped);
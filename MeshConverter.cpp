@@ -0,0 +1,198 @@
+// Converts an OBJ file to the binary mesh container, or prints the header of
+// an existing one.
+// Linux: cmake -S . -B build && cmake --build build, or
+//        g++ -O2 -std=c++20 MeshConverter.cpp MeshFile.cpp MeshOptimizer.cpp ObjMesh.cpp MappedFile.cpp VertexFormat.cpp -o meshconv
+//   meshconv <input.obj> <output.mesh> [--format float|half|snorm16] [--normalize] [--no-optimize]
+//   meshconv --info <file.mesh>
+//
+// --normalize centers the mesh on its bounds and scales the larger extent to
+// [-1, 1]; snorm16 refuses meshes outside that range without it. Indices and
+// vertices are reordered for the vertex cache, overdraw and fetch unless
+// --no-optimize is given.
+
+#include "MeshFile.h"
+#include "MeshOptimizer.h"
+#include "ObjMesh.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+int PrintMeshInfo(const char* path)
+{
+    MeshStreamReader reader;
+    if (!OpenMeshStream(reader, path))
+    {
+        std::fprintf(stderr, "%s: not a valid mesh file\n", path);
+        return 1;
+    }
+
+    std::vector<uint8_t> scratch(1 << 20);
+    bool                 intact = VerifyMeshStream(reader, scratch.data(), scratch.size());
+
+    const MeshFileHeader& h = reader.header;
+    std::printf("version   %u\n", h.version);
+    std::printf("format    %s, stride %u\n", VertexFormatName(static_cast<VertexFormat>(h.vertexFormat)), h.vertexStride);
+    std::printf("vertices  %llu at %llu\n", static_cast<unsigned long long>(h.vertexCount), static_cast<unsigned long long>(h.vertexOffset));
+    std::printf("indices   %llu x %zu bytes at %llu\n",
+                static_cast<unsigned long long>(h.indexCount),
+                IndexFormatSize(static_cast<IndexFormat>(h.indexFormat)),
+                static_cast<unsigned long long>(h.indexOffset));
+    std::printf("bounds    (%g, %g) - (%g, %g)\n", h.boundsMin[0], h.boundsMin[1], h.boundsMax[0], h.boundsMax[1]);
+    std::printf("checksum  %016llx %s\n", static_cast<unsigned long long>(h.dataChecksum), intact ? "ok" : "MISMATCH");
+
+    CloseMeshStream(reader);
+    return intact ? 0 : 1;
+}
+
+// Vertex cache, overdraw and fetch passes in place, with before/after stats.
+void OptimizeObjMesh(ObjMesh& mesh)
+{
+    size_t vertexCount = mesh.z.size();
+
+    std::vector<float> positions(vertexCount * 3);
+    for (size_t i = 0; i < vertexCount; ++i)
+    {
+        positions[i * 3]     = mesh.vertices[i * 5];
+        positions[i * 3 + 1] = mesh.vertices[i * 5 + 1];
+        positions[i * 3 + 2] = mesh.z[i];
+    }
+
+    VertexCacheStats cacheBefore    = AnalyzeVertexCache(mesh.indices.data(), mesh.indices.size(), vertexCount, 16);
+    OverdrawStats    overdrawBefore = AnalyzeOverdraw(mesh.indices.data(), mesh.indices.size(), positions.data(), vertexCount, 3);
+
+    std::vector<uint32_t> cacheOrder(mesh.indices.size());
+    OptimizeVertexCache(cacheOrder.data(), mesh.indices.data(), mesh.indices.size(), vertexCount);
+    OptimizeOverdraw(mesh.indices.data(), cacheOrder.data(), cacheOrder.size(), positions.data(), vertexCount, 3, 1.05f);
+
+    OverdrawStats overdrawAfter = AnalyzeOverdraw(mesh.indices.data(), mesh.indices.size(), positions.data(), vertexCount, 3);
+
+    // z rides along as a sixth float so it stays matched to its vertex
+    std::vector<float> interleaved(vertexCount * 6);
+    for (size_t i = 0; i < vertexCount; ++i)
+    {
+        std::copy_n(&mesh.vertices[i * 5], 5, &interleaved[i * 6]);
+        interleaved[i * 6 + 5] = mesh.z[i];
+    }
+    std::vector<float> fetchOrder(interleaved.size());
+    vertexCount = OptimizeVertexFetch(fetchOrder.data(), mesh.indices.data(), mesh.indices.size(), interleaved.data(), vertexCount, 6 * sizeof(float));
+
+    mesh.vertices.resize(vertexCount * 5);
+    mesh.z.resize(vertexCount);
+    for (size_t i = 0; i < vertexCount; ++i)
+    {
+        std::copy_n(&fetchOrder[i * 6], 5, &mesh.vertices[i * 5]);
+        mesh.z[i] = fetchOrder[i * 6 + 5];
+    }
+
+    VertexCacheStats cacheAfter = AnalyzeVertexCache(mesh.indices.data(), mesh.indices.size(), vertexCount, 16);
+    std::printf("acmr      %.3f -> %.3f\n", cacheBefore.acmr, cacheAfter.acmr);
+    std::printf("atvr      %.3f -> %.3f\n", cacheBefore.atvr, cacheAfter.atvr);
+    std::printf("overdraw  %.3f -> %.3f\n", overdrawBefore.overdraw, overdrawAfter.overdraw);
+}
+
+int main(int argc, char** argv)
+{
+    if (argc == 3 && std::strcmp(argv[1], "--info") == 0)
+        return PrintMeshInfo(argv[2]);
+
+    const char*  input     = nullptr;
+    const char*  output    = nullptr;
+    VertexFormat format    = VertexFormat::Float32;
+    bool         normalize = false;
+    bool         optimize  = true;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "--format") == 0 && i + 1 < argc)
+        {
+            const char* name = argv[++i];
+            if (std::strcmp(name, "float") == 0)
+                format = VertexFormat::Float32;
+            else if (std::strcmp(name, "half") == 0)
+                format = VertexFormat::Half;
+            else if (std::strcmp(name, "snorm16") == 0)
+                format = VertexFormat::Snorm16;
+            else
+            {
+                std::fprintf(stderr, "unknown format %s\n", name);
+                return 1;
+            }
+        }
+        else if (std::strcmp(argv[i], "--normalize") == 0)
+            normalize = true;
+        else if (std::strcmp(argv[i], "--no-optimize") == 0)
+            optimize = false;
+        else if (!input)
+            input = argv[i];
+        else if (!output)
+            output = argv[i];
+        else
+        {
+            std::fprintf(stderr, "unexpected argument %s\n", argv[i]);
+            return 1;
+        }
+    }
+
+    if (!input || !output)
+    {
+        std::fprintf(stderr, "usage: meshconv <input.obj> <output.mesh> [--format float|half|snorm16] [--normalize] [--no-optimize]\n"
+                             "       meshconv --info <file.mesh>\n");
+        return 1;
+    }
+
+    ObjMesh mesh;
+    if (!LoadObjMesh(input, mesh))
+    {
+        std::fprintf(stderr, "failed to read %s\n", input);
+        return 1;
+    }
+
+    std::vector<float>& vertices    = mesh.vertices;
+    size_t              vertexCount = mesh.z.size();
+    float  lo[2]       = { 0.f, 0.f };
+    float  hi[2]       = { 0.f, 0.f };
+    for (size_t i = 0; i < vertexCount; ++i)
+    {
+        for (int axis = 0; axis < 2; ++axis)
+        {
+            float v  = vertices[i * 5 + axis];
+            lo[axis] = i == 0 ? v : std::min(lo[axis], v);
+            hi[axis] = i == 0 ? v : std::max(hi[axis], v);
+        }
+    }
+
+    if (normalize && vertexCount > 0)
+    {
+        float center[2] = { (lo[0] + hi[0]) * 0.5f, (lo[1] + hi[1]) * 0.5f };
+        float extent    = std::max(hi[0] - lo[0], hi[1] - lo[1]) * 0.5f;
+        float scale     = extent > 0.f ? 1.f / extent : 1.f;
+        for (size_t i = 0; i < vertexCount; ++i)
+        {
+            vertices[i * 5]     = (vertices[i * 5] - center[0]) * scale;
+            vertices[i * 5 + 1] = (vertices[i * 5 + 1] - center[1]) * scale;
+        }
+    }
+    else if (format == VertexFormat::Snorm16 && std::max({ std::fabs(lo[0]), std::fabs(lo[1]), std::fabs(hi[0]), std::fabs(hi[1]) }) > 1.f)
+    {
+        std::fprintf(stderr, "%s extends past [-1, 1]; snorm16 would clamp it, use --normalize\n", input);
+        return 1;
+    }
+
+    if (optimize)
+    {
+        OptimizeObjMesh(mesh);
+        vertexCount = mesh.z.size();
+    }
+
+    if (!WriteMeshFile(output, format, vertices.data(), vertexCount, mesh.indices.data(), mesh.indices.size()))
+    {
+        std::fprintf(stderr, "failed to write %s\n", output);
+        return 1;
+    }
+
+    std::printf("%s: %zu vertices, %zu indices, %s\n", output, vertexCount, mesh.indices.size(), VertexFormatName(format));
+    return 0;
+}
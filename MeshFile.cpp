@@ -0,0 +1,292 @@
+#include "MeshFile.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace
+{
+    constexpr uint64_t kChecksumPrime = 1099511628211ull;
+
+    uint64_t AlignUp(uint64_t value, uint64_t alignment)
+    {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
+    uint64_t HeaderChecksum(const MeshFileHeader& header)
+    {
+        return MeshChecksum(kMeshChecksumSeed, &header, offsetof(MeshFileHeader, headerChecksum));
+    }
+
+    // Everything a reader relies on before touching the data: the layout must be
+    // the one this build has for the format, and every blob must lie inside
+    // the file. Counts are checked against the file size before multiplying.
+    bool ValidateHeader(const MeshFileHeader& header, uint64_t fileSize)
+    {
+        if (header.magic != kMeshFileMagic || header.version != kMeshFileVersion)
+            return false;
+        if (header.headerChecksum != HeaderChecksum(header))
+            return false;
+        if (header.vertexFormat >= static_cast<uint32_t>(VertexFormat::Count))
+            return false;
+        if (header.indexFormat != static_cast<uint32_t>(IndexFormat::UInt16) && header.indexFormat != static_cast<uint32_t>(IndexFormat::UInt32))
+            return false;
+
+        const VertexLayout& layout = GetVertexLayout(static_cast<VertexFormat>(header.vertexFormat));
+        if (header.vertexStride != layout.stride || header.elementCount != layout.elementCount)
+            return false;
+        for (uint32_t i = 0; i < layout.elementCount; ++i)
+        {
+            const MeshFileElement& e = header.elements[i];
+            if (std::strncmp(e.semantic, layout.elements[i].semantic, sizeof(e.semantic)) != 0 ||
+                e.semanticIndex != layout.elements[i].semanticIndex ||
+                e.format != static_cast<uint32_t>(layout.elements[i].format) ||
+                e.offset != layout.elements[i].offset)
+                return false;
+        }
+
+        uint64_t indexSize = IndexFormatSize(static_cast<IndexFormat>(header.indexFormat));
+        if (header.dataEnd > fileSize ||
+            header.vertexOffset < sizeof(MeshFileHeader) ||
+            header.vertexOffset % kMeshBlobAlignment != 0 ||
+            header.indexOffset % kMeshBlobAlignment != 0 ||
+            (header.dataEnd - header.vertexOffset) % kMeshBlobAlignment != 0 ||
+            header.vertexCount > fileSize / header.vertexStride ||
+            header.indexCount > fileSize / indexSize)
+            return false;
+
+        return header.vertexOffset + header.vertexCount * header.vertexStride <= header.indexOffset &&
+               header.indexOffset + header.indexCount * indexSize <= header.dataEnd;
+    }
+
+    bool Seek(FILE* file, uint64_t offset)
+    {
+#ifdef _WIN32
+        return _fseeki64(file, static_cast<__int64>(offset), SEEK_SET) == 0;
+#else
+        return fseeko(file, static_cast<off_t>(offset), SEEK_SET) == 0;
+#endif
+    }
+
+    bool FileSize(FILE* file, uint64_t& size)
+    {
+#ifdef _WIN32
+        if (_fseeki64(file, 0, SEEK_END) != 0)
+            return false;
+        __int64 end = _ftelli64(file);
+#else
+        if (fseeko(file, 0, SEEK_END) != 0)
+            return false;
+        off_t end = ftello(file);
+#endif
+        size = static_cast<uint64_t>(end);
+        return end >= 0;
+    }
+
+    bool ReadAt(FILE* file, uint64_t offset, void* out, size_t size)
+    {
+        return Seek(file, offset) && std::fread(out, 1, size, file) == size;
+    }
+}   // namespace
+
+uint64_t MeshChecksum(uint64_t hash, const void* data, size_t size)
+{
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i + 8 <= size; i += 8)
+    {
+        uint64_t word;
+        std::memcpy(&word, bytes + i, sizeof(word));
+        hash = (hash ^ word) * kChecksumPrime;
+    }
+    return hash;
+}
+
+float MeshBoundingRadius(const MeshFileHeader& header)
+{
+    float x = std::max(std::fabs(header.boundsMin[0]), std::fabs(header.boundsMax[0]));
+    float y = std::max(std::fabs(header.boundsMin[1]), std::fabs(header.boundsMax[1]));
+    return std::sqrt(x * x + y * y);
+}
+
+bool WriteMeshFile(const char* path, VertexFormat format, const float* vertices, size_t vertexCount, const uint32_t* indices, size_t indexCount)
+{
+    const VertexLayout& layout      = GetVertexLayout(format);
+    IndexFormat         indexFormat = SelectIndexFormat(vertexCount);
+
+    MeshFileHeader header = {};
+    header.magic          = kMeshFileMagic;
+    header.version        = kMeshFileVersion;
+    header.vertexFormat   = static_cast<uint32_t>(format);
+    header.vertexStride   = layout.stride;
+    header.elementCount   = layout.elementCount;
+    header.indexFormat    = static_cast<uint32_t>(indexFormat);
+    header.vertexCount    = vertexCount;
+    header.indexCount     = indexCount;
+    header.vertexOffset   = AlignUp(sizeof(MeshFileHeader), kMeshBlobAlignment);
+    header.indexOffset    = AlignUp(header.vertexOffset + vertexCount * layout.stride, kMeshBlobAlignment);
+    header.dataEnd        = AlignUp(header.indexOffset + indexCount * IndexFormatSize(indexFormat), kMeshBlobAlignment);
+
+    for (uint32_t i = 0; i < layout.elementCount; ++i)
+    {
+        MeshFileElement& e = header.elements[i];
+        std::strncpy(e.semantic, layout.elements[i].semantic, sizeof(e.semantic) - 1);
+        e.semanticIndex = layout.elements[i].semanticIndex;
+        e.format        = static_cast<uint32_t>(layout.elements[i].format);
+        e.offset        = layout.elements[i].offset;
+    }
+
+    for (size_t i = 0; i < vertexCount; ++i)
+    {
+        const float* v = vertices + i * 5;
+        for (int axis = 0; axis < 2; ++axis)
+        {
+            header.boundsMin[axis] = i == 0 || v[axis] < header.boundsMin[axis] ? v[axis] : header.boundsMin[axis];
+            header.boundsMax[axis] = i == 0 || v[axis] > header.boundsMax[axis] ? v[axis] : header.boundsMax[axis];
+        }
+    }
+
+    // the data region is built whole so the checksum and the write see the same padding
+    std::vector<uint8_t> data(header.dataEnd - header.vertexOffset);
+    PackVertices(format, vertices, vertexCount, data.data());
+    PackIndices(indices, indexCount, indexFormat, data.data() + (header.indexOffset - header.vertexOffset));
+
+    header.dataChecksum   = MeshChecksum(kMeshChecksumSeed, data.data(), data.size());
+    header.headerChecksum = HeaderChecksum(header);
+
+    // write next to the target, then swap it in; a reader may still have the old file mapped
+    std::string tempPath = std::string(path) + ".tmp";
+    FILE*       file     = std::fopen(tempPath.c_str(), "wb");
+    if (!file)
+        return false;
+
+    static const uint8_t padding[kMeshBlobAlignment] = {};
+    std::fwrite(&header, sizeof(header), 1, file);
+    std::fwrite(padding, 1, header.vertexOffset - sizeof(header), file);
+    std::fwrite(data.data(), 1, data.size(), file);
+
+    bool ok = std::ferror(file) == 0;
+    if (std::fclose(file) != 0 || !ok)
+    {
+        std::remove(tempPath.c_str());
+        return false;
+    }
+
+    std::error_code error;
+    std::filesystem::rename(tempPath, path, error);
+    if (error)
+    {
+        std::remove(tempPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool OpenMeshFile(MeshView& mesh, const char* path, bool verifyData)
+{
+    CloseMeshFile(mesh);
+
+    if (!OpenMappedFile(mesh.file, path))
+        return false;
+
+    const MappedFile& file = mesh.file;
+    if (file.size < sizeof(MeshFileHeader))
+    {
+        CloseMeshFile(mesh);
+        return false;
+    }
+
+    std::memcpy(&mesh.header, file.data, sizeof(MeshFileHeader));
+    const MeshFileHeader& h = mesh.header;
+
+    if (!ValidateHeader(h, file.size) ||
+        (verifyData && MeshChecksum(kMeshChecksumSeed, file.data + h.vertexOffset, h.dataEnd - h.vertexOffset) != h.dataChecksum))
+    {
+        CloseMeshFile(mesh);
+        return false;
+    }
+
+    mesh.vertexFormat = static_cast<VertexFormat>(h.vertexFormat);
+    mesh.indexFormat  = static_cast<IndexFormat>(h.indexFormat);
+    mesh.vertices     = file.data + h.vertexOffset;
+    mesh.indices      = file.data + h.indexOffset;
+    mesh.vertexBytes  = h.vertexCount * h.vertexStride;
+    mesh.indexBytes   = h.indexCount * IndexFormatSize(mesh.indexFormat);
+    return true;
+}
+
+void CloseMeshFile(MeshView& mesh)
+{
+    CloseMappedFile(mesh.file);
+    mesh = MeshView {};
+}
+
+bool OpenMeshStream(MeshStreamReader& reader, const char* path)
+{
+    CloseMeshStream(reader);
+
+    reader.file = std::fopen(path, "rb");
+    if (!reader.file)
+        return false;
+
+    uint64_t size = 0;
+    if (!FileSize(reader.file, size) ||
+        size < sizeof(MeshFileHeader) ||
+        !ReadAt(reader.file, 0, &reader.header, sizeof(MeshFileHeader)) ||
+        !ValidateHeader(reader.header, size))
+    {
+        CloseMeshStream(reader);
+        return false;
+    }
+    return true;
+}
+
+void CloseMeshStream(MeshStreamReader& reader)
+{
+    if (reader.file)
+        std::fclose(reader.file);
+    reader = MeshStreamReader {};
+}
+
+bool ReadMeshVertices(MeshStreamReader& reader, uint64_t first, uint64_t count, void* out)
+{
+    const MeshFileHeader& h = reader.header;
+    if (!reader.file || first > h.vertexCount || count > h.vertexCount - first)
+        return false;
+
+    return ReadAt(reader.file, h.vertexOffset + first * h.vertexStride, out, static_cast<size_t>(count * h.vertexStride));
+}
+
+bool ReadMeshIndices(MeshStreamReader& reader, uint64_t first, uint64_t count, void* out)
+{
+    const MeshFileHeader& h = reader.header;
+    if (!reader.file || first > h.indexCount || count > h.indexCount - first)
+        return false;
+
+    uint64_t indexSize = IndexFormatSize(static_cast<IndexFormat>(h.indexFormat));
+    return ReadAt(reader.file, h.indexOffset + first * indexSize, out, static_cast<size_t>(count * indexSize));
+}
+
+bool VerifyMeshStream(MeshStreamReader& reader, void* scratch, size_t scratchSize)
+{
+    const MeshFileHeader& h = reader.header;
+    if (!reader.file || scratchSize < kMeshBlobAlignment || !Seek(reader.file, h.vertexOffset))
+        return false;
+
+    scratchSize -= scratchSize % kMeshBlobAlignment;
+
+    uint64_t hash      = kMeshChecksumSeed;
+    uint64_t remaining = h.dataEnd - h.vertexOffset;
+    while (remaining > 0)
+    {
+        size_t chunk = remaining < scratchSize ? static_cast<size_t>(remaining) : scratchSize;
+        if (std::fread(scratch, 1, chunk, reader.file) != chunk)
+            return false;
+        hash = MeshChecksum(hash, scratch, chunk);
+        remaining -= chunk;
+    }
+    return hash == h.dataChecksum;
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include "MappedFile.h"
+#include "RenderContext.h"
+#include "VertexFormat.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+
+// Binary mesh container, laid out so a memory mapping can be handed to the
+// GPU as is:
+//
+//   MeshFileHeader           192 bytes
+//   vertex blob              at vertexOffset, vertexCount * vertexStride bytes
+//   index blob               at indexOffset, indexCount * 2 or 4 bytes
+//
+// Blobs start on kMeshBlobAlignment and the data region [vertexOffset,
+// dataEnd) is zero-padded to a multiple of it. headerChecksum covers the
+// header up to that field; dataChecksum covers the whole data region.
+constexpr uint32_t kMeshFileMagic     = 0x4853454D;   // "MESH"
+constexpr uint32_t kMeshFileVersion   = 1;
+constexpr uint32_t kMeshBlobAlignment = 64;
+
+struct MeshFileElement
+{
+    char     semantic[12];   // NUL-terminated
+    uint32_t semanticIndex;
+    uint32_t format;          // VertexElementFormat
+    uint32_t offset;
+};
+
+struct MeshFileHeader
+{
+    uint32_t        magic;
+    uint32_t        version;
+    uint32_t        vertexFormat;   // VertexFormat
+    uint32_t        vertexStride;
+    uint32_t        elementCount;
+    uint32_t        indexFormat;    // IndexFormat
+    uint64_t        vertexCount;
+    uint64_t        indexCount;
+    uint64_t        vertexOffset;
+    uint64_t        indexOffset;
+    uint64_t        dataEnd;
+    float           boundsMin[2];
+    float           boundsMax[2];
+    MeshFileElement elements[VertexLayout::kMaxElements];
+    uint32_t        reserved[12];   // zero
+    uint64_t        dataChecksum;
+    uint64_t        headerChecksum;
+};
+
+static_assert(sizeof(MeshFileHeader) == 192, "file layout");
+
+// 64-bit FNV-style hash taken a word at a time; size must be a multiple of 8.
+uint64_t MeshChecksum(uint64_t hash, const void* data, size_t size);
+constexpr uint64_t kMeshChecksumSeed = 14695981039346656037ull;
+
+// Radius of the smallest origin-centered circle around the header bounds.
+float MeshBoundingRadius(const MeshFileHeader& header);
+
+// Packs float vertices (x, y, r, g, b) to `format` and indices to the
+// narrowest width that fits, then writes the container.
+bool WriteMeshFile(const char* path, VertexFormat format, const float* vertices, size_t vertexCount, const uint32_t* indices, size_t indexCount);
+
+// Zero-copy view of a mapped mesh file. vertices/indices point into the
+// mapping and stay valid until CloseMeshFile.
+struct MeshView
+{
+    MappedFile     file;
+    MeshFileHeader header       = {};
+    VertexFormat   vertexFormat = VertexFormat::Float32;
+    IndexFormat    indexFormat  = IndexFormat::UInt32;
+    const void*    vertices     = nullptr;
+    const void*    indices      = nullptr;
+    size_t         vertexBytes  = 0;
+    size_t         indexBytes   = 0;
+};
+
+// Maps the file and validates the header and layout descriptor. With
+// verifyData the data checksum is checked too, which touches every page.
+bool OpenMeshFile(MeshView& mesh, const char* path, bool verifyData);
+void CloseMeshFile(MeshView& mesh);
+
+// Chunked reads through a small buffer, for meshes larger than the address
+// space the caller is willing to map.
+struct MeshStreamReader
+{
+    FILE*          file   = nullptr;
+    MeshFileHeader header = {};
+};
+
+bool OpenMeshStream(MeshStreamReader& reader, const char* path);
+void CloseMeshStream(MeshStreamReader& reader);
+
+// [first, first + count) vertices or indices into `out`.
+bool ReadMeshVertices(MeshStreamReader& reader, uint64_t first, uint64_t count, void* out);
+bool ReadMeshIndices(MeshStreamReader& reader, uint64_t first, uint64_t count, void* out);
+
+// Checks dataChecksum by streaming the data region through `scratch`
+// (a multiple of kMeshBlobAlignment bytes).
+bool VerifyMeshStream(MeshStreamReader& reader, void* scratch, size_t scratchSize);
@@ -0,0 +1,471 @@
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+namespace
+{
+    constexpr uint32_t kInvalid = ~0u;
+
+    // Forsyth scoring: an LRU of 32 for scores; the 3 extra slots hold the
+    // vertices pushed out by the triangle just emitted.
+    constexpr uint32_t kForsythCacheSize = 32;
+    constexpr uint32_t kMaxValence       = 32;
+    constexpr float    kLastTriangle     = 0.75f;   // flat for the 3 newest entries, their order is arbitrary
+    constexpr float    kCacheDecay       = 1.5f;
+    constexpr float    kValenceScale     = 2.f;
+    constexpr float    kValenceDecay     = 0.5f;
+
+    // Cluster splitting simulates the FIFO used for analysis.
+    constexpr uint32_t kFifoCacheSize = 16;
+
+    constexpr uint32_t kOverdrawViewport = 256;
+
+    struct ScoreTables
+    {
+        float cache[kForsythCacheSize + 1];   // [position + 1], 0 = not cached
+        float valence[kMaxValence + 1];       // [remaining triangles], capped
+
+        ScoreTables()
+        {
+            cache[0] = 0.f;
+            for (uint32_t i = 0; i < kForsythCacheSize; ++i)
+                cache[i + 1] = i < 3 ? kLastTriangle : std::pow(1.f - float(i - 3) / (kForsythCacheSize - 3), kCacheDecay);
+
+            valence[0] = 0.f;
+            for (uint32_t i = 1; i <= kMaxValence; ++i)
+                valence[i] = kValenceScale * std::pow(float(i), -kValenceDecay);
+        }
+    };
+
+    const ScoreTables g_scores;
+
+    float VertexScore(int cachePosition, uint32_t liveTriangles)
+    {
+        // no triangles left: nothing to gain from it, let it fall out of the cache
+        if (liveTriangles == 0)
+            return -1.f;
+        return g_scores.cache[cachePosition + 1] + g_scores.valence[std::min(liveTriangles, kMaxValence)];
+    }
+
+    // Triangles per vertex as one flat array, vertex v's at [offsets[v], offsets[v] + counts[v]).
+    struct TriangleAdjacency
+    {
+        std::vector<uint32_t> counts;
+        std::vector<uint32_t> offsets;
+        std::vector<uint32_t> triangles;
+    };
+
+    void BuildAdjacency(TriangleAdjacency& adjacency, const uint32_t* indices, size_t indexCount, size_t vertexCount)
+    {
+        adjacency.counts.assign(vertexCount, 0);
+        adjacency.offsets.resize(vertexCount);
+        adjacency.triangles.resize(indexCount);
+
+        for (size_t i = 0; i < indexCount; ++i)
+            ++adjacency.counts[indices[i]];
+
+        uint32_t offset = 0;
+        for (size_t v = 0; v < vertexCount; ++v)
+        {
+            adjacency.offsets[v] = offset;
+            offset += adjacency.counts[v];
+        }
+
+        // filled by bumping the offsets, then put back
+        for (size_t i = 0; i < indexCount; ++i)
+            adjacency.triangles[adjacency.offsets[indices[i]]++] = static_cast<uint32_t>(i / 3);
+        for (size_t v = 0; v < vertexCount; ++v)
+            adjacency.offsets[v] -= adjacency.counts[v];
+    }
+
+    // FIFO cache as per-vertex insertion timestamps: a vertex is cached while
+    // fewer than cacheSize others were inserted after it. Adding cacheSize + 1
+    // to `timestamp` empties the cache.
+    uint32_t UpdateFifo(const uint32_t* triangle, uint32_t cacheSize, std::vector<uint32_t>& timestamps, uint32_t& timestamp)
+    {
+        uint32_t misses = 0;
+        for (int k = 0; k < 3; ++k)
+        {
+            uint32_t v = triangle[k];
+            if (timestamp - timestamps[v] > cacheSize)
+            {
+                timestamps[v] = timestamp++;
+                ++misses;
+            }
+        }
+        return misses;
+    }
+
+    void Cross(const float* a, const float* b, const float* c, float* n)
+    {
+        float e1[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+        float e2[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+        n[0]        = e1[1] * e2[2] - e1[2] * e2[1];
+        n[1]        = e1[2] * e2[0] - e1[0] * e2[2];
+        n[2]        = e1[0] * e2[1] - e1[1] * e2[0];
+    }
+
+    struct OverdrawTarget
+    {
+        std::vector<float> depth;
+        uint64_t           shaded = 0;
+    };
+
+    // Pixel centers inside the triangle (either winding) that pass depth < stored.
+    void RasterizeDepth(OverdrawTarget& target, const float* a, const float* b, const float* c)
+    {
+        float area = (b[0] - a[0]) * (c[1] - a[1]) - (b[1] - a[1]) * (c[0] - a[0]);
+        if (area == 0.f)
+            return;
+
+        float sign = area > 0.f ? 1.f : -1.f;
+        float inv  = 1.f / area;
+
+        int x0 = std::max(0, static_cast<int>(std::floor(std::min({ a[0], b[0], c[0] }))));
+        int y0 = std::max(0, static_cast<int>(std::floor(std::min({ a[1], b[1], c[1] }))));
+        int x1 = std::min(int(kOverdrawViewport) - 1, static_cast<int>(std::ceil(std::max({ a[0], b[0], c[0] }))));
+        int y1 = std::min(int(kOverdrawViewport) - 1, static_cast<int>(std::ceil(std::max({ a[1], b[1], c[1] }))));
+
+        for (int y = y0; y <= y1; ++y)
+        {
+            float py = y + 0.5f;
+            for (int x = x0; x <= x1; ++x)
+            {
+                float px = x + 0.5f;
+                float wa = (c[0] - b[0]) * (py - b[1]) - (c[1] - b[1]) * (px - b[0]);
+                float wb = (a[0] - c[0]) * (py - c[1]) - (a[1] - c[1]) * (px - c[0]);
+                float wc = (b[0] - a[0]) * (py - a[1]) - (b[1] - a[1]) * (px - a[0]);
+                if (wa * sign < 0.f || wb * sign < 0.f || wc * sign < 0.f)
+                    continue;
+
+                float  z     = (wa * a[2] + wb * b[2] + wc * c[2]) * inv;
+                float& depth = target.depth[y * kOverdrawViewport + x];
+                if (z < depth)
+                {
+                    depth = z;
+                    ++target.shaded;
+                }
+            }
+        }
+    }
+}   // namespace
+
+VertexCacheStats AnalyzeVertexCache(const uint32_t* indices, size_t indexCount, size_t vertexCount, uint32_t cacheSize)
+{
+    VertexCacheStats stats;
+
+    std::vector<uint32_t> timestamps(vertexCount, 0);
+    std::vector<uint8_t>  referenced(vertexCount, 0);
+    uint32_t              timestamp       = cacheSize + 1;
+    size_t                referencedCount = 0;
+    for (size_t i = 0; i + 3 <= indexCount; i += 3)
+    {
+        stats.transformed += UpdateFifo(indices + i, cacheSize, timestamps, timestamp);
+        for (int k = 0; k < 3; ++k)
+        {
+            referencedCount += referenced[indices[i + k]] == 0;
+            referenced[indices[i + k]] = 1;
+        }
+    }
+
+    size_t triangleCount = indexCount / 3;
+    stats.acmr           = triangleCount ? double(stats.transformed) / triangleCount : 0.0;
+    stats.atvr           = referencedCount ? double(stats.transformed) / referencedCount : 0.0;
+    return stats;
+}
+
+OverdrawStats AnalyzeOverdraw(const uint32_t* indices, size_t indexCount, const float* positions, size_t vertexCount, size_t positionStride)
+{
+    OverdrawStats stats;
+    if (indexCount < 3 || vertexCount == 0)
+        return stats;
+
+    float lo[3] = { std::numeric_limits<float>::max(), std::numeric_limits<float>::max(), std::numeric_limits<float>::max() };
+    float hi[3] = { -std::numeric_limits<float>::max(), -std::numeric_limits<float>::max(), -std::numeric_limits<float>::max() };
+    for (size_t i = 0; i < indexCount; ++i)
+    {
+        const float* p = positions + indices[i] * positionStride;
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            lo[axis] = std::min(lo[axis], p[axis]);
+            hi[axis] = std::max(hi[axis], p[axis]);
+        }
+    }
+
+    float extent = std::max({ hi[0] - lo[0], hi[1] - lo[1], hi[2] - lo[2] });
+    float scale  = extent > 0.f ? (kOverdrawViewport - 1) / extent : 0.f;
+
+    OverdrawTarget target;
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        int u = (axis + 1) % 3;
+        int v = (axis + 2) % 3;
+        for (float direction : { 1.f, -1.f })
+        {
+            target.depth.assign(kOverdrawViewport * kOverdrawViewport, std::numeric_limits<float>::max());
+
+            for (size_t i = 0; i + 3 <= indexCount; i += 3)
+            {
+                float corners[3][3];
+                for (int k = 0; k < 3; ++k)
+                {
+                    const float* p = positions + indices[i + k] * positionStride;
+                    corners[k][0]  = (p[u] - lo[u]) * scale;
+                    corners[k][1]  = (p[v] - lo[v]) * scale;
+                    corners[k][2]  = (p[axis] - lo[axis]) * direction;
+                }
+                RasterizeDepth(target, corners[0], corners[1], corners[2]);
+            }
+
+            for (float depth : target.depth)
+                stats.covered += depth != std::numeric_limits<float>::max();
+        }
+    }
+
+    stats.shaded   = target.shaded;
+    stats.overdraw = stats.covered ? double(stats.shaded) / stats.covered : 0.0;
+    return stats;
+}
+
+void OptimizeVertexCache(uint32_t* destination, const uint32_t* indices, size_t indexCount, size_t vertexCount)
+{
+    size_t triangleCount = indexCount / 3;
+    if (triangleCount == 0)
+        return;
+
+    TriangleAdjacency adjacency;
+    BuildAdjacency(adjacency, indices, triangleCount * 3, vertexCount);
+
+    // counts become the live (not yet emitted) triangle counts, and each
+    // vertex's list keeps its live triangles at the front
+    std::vector<uint32_t>& live = adjacency.counts;
+    std::vector<int>       cachePosition(vertexCount, -1);
+    std::vector<float>     vertexScore(vertexCount);
+    std::vector<uint8_t>   emitted(triangleCount, 0);
+    for (size_t v = 0; v < vertexCount; ++v)
+        vertexScore[v] = VertexScore(-1, live[v]);
+
+    auto triangleScore = [&](uint32_t t) {
+        return vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]] + vertexScore[indices[t * 3 + 2]];
+    };
+
+    uint32_t best      = 0;
+    float    bestScore = triangleScore(0);
+    for (uint32_t t = 1; t < triangleCount; ++t)
+    {
+        float score = triangleScore(t);
+        if (score > bestScore)
+        {
+            best      = t;
+            bestScore = score;
+        }
+    }
+
+    uint32_t cache[kForsythCacheSize + 3];
+    uint32_t nextCache[kForsythCacheSize + 3];
+    uint32_t cacheCount = 0;
+    size_t   deadEnd    = 0;   // every triangle before it has been emitted
+
+    for (size_t out = 0; out < triangleCount; ++out)
+    {
+        // nothing in the cache has triangles left: take the next unemitted one in input order
+        if (best == kInvalid)
+        {
+            while (emitted[deadEnd])
+                ++deadEnd;
+            best = static_cast<uint32_t>(deadEnd);
+        }
+
+        const uint32_t* triangle = indices + best * 3;
+        destination[out * 3]     = triangle[0];
+        destination[out * 3 + 1] = triangle[1];
+        destination[out * 3 + 2] = triangle[2];
+        emitted[best]            = 1;
+
+        uint32_t nextCount = 0;
+        for (int k = 0; k < 3; ++k)
+        {
+            uint32_t v = triangle[k];
+            if (std::find(nextCache, nextCache + nextCount, v) == nextCache + nextCount)
+                nextCache[nextCount++] = v;
+
+            // swap the emitted triangle out of the live range
+            uint32_t* list = adjacency.triangles.data() + adjacency.offsets[v];
+            uint32_t* slot = std::find(list, list + live[v], best);
+            std::swap(*slot, list[live[v] - 1]);
+            --live[v];
+        }
+        for (uint32_t i = 0; i < cacheCount; ++i)
+        {
+            uint32_t v = cache[i];
+            if (v != triangle[0] && v != triangle[1] && v != triangle[2])
+                nextCache[nextCount++] = v;
+        }
+
+        for (uint32_t i = 0; i < nextCount; ++i)
+        {
+            uint32_t v       = nextCache[i];
+            cachePosition[v] = i < kForsythCacheSize ? static_cast<int>(i) : -1;
+            vertexScore[v]   = VertexScore(cachePosition[v], live[v]);
+        }
+
+        cacheCount = std::min(nextCount, kForsythCacheSize);
+        std::memcpy(cache, nextCache, cacheCount * sizeof(uint32_t));
+
+        // only triangles touching the cache changed score
+        best      = kInvalid;
+        bestScore = 0.f;
+        for (uint32_t i = 0; i < cacheCount; ++i)
+        {
+            uint32_t        v    = cache[i];
+            const uint32_t* list = adjacency.triangles.data() + adjacency.offsets[v];
+            for (uint32_t j = 0; j < live[v]; ++j)
+            {
+                float score = triangleScore(list[j]);
+                if (best == kInvalid || score > bestScore)
+                {
+                    best      = list[j];
+                    bestScore = score;
+                }
+            }
+        }
+    }
+}
+
+void OptimizeOverdraw(uint32_t* destination, const uint32_t* indices, size_t indexCount, const float* positions, size_t vertexCount, size_t positionStride, float threshold)
+{
+    size_t triangleCount = indexCount / 3;
+    if (triangleCount == 0)
+        return;
+
+    std::vector<uint32_t> timestamps(vertexCount, 0);
+    uint32_t              timestamp = kFifoCacheSize + 1;
+
+    // hard boundaries: a triangle missing on all three vertices starts a new
+    // patch, usually disjoint from what came before
+    std::vector<uint32_t> hard;
+    for (size_t t = 0; t < triangleCount; ++t)
+    {
+        if (UpdateFifo(indices + t * 3, kFifoCacheSize, timestamps, timestamp) == 3 || t == 0)
+            hard.push_back(static_cast<uint32_t>(t));
+    }
+    hard.push_back(static_cast<uint32_t>(triangleCount));
+
+    // soft boundaries: inside a patch, cut as soon as the running ACMR from
+    // the last cut (with a cold cache) gets within threshold of the patch's,
+    // so reordering the pieces costs at most that much cache efficiency
+    std::vector<uint32_t> clusters;
+    for (size_t h = 0; h + 1 < hard.size(); ++h)
+    {
+        uint32_t start = hard[h];
+        uint32_t end   = hard[h + 1];
+
+        timestamp += kFifoCacheSize + 1;
+        uint32_t patchMisses = 0;
+        for (uint32_t t = start; t < end; ++t)
+            patchMisses += UpdateFifo(indices + t * 3, kFifoCacheSize, timestamps, timestamp);
+        float target = threshold * float(patchMisses) / float(end - start);
+
+        clusters.push_back(start);
+        timestamp += kFifoCacheSize + 1;
+        uint32_t misses = 0;
+        for (uint32_t t = start; t < end; ++t)
+        {
+            misses += UpdateFifo(indices + t * 3, kFifoCacheSize, timestamps, timestamp);
+            if (float(misses) <= target * float(t + 1 - clusters.back()))
+            {
+                clusters.push_back(t + 1);
+                timestamp += kFifoCacheSize + 1;
+                misses = 0;
+            }
+        }
+
+        // the tail after the last cut is short and has a poor ACMR on its own: merge it back
+        if (clusters.back() != start)
+            clusters.pop_back();
+    }
+    clusters.push_back(static_cast<uint32_t>(triangleCount));
+
+    // area-weighted centroid and normal per cluster
+    size_t             clusterCount = clusters.size() - 1;
+    std::vector<float> centroids(clusterCount * 3, 0.f);
+    std::vector<float> normals(clusterCount * 3, 0.f);
+    std::vector<float> areas(clusterCount, 0.f);
+    float              meshCentroid[3] = { 0.f, 0.f, 0.f };
+    float              meshArea        = 0.f;
+    for (size_t c = 0; c < clusterCount; ++c)
+    {
+        for (uint32_t t = clusters[c]; t < clusters[c + 1]; ++t)
+        {
+            const float* a = positions + indices[t * 3] * positionStride;
+            const float* b = positions + indices[t * 3 + 1] * positionStride;
+            const float* d = positions + indices[t * 3 + 2] * positionStride;
+
+            float n[3];
+            Cross(a, b, d, n);
+            float area = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+            for (int axis = 0; axis < 3; ++axis)
+            {
+                centroids[c * 3 + axis] += (a[axis] + b[axis] + d[axis]) * (area / 3.f);
+                normals[c * 3 + axis] += n[axis];
+            }
+            areas[c] += area;
+        }
+
+        for (int axis = 0; axis < 3; ++axis)
+            meshCentroid[axis] += centroids[c * 3 + axis];
+        meshArea += areas[c];
+    }
+    for (int axis = 0; axis < 3; ++axis)
+        meshCentroid[axis] = meshArea > 0.f ? meshCentroid[axis] / meshArea : 0.f;
+
+    // clusters facing away from the center occlude the ones behind them: draw those first
+    std::vector<float> keys(clusterCount, 0.f);
+    for (size_t c = 0; c < clusterCount; ++c)
+    {
+        float* n      = &normals[c * 3];
+        float  length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+        if (areas[c] == 0.f || length == 0.f)
+            continue;
+
+        for (int axis = 0; axis < 3; ++axis)
+            keys[c] += (centroids[c * 3 + axis] / areas[c] - meshCentroid[axis]) * (n[axis] / length);
+    }
+
+    std::vector<uint32_t> order(clusterCount);
+    for (size_t c = 0; c < clusterCount; ++c)
+        order[c] = static_cast<uint32_t>(c);
+    std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return keys[a] > keys[b]; });
+
+    size_t out = 0;
+    for (uint32_t c : order)
+    {
+        size_t count = (clusters[c + 1] - clusters[c]) * 3;
+        std::memcpy(destination + out, indices + clusters[c] * 3, count * sizeof(uint32_t));
+        out += count;
+    }
+}
+
+size_t OptimizeVertexFetch(void* destination, uint32_t* indices, size_t indexCount, const void* vertices, size_t vertexCount, size_t vertexSize)
+{
+    std::vector<uint32_t> remap(vertexCount, kInvalid);
+
+    const uint8_t* source = static_cast<const uint8_t*>(vertices);
+    uint8_t*       out    = static_cast<uint8_t*>(destination);
+    uint32_t       next   = 0;
+    for (size_t i = 0; i < indexCount; ++i)
+    {
+        uint32_t& slot = remap[indices[i]];
+        if (slot == kInvalid)
+        {
+            std::memcpy(out + size_t(next) * vertexSize, source + size_t(indices[i]) * vertexSize, vertexSize);
+            slot = next++;
+        }
+        indices[i] = slot;
+    }
+    return next;
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Offline index/vertex reordering for DrawIndexed meshes, run by the mesh
+// converter before a mesh is written. The usual order is
+//
+//   OptimizeVertexCache   triangle order for post-transform cache hits
+//   OptimizeOverdraw      clusters of that order sorted outside-in
+//   OptimizeVertexFetch   vertices renumbered in first-use order
+//
+// Every pass is deterministic (ties keep input order) and linear or n log n in
+// the triangle count. Index buffers hold triangle lists; destination and
+// source must not overlap unless noted.
+
+struct VertexCacheStats
+{
+    uint64_t transformed = 0;     // cache misses = vertex shader invocations
+    double   acmr        = 0.0;   // per triangle, 0.5 at best on a regular grid, 3 at worst
+    double   atvr        = 0.0;   // per referenced vertex, 1 at best
+};
+
+// FIFO post-transform cache of `cacheSize` entries, the model most GPUs are
+// closest to.
+VertexCacheStats AnalyzeVertexCache(const uint32_t* indices, size_t indexCount, size_t vertexCount, uint32_t cacheSize);
+
+struct OverdrawStats
+{
+    uint64_t covered  = 0;     // pixels touched at least once
+    uint64_t shaded   = 0;     // pixels that passed the depth test
+    double   overdraw = 0.0;   // shaded / covered, 1 at best
+};
+
+// Rasterizes the mesh with a less-than depth test from the six axis
+// directions at a fixed resolution. positions holds x, y, z at
+// positionStride floats apart. Order-dependent only where triangles overlap
+// in depth; a flat 2D mesh always reports 1.
+OverdrawStats AnalyzeOverdraw(const uint32_t* indices, size_t indexCount, const float* positions, size_t vertexCount, size_t positionStride);
+
+// Forsyth's linear-speed greedy reordering: each step emits the live triangle
+// with the best score among those touching the simulated LRU cache, scored by
+// cache position and by how few triangles each vertex has left.
+void OptimizeVertexCache(uint32_t* destination, const uint32_t* indices, size_t indexCount, size_t vertexCount);
+
+// Sander et al.'s "fast triangle reordering": splits the cache-optimized order
+// into clusters where its ACMR allows (threshold 1.05 keeps ACMR within 5%),
+// then draws clusters facing away from the mesh center first.
+void OptimizeOverdraw(uint32_t* destination, const uint32_t* indices, size_t indexCount, const float* positions, size_t vertexCount, size_t positionStride, float threshold);
+
+// Copies vertices into `destination` in the order the indices first use them
+// and rewrites `indices` in place. Unreferenced vertices are dropped; returns
+// the new vertex count.
+size_t OptimizeVertexFetch(void* destination, uint32_t* indices, size_t indexCount, const void* vertices, size_t vertexCount, size_t vertexSize);
@@ -0,0 +1,128 @@
+#include "NullRenderContext.h"
+
+#include <cstring>
+
+void AccumulateSubmissionStats(SubmissionStats& total, const SubmissionStats& frame)
+{
+    total.binds += frame.binds;
+    total.maps += frame.maps;
+    total.updates += frame.updates;
+    total.bytesUploaded += frame.bytesUploaded;
+    total.clears += frame.clears;
+    total.draws += frame.draws;
+    total.instances += frame.instances;
+    total.indices += frame.indices;
+}
+
+RenderHandle NullRenderContext::CreateBuffer(size_t size)
+{
+    buffers.push_back(std::make_unique<NullBuffer>());
+    buffers.back()->data.resize(size);
+    return buffers.back().get();
+}
+
+RenderHandle NullRenderContext::CreateObject()
+{
+    objects.push_back(std::make_unique<uint8_t>());
+    return objects.back().get();
+}
+
+void NullRenderContext::EndFrame()
+{
+    AccumulateSubmissionStats(total, frame);
+    frame = {};
+    ++frameCount;
+}
+
+void NullRenderContext::SetInputLayout(RenderHandle)
+{
+    ++frame.binds;
+}
+
+void NullRenderContext::SetPrimitiveTopology(PrimitiveTopology)
+{
+    ++frame.binds;
+}
+
+void NullRenderContext::SetVertexBuffers(uint32_t, uint32_t, const RenderHandle*, const uint32_t*, const uint32_t*)
+{
+    ++frame.binds;
+}
+
+void NullRenderContext::SetIndexBuffer(RenderHandle, IndexFormat, uint32_t)
+{
+    ++frame.binds;
+}
+
+void NullRenderContext::SetVertexShader(RenderHandle)
+{
+    ++frame.binds;
+}
+
+void NullRenderContext::SetVSConstantBuffer(uint32_t, RenderHandle)
+{
+    ++frame.binds;
+}
+
+void NullRenderContext::SetVSConstantBufferRange(uint32_t, const ConstantRange&)
+{
+    ++frame.binds;
+}
+
+void NullRenderContext::SetViewport(const RenderViewport&)
+{
+    ++frame.binds;
+}
+
+void NullRenderContext::SetPixelShader(RenderHandle)
+{
+    ++frame.binds;
+}
+
+void NullRenderContext::SetRenderTarget(RenderHandle)
+{
+    ++frame.binds;
+}
+
+void NullRenderContext::ClearRenderTarget(RenderHandle, const float*)
+{
+    ++frame.clears;
+}
+
+void* NullRenderContext::Map(RenderHandle buffer, MapMode)
+{
+    if (!buffer)
+        return nullptr;
+
+    ++frame.maps;
+    return static_cast<NullBuffer*>(buffer)->data.data();
+}
+
+void NullRenderContext::Unmap(RenderHandle, size_t bytesWritten)
+{
+    frame.bytesUploaded += bytesWritten;
+}
+
+void NullRenderContext::UpdateBuffer(RenderHandle buffer, size_t offset, const void* data, size_t size)
+{
+    if (!buffer)
+        return;
+
+    ++frame.updates;
+    frame.bytesUploaded += size;
+    std::memcpy(static_cast<NullBuffer*>(buffer)->data.data() + offset, data, size);
+}
+
+void NullRenderContext::DrawIndexed(uint32_t indexCount, uint32_t, int32_t)
+{
+    ++frame.draws;
+    ++frame.instances;
+    frame.indices += indexCount;
+}
+
+void NullRenderContext::DrawIndexedInstanced(uint32_t indexCount, uint32_t instanceCount, uint32_t, int32_t, uint32_t)
+{
+    ++frame.draws;
+    frame.instances += instanceCount;
+    frame.indices += static_cast<uint64_t>(indexCount) * instanceCount;
+}
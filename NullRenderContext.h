@@ -0,0 +1,65 @@
+#pragma once
+
+#include "RenderContext.h"
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Per-frame submission counters.
+struct SubmissionStats
+{
+    uint64_t binds         = 0;   // Set* calls
+    uint64_t maps          = 0;
+    uint64_t updates       = 0;   // UpdateBuffer calls
+    uint64_t bytesUploaded = 0;
+    uint64_t clears        = 0;
+    uint64_t draws         = 0;
+    uint64_t instances     = 0;
+    uint64_t indices       = 0;
+};
+
+void AccumulateSubmissionStats(SubmissionStats& total, const SubmissionStats& frame);
+
+// Recording device with no GPU behind it. Buffers get CPU backing memory so
+// Map/Unmap writes land somewhere; every other object is an opaque handle.
+struct NullRenderContext : IRenderContext
+{
+    SubmissionStats frame;
+    SubmissionStats total;
+    uint64_t        frameCount = 0;
+
+    RenderHandle CreateBuffer(size_t size);
+    RenderHandle CreateObject();
+
+    // Folds `frame` into `total` and resets it.
+    void EndFrame();
+
+    void SetInputLayout(RenderHandle layout) override;
+    void SetPrimitiveTopology(PrimitiveTopology topology) override;
+    void SetVertexBuffers(uint32_t startSlot, uint32_t count, const RenderHandle* buffers, const uint32_t* strides, const uint32_t* offsets) override;
+    void SetIndexBuffer(RenderHandle buffer, IndexFormat format, uint32_t offset) override;
+    void SetVertexShader(RenderHandle shader) override;
+    void SetVSConstantBuffer(uint32_t slot, RenderHandle buffer) override;
+    void SetVSConstantBufferRange(uint32_t slot, const ConstantRange& range) override;
+    void SetViewport(const RenderViewport& viewport) override;
+    void SetPixelShader(RenderHandle shader) override;
+    void SetRenderTarget(RenderHandle view) override;
+    void ClearRenderTarget(RenderHandle view, const float color[4]) override;
+
+    void* Map(RenderHandle buffer, MapMode mode) override;
+    void  Unmap(RenderHandle buffer, size_t bytesWritten) override;
+    void  UpdateBuffer(RenderHandle buffer, size_t offset, const void* data, size_t size) override;
+
+    void DrawIndexed(uint32_t indexCount, uint32_t startIndex, int32_t baseVertex) override;
+    void DrawIndexedInstanced(uint32_t indexCount, uint32_t instanceCount, uint32_t startIndex, int32_t baseVertex, uint32_t startInstance) override;
+
+private:
+    struct NullBuffer
+    {
+        std::vector<uint8_t> data;
+    };
+
+    std::vector<std::unique_ptr<NullBuffer>> buffers;
+    std::vector<std::unique_ptr<uint8_t>>    objects;
+};
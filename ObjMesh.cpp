@@ -0,0 +1,116 @@
+#include "ObjMesh.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+namespace
+{
+    bool ReadWholeFile(const char* path, std::string& text)
+    {
+        FILE* file = std::fopen(path, "rb");
+        if (!file)
+            return false;
+
+        char   buffer[1 << 16];
+        size_t read;
+        while ((read = std::fread(buffer, 1, sizeof(buffer), file)) > 0)
+            text.append(buffer, read);
+
+        bool ok = std::ferror(file) == 0;
+        std::fclose(file);
+        return ok;
+    }
+
+    const char* SkipSpaces(const char* p)
+    {
+        while (*p == ' ' || *p == '\t')
+            ++p;
+        return p;
+    }
+
+    const char* NextLine(const char* p)
+    {
+        while (*p && *p != '\n')
+            ++p;
+        return *p ? p + 1 : p;
+    }
+}   // namespace
+
+bool LoadObjMesh(const char* path, ObjMesh& mesh)
+{
+    mesh.vertices.clear();
+    mesh.z.clear();
+    mesh.indices.clear();
+
+    std::string text;
+    if (!ReadWholeFile(path, text))
+        return false;
+
+    std::vector<uint32_t> face;
+    for (const char* line = text.c_str(); *line; line = NextLine(line))
+    {
+        const char* p = SkipSpaces(line);
+
+        if (p[0] == 'v' && (p[1] == ' ' || p[1] == '\t'))
+        {
+            float values[6] = { 0.f, 0.f, 0.f, 1.f, 1.f, 1.f };
+            int   count     = 0;
+            p += 1;
+            for (; count < 6; ++count)
+            {
+                // strtof would skip the line break and read on into the next line
+                p = SkipSpaces(p);
+                if (*p == '\r' || *p == '\n')
+                    break;
+
+                char* end;
+                float value = std::strtof(p, &end);
+                if (end == p)
+                    break;
+                values[count] = value;
+                p             = end;
+            }
+            if (count < 3)
+                return false;
+            if (count < 6)
+                values[3] = values[4] = values[5] = 1.f;
+
+            mesh.vertices.insert(mesh.vertices.end(), { values[0], values[1], values[3], values[4], values[5] });
+            mesh.z.push_back(values[2]);
+        }
+        else if (p[0] == 'f' && (p[1] == ' ' || p[1] == '\t'))
+        {
+            size_t vertexCount = mesh.z.size();
+            face.clear();
+            p += 1;
+            for (;;)
+            {
+                p = SkipSpaces(p);
+                if (*p == '\r' || *p == '\n')
+                    break;
+
+                char* end;
+                long  index = std::strtol(p, &end, 10);
+                if (end == p)
+                    break;
+                p = end;
+
+                // skip /vt/vn
+                while (*p && *p != ' ' && *p != '\t' && *p != '\r' && *p != '\n')
+                    ++p;
+
+                long resolved = index < 0 ? static_cast<long>(vertexCount) + index : index - 1;
+                if (index == 0 || resolved < 0 || static_cast<size_t>(resolved) >= vertexCount)
+                    return false;
+                face.push_back(static_cast<uint32_t>(resolved));
+            }
+            if (face.size() < 3)
+                return false;
+
+            for (size_t i = 1; i + 1 < face.size(); ++i)
+                mesh.indices.insert(mesh.indices.end(), { face[0], face[i], face[i + 1] });
+        }
+    }
+    return true;
+}
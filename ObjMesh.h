@@ -0,0 +1,17 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// Minimal Wavefront OBJ reader for the mesh tools: `v x y z [r g b]` and `f`
+// lines, everything else is skipped. Vertices without a color come out white.
+// Faces are fan-triangulated; each face corner may be `v`, `v/vt`, `v//vn` or
+// `v/vt/vn`, negative indices count back from the last vertex.
+struct ObjMesh
+{
+    std::vector<float>    vertices;   // x, y, r, g, b per vertex, the source layout of PackVertices
+    std::vector<float>    z;          // per vertex; the scene is 2D, only the optimizer looks at it
+    std::vector<uint32_t> indices;
+};
+
+bool LoadObjMesh(const char* path, ObjMesh& mesh);
@@ -0,0 +1,319 @@
+#include "PrimitiveBatcher.h"
+
+namespace
+{
+    // Room for one shape in the open batch, opening a new one if the topology
+    // changed, a ring is full or nothing is open. `base` is the batch-relative
+    // index of v[0]. Mapped memory is write-combined: callers only write it.
+    bool ReserveShape(PrimitiveBatcher& b, PrimitiveTopology topology, uint32_t vertexCount, uint32_t indexCount, BatchVertex*& v, uint32_t*& idx, uint32_t& base)
+    {
+        if (vertexCount > b.vertexRing.capacity || indexCount > b.indexRing.capacity)
+        {
+            ++b.frame.droppedShapes;
+            return false;
+        }
+
+        if (b.vertices && b.topology != topology)
+        {
+            ++b.frame.stateFlushes;
+            FlushBatcher(b);
+        }
+        else if (b.vertices && (!RingFits(b.vertexRing, vertexCount) || !RingFits(b.indexRing, indexCount)))
+        {
+            ++b.frame.ringFlushes;
+            FlushBatcher(b);
+        }
+
+        uint32_t vertexOffset = 0;
+        uint32_t indexOffset  = 0;
+        MapMode  vertexMode   = RingAllocate(b.vertexRing, vertexCount, vertexOffset);
+        MapMode  indexMode    = RingAllocate(b.indexRing, indexCount, indexOffset);
+
+        if (!b.vertices)
+        {
+            void* vertexMemory = b.context->Map(b.vertexBuffer, vertexMode);
+            void* indexMemory  = vertexMemory ? b.context->Map(b.indexBuffer, indexMode) : nullptr;
+            if (!indexMemory)
+            {
+                if (vertexMemory)
+                    b.context->Unmap(b.vertexBuffer, 0);
+                ++b.frame.droppedShapes;
+                return false;
+            }
+
+            b.frame.discards += (vertexMode == MapMode::WriteDiscard) + (indexMode == MapMode::WriteDiscard);
+
+            b.vertices    = static_cast<BatchVertex*>(vertexMemory);
+            b.indices     = static_cast<uint32_t*>(indexMemory);
+            b.firstVertex = vertexOffset;
+            b.firstIndex  = indexOffset;
+            b.topology    = topology;
+        }
+
+        v    = b.vertices + vertexOffset;
+        idx  = b.indices + indexOffset;
+        base = vertexOffset - b.firstVertex;
+        return true;
+    }
+
+    // z of (cur - prev) x (next - cur); > 0 turns left
+    float Turn(const float* xy, uint32_t prev, uint32_t cur, uint32_t next)
+    {
+        float ax = xy[cur * 2] - xy[prev * 2];
+        float ay = xy[cur * 2 + 1] - xy[prev * 2 + 1];
+        float bx = xy[next * 2] - xy[cur * 2];
+        float by = xy[next * 2 + 1] - xy[cur * 2 + 1];
+        return ax * by - ay * bx;
+    }
+
+    // Inside or on the edges of triangle (a, b, c) wound in direction `winding`.
+    bool InTriangle(const float* xy, uint32_t p, uint32_t a, uint32_t b, uint32_t c, float winding)
+    {
+        return Turn(xy, a, b, p) * winding >= 0.f &&
+               Turn(xy, b, c, p) * winding >= 0.f &&
+               Turn(xy, c, a, p) * winding >= 0.f;
+    }
+}   // namespace
+
+bool RingFits(const RingAllocator& ring, uint32_t count)
+{
+    return count <= ring.capacity - ring.head;
+}
+
+MapMode RingAllocate(RingAllocator& ring, uint32_t count, uint32_t& offset)
+{
+    if (!RingFits(ring, count))
+    {
+        ring.head = 0;
+        ++ring.wraps;
+    }
+
+    offset = ring.head;
+    ring.head += count;
+
+    return offset == 0 ? MapMode::WriteDiscard : MapMode::WriteNoOverwrite;
+}
+
+void AccumulateBatcherStats(BatcherStats& total, const BatcherStats& frame)
+{
+    total.draws += frame.draws;
+    total.ringFlushes += frame.ringFlushes;
+    total.stateFlushes += frame.stateFlushes;
+    total.discards += frame.discards;
+    total.vertices += frame.vertices;
+    total.indices += frame.indices;
+    total.droppedShapes += frame.droppedShapes;
+}
+
+void InitPrimitiveBatcher(PrimitiveBatcher& batcher, IRenderContext* context, RenderHandle vertexBuffer, uint32_t vertexCapacity, RenderHandle indexBuffer, uint32_t indexCapacity)
+{
+    batcher.context             = context;
+    batcher.vertexBuffer        = vertexBuffer;
+    batcher.indexBuffer         = indexBuffer;
+    batcher.vertexRing          = {};
+    batcher.vertexRing.capacity = vertexCapacity;
+    batcher.indexRing           = {};
+    batcher.indexRing.capacity  = indexCapacity;
+    batcher.vertices            = nullptr;
+    batcher.indices             = nullptr;
+}
+
+void SetBatchConstantBuffer(PrimitiveBatcher& batcher, RenderHandle constantBuffer)
+{
+    ConstantRange whole;
+    whole.buffer = constantBuffer;
+    SetBatchConstantRange(batcher, whole);
+}
+
+void SetBatchConstantRange(PrimitiveBatcher& batcher, const ConstantRange& constants)
+{
+    if (batcher.constants.buffer == constants.buffer &&
+        batcher.constants.offset == constants.offset &&
+        batcher.constants.size == constants.size)
+        return;
+
+    if (batcher.vertices)
+    {
+        ++batcher.frame.stateFlushes;
+        FlushBatcher(batcher);
+    }
+    batcher.constants = constants;
+}
+
+bool BatchTriangle(PrimitiveBatcher& batcher, const BatchVertex& a, const BatchVertex& b, const BatchVertex& c)
+{
+    BatchVertex* v;
+    uint32_t*    idx;
+    uint32_t     base;
+    if (!ReserveShape(batcher, PrimitiveTopology::TriangleList, 3, 3, v, idx, base))
+        return false;
+
+    v[0]   = a;
+    v[1]   = b;
+    v[2]   = c;
+    idx[0] = base;
+    idx[1] = base + 1;
+    idx[2] = base + 2;
+    return true;
+}
+
+bool BatchQuad(PrimitiveBatcher& batcher, const BatchVertex corners[4])
+{
+    BatchVertex* v;
+    uint32_t*    idx;
+    uint32_t     base;
+    if (!ReserveShape(batcher, PrimitiveTopology::TriangleList, 4, 6, v, idx, base))
+        return false;
+
+    v[0]   = corners[0];
+    v[1]   = corners[1];
+    v[2]   = corners[2];
+    v[3]   = corners[3];
+    idx[0] = base;
+    idx[1] = base + 1;
+    idx[2] = base + 2;
+    idx[3] = base;
+    idx[4] = base + 2;
+    idx[5] = base + 3;
+    return true;
+}
+
+bool BatchRect(PrimitiveBatcher& batcher, float x, float y, float width, float height, const float color[3])
+{
+    BatchVertex corners[4] = {
+        { x, y, color[0], color[1], color[2] },
+        { x + width, y, color[0], color[1], color[2] },
+        { x + width, y + height, color[0], color[1], color[2] },
+        { x, y + height, color[0], color[1], color[2] },
+    };
+    return BatchQuad(batcher, corners);
+}
+
+bool BatchLine(PrimitiveBatcher& batcher, const BatchVertex& a, const BatchVertex& b)
+{
+    BatchVertex* v;
+    uint32_t*    idx;
+    uint32_t     base;
+    if (!ReserveShape(batcher, PrimitiveTopology::LineList, 2, 2, v, idx, base))
+        return false;
+
+    v[0]   = a;
+    v[1]   = b;
+    idx[0] = base;
+    idx[1] = base + 1;
+    return true;
+}
+
+bool BatchPolygon(PrimitiveBatcher& batcher, const float* xy, uint32_t pointCount, const float color[3])
+{
+    float area = 0.f;
+    for (uint32_t i = 0; i < pointCount; ++i)
+    {
+        uint32_t j = i + 1 == pointCount ? 0 : i + 1;
+        area += xy[i * 2] * xy[j * 2 + 1] - xy[j * 2] * xy[i * 2 + 1];
+    }
+
+    if (pointCount < 3 || area == 0.f)
+    {
+        ++batcher.frame.droppedShapes;
+        return false;
+    }
+
+    BatchVertex* v;
+    uint32_t*    idx;
+    uint32_t     base;
+    if (!ReserveShape(batcher, PrimitiveTopology::TriangleList, pointCount, (pointCount - 2) * 3, v, idx, base))
+        return false;
+
+    for (uint32_t i = 0; i < pointCount; ++i)
+        v[i] = { xy[i * 2], xy[i * 2 + 1], color[0], color[1], color[2] };
+
+    // Ear clipping on the caller's points; the mapped memory is never read back
+    float                  winding   = area > 0.f ? 1.f : -1.f;
+    std::vector<uint32_t>& remaining = batcher.polygonScratch;
+    remaining.resize(pointCount);
+    for (uint32_t i = 0; i < pointCount; ++i)
+        remaining[i] = i;
+
+    uint32_t count  = pointCount;
+    uint32_t cursor = 0;
+    uint32_t misses = 0;
+    while (count > 3)
+    {
+        uint32_t prev = remaining[cursor == 0 ? count - 1 : cursor - 1];
+        uint32_t cur  = remaining[cursor];
+        uint32_t next = remaining[cursor + 1 == count ? 0 : cursor + 1];
+
+        bool ear = Turn(xy, prev, cur, next) * winding > 0.f;
+        for (uint32_t k = 0; ear && k < count; ++k)
+        {
+            uint32_t p = remaining[k];
+            if (p != prev && p != cur && p != next)
+                ear = !InTriangle(xy, p, prev, cur, next, winding);
+        }
+
+        // a full lap without an ear means the outline self-intersects; clip anyway
+        if (ear || misses == count)
+        {
+            *idx++ = base + prev;
+            *idx++ = base + cur;
+            *idx++ = base + next;
+            remaining.erase(remaining.begin() + cursor);
+            --count;
+            misses = 0;
+            if (cursor == count)
+                cursor = 0;
+        }
+        else
+        {
+            cursor = cursor + 1 == count ? 0 : cursor + 1;
+            ++misses;
+        }
+    }
+
+    idx[0] = base + remaining[0];
+    idx[1] = base + remaining[1];
+    idx[2] = base + remaining[2];
+    return true;
+}
+
+void FlushBatcher(PrimitiveBatcher& batcher)
+{
+    if (!batcher.vertices)
+        return;
+
+    IRenderContext& c = *batcher.context;
+
+    uint32_t vertexCount = batcher.vertexRing.head - batcher.firstVertex;
+    uint32_t indexCount  = batcher.indexRing.head - batcher.firstIndex;
+
+    c.Unmap(batcher.vertexBuffer, vertexCount * sizeof(BatchVertex));
+    c.Unmap(batcher.indexBuffer, indexCount * sizeof(uint32_t));
+    batcher.vertices = nullptr;
+    batcher.indices  = nullptr;
+
+    uint32_t stride = sizeof(BatchVertex);
+    uint32_t offset = 0;
+
+    c.SetInputLayout(batcher.inputLayout);
+    c.SetPrimitiveTopology(batcher.topology);
+    c.SetVertexBuffers(0, 1, &batcher.vertexBuffer, &stride, &offset);
+    c.SetIndexBuffer(batcher.indexBuffer, IndexFormat::UInt32, 0);
+    c.SetVertexShader(batcher.vertexShader);
+    c.SetVSConstantBufferRange(0, batcher.constants);
+    c.SetPixelShader(batcher.pixelShader);
+
+    c.DrawIndexed(indexCount, batcher.firstIndex, static_cast<int32_t>(batcher.firstVertex));
+
+    ++batcher.frame.draws;
+    batcher.frame.vertices += vertexCount;
+    batcher.frame.indices += indexCount;
+}
+
+void EndBatcherFrame(PrimitiveBatcher& batcher)
+{
+    FlushBatcher(batcher);
+
+    AccumulateBatcherStats(batcher.total, batcher.frame);
+    batcher.frame = {};
+}
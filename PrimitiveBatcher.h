@@ -0,0 +1,109 @@
+#pragma once
+
+#include "RenderContext.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Same layout as the demo's Vertex (POSITION float2, COLOR float3), so the
+// batcher draws with the scene's non-instanced input layout and shaders.
+struct BatchVertex
+{
+    float x;
+    float y;
+    float r;
+    float g;
+    float b;
+};
+
+static_assert(sizeof(BatchVertex) == 20, "BatchVertex must match the Vertex input layout");
+
+// Linear suballocator over a dynamic buffer that starts again from the front
+// when it runs out. Counts are in elements.
+struct RingAllocator
+{
+    uint32_t capacity = 0;
+    uint32_t head     = 0;
+    uint64_t wraps    = 0;
+};
+
+// True if `count` elements fit at the head without wrapping.
+bool RingFits(const RingAllocator& ring, uint32_t count);
+
+// Reserves `count` contiguous elements, wrapping to the front when they don't
+// fit at the head, and returns the map mode the write needs: WriteDiscard at
+// the front (the GPU may still be reading the old contents), WriteNoOverwrite
+// anywhere else. count must not exceed capacity.
+MapMode RingAllocate(RingAllocator& ring, uint32_t count, uint32_t& offset);
+
+struct BatcherStats
+{
+    uint64_t draws         = 0;
+    uint64_t ringFlushes   = 0;   // batch ended because a ring filled up
+    uint64_t stateFlushes  = 0;   // batch ended because topology or constants changed
+    uint64_t discards      = 0;   // WriteDiscard maps, i.e. ring wraps and first use
+    uint64_t vertices      = 0;
+    uint64_t indices       = 0;
+    uint64_t droppedShapes = 0;   // larger than a ring, or Map failed
+};
+
+void AccumulateBatcherStats(BatcherStats& total, const BatcherStats& frame);
+
+// Immediate-mode 2D geometry. Shapes append into a vertex and an index ring
+// that stay mapped while a batch is open; a batch is one DrawIndexed, issued
+// when the topology or constant buffer changes, a ring fills up, or on Flush.
+// Indices are batch-relative and drawn with baseVertex, so a batch can start
+// anywhere in the vertex ring.
+//
+// While a batch is open its buffers are mapped: flush before issuing other
+// draws on the same context.
+struct PrimitiveBatcher
+{
+    IRenderContext* context = nullptr;
+
+    // Dynamic buffers of vertexRing.capacity BatchVertex and indexRing.capacity uint32_t.
+    RenderHandle  vertexBuffer = nullptr;
+    RenderHandle  indexBuffer  = nullptr;
+    RingAllocator vertexRing;
+    RingAllocator indexRing;
+
+    RenderHandle inputLayout  = nullptr;
+    RenderHandle vertexShader = nullptr;
+    RenderHandle pixelShader  = nullptr;
+
+    BatcherStats frame;
+    BatcherStats total;
+
+    // open batch
+    PrimitiveTopology topology    = PrimitiveTopology::TriangleList;
+    ConstantRange     constants;                // VS slot 0
+    BatchVertex*      vertices    = nullptr;   // mapped buffer start, null when no batch is open
+    uint32_t*         indices     = nullptr;
+    uint32_t          firstVertex = 0;
+    uint32_t          firstIndex  = 0;
+
+    std::vector<uint32_t> polygonScratch;
+};
+
+void InitPrimitiveBatcher(PrimitiveBatcher& batcher, IRenderContext* context, RenderHandle vertexBuffer, uint32_t vertexCapacity, RenderHandle indexBuffer, uint32_t indexCapacity);
+
+// Constant buffer for the following shapes (world matrix at VS slot 0).
+void SetBatchConstantBuffer(PrimitiveBatcher& batcher, RenderHandle constantBuffer);
+void SetBatchConstantRange(PrimitiveBatcher& batcher, const ConstantRange& constants);
+
+// Shapes return false when they were dropped.
+bool BatchTriangle(PrimitiveBatcher& batcher, const BatchVertex& a, const BatchVertex& b, const BatchVertex& c);
+bool BatchQuad(PrimitiveBatcher& batcher, const BatchVertex corners[4]);   // corners in order around the quad
+bool BatchRect(PrimitiveBatcher& batcher, float x, float y, float width, float height, const float color[3]);
+bool BatchLine(PrimitiveBatcher& batcher, const BatchVertex& a, const BatchVertex& b);   // one pixel wide, LineList
+
+// Filled simple polygon, either winding, convex or not; ear-clipped.
+// xy holds pointCount (x, y) pairs.
+bool BatchPolygon(PrimitiveBatcher& batcher, const float* xy, uint32_t pointCount, const float color[3]);
+
+// Draws the open batch, if any.
+void FlushBatcher(PrimitiveBatcher& batcher);
+
+// Flushes, then folds `frame` into `total` and resets it.
+void EndBatcherFrame(PrimitiveBatcher& batcher);
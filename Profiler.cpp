@@ -0,0 +1,367 @@
+#include "Profiler.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+
+#if defined(_M_X64) || defined(_M_IX86)
+#    include <intrin.h>
+#    define PROFILER_HAS_TSC 1
+#elif defined(__x86_64__) || defined(__i386__)
+#    include <x86intrin.h>
+#    define PROFILER_HAS_TSC 1
+#else
+#    define PROFILER_HAS_TSC 0
+#endif
+
+namespace
+{
+    constexpr uint64_t kRingCapacity = 1 << 16;   // events per thread, power of two
+    constexpr uint32_t kMaxDepth     = 64;
+
+    // Single producer (the owning thread), single consumer (whoever holds the
+    // registry lock in ProfilerCollect). Handed to a new thread once its
+    // owner has exited and the last events were collected.
+    struct ProfileThreadBuffer
+    {
+        uint32_t                        threadId = 0;
+        bool                            released = false;   // registry lock
+        std::atomic<const char*>        name { nullptr };
+        std::unique_ptr<ProfileEvent[]> ring;
+        std::atomic<uint64_t>           writeIndex { 0 };
+        std::atomic<uint64_t>           readIndex { 0 };
+        std::atomic<uint64_t>           dropped { 0 };
+
+        // owner thread only
+        uint64_t    zoneBegin[kMaxDepth] = {};
+        const char* zoneName[kMaxDepth]  = {};
+        uint32_t    depth                = 0;
+    };
+
+    struct ProfilerRegistry
+    {
+        std::mutex                                        mutex;
+        std::vector<std::unique_ptr<ProfileThreadBuffer>> buffers;
+        std::vector<ProfileThreadBuffer*>                 released;   // owners exited
+        uint32_t                                          nextThreadId = 0;
+        uint64_t                                          startTicks   = 0;
+        uint64_t                                          startNs      = 0;
+        std::atomic<double>                               nsPerTick { 0.0 };
+    };
+
+    uint64_t SteadyNanoseconds()
+    {
+        return static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch())
+                .count());
+    }
+
+    ProfilerRegistry& Registry()
+    {
+        static ProfilerRegistry* registry = []() {
+            ProfilerRegistry* r = new ProfilerRegistry();   // never freed, threads may outlive statics
+            r->startTicks       = ProfilerTimestamp();
+            r->startNs          = SteadyNanoseconds();
+            return r;
+        }();
+        return *registry;
+    }
+
+    thread_local ProfileThreadBuffer* t_buffer = nullptr;
+
+    // Releases the thread's buffer when the thread exits. Kept apart from
+    // t_buffer so the per-event lookup stays a plain thread_local read.
+    struct ThreadBufferOwner
+    {
+        ProfileThreadBuffer* buffer = nullptr;
+
+        ~ThreadBufferOwner()
+        {
+            if (!buffer)
+                return;
+
+            ProfilerRegistry&           registry = Registry();
+            std::lock_guard<std::mutex> lock(registry.mutex);
+            buffer->released = true;
+            registry.released.push_back(buffer);
+            t_buffer = nullptr;
+        }
+    };
+
+    thread_local ThreadBufferOwner t_owner;
+
+    // A released buffer whose events were all collected, or a new one.
+    ProfileThreadBuffer* AcquireBuffer(ProfilerRegistry& registry)
+    {
+        for (size_t i = 0; i < registry.released.size(); ++i)
+        {
+            ProfileThreadBuffer* buffer = registry.released[i];
+            if (buffer->readIndex.load(std::memory_order_relaxed) != buffer->writeIndex.load(std::memory_order_relaxed))
+                continue;
+
+            registry.released.erase(registry.released.begin() + i);
+            buffer->released = false;
+            buffer->name.store(nullptr, std::memory_order_relaxed);
+            buffer->depth = 0;
+            return buffer;
+        }
+
+        auto buffer  = std::make_unique<ProfileThreadBuffer>();
+        buffer->ring = std::make_unique<ProfileEvent[]>(kRingCapacity);
+        registry.buffers.push_back(std::move(buffer));
+        return registry.buffers.back().get();
+    }
+
+    ProfileThreadBuffer* ThreadBuffer()
+    {
+        if (t_buffer)
+            return t_buffer;
+
+        ProfilerRegistry&           registry = Registry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        ProfileThreadBuffer*        buffer = AcquireBuffer(registry);
+
+        // a fresh id, so a capture never merges two threads
+        buffer->threadId = registry.nextThreadId++;
+        t_buffer         = buffer;
+        t_owner.buffer   = buffer;
+        return buffer;
+    }
+
+    void Push(ProfileThreadBuffer* buffer, const ProfileEvent& event)
+    {
+        uint64_t write = buffer->writeIndex.load(std::memory_order_relaxed);
+        if (write - buffer->readIndex.load(std::memory_order_acquire) >= kRingCapacity)
+        {
+            buffer->dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+
+        buffer->ring[write & (kRingCapacity - 1)] = event;
+        buffer->writeIndex.store(write + 1, std::memory_order_release);
+    }
+
+    double NsPerTick()
+    {
+#if PROFILER_HAS_TSC
+        ProfilerRegistry& registry = Registry();
+        double            cached   = registry.nsPerTick.load(std::memory_order_relaxed);
+        if (cached > 0.0)
+            return cached;
+
+        // measure against steady_clock over at least 10 ms since startup
+        uint64_t ns = SteadyNanoseconds();
+        while (ns - registry.startNs < 10000000)
+            ns = SteadyNanoseconds();
+
+        uint64_t ticks = ProfilerTimestamp();
+        double   ratio = static_cast<double>(ns - registry.startNs) / static_cast<double>(ticks - registry.startTicks);
+
+        // keep it once the baseline is long enough to be trusted
+        if (ns - registry.startNs > 1000000000)
+            registry.nsPerTick.store(ratio, std::memory_order_relaxed);
+        return ratio;
+#else
+        return 1.0;
+#endif
+    }
+
+    void WriteJsonString(FILE* file, const char* s)
+    {
+        std::fputc('"', file);
+        for (; s && *s; ++s)
+        {
+            if (*s == '"' || *s == '\\')
+                std::fputc('\\', file);
+            std::fputc(*s, file);
+        }
+        std::fputc('"', file);
+    }
+}   // namespace
+
+uint64_t ProfilerTimestamp()
+{
+#if PROFILER_HAS_TSC
+    return __rdtsc();
+#else
+    return SteadyNanoseconds();
+#endif
+}
+
+double ProfilerTicksToNanoseconds(uint64_t ticks)
+{
+    return ticks * NsPerTick();
+}
+
+void ProfilerSetThreadName(const char* name)
+{
+    ThreadBuffer()->name.store(name, std::memory_order_release);
+}
+
+void ProfilerBeginZone(const char* name)
+{
+    ProfileThreadBuffer* buffer = ThreadBuffer();
+    if (buffer->depth < kMaxDepth)
+    {
+        buffer->zoneName[buffer->depth]  = name;
+        buffer->zoneBegin[buffer->depth] = ProfilerTimestamp();
+    }
+    ++buffer->depth;
+}
+
+void ProfilerEndZone()
+{
+    uint64_t             end    = ProfilerTimestamp();
+    ProfileThreadBuffer* buffer = ThreadBuffer();
+    if (buffer->depth == 0)
+        return;
+
+    uint32_t depth = --buffer->depth;
+    if (depth >= kMaxDepth)
+        return;
+
+    uint64_t begin = buffer->zoneBegin[depth];
+    Push(buffer, ProfileEvent { buffer->zoneName[depth], begin, end - begin, depth, ProfileEventType::Zone });
+}
+
+void ProfilerCounter(const char* name, double value)
+{
+    ProfileThreadBuffer* buffer = ThreadBuffer();
+
+    uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    Push(buffer, ProfileEvent { name, ProfilerTimestamp(), bits, buffer->depth, ProfileEventType::Counter });
+}
+
+void ProfilerMarkFrame(uint64_t frameIndex)
+{
+    ProfileThreadBuffer* buffer = ThreadBuffer();
+    Push(buffer, ProfileEvent { "Frame", ProfilerTimestamp(), frameIndex, 0, ProfileEventType::Frame });
+}
+
+void ProfilerCollect(ProfileCapture& capture)
+{
+    ProfilerRegistry&           registry = Registry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+
+    for (auto& buffer : registry.buffers)
+    {
+        uint64_t read  = buffer->readIndex.load(std::memory_order_relaxed);
+        uint64_t write = buffer->writeIndex.load(std::memory_order_acquire);
+        if (buffer->released && read == write)
+            continue;
+
+        auto it = std::find_if(capture.threads.begin(), capture.threads.end(), [&](const ProfileThreadEvents& t) {
+            return t.threadId == buffer->threadId;
+        });
+        if (it == capture.threads.end())
+        {
+            capture.threads.push_back({});
+            it           = capture.threads.end() - 1;
+            it->threadId = buffer->threadId;
+        }
+        it->name = buffer->name.load(std::memory_order_acquire);
+
+        for (uint64_t i = read; i < write; ++i)
+            it->events.push_back(buffer->ring[i & (kRingCapacity - 1)]);
+        buffer->readIndex.store(write, std::memory_order_release);
+
+        capture.droppedEvents += buffer->dropped.exchange(0, std::memory_order_relaxed);
+    }
+}
+
+void ProfilerDiscard()
+{
+    ProfilerRegistry&           registry = Registry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+
+    for (auto& buffer : registry.buffers)
+    {
+        buffer->readIndex.store(buffer->writeIndex.load(std::memory_order_acquire), std::memory_order_release);
+        buffer->dropped.store(0, std::memory_order_relaxed);
+    }
+}
+
+bool ExportChromeTrace(const ProfileCapture& capture, const char* path, uint64_t firstFrame, uint64_t lastFrame)
+{
+    uint64_t rangeBegin = 0;
+    uint64_t rangeEnd   = UINT64_MAX;
+    bool     hasFirst   = false;
+
+    for (const ProfileThreadEvents& thread : capture.threads)
+    {
+        for (const ProfileEvent& e : thread.events)
+        {
+            if (e.type != ProfileEventType::Frame)
+                continue;
+
+            if (e.payload == firstFrame)
+            {
+                rangeBegin = e.timestamp;
+                hasFirst   = true;
+            }
+            if (lastFrame != UINT64_MAX && e.payload == lastFrame + 1)
+                rangeEnd = e.timestamp;
+        }
+    }
+    if (!hasFirst)
+        rangeEnd = UINT64_MAX;
+
+    FILE* file = std::fopen(path, "w");
+    if (!file)
+        return false;
+
+    uint64_t origin    = Registry().startTicks;
+    double   nsPerTick = NsPerTick();
+    auto     toUs      = [&](uint64_t ticks) { return (ticks - origin) * nsPerTick / 1000.0; };
+
+    std::fprintf(file, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+
+    bool first = true;
+    for (const ProfileThreadEvents& thread : capture.threads)
+    {
+        std::fprintf(file, "%s{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":", first ? "" : ",\n", thread.threadId);
+        WriteJsonString(file, thread.name ? thread.name : "thread");
+        std::fprintf(file, "}}");
+        first = false;
+
+        for (const ProfileEvent& e : thread.events)
+        {
+            uint64_t end = e.type == ProfileEventType::Zone ? e.timestamp + e.payload : e.timestamp;
+            if (end < rangeBegin || e.timestamp >= rangeEnd)
+                continue;
+
+            std::fprintf(file, ",\n{\"name\":");
+            WriteJsonString(file, e.name);
+
+            switch (e.type)
+            {
+                case ProfileEventType::Zone:
+                    std::fprintf(file, ",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f", toUs(e.timestamp), e.payload * nsPerTick / 1000.0);
+                    break;
+                case ProfileEventType::Counter:
+                {
+                    double value;
+                    std::memcpy(&value, &e.payload, sizeof(value));
+                    std::fprintf(file, ",\"ph\":\"C\",\"ts\":%.3f,\"args\":{\"value\":%.17g}", toUs(e.timestamp), value);
+                    break;
+                }
+                case ProfileEventType::Frame:
+                    std::fprintf(file, ",\"ph\":\"i\",\"s\":\"g\",\"ts\":%.3f,\"args\":{\"frame\":%llu}", toUs(e.timestamp), static_cast<unsigned long long>(e.payload));
+                    break;
+            }
+            std::fprintf(file, ",\"pid\":1,\"tid\":%u}", thread.threadId);
+        }
+    }
+
+    std::fprintf(file, "\n]}\n");
+
+    bool ok = std::ferror(file) == 0;
+    std::fclose(file);
+    return ok;
+}
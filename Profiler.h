@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Scoped CPU profiler. Each thread writes completed zones and counters into
+// its own lock-free ring; ProfilerCollect drains all rings from any one
+// thread. A ring outlives its thread only until its last events are
+// collected, then goes to the next new thread. Build with PROFILER_ENABLED=0
+// to compile every macro out.
+
+#ifndef PROFILER_ENABLED
+#    define PROFILER_ENABLED 1
+#endif
+
+enum class ProfileEventType : uint32_t
+{
+    Zone,
+    Counter,
+    Frame,
+};
+
+struct ProfileEvent
+{
+    const char*      name;        // must outlive the capture (string literals)
+    uint64_t         timestamp;   // profiler ticks
+    uint64_t         payload;     // zone: duration in ticks, counter: double bits, frame: index
+    uint32_t         depth;
+    ProfileEventType type;
+};
+
+struct ProfileThreadEvents
+{
+    uint32_t                  threadId = 0;
+    const char*               name     = nullptr;
+    std::vector<ProfileEvent> events;
+};
+
+struct ProfileCapture
+{
+    std::vector<ProfileThreadEvents> threads;
+    uint64_t                         droppedEvents = 0;
+};
+
+uint64_t ProfilerTimestamp();
+double   ProfilerTicksToNanoseconds(uint64_t ticks);
+
+void ProfilerSetThreadName(const char* name);
+void ProfilerBeginZone(const char* name);
+void ProfilerEndZone();
+void ProfilerCounter(const char* name, double value);
+void ProfilerMarkFrame(uint64_t frameIndex);
+
+// Moves everything recorded so far into `capture` (appending).
+void ProfilerCollect(ProfileCapture& capture);
+
+// Drops everything recorded so far; keeps the rings from filling up between
+// captures without copying (or allocating) anything.
+void ProfilerDiscard();
+
+// Chrome / Perfetto trace JSON. Restricts output to [firstFrame, lastFrame]
+// when both markers exist; pass UINT64_MAX for lastFrame to take the rest.
+bool ExportChromeTrace(const ProfileCapture& capture, const char* path, uint64_t firstFrame, uint64_t lastFrame);
+
+struct ProfileScope
+{
+    explicit ProfileScope(const char* name)
+    {
+        ProfilerBeginZone(name);
+    }
+
+    ~ProfileScope()
+    {
+        ProfilerEndZone();
+    }
+
+    ProfileScope(const ProfileScope&)            = delete;
+    ProfileScope& operator=(const ProfileScope&) = delete;
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b)       PROFILE_CONCAT_INNER(a, b)
+
+#if PROFILER_ENABLED
+#    define PROFILE_SCOPE(name)          ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(name)
+#    define PROFILE_COUNTER(name, value) ProfilerCounter(name, static_cast<double>(value))
+#    define PROFILE_FRAME(index)         ProfilerMarkFrame(index)
+#    define PROFILE_THREAD(name)         ProfilerSetThreadName(name)
+#else
+#    define PROFILE_SCOPE(name)          ((void)0)
+#    define PROFILE_COUNTER(name, value) ((void)0)
+#    define PROFILE_FRAME(index)         ((void)0)
+#    define PROFILE_THREAD(name)         ((void)0)
+#endif
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Backend object (buffer, shader, input layout, render target view).
+// For D3D11 this is the raw ID3D11* pointer.
+using RenderHandle = void*;
+
+enum class PrimitiveTopology
+{
+    TriangleList,
+    LineList,
+};
+
+enum class IndexFormat
+{
+    UInt16,
+    UInt32,
+};
+
+enum class MapMode
+{
+    WriteDiscard,
+    WriteNoOverwrite,
+};
+
+// Constant buffer offsets and sizes are in bytes and multiples of this
+// (D3D11.1 binds in units of 16 constants).
+constexpr uint32_t kConstantBufferAlignment = 256;
+
+// Part of a constant buffer bound to one slot; size 0 is the whole buffer.
+struct ConstantRange
+{
+    RenderHandle buffer = nullptr;
+    uint32_t     offset = 0;
+    uint32_t     size   = 0;
+};
+
+struct RenderViewport
+{
+    float x        = 0.f;
+    float y        = 0.f;
+    float width    = 0.f;
+    float height   = 0.f;
+    float minDepth = 0.f;
+    float maxDepth = 1.f;
+};
+
+// The part of ID3D11DeviceContext the frame loop uses, so the same submission
+// code can drive D3D11 or a recording null device.
+struct IRenderContext
+{
+    virtual ~IRenderContext() = default;
+
+    virtual void SetInputLayout(RenderHandle layout) = 0;
+    virtual void SetPrimitiveTopology(PrimitiveTopology topology) = 0;
+    virtual void SetVertexBuffers(uint32_t startSlot, uint32_t count, const RenderHandle* buffers, const uint32_t* strides, const uint32_t* offsets) = 0;
+    virtual void SetIndexBuffer(RenderHandle buffer, IndexFormat format, uint32_t offset) = 0;
+    virtual void SetVertexShader(RenderHandle shader) = 0;
+    virtual void SetVSConstantBuffer(uint32_t slot, RenderHandle buffer) = 0;
+    virtual void SetVSConstantBufferRange(uint32_t slot, const ConstantRange& range) = 0;
+    virtual void SetViewport(const RenderViewport& viewport) = 0;
+    virtual void SetPixelShader(RenderHandle shader) = 0;
+    virtual void SetRenderTarget(RenderHandle view) = 0;
+    virtual void ClearRenderTarget(RenderHandle view, const float color[4]) = 0;
+
+    // Returns nullptr on failure. bytesWritten is informational (D3D11 ignores it).
+    virtual void* Map(RenderHandle buffer, MapMode mode) = 0;
+    virtual void  Unmap(RenderHandle buffer, size_t bytesWritten) = 0;
+
+    // Copies into part of a buffer the GPU may still be reading, the rest keeps
+    // its contents. D3D11: UpdateSubresource, so a DEFAULT usage buffer.
+    virtual void UpdateBuffer(RenderHandle buffer, size_t offset, const void* data, size_t size) = 0;
+
+    virtual void DrawIndexed(uint32_t indexCount, uint32_t startIndex, int32_t baseVertex) = 0;
+    virtual void DrawIndexedInstanced(uint32_t indexCount, uint32_t instanceCount, uint32_t startIndex, int32_t baseVertex, uint32_t startInstance) = 0;
+};
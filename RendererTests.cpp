@@ -0,0 +1,2890 @@
+// Correctness checks for the portable renderer code, one named test per
+// module. No window or GPU required; timings live in bench.
+// Linux: cmake -S . -B build && cmake --build build && ctest --test-dir build, or
+//        g++ -O2 -std=c++20 -pthread RendererTests.cpp AffineKernel.cpp AsyncShaderBuilder.cpp BenchReport.cpp ConstantArena.cpp DrawBucket.cpp DynamicResolution.cpp FrameAllocator.cpp FramePacer.cpp FrameTimer.cpp HeapCounter.cpp InputCapture.cpp InputEvents.cpp InstanceBuffer.cpp JobSystem.cpp MappedFile.cpp MeshFile.cpp MeshOptimizer.cpp NullRenderContext.cpp ObjMesh.cpp PrimitiveBatcher.cpp Profiler.cpp Scene.cpp ShaderCache.cpp SimulationThread.cpp SoftwareRasterizer.cpp SpatialGrid.cpp StateTrackingContext.cpp TestSupport.cpp TransformGraph.cpp VertexFormat.cpp -o renderer_tests
+//   renderer_tests              run every test
+//   renderer_tests <name>...    run the named tests
+//   renderer_tests --list       print the test names
+
+#include "AffineKernel.h"
+#include "AsyncShaderBuilder.h"
+#include "BenchReport.h"
+#include "ConstantArena.h"
+#include "DrawBucket.h"
+#include "DynamicResolution.h"
+#include "FrameAllocator.h"
+#include "FramePacer.h"
+#include "FrameTimer.h"
+#include "FrameTimer.h"
+#include "HeapCounter.h"
+#include "InputCapture.h"
+#include "InputEvents.h"
+#include "InstanceBuffer.h"
+#include "JobSystem.h"
+#include "MeshFile.h"
+#include "MeshOptimizer.h"
+#include "NullRenderContext.h"
+#include "ObjMesh.h"
+#include "PrimitiveBatcher.h"
+#include "Profiler.h"
+#include "Scene.h"
+#include "ShaderCache.h"
+#include "SimulationThread.h"
+#include "SoftwareRasterizer.h"
+#include "SpatialGrid.h"
+#include "StateTrackingContext.h"
+#include "TestExpect.h"
+#include "TestSupport.h"
+#include "TransformGraph.h"
+#include "TripleBuffer.h"
+#include "VertexFormat.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+volatile float g_testSink = 0.f;   // keeps the work under test from being optimized out
+
+// Checks every kernel path against the SimpleMath-style reference and against each other.
+bool ValidateAffineKernels()
+{
+    const AffineKernelPath paths[]   = { AffineKernelPath::Scalar, AffineKernelPath::SSE, AffineKernelPath::AVX2 };
+    const float            ranges[]  = { 3.2f, 100.f, 8192.f };
+    const float            tolerance = 1e-5f;
+    const size_t           count     = 100003;   // not a multiple of the SIMD width
+
+    bool ok = true;
+    for (float range : ranges)
+    {
+        AffineInputs in = MakeAffineInputs(count, range);
+
+        std::vector<float> reference(count * 16);
+        for (size_t i = 0; i < count; ++i)
+            ReferenceWorldMatrix(in.px[i], in.py[i], in.sx[i], in.sy[i], in.rot[i], &reference[i * 16]);
+
+        std::vector<float> scalar(count * 16);
+        BuildAffineMatrices(AffineKernelPath::Scalar, in.px.data(), in.py.data(), in.sx.data(), in.sy.data(), in.rot.data(), count, scalar.data());
+
+        for (AffineKernelPath path : paths)
+        {
+            if (!IsAffineKernelPathSupported(path))
+                continue;
+
+            std::vector<float> result(count * 16);
+            BuildAffineMatrices(path, in.px.data(), in.py.data(), in.sx.data(), in.sy.data(), in.rot.data(), count, result.data());
+
+            float maxError = 0.f;
+            for (size_t i = 0; i < result.size(); ++i)
+                maxError = std::max(maxError, std::fabs(result[i] - reference[i]));
+
+            bool bitExact = std::memcmp(result.data(), scalar.data(), result.size() * sizeof(float)) == 0;
+            bool passed   = bitExact && maxError <= tolerance;
+            ok &= Expect(passed, "%s path off the reference for |r| < %.0f", AffineKernelPathName(path), range);
+
+            std::printf("affine validate   %-6s  |r|<%-6.0f max error %.2e  bit-exact vs scalar: %s  %s\n",
+                        AffineKernelPathName(path),
+                        range,
+                        maxError,
+                        bitExact ? "yes" : "no",
+                        passed ? "ok" : "FAILED");
+        }
+    }
+    return ok;
+}
+
+// Screen position (in pixels) to the NDC the rasterizer maps back onto it.
+RasterVertex ScreenVertex(const RasterTarget& target, float x, float y, float r, float g, float b)
+{
+    return { 2.f * x / target.width - 1.f, 1.f - 2.f * y / target.height, r, g, b };
+}
+
+const float kIdentityWorld[16] = { 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1 };
+
+// One triangle per draw, over a cleared target.
+RasterStats RasterizeTriangles(SoftwareRasterizer* rasterizer, RasterTarget& target, const std::vector<RasterVertex>& vertices)
+{
+    static const uint32_t indices[] = { 0, 1, 2 };
+    const float           clear[]   = { 0.f, 0.f, 0.f, 0.f };
+
+    std::vector<RasterDrawCall> draws;
+    for (size_t i = 0; i + 3 <= vertices.size(); i += 3)
+        draws.push_back({ &vertices[i], indices, 3, kIdentityWorld });
+
+    RasterStats stats;
+    ClearRasterTarget(target, clear);
+    RasterizeDraws(rasterizer, target, draws.data(), draws.size(), &stats);
+    return stats;
+}
+
+// Every channel within one step of the barycentric blend of the corner colors
+// at the center of pixel (x, y).
+bool MatchesInterpolatedColor(const RasterTarget& target, const RasterVertex* v, uint32_t x, uint32_t y)
+{
+    auto sx   = [&](int i) { return (v[i].x + 1.0) * 0.5 * target.width; };
+    auto sy   = [&](int i) { return (1.0 - v[i].y) * 0.5 * target.height; };
+    double px = x + 0.5;
+    double py = y + 0.5;
+
+    double area = (sx(1) - sx(0)) * (sy(2) - sy(0)) - (sy(1) - sy(0)) * (sx(2) - sx(0));
+    double w1   = ((px - sx(0)) * (sy(2) - sy(0)) - (py - sy(0)) * (sx(2) - sx(0))) / area;
+    double w2   = ((sx(1) - sx(0)) * (py - sy(0)) - (sy(1) - sy(0)) * (px - sx(0))) / area;
+    double w0   = 1.0 - w1 - w2;
+
+    uint32_t pixel = target.pixels[static_cast<size_t>(y) * target.width + x];
+    for (int k = 0; k < 3; ++k)
+    {
+        double expected = 255.0 * (w0 * (&v[0].r)[k] + w1 * (&v[1].r)[k] + w2 * (&v[2].r)[k]);
+        if (std::fabs(static_cast<double>((pixel >> (8 * k)) & 0xFF) - expected) > 1.0)
+            return false;
+    }
+    return true;
+}
+
+// Coverage and the top-left rule on a rectangle whose edges and diagonal run
+// through pixel centers, color interpolation, and the same image from every
+// worker count and edge-function path.
+bool ValidateSoftwareRasterizer()
+{
+    bool ok = true;
+
+    SoftwareRasterizer* single = CreateSoftwareRasterizer(1);
+    SoftwareRasterizer* many   = CreateSoftwareRasterizer(4);
+
+    // both paths: [1.5, 5.5] x [2.5, 6.5] split along the diagonal. The top
+    // and left edges own the centers on them, the bottom and right edges do
+    // not, and each diagonal center goes to exactly one of the two triangles.
+    RasterTarget target;
+    for (RasterPath path : { RasterPath::Scalar, RasterPath::SSE })
+    {
+        if (!IsRasterPathSupported(path))
+            continue;
+        SetRasterPath(single, path);
+
+        ResizeRasterTarget(target, 8, 8);
+        std::vector<RasterVertex> rect = {
+            ScreenVertex(target, 1.5f, 2.5f, 1.f, 0.f, 0.f), ScreenVertex(target, 5.5f, 2.5f, 1.f, 0.f, 0.f), ScreenVertex(target, 5.5f, 6.5f, 1.f, 0.f, 0.f),
+            ScreenVertex(target, 1.5f, 2.5f, 0.f, 1.f, 0.f), ScreenVertex(target, 5.5f, 6.5f, 0.f, 1.f, 0.f), ScreenVertex(target, 1.5f, 6.5f, 0.f, 1.f, 0.f),
+        };
+        RasterStats stats   = RasterizeTriangles(single, target, rect);
+        bool        covered = true;
+        for (uint32_t y = 0; y < 8; ++y)
+        {
+            for (uint32_t x = 0; x < 8; ++x)
+                covered &= (target.pixels[y * 8 + x] != 0) == (x >= 1 && x <= 4 && y >= 2 && y <= 5);
+        }
+        ok &= Expect(stats.trianglesCulled == 0 && covered, "%s: rectangle coverage wrong", RasterPathName(path));
+        ok &= Expect(stats.pixelsWritten == 16, "%s: shared edge drawn %llu times over", RasterPathName(path), static_cast<unsigned long long>(stats.pixelsWritten - 16));
+
+        // corners red, green, blue; the centroid is a pixel center
+        ResizeRasterTarget(target, 64, 64);
+        std::vector<RasterVertex> triangle = {
+            ScreenVertex(target, 8.5f, 8.5f, 1.f, 0.f, 0.f),
+            ScreenVertex(target, 56.5f, 8.5f, 0.f, 1.f, 0.f),
+            ScreenVertex(target, 8.5f, 56.5f, 0.f, 0.f, 1.f),
+        };
+        RasterizeTriangles(single, target, triangle);
+        ok &= Expect(target.pixels[8 * 64 + 8] == 0xFF0000FFu, "%s: top-left corner not pure red: %08x", RasterPathName(path), target.pixels[8 * 64 + 8]);
+        ok &= Expect(target.pixels[24 * 64 + 24] == 0xFF555555u, "%s: centroid not an even mix: %08x", RasterPathName(path), target.pixels[24 * 64 + 24]);
+        ok &= Expect(MatchesInterpolatedColor(target, triangle.data(), 55, 8) && MatchesInterpolatedColor(target, triangle.data(), 8, 55), "%s: color next to the green or blue corner wrong", RasterPathName(path));
+        bool interpolated = true;
+        for (uint32_t y = 9; y < 40; y += 3)
+        {
+            for (uint32_t x = 9; x < 40 && x + y < 64; x += 3)
+                interpolated &= MatchesInterpolatedColor(target, triangle.data(), x, y);
+        }
+        ok &= Expect(interpolated, "%s: interior color off the barycentric blend", RasterPathName(path));
+    }
+
+    // overlapping random triangles, some culled, some off screen, on a target
+    // that is no multiple of the tile or the SIMD width
+    std::mt19937                          rng(3);
+    std::uniform_real_distribution<float> position(-1.2f, 1.2f);
+    std::uniform_real_distribution<float> color(0.f, 1.f);
+    std::vector<RasterVertex>             scene;
+    for (int i = 0; i < 3 * 2000; ++i)
+        scene.push_back({ position(rng), position(rng), color(rng), color(rng), color(rng) });
+
+    RasterTarget reference;
+    ResizeRasterTarget(reference, 301, 203);
+    ResizeRasterTarget(target, 301, 203);
+    SetRasterPath(single, RasterPath::Scalar);
+    RasterStats scalar = RasterizeTriangles(single, reference, scene);
+
+    SetRasterPath(many, RasterPath::Scalar);
+    RasterStats stats = RasterizeTriangles(many, target, scene);
+    ok &= Expect(scalar.pixelsWritten > 0 && target.pixels == reference.pixels && stats.pixelsWritten == scalar.pixelsWritten, "4 workers differ from 1");
+
+    if (IsRasterPathSupported(RasterPath::SSE))
+    {
+        SetRasterPath(single, RasterPath::SSE);
+        stats = RasterizeTriangles(single, target, scene);
+        ok &= Expect(target.pixels == reference.pixels && stats.pixelsWritten == scalar.pixelsWritten, "sse edge functions differ from scalar");
+
+        SetRasterPath(many, RasterPath::SSE);
+        stats = RasterizeTriangles(many, target, scene);
+        ok &= Expect(target.pixels == reference.pixels && stats.pixelsWritten == scalar.pixelsWritten, "sse with 4 workers differs from scalar");
+    }
+
+    DestroySoftwareRasterizer(single);
+    DestroySoftwareRasterizer(many);
+    return ok;
+}
+
+// Null device resources for the triangle and up to 64 instances, shaped like
+// the headless runner's.
+RenderResources NullSceneResources(NullRenderContext& device)
+{
+    RenderResources r;
+    r.inputLayout           = device.CreateObject();
+    r.instancedInputLayout  = device.CreateObject();
+    r.vertexShader          = device.CreateObject();
+    r.instancedVertexShader = device.CreateObject();
+    r.pixelShader           = device.CreateObject();
+    r.renderTargetView      = device.CreateObject();
+    r.vertexStride          = GetVertexLayout(kSceneVertexFormat).stride;
+    r.indexFormat           = IndexFormat::UInt16;
+    r.vertexBuffer          = device.CreateBuffer(r.vertexStride * 3);
+    r.indexBuffer           = device.CreateBuffer(sizeof(uint16_t) * 3);
+    r.constantBuffer        = device.CreateBuffer(sizeof(ConstantBuffer));
+    r.instanceCapacity      = 64;
+    r.instanceBuffer        = device.CreateBuffer(sizeof(InstanceData) * r.instanceCapacity);
+    r.indexCount            = 3;
+    r.viewport              = RenderViewport { 0.f, 0.f, 640.f, 360.f, 0.f, 1.f };
+    return r;
+}
+
+// The counters the headless runner reports, for a known RenderScene sequence:
+// a first frame, a repeat whose constants are already in the buffer, a frame
+// without the instanced shader, and frames through the constant arena.
+bool ValidateNullRenderContext()
+{
+    NullRenderContext device;
+    RenderResources   r = NullSceneResources(device);
+    DrawBucket        bucket;
+
+    ConstantBuffer constants = {};
+    constants.world[0] = constants.world[5] = constants.world[10] = constants.world[15] = 1.f;
+
+    bool ok = true;
+
+    // pass: topology, viewport, target; triangle: layout, vertex and index
+    // buffers, both shaders, constants; instances: layout, vertex buffers, shader
+    RenderScene(device, r, constants, 10, bucket);
+    ok &= Expect(device.frame.binds == 12 && device.frame.clears == 1, "first frame: %llu binds, %llu clears", (unsigned long long)device.frame.binds, (unsigned long long)device.frame.clears);
+    ok &= Expect(device.frame.draws == 2 && device.frame.instances == 11 && device.frame.indices == 33, "first frame: %llu draws, %llu instances, %llu indices", (unsigned long long)device.frame.draws, (unsigned long long)device.frame.instances, (unsigned long long)device.frame.indices);
+    ok &= Expect(device.frame.maps == 1 && device.frame.bytesUploaded == sizeof(ConstantBuffer) && device.frame.updates == 0, "first frame: constants not written with one map");
+    device.EndFrame();
+
+    RenderScene(device, r, constants, 10, bucket);
+    ok &= Expect(device.frame.maps == 0 && device.frame.bytesUploaded == 0, "unchanged constants were uploaded again");
+    ok &= Expect(device.frame.binds == 12 && device.frame.draws == 2, "repeat frame submitted differently");
+    device.EndFrame();
+
+    // the instanced draw waits for its shader; instances past the capacity are dropped
+    RenderHandle instancedShader = r.instancedVertexShader;
+    r.instancedVertexShader      = nullptr;
+    constants.world[12]          = 0.5f;
+    RenderScene(device, r, constants, 10, bucket);
+    ok &= Expect(device.frame.binds == 9 && device.frame.draws == 1 && device.frame.instances == 1, "draw without its shader was submitted");
+    ok &= Expect(device.frame.maps == 1, "moved constants not written");
+    device.EndFrame();
+
+    r.instancedVertexShader = instancedShader;
+    RenderScene(device, r, constants, 100, bucket);
+    ok &= Expect(device.frame.instances == 1 + r.instanceCapacity, "instance count not clamped to the capacity");
+    device.EndFrame();
+
+    // with the arena, moving constants take a block both draws bind and the
+    // only map is its flush; once they stop, they are written to constantBuffer
+    // and bound from there
+    ConstantArena arena;
+    InitConstantArena(arena, device.CreateBuffer(1024), 1024, false);
+    r.constantArena     = &arena;
+    constants.world[13] = 0.25f;
+
+    const uint64_t expectedMaps[3]  = { 1, 1, 0 };
+    const uint64_t expectedBytes[3] = { kConstantBufferAlignment, sizeof(ConstantBuffer), 0 };
+    for (uint64_t frame = 0; frame < 3; ++frame)
+    {
+        BeginConstantArenaFrame(arena, frame + 1, 0);
+        RenderScene(device, r, constants, 10, bucket);
+        EndConstantArenaFrame(arena);
+        ok &= Expect(device.frame.binds == 12 && device.frame.maps == expectedMaps[frame] && device.frame.bytesUploaded == expectedBytes[frame],
+                     "arena frame %llu: %llu binds, %llu maps, %llu bytes",
+                     (unsigned long long)frame,
+                     (unsigned long long)device.frame.binds,
+                     (unsigned long long)device.frame.maps,
+                     (unsigned long long)device.frame.bytesUploaded);
+        device.EndFrame();
+    }
+    ok &= Expect(arena.total.blocks == 1, "still constants pushed %llu arena blocks", (unsigned long long)arena.total.blocks);
+
+    // a null buffer maps to nothing and is not counted
+    ok &= Expect(device.Map(nullptr, MapMode::WriteDiscard) == nullptr && device.frame.maps == 0, "null buffer map counted");
+    device.EndFrame();
+
+    const SubmissionStats& t = device.total;
+    ok &= Expect(device.frameCount == 8 && device.frame.draws == 0, "EndFrame did not reset the frame");
+    ok &= Expect(t.draws == 13 && t.binds == 81 && t.maps == 4 && t.clears == 7, "totals: %llu draws, %llu binds, %llu maps", (unsigned long long)t.draws, (unsigned long long)t.binds, (unsigned long long)t.maps);
+    ok &= Expect(t.instances == 11 + 11 + 1 + 65 + 3 * 11 && t.indices == 3 * t.instances, "instance totals wrong");
+
+    return ok;
+}
+
+// Whole file as text; empty when it cannot be read.
+std::string ReadTextFile(const char* path)
+{
+    std::string text;
+    FILE*       file = std::fopen(path, "rb");
+    if (!file)
+        return text;
+
+    char   chunk[4096];
+    size_t read;
+    while ((read = std::fread(chunk, 1, sizeof(chunk), file)) > 0)
+        text.append(chunk, read);
+    std::fclose(file);
+    return text;
+}
+
+// Synthetic timestamps through an 8-frame ring: two ticks inside one
+// millisecond, a repeated timestamp, then enough frames to wrap. Checks the
+// exact nearest-rank percentiles, the buckets and the exported text.
+bool ValidateFrameTimer()
+{
+    bool ok = true;
+
+    FrameTimer timer;
+    InitFrameTimer(timer, 8);
+
+    uint64_t now = 5000000000ull;
+    ok &= Expect(TickFrameTimer(timer, now) == 0.f && timer.samples == 0, "first tick recorded a frame");
+    ok &= Expect(TickFrameTimer(timer, now + 500000) == 0.0005f, "sub-millisecond frame lost");
+    now += 500000;
+    ok &= Expect(TickFrameTimer(timer, now) == 0.f, "repeated timestamp not a zero-length frame");
+
+    for (uint64_t ms = 1; ms <= 2; ++ms)
+        TickFrameTimer(timer, now += ms * 1000000);
+
+    // 0.5, 0, 1, 2 ms
+    FrameTimeStats stats = ComputeFrameTimeStats(timer);
+    ok &= Expect(stats.samples == 4 && stats.minMs == 0.0 && stats.p50Ms == 0.5 && stats.p95Ms == 2.0 && stats.p99Ms == 2.0 && stats.maxMs == 2.0 && stats.meanMs == 0.875,
+                 "stats before the wrap: p50 %.3f p95 %.3f mean %.3f",
+                 stats.p50Ms,
+                 stats.p95Ms,
+                 stats.meanMs);
+
+    // 12 frames in all; the ring keeps 3 .. 10 ms
+    for (uint64_t ms = 3; ms <= 10; ++ms)
+        TickFrameTimer(timer, now += ms * 1000000);
+
+    stats = ComputeFrameTimeStats(timer);
+    ok &= Expect(timer.frameCount == 13 && stats.samples == 8, "%zu samples after %llu ticks", stats.samples, static_cast<unsigned long long>(timer.frameCount));
+    ok &= Expect(stats.minMs == 3.0 && stats.p50Ms == 6.0 && stats.p95Ms == 10.0 && stats.p99Ms == 10.0 && stats.maxMs == 10.0 && stats.meanMs == 6.5,
+                 "stats after the wrap: min %.3f p50 %.3f p95 %.3f p99 %.3f max %.3f mean %.3f",
+                 stats.minMs,
+                 stats.p50Ms,
+                 stats.p95Ms,
+                 stats.p99Ms,
+                 stats.maxMs,
+                 stats.meanMs);
+
+    LinearAllocator scratch;
+    InitLinearAllocator(scratch, 1024);
+    FrameTimeStats heapFree = ComputeFrameTimeStats(timer, scratch);
+    ok &= Expect(std::memcmp(&heapFree, &stats, sizeof(stats)) == 0, "scratch stats differ");
+
+    float newest[3];
+    ok &= Expect(CopyFrameTimesMs(timer, newest, 3) == 3 && newest[0] == 8.f && newest[1] == 9.f && newest[2] == 10.f, "newest frames not kept in order");
+
+    // 2 ms buckets, the last also holding everything above 6 ms
+    FrameTimeHistogram histogram = ComputeFrameTimeHistogram(timer, 2.0, 4);
+    ok &= Expect(histogram.counts == std::vector<uint32_t> { 0, 1, 2, 5 }, "histogram %u %u %u %u", histogram.counts[0], histogram.counts[1], histogram.counts[2], histogram.counts[3]);
+    uint32_t counts[4];
+    CountFrameTimeBuckets(timer, 2.0, counts, 4);
+    ok &= Expect(std::equal(counts, counts + 4, histogram.counts.begin()), "bucket counts differ from the histogram");
+
+    const char* csvPath  = "frame_timer_validate.csv";
+    const char* jsonPath = "frame_timer_validate.json";
+    ok &= Expect(ExportFrameTimesCSV(timer, csvPath) && ExportFrameTimesJSON(timer, jsonPath), "export failed");
+
+    std::string csv = "frame,ms\n";
+    for (int i = 0; i < 8; ++i)
+        csv += std::to_string(i) + "," + std::to_string(3 + i) + ".000000\n";
+    ok &= Expect(ReadTextFile(csvPath) == csv, "CSV export differs");
+
+    std::string json = "{\n"
+                       "  \"samples\": 8,\n"
+                       "  \"ms\": { \"mean\": 6.500000, \"min\": 3.000000, \"p50\": 6.000000, \"p95\": 10.000000, \"p99\": 10.000000, \"max\": 10.000000 },\n"
+                       "  \"histogram\": { \"bucketMs\": 1.000, \"counts\": [";
+    for (int i = 0; i < 50; ++i)
+        json += std::string(i ? ", " : "") + (i >= 3 && i <= 10 ? "1" : "0");
+    json += "] },\n  \"frameTimesMs\": [";
+    for (int i = 0; i < 8; ++i)
+        json += std::string(i ? ", " : "") + std::to_string(3 + i) + ".000000";
+    json += "]\n}\n";
+    ok &= Expect(ReadTextFile(jsonPath) == json, "JSON export differs");
+
+    std::remove(csvPath);
+    std::remove(jsonPath);
+    return ok;
+}
+
+// Nested zones on two threads, counters, ring overflow and trace export.
+bool ValidateProfiler()
+{
+    ProfileCapture discard;
+    ProfilerCollect(discard);
+
+    auto work = [](const char* threadName) {
+        PROFILE_THREAD(threadName);
+        for (int frame = 0; frame < 4; ++frame)
+        {
+            PROFILE_FRAME(frame);
+            PROFILE_SCOPE("Outer");
+            {
+                PROFILE_SCOPE("Inner");
+                PROFILE_COUNTER("Value", frame * 0.5);
+            }
+        }
+    };
+
+    std::thread worker(work, "Worker");
+    work("Main");
+    worker.join();
+
+    ProfileCapture capture;
+    ProfilerCollect(capture);
+
+    int threads = 0;
+    for (const ProfileThreadEvents& thread : capture.threads)
+    {
+        if (thread.events.empty())
+            continue;
+        ++threads;
+
+        int    zones        = 0;
+        double counterTotal = 0.0;
+        for (size_t i = 0; i < thread.events.size(); ++i)
+        {
+            const ProfileEvent& e = thread.events[i];
+            if (e.type == ProfileEventType::Counter)
+            {
+                double value;
+                std::memcpy(&value, &e.payload, sizeof(value));
+                counterTotal += value;
+            }
+            else if (e.type == ProfileEventType::Zone)
+            {
+                ++zones;
+                bool inner = std::strcmp(e.name, "Inner") == 0;
+                if (!Expect(e.depth == (inner ? 1u : 0u), "%s has depth %u", e.name, e.depth))
+                    return false;
+                // an inner zone completes first and lies inside the following outer zone
+                if (inner)
+                {
+                    if (!Expect(i + 1 < thread.events.size(), "inner zone not followed by its outer zone"))
+                        return false;
+
+                    const ProfileEvent& outer = thread.events[i + 1];
+                    if (!Expect(outer.timestamp <= e.timestamp && outer.timestamp + outer.payload >= e.timestamp + e.payload, "inner zone not nested"))
+                        return false;
+                }
+            }
+        }
+
+        if (!Expect(zones == 8 && counterTotal == 3.0, "%d zones, counter total %.2f", zones, counterTotal))
+            return false;
+    }
+
+    if (!Expect(threads == 2 && capture.droppedEvents == 0, "%d threads, %llu dropped", threads, static_cast<unsigned long long>(capture.droppedEvents)))
+        return false;
+
+    // the ring holds 65536 events; the rest must be counted, not written
+    for (int i = 0; i < 70000; ++i)
+        PROFILE_COUNTER("Overflow", i);
+
+    ProfileCapture overflow;
+    ProfilerCollect(overflow);
+    if (!Expect(overflow.droppedEvents == 70000 - 65536, "expected %d dropped, got %llu", 70000 - 65536, static_cast<unsigned long long>(overflow.droppedEvents)))
+        return false;
+
+    // threads started one after another share one ring, each under its own id
+    ProfileCapture reused;
+    uint64_t       bytes = 0;
+    for (int i = 0; i < 4; ++i)
+    {
+        if (i == 1)
+            bytes = HeapAllocatedBytes();
+
+        std::thread([]() { PROFILE_SCOPE("Short"); }).join();
+        ProfilerCollect(reused);
+    }
+    bytes = HeapAllocatedBytes() - bytes;
+
+    int shortThreads = 0;
+    for (const ProfileThreadEvents& thread : reused.threads)
+        shortThreads += thread.events.size() == 1 && std::strcmp(thread.events[0].name, "Short") == 0;
+    if (!Expect(shortThreads == 4, "%d of 4 exited threads captured apart", shortThreads))
+        return false;
+    if (!Expect(bytes < 65536 * sizeof(ProfileEvent), "%llu bytes allocated for 3 threads, rings not reused", static_cast<unsigned long long>(bytes)))
+        return false;
+
+    return Expect(ExportChromeTrace(capture, "profiler_validate.json", 1, 2) && std::remove("profiler_validate.json") == 0, "trace export failed");
+}
+
+// Miss/hit, persistence, keying, corruption and eviction against the stub.
+bool ValidateShaderCache()
+{
+    const char* path = "shader_cache_validate.bin";
+    std::remove(path);
+
+    const char           source[] = "float4 main() : SV_TARGET { return 1; }";
+    ShaderDefine         define   = { "FAST", "1" };
+    ShaderCompileRequest requests[4];
+    for (ShaderCompileRequest& r : requests)
+    {
+        r.source     = source;
+        r.sourceSize = sizeof(source) - 1;
+        r.entryPoint = "main";
+        r.target     = "ps_5_0";
+    }
+    requests[1].target      = "vs_5_0";
+    requests[2].defines     = &define;
+    requests[2].defineCount = 1;
+    requests[3].flags       = 1;
+
+    bool ok = true;
+    for (int i = 0; i < 4; ++i)
+        for (int j = i + 1; j < 4; ++j)
+            ok &= Expect(HashShaderRequest(requests[i]) != HashShaderRequest(requests[j]), "keys collide");
+
+    StubShaderCompiler                compiler;
+    ShaderCache                       cache;
+    ShaderBytecode                    bytecode;
+    std::vector<std::vector<uint8_t>> expected(4);
+
+    // cold: every request compiles once, the second lookup hits in memory
+    OpenShaderCache(cache, path, 1 << 20);
+    for (int i = 0; i < 4; ++i)
+    {
+        ok &= Expect(GetOrCompileShader(cache, compiler, requests[i], bytecode, nullptr), "cold compile failed");
+        expected[i].assign(bytecode.data, bytecode.data + bytecode.size);
+        ok &= Expect(GetOrCompileShader(cache, compiler, requests[i], bytecode, nullptr), "in-memory lookup failed");
+    }
+    ok &= Expect(compiler.compiles == 4 && cache.stats.hits == 4, "cold run compiled twice");
+    ok &= Expect(SaveShaderCache(cache), "save failed");
+    CloseShaderCache(cache);
+
+    // warm: served from the mapped file, byte-identical
+    compiler.compiles = 0;
+    OpenShaderCache(cache, path, 1 << 20);
+    for (int i = 0; i < 4; ++i)
+    {
+        ok &= Expect(GetOrCompileShader(cache, compiler, requests[i], bytecode, nullptr), "warm lookup failed");
+        ok &= Expect(bytecode.size == expected[i].size() && std::memcmp(bytecode.data, expected[i].data(), bytecode.size) == 0, "warm bytecode differs");
+    }
+    ok &= Expect(compiler.compiles == 0, "warm run compiled");
+    ok &= Expect(cache.dirty, "hits from an earlier run did not mark the cache for saving");
+
+    // compile errors are reported and not cached
+    std::string          errors;
+    ShaderCompileRequest broken = requests[0];
+    broken.entryPoint           = "missing";
+    compiler.failNext           = true;
+    ok &= Expect(!GetOrCompileShader(cache, compiler, broken, bytecode, &errors) && !errors.empty(), "failure not reported");
+    CloseShaderCache(cache);
+
+    // flip one byte in the last blob: only that entry recompiles
+    {
+        FILE* file = std::fopen(path, "r+b");
+        std::fseek(file, -1, SEEK_END);
+        int last = std::fgetc(file);
+        std::fseek(file, -1, SEEK_END);
+        std::fputc(last ^ 0xff, file);
+        std::fclose(file);
+    }
+    compiler.compiles = 0;
+    OpenShaderCache(cache, path, 1 << 20);
+    for (int i = 0; i < 4; ++i)
+    {
+        ok &= Expect(GetOrCompileShader(cache, compiler, requests[i], bytecode, nullptr), "lookup after corruption failed");
+        ok &= Expect(bytecode.size == expected[i].size() && std::memcmp(bytecode.data, expected[i].data(), bytecode.size) == 0, "corrupt blob served");
+    }
+    ok &= Expect(compiler.compiles == 1 && cache.stats.corrupt == 1, "corrupt blob not detected");
+    ok &= Expect(SaveShaderCache(cache), "save after corruption failed");
+    CloseShaderCache(cache);
+
+    // truncated file: header no longer matches, whole file dropped
+    {
+        FILE* file = std::fopen(path, "wb");
+        std::fputs("SHDC", file);
+        std::fclose(file);
+    }
+    compiler.compiles = 0;
+    OpenShaderCache(cache, path, 1 << 20);
+    ok &= Expect(cache.entries.empty() && cache.stats.corrupt == 1, "truncated file accepted");
+    for (int i = 0; i < 4; ++i)
+        GetOrCompileShader(cache, compiler, requests[i], bytecode, nullptr);
+    ok &= Expect(SaveShaderCache(cache), "save after truncation failed");
+    CloseShaderCache(cache);
+
+    // eviction: with room for ~2 blobs only the ones used this run survive;
+    // hits alone are enough to save
+    OpenShaderCache(cache, path, expected[0].size() + expected[1].size());
+    GetOrCompileShader(cache, compiler, requests[0], bytecode, nullptr);
+    GetOrCompileShader(cache, compiler, requests[1], bytecode, nullptr);
+    ok &= Expect(SaveShaderCache(cache), "save with eviction failed");
+    ok &= Expect(cache.stats.evictions == 2 && cache.entries.size() == 2, "eviction kept the wrong entries");
+    ok &= Expect(cache.entries.count(HashShaderRequest(requests[0])) && cache.entries.count(HashShaderRequest(requests[1])), "recently used entry evicted");
+
+    // a second use in the same run changes nothing to save
+    GetOrCompileShader(cache, compiler, requests[0], bytecode, nullptr);
+    ok &= Expect(!cache.dirty, "repeated hit marked the cache dirty");
+    CloseShaderCache(cache);
+
+    std::remove(path);
+    return ok;
+}
+
+bool ValidateStateTracking()
+{
+    RecordingRenderContext device;
+    StateTrackingContext   tracker;
+    tracker.inner = &device;
+
+    RenderHandle   vbA      = reinterpret_cast<RenderHandle>(0x100);
+    RenderHandle   vbB      = reinterpret_cast<RenderHandle>(0x200);
+    RenderHandle   shaderA  = reinterpret_cast<RenderHandle>(0x300);
+    RenderHandle   shaderB  = reinterpret_cast<RenderHandle>(0x400);
+    RenderViewport viewport = { 0.f, 0.f, 1280.f, 720.f, 0.f, 1.f };
+
+    bool ok = true;
+
+    BindDrawState(tracker, vbA, shaderA, viewport);
+    ok &= Expect(device.calls == 9 && TotalIssued(tracker.frame) == 9, "first binds not all issued");
+
+    BindDrawState(tracker, vbA, shaderA, viewport);
+    ok &= Expect(device.calls == 9 && TotalElided(tracker.frame) == 9, "repeated binds reached the device");
+
+    // only what differs goes through
+    BindDrawState(tracker, vbB, shaderB, viewport);
+    ok &= Expect(device.calls == 11, "changed binds not issued exactly once");
+
+    viewport.width = 640.f;
+    BindDrawState(tracker, vbB, shaderB, viewport);
+    ok &= Expect(device.calls == 12, "viewport change missed");
+
+    // a multi-slot set is trimmed to the slots that changed
+    RenderHandle buffers[3] = { vbB, vbA, vbA };
+    uint32_t     strides[3] = { 20, 64, 64 };
+    uint32_t     offsets[3] = { 0, 0, 0 };
+    tracker.SetVertexBuffers(0, 3, buffers, strides, offsets);
+    ok &= Expect(device.lastVertexStart == 1 && device.lastVertexCount == 2, "vertex buffer range not trimmed");
+
+    buffers[2] = vbB;
+    tracker.SetVertexBuffers(0, 3, buffers, strides, offsets);
+    ok &= Expect(device.lastVertexStart == 2 && device.lastVertexCount == 1, "single changed slot not isolated");
+
+    int sets = device.vertexBufferSets;
+    tracker.SetVertexBuffers(0, 3, buffers, strides, offsets);
+    ok &= Expect(device.vertexBufferSets == sets, "unchanged vertex buffers reissued");
+
+    // constant buffer ranges are shadowed with their offset and size
+    ConstantRange block  = { vbA, 256, 256 };
+    int           before = device.calls;
+    tracker.SetVSConstantBufferRange(1, block);
+    tracker.SetVSConstantBufferRange(1, block);
+    block.offset = 512;
+    tracker.SetVSConstantBufferRange(1, block);
+    tracker.SetVSConstantBuffer(1, vbA);
+    ok &= Expect(device.calls == before + 3, "constant buffer range not tracked by offset");
+
+    // after Invalidate everything is issued again
+    tracker.Invalidate();
+    before = device.calls;
+    BindDrawState(tracker, vbB, shaderB, viewport);
+    ok &= Expect(device.calls == before + 9, "Invalidate did not reset the shadow");
+
+    tracker.EndFrame();
+    ok &= Expect(TotalIssued(tracker.frame) == 0 && TotalIssued(tracker.total) == static_cast<uint64_t>(device.calls), "issued count does not match the device");
+
+    return ok;
+}
+
+// Radix order must match a stable comparison sort of the merged lists, and
+// submission must skip every bind the previous draw already made.
+bool ValidateDrawBucket()
+{
+    DrawBucket bucket;
+    RecordSyntheticDrawsThreaded(bucket, 20000, 4);
+    SortDrawBucket(bucket);
+
+    std::vector<DrawSortEntry> reference;
+    for (uint32_t l = 0; l < bucket.lists.size(); ++l)
+        for (uint32_t i = 0; i < bucket.lists[l].commands.size(); ++i)
+            reference.push_back({ bucket.lists[l].commands[i].sortKey, l, i });
+    std::stable_sort(reference.begin(), reference.end(), [](const DrawSortEntry& a, const DrawSortEntry& b) {
+        return a.key < b.key;
+    });
+
+    bool same = reference.size() == bucket.sorted.size();
+    for (size_t i = 0; same && i < reference.size(); ++i)
+        same = reference[i].list == bucket.sorted[i].list && reference[i].index == bucket.sorted[i].index;
+
+    Expect(same, "radix order differs from stable_sort");
+
+    // key fields order pass > shader > buffers > depth
+    bool keys = MakeDrawSortKey(1, 0, 0, 0.f) > MakeDrawSortKey(0, 0xFFFF, 0xFFFFF, 1.f) &&
+                MakeDrawSortKey(0, 1, 0, 0.f) > MakeDrawSortKey(0, 0, 0xFFFFF, 1.f) &&
+                MakeDrawSortKey(0, 0, 1, 0.f) > MakeDrawSortKey(0, 0, 0, 1.f) &&
+                MakeDrawSortKey(0, 0, 0, 0.5f) > MakeDrawSortKey(0, 0, 0, 0.25f);
+    Expect(keys, "sort key field order wrong");
+
+    // six draws over two shaders and two meshes, recorded out of order on two
+    // lists: repeats of the previous draw's state must not reach the device
+    auto handle = [](uintptr_t id) { return reinterpret_cast<RenderHandle>(id); };
+
+    DrawCommand base      = {};
+    base.inputLayout      = handle(0x10);
+    base.vertexShader     = handle(0x20);
+    base.pixelShader      = handle(0x30);
+    base.constants        = ConstantRange { handle(0x40), 0, 256 };
+    base.indexBuffer      = handle(0x50);
+    base.vertexBuffers[0] = handle(0x60);
+    base.vertexStrides[0] = 20;
+    base.indexCount       = 3;
+
+    DrawCommand draws[6];
+    for (DrawCommand& d : draws)
+        d = base;
+    draws[0].sortKey = MakeDrawSortKey(0, 0, 0, 0.1f);
+    draws[1].sortKey = MakeDrawSortKey(0, 0, 0, 0.2f);   // same state as 0
+    draws[2].sortKey = MakeDrawSortKey(0, 0, 0, 0.3f);   // next constants
+    for (int i = 2; i < 6; ++i)
+        draws[i].constants.offset = 256;
+    for (int i = 3; i < 6; ++i)   // other mesh
+    {
+        draws[i].indexBuffer      = handle(0x51);
+        draws[i].vertexBuffers[0] = handle(0x61);
+    }
+    draws[3].sortKey = MakeDrawSortKey(0, 0, 1, 0.f);
+    for (int i = 4; i < 6; ++i)   // instanced shader, same pixel shader
+    {
+        draws[i].inputLayout      = handle(0x11);
+        draws[i].vertexShader     = handle(0x21);
+        draws[i].vertexBuffers[1] = handle(0x70);
+        draws[i].vertexStrides[1] = 64;
+        draws[i].instanceCount    = 100;
+    }
+    draws[4].sortKey = MakeDrawSortKey(0, 1, 1, 0.f);
+    draws[5].sortKey = MakeDrawSortKey(0, 1, 1, 0.5f);   // same state as 4
+
+    ResetDrawBucket(bucket, 2);
+    for (int i : { 5, 2, 0 })
+        bucket.lists[0].commands.push_back(draws[i]);
+    for (int i : { 3, 1, 4 })
+        bucket.lists[1].commands.push_back(draws[i]);
+    SortDrawBucket(bucket);
+
+    RecordingRenderContext device;
+    SubmitDrawBucket(bucket, device);
+
+    bool skipped = device.inputLayoutSets == 2 && device.vertexBufferSets == 3 && device.indexBufferSets == 2 && device.vertexShaderSets == 2 &&
+                   device.pixelShaderSets == 1 && device.constantRangeSets == 2;
+    bool drawn   = device.draws == 4 && device.instancedDraws == 2;
+    Expect(skipped,
+           "binds: %d layouts, %d vertex buffers, %d index buffers, %d vertex shaders, %d pixel shaders, %d constant ranges",
+           device.inputLayoutSets,
+           device.vertexBufferSets,
+           device.indexBufferSets,
+           device.vertexShaderSets,
+           device.pixelShaderSets,
+           device.constantRangeSets);
+    Expect(drawn, "%d draws and %d instanced draws for 4 and 2 commands", device.draws, device.instancedDraws);
+
+    return same && keys && skipped && drawn;
+}
+
+// Writer publishes a counter with a payload derived from it; the reader must
+// only ever see whole values, in increasing order.
+bool ValidateTripleBuffer()
+{
+    struct Value
+    {
+        uint64_t sequence;
+        uint64_t payload[15];
+    };
+
+    const uint64_t      count = 200000;
+    TripleBuffer<Value> buffer;
+
+    std::thread writer([&]() {
+        for (uint64_t i = 1; i <= count; ++i)
+        {
+            Value& v   = buffer.WriteBuffer();
+            v.sequence = i;
+            for (uint64_t& p : v.payload)
+                p = i * 2654435761u;
+            buffer.Publish();
+        }
+    });
+
+    uint64_t last  = 0;
+    bool     ok    = true;
+    uint64_t reads = 0;
+    while (last < count && ok)
+    {
+        if (!buffer.Update())
+            continue;
+
+        const Value& v = buffer.ReadBuffer();
+        ok             = v.sequence > last;
+        for (uint64_t p : v.payload)
+            ok = ok && p == v.sequence * 2654435761u;
+        last = v.sequence;
+        ++reads;
+    }
+    writer.join();
+
+    return Expect(ok, "torn or out-of-order value after %llu", static_cast<unsigned long long>(last)) && Expect(reads > 0, "nothing read");
+}
+
+// Blocks until the simulation has published `frames` frames since Start.
+void WaitForSimulatedFrames(SimulationThread& sim, uint64_t frames)
+{
+    std::unique_lock<std::mutex> lock(sim.mutex);
+    sim.wake.wait(lock, [&]() { return sim.producedFrame >= frames; });
+}
+
+uint64_t SimulatedFrames(SimulationThread& sim)
+{
+    std::lock_guard<std::mutex> lock(sim.mutex);
+    return sim.producedFrame;
+}
+
+// Steps the simulation thread a known number of fixed-step frames through the
+// frame limit. The newest snapshot wins and the ones it replaced count as
+// skipped, frameLag caps how far ahead it runs, Stop joins, and the snapshot
+// matches the same frames run inline, down to the instance buffer upload.
+bool ValidateSimulationThread()
+{
+    bool ok = true;
+
+    SceneState initial;
+    initial.requestedInstanceCount = 300;
+    initial.instanceExtent         = 2.f;
+
+    bool keys[256] = {};
+    keys['D']      = true;
+    keys[KEY_UP]   = true;
+
+    const float dt = 1.f / 60.f;
+
+    // the same frames inline: the thread applies the initial controls first
+    SceneState reference = initial;
+    ApplySceneControls(reference, GetSceneControls(initial));
+    auto stepReference = [&](uint64_t frames) {
+        for (uint64_t i = 0; i < frames; ++i)
+            UpdateScene(reference, keys, dt);
+    };
+
+    SimulationThread sim;
+    SetSimulationFrameLimit(sim, 0);
+    StartSimulationThread(sim, initial, 256, 8, dt);
+    PostSimulationInput(sim, keys, nullptr);
+
+    // five frames ahead of a renderer that has not looked yet
+    SetSimulationFrameLimit(sim, 5);
+    WaitForSimulatedFrames(sim, 5);
+    const SceneSnapshot* snapshot = &AcquireSimulationSnapshot(sim);
+    ok &= Expect(snapshot->frame == 5 && sim.skippedSnapshots == 0, "first snapshot is frame %llu", static_cast<unsigned long long>(snapshot->frame));
+
+    stepReference(5);
+    SceneSnapshot expected;
+    CaptureSceneSnapshot(reference, 256, expected);
+    ok &= Expect(std::memcmp(&snapshot->constants, &expected.constants, sizeof(ConstantBuffer)) == 0, "fixed-step constants differ from the inline run");
+    ok &= Expect(!snapshot->instances.empty() && snapshot->instances.size() == expected.instances.size() &&
+                     std::memcmp(snapshot->instances.data(), expected.instances.data(), expected.instances.size() * sizeof(InstanceData)) == 0,
+                 "snapshot instances differ from the inline run");
+
+    RecordingRenderContext device;
+    RenderResources        resources;
+    resources.instanceCapacity = 256;
+    resources.instanceBuffer   = device.AddBuffer(256 * sizeof(InstanceData));
+    ok &= Expect(UploadSceneSnapshot(device, resources, *snapshot) &&
+                     std::memcmp(resources.instanceBuffer, snapshot->instances.data(), snapshot->instances.size() * sizeof(InstanceData)) == 0,
+                 "snapshot not handed to the instance buffer");
+
+    // four more; the three the renderer never saw are skipped
+    SetSimulationFrameLimit(sim, 9);
+    WaitForSimulatedFrames(sim, 9);
+    snapshot = &AcquireSimulationSnapshot(sim);
+    ok &= Expect(snapshot->frame == 9 && sim.skippedSnapshots == 3, "frame %llu, %llu skipped", static_cast<unsigned long long>(snapshot->frame), static_cast<unsigned long long>(sim.skippedSnapshots));
+
+    // one frame of lag: at most two past the last one acquired
+    SetSimulationFrameLag(sim, 1);
+    SetSimulationFrameLimit(sim, 100);
+    WaitForSimulatedFrames(sim, 11);
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    ok &= Expect(SimulatedFrames(sim) == 11, "ran %llu frames past a lag of 1", static_cast<unsigned long long>(SimulatedFrames(sim) - 9));
+
+    SetSimulationFrameLimit(sim, 12);
+    snapshot = &AcquireSimulationSnapshot(sim);
+    ok &= Expect(snapshot->frame == 11 && sim.skippedSnapshots == 4, "lagged snapshot is frame %llu", static_cast<unsigned long long>(snapshot->frame));
+
+    // no lag: the renderer waits for the next frame, and the simulation gets
+    // one ahead of it at most
+    SetSimulationFrameLag(sim, 0);
+    snapshot = &AcquireSimulationSnapshot(sim);
+    ok &= Expect(snapshot->frame == 12 && sim.skippedSnapshots == 4, "lockstep snapshot is frame %llu", static_cast<unsigned long long>(snapshot->frame));
+
+    stepReference(7);
+    CaptureSceneSnapshot(reference, 256, expected);
+    ok &= Expect(std::memcmp(&snapshot->constants, &expected.constants, sizeof(ConstantBuffer)) == 0, "constants after 12 frames differ");
+
+    SetSimulationFrameLimit(sim, 100);
+    WaitForSimulatedFrames(sim, 13);
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    ok &= Expect(SimulatedFrames(sim) == 13, "ran %llu frames past a lag of 0", static_cast<unsigned long long>(SimulatedFrames(sim) - 12));
+
+    StopSimulationThread(sim);
+    stepReference(1);
+    ok &= Expect(!IsSimulationRunning(sim) && !sim.thread.joinable(), "stop did not join");
+    ok &= Expect(SimulatedFrames(sim) == 13 && HashSceneState(sim.scene) == HashSceneState(reference), "final state differs from 13 inline frames");
+    return ok;
+}
+
+// Corners of the rect as BatchQuad indexes them.
+void AppendRectPositions(std::vector<float>& out, float x, float y, float w, float h)
+{
+    float corners[4][2] = { { x, y }, { x + w, y }, { x + w, y + h }, { x, y + h } };
+    for (int corner : { 0, 1, 2, 0, 2, 3 })
+        out.insert(out.end(), corners[corner], corners[corner] + 2);
+}
+
+// Sum of |area| over the drawn triangles; false if any is degenerate or wound
+// against the polygon.
+bool CheckPolygonTriangles(const std::vector<float>& xy, float winding, float& areaSum)
+{
+    areaSum = 0.f;
+    for (size_t t = 0; t + 6 <= xy.size(); t += 6)
+    {
+        float area = 0.5f * ((xy[t + 2] - xy[t]) * (xy[t + 5] - xy[t + 1]) - (xy[t + 3] - xy[t + 1]) * (xy[t + 4] - xy[t]));
+        if (area * winding <= 0.f)
+            return false;
+        areaSum += std::fabs(area);
+    }
+    return true;
+}
+
+// Shapes must come out of the draws exactly as submitted, across ring wraps
+// and state changes, in as few draws as the rings allow.
+bool ValidatePrimitiveBatcher()
+{
+    bool ok = true;
+
+    // ring allocator: discard at the front, no-overwrite behind it
+    RingAllocator ring;
+    uint32_t      offset = 0;
+    ring.capacity        = 100;
+    ok &= Expect(RingAllocate(ring, 40, offset) == MapMode::WriteDiscard && offset == 0, "first allocation not a discard at 0");
+    ok &= Expect(RingAllocate(ring, 40, offset) == MapMode::WriteNoOverwrite && offset == 40, "second allocation not appended");
+    ok &= Expect(RingAllocate(ring, 40, offset) == MapMode::WriteDiscard && offset == 0 && ring.wraps == 1, "full ring did not wrap");
+    ok &= Expect(RingAllocate(ring, 60, offset) == MapMode::WriteNoOverwrite && offset == 40 && ring.head == 100, "exact fit wrapped");
+    ok &= Expect(RingAllocate(ring, 1, offset) == MapMode::WriteDiscard && ring.wraps == 2, "allocation past the end did not wrap");
+
+    // 16 quads fill both rings exactly
+    RecordingRenderContext device;
+    device.resolveDraws = true;
+    RenderHandle vb     = device.AddBuffer(64 * sizeof(BatchVertex));
+    RenderHandle ib     = device.AddBuffer(96 * sizeof(uint32_t));
+
+    PrimitiveBatcher batcher;
+    InitPrimitiveBatcher(batcher, &device, vb, 64, ib, 96);
+
+    const float        white[3] = { 1.f, 1.f, 1.f };
+    std::vector<float> expected;
+    for (int i = 0; i < 100; ++i)
+    {
+        BatchRect(batcher, static_cast<float>(i), static_cast<float>(2 * i), 1.f, 1.f, white);
+        AppendRectPositions(expected, static_cast<float>(i), static_cast<float>(2 * i), 1.f, 1.f);
+    }
+    FlushBatcher(batcher);
+
+    ok &= Expect(device.drawnPositions == expected, "rects drawn differ from rects batched");
+    ok &= Expect(device.draws == 7 && batcher.frame.draws == 7 && batcher.frame.ringFlushes == 6, "rects not batched up to ring size");
+    ok &= Expect(batcher.vertexRing.wraps == 6 && batcher.frame.discards == 14, "ring wraps not discarded");
+
+    // topology and constant buffer changes end a batch, repeats don't;
+    // the rest of the ring is appended to without discarding
+    device.drawnPositions.clear();
+    device.drawTopologies.clear();
+    device.mapModes.clear();
+    device.draws = 0;
+    batcher.frame = {};
+
+    RenderHandle cbA  = reinterpret_cast<RenderHandle>(0x10);
+    RenderHandle cbB  = reinterpret_cast<RenderHandle>(0x20);
+    BatchVertex  p[4] = { { 0.f, 0.f, 1.f, 0.f, 0.f }, { 1.f, 0.f, 0.f, 1.f, 0.f }, { 1.f, 1.f, 0.f, 0.f, 1.f }, { 0.f, 1.f, 1.f, 1.f, 1.f } };
+
+    SetBatchConstantBuffer(batcher, cbA);
+    BatchTriangle(batcher, p[0], p[1], p[2]);
+    BatchTriangle(batcher, p[0], p[2], p[3]);
+    BatchLine(batcher, p[0], p[1]);
+    SetBatchConstantBuffer(batcher, cbA);
+    BatchLine(batcher, p[1], p[2]);
+    SetBatchConstantBuffer(batcher, cbB);
+    BatchLine(batcher, p[2], p[3]);
+    BatchTriangle(batcher, p[3], p[2], p[1]);
+    EndBatcherFrame(batcher);
+
+    expected.clear();
+    for (int v : { 0, 1, 2, 0, 2, 3, 0, 1, 1, 2, 2, 3, 3, 2, 1 })
+        expected.insert(expected.end(), { p[v].x, p[v].y });
+
+    std::vector<PrimitiveTopology> topologies = { PrimitiveTopology::TriangleList, PrimitiveTopology::LineList, PrimitiveTopology::LineList, PrimitiveTopology::TriangleList };
+    ok &= Expect(device.drawnPositions == expected, "mixed shapes drawn out of order");
+    ok &= Expect(device.drawTopologies == topologies && batcher.total.stateFlushes == 3, "state changes not flushed exactly once each");
+    ok &= Expect(std::count(device.mapModes.begin(), device.mapModes.end(), MapMode::WriteDiscard) == 0, "partly used ring discarded");
+
+    // ear clipping: concave and star outlines, both windings, cover the polygon exactly
+    const float lShape[] = { 0.f, 0.f, 4.f, 0.f, 4.f, 1.f, 1.f, 1.f, 1.f, 3.f, 0.f, 3.f };
+    float       star[20];
+    for (int i = 0; i < 10; ++i)
+    {
+        float radius    = i & 1 ? 0.4f : 1.f;
+        float angle     = i * 0.6283185f;
+        star[i * 2]     = radius * std::cos(angle);
+        star[i * 2 + 1] = radius * std::sin(angle);
+    }
+
+    struct PolygonCase
+    {
+        const float* xy;
+        uint32_t     count;
+        float        area;
+    };
+    PolygonCase cases[] = { { lShape, 6, 6.f }, { star, 10, 10 * 0.5f * 0.4f * std::sin(0.6283185f) } };
+
+    for (const PolygonCase& polygon : cases)
+    {
+        for (float winding : { 1.f, -1.f })
+        {
+            std::vector<float> xy(polygon.xy, polygon.xy + polygon.count * 2);
+            if (winding < 0.f)
+            {
+                for (uint32_t i = 0; i < polygon.count / 2; ++i)
+                {
+                    std::swap(xy[i * 2], xy[(polygon.count - 1 - i) * 2]);
+                    std::swap(xy[i * 2 + 1], xy[(polygon.count - 1 - i) * 2 + 1]);
+                }
+            }
+
+            device.drawnPositions.clear();
+            BatchPolygon(batcher, xy.data(), polygon.count, white);
+            FlushBatcher(batcher);
+
+            float area  = 0.f;
+            bool  wound = CheckPolygonTriangles(device.drawnPositions, winding, area);
+            ok &= Expect(device.drawnPositions.size() == (polygon.count - 2) * 6, "polygon triangle count wrong");
+            ok &= Expect(wound && std::fabs(area - polygon.area) < 1e-4f, "polygon triangulation does not cover the outline");
+        }
+    }
+
+    // larger than the ring: dropped, not split
+    std::vector<float> big(2 * 100);
+    for (int i = 0; i < 100; ++i)
+    {
+        big[i * 2]     = std::cos(i * 0.0628f);
+        big[i * 2 + 1] = std::sin(i * 0.0628f);
+    }
+    ok &= Expect(!BatchPolygon(batcher, big.data(), 100, white) && batcher.frame.droppedShapes == 1, "oversized polygon not dropped");
+
+    // the overlay binds its own target and size, whatever the scene left bound
+    RenderResources overlay;
+    overlay.overlayConstantBuffer = device.AddBuffer(sizeof(ConstantBuffer));
+    overlay.renderTargetView      = reinterpret_cast<RenderHandle>(0x30);
+    overlay.viewport              = RenderViewport { 0.f, 0.f, 640.f, 480.f, 0.f, 1.f };
+    device.SetRenderTarget(reinterpret_cast<RenderHandle>(0x40));
+    device.SetViewport(RenderViewport { 0.f, 0.f, 320.f, 240.f, 0.f, 1.f });
+
+    const float frameTimesMs[2] = { 10.f, 20.f };
+    RenderDebugOverlay(batcher, overlay, ConstantRange {}, p, 4, frameTimesMs, 2);
+    EndBatcherFrame(batcher);
+    ok &= Expect(device.lastRenderTarget == overlay.renderTargetView && device.lastViewport.width == 640.f && device.lastViewport.height == 480.f,
+                 "overlay drawn to the target and viewport left bound");
+
+    return ok;
+}
+
+// Every half must survive float -> half unchanged, and every midpoint between
+// neighbours must round to the even one; all paths must match the scalar bytes.
+bool ValidateVertexFormats()
+{
+    std::vector<float>    halfInputs;
+    std::vector<uint16_t> halfExpected;
+    for (uint32_t h = 0; h < 0x10000; ++h)
+    {
+        uint32_t magnitude = h & 0x7FFF;
+        if (magnitude > 0x7C00)
+            continue;   // NaN
+
+        halfInputs.push_back(HalfToFloat(static_cast<uint16_t>(h)));
+        halfExpected.push_back(static_cast<uint16_t>(h));
+
+        if (magnitude < 0x7BFF)
+        {
+            float    mid  = (HalfToFloat(static_cast<uint16_t>(h)) + HalfToFloat(static_cast<uint16_t>(h + 1))) * 0.5f;
+            uint16_t even = static_cast<uint16_t>(h & 1 ? h + 1 : h);
+            halfInputs.push_back(mid);
+            halfExpected.push_back(even);
+            halfInputs.push_back(std::nextafter(mid, 0.f));
+            halfExpected.push_back(static_cast<uint16_t>(h));
+            halfInputs.push_back(std::nextafter(mid, mid * 2.f));
+            halfExpected.push_back(static_cast<uint16_t>(h + 1));
+        }
+    }
+
+    // the midpoint between the largest half and the next exponent rounds to infinity
+    for (float sign : { 1.f, -1.f })
+    {
+        halfInputs.insert(halfInputs.end(), { sign * 65520.f, sign * std::nextafter(65520.f, 0.f) });
+        halfExpected.insert(halfExpected.end(), { static_cast<uint16_t>(sign > 0.f ? 0x7C00 : 0xFC00), static_cast<uint16_t>(sign > 0.f ? 0x7BFF : 0xFBFF) });
+    }
+
+    std::mt19937                          rng(12);
+    std::uniform_real_distribution<float> wide(-2.f, 2.f);
+    std::uniform_real_distribution<float> color(-0.25f, 1.25f);
+    const size_t                          vertexCount = 10007;   // odd, so every path runs its tail
+    std::vector<float>                    vertices(vertexCount * 5);
+    for (size_t i = 0; i < vertexCount; ++i)
+    {
+        vertices[i * 5]     = wide(rng);
+        vertices[i * 5 + 1] = wide(rng) * 0.5f;
+        vertices[i * 5 + 2] = color(rng);
+        vertices[i * 5 + 3] = color(rng);
+        vertices[i * 5 + 4] = color(rng);
+    }
+    vertices[7] = std::nanf("");
+
+    bool ok = true;
+    for (VertexPackPath path : kVertexPackPaths)
+    {
+        if (!IsVertexPackPathSupported(path))
+            continue;
+
+        std::vector<uint16_t> halves(halfInputs.size());
+        FloatToHalf(path, halfInputs.data(), halfInputs.size(), halves.data());
+        bool halfExact = halves == halfExpected;
+
+        // snorm16 / unorm8: round to nearest, within half a step of the clamped input
+        std::vector<int16_t> snorm(vertices.size());
+        std::vector<uint8_t> unorm(vertices.size());
+        FloatToSnorm16(path, vertices.data(), vertices.size(), snorm.data());
+        FloatToUnorm8(path, vertices.data(), vertices.size(), unorm.data());
+
+        float snormError = 0.f;
+        float unormError = 0.f;
+        for (size_t i = 0; i < vertices.size(); ++i)
+        {
+            float x    = vertices[i] == vertices[i] ? vertices[i] : 0.f;
+            snormError = std::max(snormError, std::fabs(Snorm16ToFloat(snorm[i]) - std::clamp(x, -1.f, 1.f)));
+            unormError = std::max(unormError, std::fabs(Unorm8ToFloat(unorm[i]) - std::clamp(x, 0.f, 1.f)));
+        }
+        bool rounded = snormError <= 0.5f / 32767.f + 1e-7f && unormError <= 0.5f / 255.f + 1e-7f;
+
+        bool sameAsScalar = true;
+        for (VertexFormat format : { VertexFormat::Half, VertexFormat::Snorm16 })
+        {
+            std::vector<uint8_t> packed(vertexCount * 8);
+            std::vector<uint8_t> reference(vertexCount * 8);
+            PackVertices(path, format, vertices.data(), vertexCount, packed.data());
+            PackVertices(VertexPackPath::Scalar, format, vertices.data(), vertexCount, reference.data());
+            sameAsScalar &= packed == reference;
+        }
+
+        bool valid = halfExact && rounded && sameAsScalar;
+        std::printf("vertex validate   %-6s  halves exact: %s  snorm err %.2e  unorm err %.2e  same as scalar: %s  %s\n",
+                    VertexPackPathName(path),
+                    halfExact ? "yes" : "no",
+                    snormError,
+                    unormError,
+                    sameAsScalar ? "yes" : "no",
+                    valid ? "ok" : "FAIL");
+        ok &= Expect(valid, "%s path wrong", VertexPackPathName(path));
+    }
+
+    // packed vertices decode back to the source
+    std::vector<uint8_t> packed(vertexCount * 8);
+    PackVertices(VertexFormat::Half, vertices.data(), vertexCount, packed.data());
+    bool decoded = true;
+    for (size_t i = 2; i < vertexCount; ++i)   // vertex 1 holds the NaN
+    {
+        uint16_t position[2];
+        std::memcpy(position, &packed[i * 8], sizeof(position));
+        uint8_t red = static_cast<uint8_t>(std::lrint(std::clamp(vertices[i * 5 + 2], 0.f, 1.f) * 255.f));
+        decoded &= std::fabs(HalfToFloat(position[0]) - vertices[i * 5]) <= std::fabs(vertices[i * 5]) * (1.f / 2048.f) + 1e-7f;
+        decoded &= packed[i * 8 + 4] == red && packed[i * 8 + 7] == 255;
+    }
+
+    Expect(decoded, "packed vertices do not decode to the source");
+
+    // the color element ends the vertex
+    bool layouts = true;
+    for (uint32_t f = 0; f < static_cast<uint32_t>(VertexFormat::Count); ++f)
+    {
+        const VertexLayout&  layout = GetVertexLayout(static_cast<VertexFormat>(f));
+        const VertexElement& last   = layout.elements[layout.elementCount - 1];
+        layouts &= layout.format == static_cast<VertexFormat>(f) && last.offset + (last.format == VertexElementFormat::Float3 ? 12u : 4u) == layout.stride;
+    }
+    Expect(layouts, "layout stride does not match its elements");
+
+    uint32_t indices[4] = { 0, 1, 65535, 2 };
+    uint16_t narrow[4];
+    PackIndices(indices, 4, SelectIndexFormat(65536), narrow);
+    bool indexWidth = SelectIndexFormat(65536) == IndexFormat::UInt16 && SelectIndexFormat(65537) == IndexFormat::UInt32 && narrow[2] == 65535 && narrow[3] == 2;
+
+    Expect(indexWidth, "index width selection wrong");
+    return ok && decoded && layouts && indexWidth;
+}
+
+void FlipFileByte(const char* path, long offset)
+{
+    FILE* file = std::fopen(path, "r+b");
+    std::fseek(file, offset, SEEK_SET);
+    int byte = std::fgetc(file);
+    std::fseek(file, offset, SEEK_SET);
+    std::fputc(byte ^ 0x01, file);
+    std::fclose(file);
+}
+
+// Round trip through the container, the streaming reader, corruption and the
+// OBJ reader.
+bool ValidateMeshFile()
+{
+    const char* path = "mesh_validate.mesh";
+    const char* obj  = "mesh_validate.obj";
+
+    std::mt19937                          rng(13);
+    std::uniform_real_distribution<float> unit(-1.f, 1.f);
+
+    bool ok = true;
+    for (size_t vertexCount : { size_t(1000), size_t(70000) })
+    {
+        std::vector<float>    vertices(vertexCount * 5);
+        std::vector<uint32_t> indices(vertexCount * 3 + 1);   // odd, so the index blob ends unpadded
+        for (float& v : vertices)
+            v = unit(rng);
+        for (size_t i = 0; i < indices.size(); ++i)
+            indices[i] = static_cast<uint32_t>(rng() % vertexCount);
+
+        for (uint32_t f = 0; f < static_cast<uint32_t>(VertexFormat::Count); ++f)
+        {
+            VertexFormat         format = static_cast<VertexFormat>(f);
+            IndexFormat          width  = SelectIndexFormat(vertexCount);
+            std::vector<uint8_t> packedVertices(vertexCount * GetVertexLayout(format).stride);
+            std::vector<uint8_t> packedIndices(indices.size() * IndexFormatSize(width));
+            PackVertices(format, vertices.data(), vertexCount, packedVertices.data());
+            PackIndices(indices.data(), indices.size(), width, packedIndices.data());
+
+            ok &= Expect(WriteMeshFile(path, format, vertices.data(), vertexCount, indices.data(), indices.size()), "write failed");
+
+            MeshView mesh;
+            ok &= Expect(OpenMeshFile(mesh, path, true), "written file rejected");
+            ok &= Expect(mesh.vertexFormat == format && mesh.indexFormat == width && mesh.header.vertexCount == vertexCount && mesh.header.indexCount == indices.size(), "header does not match the source");
+            ok &= Expect(reinterpret_cast<uintptr_t>(mesh.vertices) % kMeshBlobAlignment == 0 && reinterpret_cast<uintptr_t>(mesh.indices) % kMeshBlobAlignment == 0, "mapped blobs not aligned");
+            ok &= Expect(mesh.vertexBytes == packedVertices.size() && std::memcmp(mesh.vertices, packedVertices.data(), mesh.vertexBytes) == 0, "mapped vertices differ from PackVertices");
+            ok &= Expect(mesh.indexBytes == packedIndices.size() && std::memcmp(mesh.indices, packedIndices.data(), mesh.indexBytes) == 0, "mapped indices differ from PackIndices");
+            ok &= Expect(mesh.header.boundsMin[0] >= -1.f && mesh.header.boundsMax[1] <= 1.f && mesh.header.boundsMin[0] < mesh.header.boundsMax[0], "bounds wrong");
+
+            // streamed ranges match the mapping; a scratch smaller than the data forces several chunks
+            MeshStreamReader     reader;
+            std::vector<uint8_t> chunk(packedVertices.size());
+            ok &= Expect(OpenMeshStream(reader, path), "stream open failed");
+            ok &= Expect(ReadMeshVertices(reader, 10, 100, chunk.data()) && std::memcmp(chunk.data(), packedVertices.data() + 10 * mesh.header.vertexStride, 100 * mesh.header.vertexStride) == 0, "streamed vertices differ");
+            ok &= Expect(ReadMeshIndices(reader, indices.size() - 5, 5, chunk.data()) && std::memcmp(chunk.data(), packedIndices.data() + (indices.size() - 5) * IndexFormatSize(width), 5 * IndexFormatSize(width)) == 0, "streamed indices differ");
+            ok &= Expect(!ReadMeshVertices(reader, vertexCount - 1, 2, chunk.data()) && !ReadMeshIndices(reader, indices.size() + 1, 0, chunk.data()), "out of range read accepted");
+            ok &= Expect(VerifyMeshStream(reader, chunk.data(), 3 * kMeshBlobAlignment), "streamed checksum mismatch");
+            CloseMeshStream(reader);
+            CloseMeshFile(mesh);
+        }
+    }
+
+    // one flipped bit in the data: the cheap open still maps it, verification catches it
+    uint32_t triangle[3] = { 0, 1, 2 };
+    float    corners[15] = { -0.5f, 0.f, 1.f, 0.f, 0.f, 0.f, 0.5f, 0.f, 0.f, 1.f, 0.5f, 0.f, 0.f, 1.f, 0.f };
+    WriteMeshFile(path, VertexFormat::Float32, corners, 3, triangle, 3);
+    FlipFileByte(path, sizeof(MeshFileHeader) + 4);
+    {
+        MeshView             mesh;
+        MeshStreamReader     reader;
+        std::vector<uint8_t> scratch(1024);
+        ok &= Expect(OpenMeshFile(mesh, path, false), "unverified open rejected intact header");
+        ok &= Expect(!OpenMeshFile(mesh, path, true), "corrupt data accepted");
+        ok &= Expect(OpenMeshStream(reader, path) && !VerifyMeshStream(reader, scratch.data(), scratch.size()), "corrupt data streamed as intact");
+        CloseMeshStream(reader);
+        CloseMeshFile(mesh);
+    }
+
+    // header corruption and truncation fail the open itself
+    WriteMeshFile(path, VertexFormat::Float32, corners, 3, triangle, 3);
+    FlipFileByte(path, offsetof(MeshFileHeader, vertexCount));
+    {
+        MeshView         mesh;
+        MeshStreamReader reader;
+        ok &= Expect(!OpenMeshFile(mesh, path, false) && !OpenMeshStream(reader, path), "corrupt header accepted");
+    }
+    WriteMeshFile(path, VertexFormat::Float32, corners, 3, triangle, 3);
+    std::filesystem::resize_file(path, sizeof(MeshFileHeader) + 32);
+    {
+        MeshView         mesh;
+        MeshStreamReader reader;
+        ok &= Expect(!OpenMeshFile(mesh, path, false) && !OpenMeshStream(reader, path), "truncated file accepted");
+    }
+
+    // OBJ: colors, a quad, negative indices, texture/normal references, CRLF
+    {
+        FILE* file = std::fopen(obj, "wb");
+        std::fputs("# test\r\nv 0 0 0 1 0 0\r\nv 1 0 0\r\nv 1 1 0.5 0 0 1\r\nv 0 1 0\r\nvt 0 0\r\nf 1/1 2/1 3/1 4/1\r\nf -4//1 -2//1 -1//1\r\n", file);
+        std::fclose(file);
+
+        ObjMesh parsed;
+        ok &= Expect(LoadObjMesh(obj, parsed), "obj rejected");
+
+        std::vector<float>    expectedVertices = { 0, 0, 1, 0, 0, 1, 0, 1, 1, 1, 1, 1, 0, 0, 1, 0, 1, 1, 1, 1 };
+        std::vector<float>    expectedZ        = { 0, 0, 0.5f, 0 };
+        std::vector<uint32_t> expectedIndices  = { 0, 1, 2, 0, 2, 3, 0, 2, 3 };
+        ok &= Expect(parsed.vertices == expectedVertices && parsed.z == expectedZ && parsed.indices == expectedIndices, "obj parsed wrong");
+
+        file = std::fopen(obj, "wb");
+        std::fputs("v 0 0 0\nf 1 2 3\n", file);
+        std::fclose(file);
+        ok &= Expect(!LoadObjMesh(obj, parsed), "obj face past the vertices accepted");
+    }
+
+    std::remove(path);
+    std::remove(obj);
+    return ok;
+}
+
+// Same triangles (corner order kept), any order.
+bool SameTriangles(const std::vector<uint32_t>& a, const std::vector<uint32_t>& b)
+{
+    std::vector<std::array<uint32_t, 3>> x(a.size() / 3);
+    std::vector<std::array<uint32_t, 3>> y(b.size() / 3);
+    std::memcpy(x.data(), a.data(), x.size() * 12);
+    std::memcpy(y.data(), b.data(), y.size() * 12);
+    std::sort(x.begin(), x.end());
+    std::sort(y.begin(), y.end());
+    return a.size() == b.size() && x == y;
+}
+
+bool ValidateMeshOptimizer()
+{
+    bool ok = true;
+
+    uint32_t         single[6] = { 0, 1, 2, 2, 1, 3 };
+    VertexCacheStats one       = AnalyzeVertexCache(single, 3, 4, 16);
+    VertexCacheStats two       = AnalyzeVertexCache(single, 6, 4, 16);
+    ok &= Expect(one.acmr == 3.0 && one.atvr == 1.0 && two.acmr == 2.0 && two.atvr == 1.0, "cache analysis of a quad wrong");
+
+    std::vector<float>    positions;
+    std::vector<uint32_t> indices;
+    AppendSphere(positions, indices, 60, 80, 1.f);
+    size_t vertexCount = positions.size() / 3;
+    ShuffleTriangles(indices, 5);
+
+    std::vector<uint32_t> cacheOrder(indices.size());
+    std::vector<uint32_t> again(indices.size());
+    OptimizeVertexCache(cacheOrder.data(), indices.data(), indices.size(), vertexCount);
+    OptimizeVertexCache(again.data(), indices.data(), indices.size(), vertexCount);
+
+    VertexCacheStats shuffled  = AnalyzeVertexCache(indices.data(), indices.size(), vertexCount, 16);
+    VertexCacheStats optimized = AnalyzeVertexCache(cacheOrder.data(), cacheOrder.size(), vertexCount, 16);
+    ok &= Expect(SameTriangles(indices, cacheOrder), "vertex cache pass changed the triangles");
+    ok &= Expect(cacheOrder == again, "vertex cache pass not deterministic");
+    ok &= Expect(shuffled.acmr > 2.5 && optimized.acmr < 0.8, "vertex cache pass did not reach a grid-like ACMR");
+
+    std::vector<uint32_t> overdrawOrder(indices.size());
+    OptimizeOverdraw(overdrawOrder.data(), cacheOrder.data(), cacheOrder.size(), positions.data(), vertexCount, 3, 1.05f);
+    VertexCacheStats afterOverdraw = AnalyzeVertexCache(overdrawOrder.data(), overdrawOrder.size(), vertexCount, 16);
+    ok &= Expect(SameTriangles(indices, overdrawOrder), "overdraw pass changed the triangles");
+    ok &= Expect(afterOverdraw.acmr <= optimized.acmr * 1.1, "overdraw pass gave up too much cache efficiency");
+
+    // a small sphere inside a big one, inner drawn first: outside-in order hides it
+    std::vector<float>    nested;
+    std::vector<uint32_t> nestedIndices;
+    AppendSphere(nested, nestedIndices, 20, 24, 0.5f);
+    AppendSphere(nested, nestedIndices, 20, 24, 1.f);
+    size_t                nestedCount = nested.size() / 3;
+    std::vector<uint32_t> nestedCache(nestedIndices.size());
+    std::vector<uint32_t> nestedOrder(nestedIndices.size());
+    OptimizeVertexCache(nestedCache.data(), nestedIndices.data(), nestedIndices.size(), nestedCount);
+    OptimizeOverdraw(nestedOrder.data(), nestedCache.data(), nestedCache.size(), nested.data(), nestedCount, 3, 1.05f);
+    OverdrawStats insideOut = AnalyzeOverdraw(nestedIndices.data(), nestedIndices.size(), nested.data(), nestedCount, 3);
+    OverdrawStats outsideIn = AnalyzeOverdraw(nestedOrder.data(), nestedOrder.size(), nested.data(), nestedCount, 3);
+    ok &= Expect(SameTriangles(nestedIndices, nestedOrder), "overdraw pass changed nested triangles");
+    ok &= Expect(insideOut.covered == outsideIn.covered && outsideIn.overdraw < insideOut.overdraw, "overdraw pass did not reduce overdraw");
+
+    // fetch: first-use numbering, unreferenced vertices dropped, same positions drawn
+    positions.insert(positions.end(), { 9.f, 9.f, 9.f });
+    std::vector<uint32_t> remapped = overdrawOrder;
+    std::vector<float>    fetchOrder(positions.size());
+    size_t                used = OptimizeVertexFetch(fetchOrder.data(), remapped.data(), remapped.size(), positions.data(), vertexCount + 1, 3 * sizeof(float));
+
+    bool     sameCorners = used == vertexCount;
+    uint32_t next        = 0;
+    for (size_t i = 0; i < remapped.size(); ++i)
+    {
+        sameCorners &= std::memcmp(&fetchOrder[remapped[i] * 3], &positions[overdrawOrder[i] * 3], 3 * sizeof(float)) == 0;
+        sameCorners &= remapped[i] <= next;
+        next = std::max(next, remapped[i] + 1);
+    }
+    ok &= Expect(sameCorners, "fetch remap does not draw the same corners in first-use order");
+    return ok;
+}
+
+// Box of half size `half` around a random center in [-range, range]².
+SpatialRect RandomSpatialRect(std::mt19937& rng, float range, float half)
+{
+    std::uniform_real_distribution<float> center(-range, range);
+    std::uniform_real_distribution<float> size(0.f, half);
+
+    float x = center(rng);
+    float y = center(rng);
+    float w = size(rng);
+    float h = size(rng);
+    return SpatialRect { x - w, y - h, x + w, y + h };
+}
+
+bool ValidateSpatialGrid()
+{
+    bool ok = true;
+
+    // random inserts, moves (within and across cells, some off the grid) and
+    // removes, checked against a linear scan after every batch
+    SpatialGrid grid;
+    InitSpatialGrid(grid, SpatialRect { -1.f, -1.f, 1.f, 1.f }, 0.1f);
+
+    const uint32_t           idCount = 2000;
+    std::vector<SpatialRect> bounds(idCount);
+    std::vector<bool>        present(idCount, false);
+    std::mt19937             rng(11);
+
+    std::vector<uint32_t> found;
+    std::vector<uint32_t> expected;
+    for (int round = 0; round < 20 && ok; ++round)
+    {
+        for (int op = 0; op < 1000; ++op)
+        {
+            uint32_t id = rng() % idCount;
+            if (rng() % 8 == 0)
+            {
+                RemoveSpatialEntry(grid, id);
+                present[id] = false;
+            }
+            else
+            {
+                bounds[id]  = RandomSpatialRect(rng, 1.3f, 0.06f);
+                present[id] = true;
+                SetSpatialEntry(grid, id, bounds[id]);
+            }
+        }
+
+        size_t live = std::count(present.begin(), present.end(), true);
+        ok &= Expect(grid.entryCount == live, "entry count wrong");
+
+        for (int query = 0; query < 50 && ok; ++query)
+        {
+            SpatialRect rect = RandomSpatialRect(rng, 1.2f, query % 2 ? 0.9f : 0.1f);
+            expected.clear();
+            for (uint32_t id = 0; id < idCount; ++id)
+            {
+                const SpatialRect& b = bounds[id];
+                if (present[id] && b.maxX >= rect.minX && b.minX <= rect.maxX && b.maxY >= rect.minY && b.minY <= rect.maxY)
+                    expected.push_back(id);
+            }
+
+            CullSpatialGrid(grid, rect, found);
+            ok &= Expect(found == expected, "cull differs from a linear scan");
+
+            found.clear();
+            QuerySpatialRect(grid, rect, found);
+            std::sort(found.begin(), found.end());
+            ok &= Expect(found == expected, "rect query differs from a linear scan");
+
+            // point query and pick at the rect's corner
+            float x = rect.minX;
+            float y = rect.minY;
+            expected.clear();
+            for (uint32_t id = 0; id < idCount; ++id)
+            {
+                const SpatialRect& b = bounds[id];
+                if (present[id] && b.minX <= x && x <= b.maxX && b.minY <= y && y <= b.maxY)
+                    expected.push_back(id);
+            }
+
+            found.clear();
+            QuerySpatialPoint(grid, x, y, found);
+            std::sort(found.begin(), found.end());
+            ok &= Expect(found == expected, "point query differs from a linear scan");
+
+            uint32_t picked = 0;
+            bool     hit    = PickSpatialPoint(grid, x, y, picked);
+            ok &= Expect(hit == !expected.empty() && (!hit || picked == expected.back()), "pick is not the topmost entry");
+        }
+    }
+
+    ClearSpatialGrid(grid);
+    CullSpatialGrid(grid, SpatialRect { -2.f, -2.f, 2.f, 2.f }, found);
+    ok &= Expect(found.empty() && grid.entryCount == 0 && !HasSpatialEntry(grid, 0), "clear left entries behind");
+
+    // indexed packing matches packing the same instances one by one
+    InstanceTransforms transforms;
+    LayoutInstanceGrid(transforms, 1000, 1.f);
+
+    std::vector<uint32_t> subset;
+    for (uint32_t i = 0; i < 1000; i += 3)
+        subset.push_back(i);
+
+    std::vector<InstanceData> gathered(subset.size());
+    PackInstancesIndexed(transforms, subset.data(), subset.size(), gathered.data());
+
+    bool samePacking = true;
+    for (size_t i = 0; i < subset.size(); ++i)
+    {
+        InstanceData single;
+        PackInstances(transforms, subset[i], 1, &single);
+        samePacking &= std::memcmp(&single, &gathered[i], sizeof(single)) == 0;
+    }
+    ok &= Expect(samePacking, "indexed packing differs from packing each instance");
+    return ok;
+}
+
+bool ValidateInputEvents()
+{
+    bool ok = true;
+
+    // ring: bounded, FIFO, usable again once drained
+    {
+        auto     queue   = std::make_unique<SpscQueue<uint32_t, 8>>();
+        bool     pushed  = true;
+        uint32_t value   = 0;
+        bool     inOrder = true;
+        for (uint32_t i = 0; i < 8; ++i)
+            pushed &= queue->Push(i);
+        ok &= Expect(pushed && !queue->Push(8), "ring accepted more than its capacity");
+        for (uint32_t i = 0; i < 8; ++i)
+            inOrder &= queue->Pop(value) && value == i;
+        ok &= Expect(inOrder && !queue->Pop(value), "ring not FIFO");
+        for (uint32_t i = 0; i < 20; ++i)
+            inOrder &= queue->Push(i) && queue->Pop(value) && value == i;
+        ok &= Expect(inOrder, "ring broken after wrapping");
+    }
+
+    // cross-thread: every value arrives exactly once and in order
+    {
+        auto           queue    = std::make_unique<SpscQueue<uint64_t, 256>>();
+        const uint64_t count    = 2000000;
+        std::thread    producer([&]() {
+            for (uint64_t i = 0; i < count; ++i)
+            {
+                while (!queue->Push(i))
+                    std::this_thread::yield();
+            }
+        });
+
+        uint64_t expected = 0;
+        uint64_t value    = 0;
+        bool     inOrder  = true;
+        while (expected < count)
+        {
+            if (queue->Pop(value))
+                inOrder &= value == expected++;
+            else
+                std::this_thread::yield();
+        }
+        producer.join();
+        ok &= Expect(inOrder, "cross-thread values lost or reordered");
+    }
+
+    // sub-frame timing over 1000 ns frames
+    auto queue = std::make_unique<InputQueue>();
+
+    InputTracker  tracker;
+    KeyFrameInput frame;
+    InitInputTracker(tracker, 0, 64);
+
+    // held from 250 to 2500: three quarters, all, half
+    queue->Push(InputEvent { 250, 'W', true });
+    ConsumeInputEvents(tracker, *queue, 1000, frame);
+    ok &= Expect(frame.heldFraction['W'] == 0.75f && frame.pressed['W'], "press a quarter into the frame not 0.75 held");
+
+    queue->Push(InputEvent { 1300, 'W', true });   // auto-repeat
+    ConsumeInputEvents(tracker, *queue, 2000, frame);
+    ok &= Expect(frame.heldFraction['W'] == 1.f && !frame.pressed['W'], "held key or auto-repeat wrong");
+
+    queue->Push(InputEvent { 2500, 'W', false });
+    ConsumeInputEvents(tracker, *queue, 3000, frame);
+    ok &= Expect(frame.heldFraction['W'] == 0.5f && !tracker.down['W'], "release half way not 0.5 held");
+
+    // a tap shorter than a frame, and one within a single instant
+    queue->Push(InputEvent { 3100, 'A', true });
+    queue->Push(InputEvent { 3200, 'A', false });
+    queue->Push(InputEvent { 3500, 'D', true });
+    queue->Push(InputEvent { 3500, 'D', false });
+    ConsumeInputEvents(tracker, *queue, 4000, frame);
+
+    bool keys[256];
+    KeysFromFrameInput(frame, keys);
+    ok &= Expect(std::fabs(frame.heldFraction['A'] - 0.1f) < 1e-6f && frame.pressed['A'] && keys['A'], "short tap lost");
+    ok &= Expect(frame.heldFraction['D'] == 0.f && frame.pressed['D'] && keys['D'] && !keys['W'], "instant tap lost");
+
+    // stamps outside the interval are clamped into it
+    queue->Push(InputEvent { 100, 'S', true });
+    queue->Push(InputEvent { 9000, 'S', false });
+    ConsumeInputEvents(tracker, *queue, 5000, frame);
+    ok &= Expect(frame.heldFraction['S'] == 1.f && !tracker.down['S'], "out of interval stamps not clamped");
+
+    // latency: each consumed event against the submit after it
+    RecordInputSubmit(tracker, 1000000);
+    queue->Push(InputEvent { 5500, 'W', true });
+    ConsumeInputEvents(tracker, *queue, 6000, frame);
+    RecordInputSubmit(tracker, 6500);
+    RecordInputSubmit(tracker, 7000);
+
+    FrameTimeStats latency = ComputeFrameTimeStats(tracker.latency);
+    ok &= Expect(tracker.consumed == 10 && latency.samples == 10, "latency not recorded once per event");
+    ok &= Expect(latency.minMs == 1000 / 1e6 && latency.maxMs == (1000000 - 100) / 1e6, "latency not measured to the next submit");
+    return ok;
+}
+
+// Each read costs readNs; sleeps wake on the next tick boundary plus up to
+// jitterNs, like a 1 ms Windows timer.
+struct FakePacerClock : IPacerClock
+{
+    uint64_t     now    = 1000000000;
+    uint64_t     readNs = 50;
+    uint64_t     tickNs = 1000000;
+    uint64_t     jitter = 300000;
+    uint64_t     sleeps = 0;
+    std::mt19937 rng { 21 };
+
+    uint64_t NowNs() override
+    {
+        now += readNs;
+        return now;
+    }
+
+    void SleepNs(uint64_t ns) override
+    {
+        ++sleeps;
+        uint64_t wake = (now + ns + tickNs - 1) / tickNs * tickNs;
+        now           = wake + rng() % jitter;
+    }
+};
+
+bool ValidateFramePacer()
+{
+    bool ok = true;
+
+    // 100 fps with 2 ms of work, then one 50 ms stall
+    FakePacerClock clock;
+    FramePacer     pacer;
+    InitFramePacer(pacer, &clock, 100.0, 2000);
+
+    const uint64_t period  = 10000000;
+    uint64_t       first   = 0;
+    uint64_t       last    = 0;
+    uint64_t       spun    = 0;
+    bool           noBurst = true;
+    for (int frame = 0; frame < 1000; ++frame)
+    {
+        uint64_t start = WaitForNextFrame(pacer);
+        if (frame == 0)
+            first = start;
+        else if (frame == 500)
+            spun = pacer.spunNs;
+        else if (frame > 1)
+            noBurst &= start - last >= period / 2;
+        last = start;
+
+        clock.now += frame == 700 ? 50000000 : 2000000;
+    }
+
+    FrameTimeStats lateness = ComputeFrameTimeStats(pacer.lateness);
+    double         meanMs   = (last - first - 40000000) / 1e6 / 999;   // the stall cost 4 periods
+    ok &= Expect(std::fabs(meanMs - 10.0) < 0.001, "mean interval off the target");
+    ok &= Expect(lateness.p99Ms < 0.001 && lateness.maxMs < 0.5, "frames started late");
+    ok &= Expect(pacer.missedDeadlines == 1 && noBurst, "stall not absorbed by restarting the schedule");
+    ok &= Expect(clock.sleeps == 998, "not one sleep per frame started on schedule");
+    ok &= Expect((pacer.spunNs - spun) / 499 < 1000000, "slack did not settle below a tick of spinning");
+    ok &= Expect(pacer.sleepSlackNs >= clock.jitter, "slack below the clock's oversleep");
+
+    // uncapped: returns straight away
+    FakePacerClock uncappedClock;
+    FramePacer     uncapped;
+    InitFramePacer(uncapped, &uncappedClock, 0.0, 16);
+    for (int frame = 0; frame < 10; ++frame)
+        WaitForNextFrame(uncapped);
+    ok &= Expect(uncappedClock.sleeps == 0 && uncapped.spunNs == 0, "uncapped pacer waited");
+    return ok;
+}
+
+// Feeds `frames` frames of a scene costing fullMs; returns how many changed the size.
+int RunDynamicResolution(DynamicResolution& dr, float fullMs, int frames)
+{
+    int changes = 0;
+    for (int frame = 0; frame < frames; ++frame)
+        changes += UpdateDynamicResolution(dr, ScaledFrameMs(dr, fullMs)) ? 1 : 0;
+    return changes;
+}
+
+bool ValidateDynamicResolution()
+{
+    bool ok = true;
+
+    DynamicResolutionSettings settings;   // 16.67 ms budget, 0.5 to 1 in 0.1 steps
+    DynamicResolution         dr;
+
+    // under budget: stays at full size
+    InitDynamicResolution(dr, settings, 1920, 1080);
+    ok &= Expect(RunDynamicResolution(dr, 10.f, 1000) == 0 && DynamicResolutionScale(dr) == 1.f, "changed size under budget");
+
+    // an isolated spike is outside the p90
+    for (int frame = 0; frame < 64; ++frame)
+        UpdateDynamicResolution(dr, frame % 16 == 7 ? 100.f : 10.f);
+    ok &= Expect(dr.level == 0, "one slow frame per window lowered the size");
+
+    // slightly over: one step, once a full window says so
+    InitDynamicResolution(dr, settings, 1920, 1080);
+    bool early = false;
+    for (int frame = 0; frame < settings.windowFrames - 1; ++frame)
+        early |= UpdateDynamicResolution(dr, 20.f);
+    ok &= Expect(!early && UpdateDynamicResolution(dr, 20.f) && dr.level == 1, "20 ms did not lower one step after one window");
+
+    // settles where it fits and does not oscillate: 18 ms full is 14.6 ms at 0.9,
+    // over budget at 1.0 and without headroom at 0.9
+    InitDynamicResolution(dr, settings, 1920, 1080);
+    RunDynamicResolution(dr, 18.f, 2000);
+    ok &= Expect(dr.level == 1 && dr.lowered == 1 && dr.raised == 0, "oscillated around the budget");
+
+    // far over: straight to the size that fits, then clamped at minScale
+    InitDynamicResolution(dr, settings, 1920, 1080);
+    for (int frame = 0; frame < settings.windowFrames; ++frame)
+        UpdateDynamicResolution(dr, 60.f);
+    ok &= Expect(dr.lowered == 1 && DynamicResolutionScale(dr) == settings.minScale, "60 ms did not jump to minScale in one change");
+    for (int frame = 0; frame < 200; ++frame)
+        UpdateDynamicResolution(dr, 60.f);
+    ok &= Expect(dr.lowered == 1 && DynamicResolutionScale(dr) == settings.minScale, "went below minScale");
+
+    // recovery from minScale: a full window, then raiseDelay headroom frames per step
+    InitDynamicResolution(dr, settings, 1920, 1080);
+    dr.level  = 5;
+    int first = 0;
+    while (!UpdateDynamicResolution(dr, ScaledFrameMs(dr, 10.f)))
+        ++first;
+    ok &= Expect(first + 1 == settings.windowFrames + settings.raiseDelay - 1 && dr.raised == 1, "raised before the delay");
+    RunDynamicResolution(dr, 10.f, 1000);
+    ok &= Expect(dr.level == 0 && dr.raised == 5, "did not climb back to full size");
+
+    // same trace, same sizes
+    std::mt19937              rng(5);
+    std::vector<float>        trace(3000);
+    std::vector<int>          levels[2];
+    for (size_t i = 0; i < trace.size(); ++i)
+        trace[i] = (i / 500 % 2 ? 24.f : 9.f) * (0.8f + 0.4f * (rng() % 1000) / 1000.f);
+    for (std::vector<int>& run : levels)
+    {
+        InitDynamicResolution(dr, settings, 1920, 1080);
+        for (float fullMs : trace)
+        {
+            UpdateDynamicResolution(dr, ScaledFrameMs(dr, fullMs));
+            run.push_back(dr.level);
+        }
+    }
+    ok &= Expect(levels[0] == levels[1] && dr.lowered > 0 && dr.raised > 0, "not deterministic");
+
+    // sizes round to the nearest pixel and never reach zero
+    uint32_t width  = 0;
+    uint32_t height = 0;
+    InitDynamicResolution(dr, settings, 1920, 1080);
+    dr.level = 1;
+    DynamicRenderSize(dr, width, height);
+    ok &= Expect(width == 1728 && height == 972, "0.9 of 1080p");
+    SetDynamicResolutionOutput(dr, 1, 3);
+    dr.level = 5;
+    DynamicRenderSize(dr, width, height);
+    ok &= Expect(width == 1 && height == 2, "tiny output");
+    return ok;
+}
+
+bool ValidateInputCapture()
+{
+    bool ok = true;
+
+    const char* path = "input_capture_validate.bin";
+
+    SceneControls initial;
+    initial.requestedInstanceCount = 100;
+    initial.instanceSpinSpeed      = 2.f;
+
+    // live run, recorded as it goes
+    std::mt19937       rng(17);
+    SceneState         live;
+    InputCaptureWriter writer;
+    ResetCaptureScene(live, initial, 0.75f);
+    ok &= Expect(BeginInputCapture(writer, path, initial, 0.75f), "could not create the capture");
+
+    std::vector<InputCaptureFrame> frames;
+    for (int frame = 0; frame < 1000; ++frame)
+    {
+        frames.push_back(SyntheticCaptureFrame(rng, frame));
+        StepCapturedFrame(live, frames.back());
+        ok &= Expect(WriteInputCaptureFrame(writer, frames.back()), "write failed");
+    }
+    ok &= Expect(EndInputCapture(writer), "end failed");
+
+    // unchanged keys cost only the frame header
+    ok &= Expect(writer.bytes < sizeof(InputCaptureHeader) + frames.size() * 16 + 11 * sizeof(InputCaptureControls), "key changes not delta encoded");
+
+    // replayed twice: same frames, same final state as the live run
+    for (int run = 0; run < 2; ++run)
+    {
+        InputCaptureReader reader;
+        if (!Expect(OpenInputCapture(reader, path), "could not open the capture"))
+            return false;
+
+        SceneState replayed;
+        ResetCaptureScene(replayed, CaptureControlsToScene(reader.header.initial), reader.header.instanceRadius);
+
+        InputCaptureFrame frame;
+        bool              same = reader.header.frameCount == frames.size();
+        for (size_t i = 0; ReadInputCaptureFrame(reader, frame); ++i)
+        {
+            const InputCaptureFrame& expected = frames[i];
+            same &= frame.deltaTime == expected.deltaTime && frame.hasControls == expected.hasControls;
+            same &= std::memcmp(frame.input.heldFraction, expected.input.heldFraction, sizeof(frame.input.heldFraction)) == 0;
+            same &= std::memcmp(frame.input.pressed, expected.input.pressed, sizeof(frame.input.pressed)) == 0;
+            same &= !frame.hasControls || frame.controls.requestedInstanceCount == expected.controls.requestedInstanceCount;
+            StepCapturedFrame(replayed, frame);
+        }
+        ok &= Expect(same && reader.framesRead == frames.size(), "frames differ after the round trip");
+        ok &= Expect(HashSceneState(replayed) == HashSceneState(live), "replay diverged from the live run");
+        CloseInputCapture(reader);
+    }
+
+    // a different run hashes differently (after the last UI edit, which would mask it)
+    SceneState other;
+    ResetCaptureScene(other, initial, 0.75f);
+    for (size_t i = 0; i < frames.size(); ++i)
+        StepCapturedFrame(other, i == 990 ? InputCaptureFrame {} : frames[i]);
+    ok &= Expect(HashSceneState(other) != HashSceneState(live), "hash blind to a dropped frame");
+
+    // truncated: reading stops at the cut instead of running past it
+    std::filesystem::resize_file(path, std::filesystem::file_size(path) - 3);
+    InputCaptureReader truncated;
+    ok &= Expect(OpenInputCapture(truncated, path), "could not open the truncated capture");
+    InputCaptureFrame frame;
+    while (ReadInputCaptureFrame(truncated, frame))
+    {
+    }
+    ok &= Expect(truncated.framesRead == frames.size() - 1, "truncated capture not detected");
+    CloseInputCapture(truncated);
+
+    std::remove(path);
+    return ok;
+}
+
+bool ValidateBenchReport()
+{
+    const char* path = "bench_report_validate.json";
+
+    BenchReport before;
+    AddBenchMetric(before, "a.ms", 1.0, "ms");
+    AddBenchMetric(before, "b.count", 0.0, "count");
+    AddBenchMetric(before, "c.ns", 2.5e-7, "ns");
+    AddBenchMetric(before, "a.ms", 2.0, "ms");
+
+    BenchReport read;
+    bool        roundTrip = WriteBenchReportJSON(before, path) && ReadBenchReportJSON(read, path);
+    std::remove(path);
+    roundTrip = roundTrip && read.metrics.size() == 3 && read.metrics[0].value == 2.0 && read.metrics[2].value == 2.5e-7 && read.metrics[1].unit == "count";
+
+    BenchReport after = before;
+    AddBenchMetric(after, "a.ms", 2.1, "ms");   // within 10%
+    AddBenchMetric(after, "b.count", 1.0, "count");
+    AddBenchMetric(after, "d.ms", 5.0, "ms");   // new, no baseline
+
+    std::vector<BenchRegression> regressions = CompareBenchReports(before, after, 0.1);
+    bool                         compared    = regressions.size() == 1 && regressions[0].name == "b.count";
+
+    AddBenchMetric(after, "a.ms", 2.3, "ms");
+    compared = compared && CompareBenchReports(before, after, 0.1).size() == 2;
+
+    // +40% but under the noise floor, and a baseline below the timer's resolution
+    BenchReport noisyBefore;
+    BenchReport noisyAfter;
+    AddBenchMetric(noisyBefore, "e.ms", 0.02, "ms");
+    AddBenchMetric(noisyBefore, "f.ms", 0.0001, "ms");
+    AddBenchMetric(noisyBefore, "g.us", 2.0, "us");
+    AddBenchMetric(noisyAfter, "e.ms", 0.028, "ms");
+    AddBenchMetric(noisyAfter, "f.ms", 0.1, "ms");
+    AddBenchMetric(noisyAfter, "g.us", 4.0, "us");
+    regressions = CompareBenchReports(noisyBefore, noisyAfter, 0.1);
+    compared    = compared && regressions.size() == 1 && regressions[0].name == "g.us";
+
+    Expect(roundTrip, "JSON round trip lost metrics");
+    Expect(compared, "wrong regressions flagged");
+    return roundTrip && compared;
+}
+
+// `size` bytes of `value` pushed as one block.
+uint32_t PushFilled(ConstantArena& arena, uint8_t value, uint32_t size)
+{
+    uint8_t data[1024];
+    std::memset(data, value, size);
+    return PushConstants(arena, data, size);
+}
+
+bool BlockHolds(const uint8_t* buffer, uint32_t offset, uint8_t value, uint32_t size)
+{
+    for (uint32_t i = 0; i < size; ++i)
+    {
+        if (buffer[offset + i] != value)
+            return false;
+    }
+    return true;
+}
+
+bool ValidateConstantArena()
+{
+    bool ok = true;
+
+    // four blocks, so frames in flight fill it quickly
+    RecordingRenderContext device;
+    RenderHandle           buffer = device.AddBuffer(1024);
+    const uint8_t*         memory = static_cast<const uint8_t*>(buffer);
+
+    ConstantArena arena;
+    InitConstantArena(arena, buffer, 1024, false);
+
+    BeginConstantArenaFrame(arena, 1, 0);
+    uint32_t a = PushFilled(arena, 0xA1, 64);
+    uint32_t b = PushFilled(arena, 0xB2, 300);
+    ok &= Expect(a == 0 && b == 256, "blocks not 256-byte aligned");
+    ok &= Expect(ConstantArenaRange(arena, b, 300).size == 512 && ConstantArenaRange(arena, b, 300).buffer == buffer, "range not rounded to whole blocks");
+
+    ok &= Expect(FlushConstantArena(arena, device), "flush failed");
+    ok &= Expect(arena.frame.maps == 1 && arena.frame.bytes == 768 && device.mapModes.size() == 1, "frame not uploaded with one map");
+    ok &= Expect(device.mapModes[0] == MapMode::WriteDiscard, "first map was not a discard");
+    ok &= Expect(BlockHolds(memory, 0, 0xA1, 64) && BlockHolds(memory, 64, 0, 192) && BlockHolds(memory, 256, 0xB2, 300), "block contents wrong");
+
+    // a second flush in the frame only copies what is new
+    uint32_t c = PushFilled(arena, 0xC3, 256);
+    ok &= Expect(c == 768 && FlushConstantArena(arena, device), "third block not placed after the second");
+    ok &= Expect(arena.frame.maps == 2 && arena.frame.bytes == 1024 && device.mapModes.back() == MapMode::WriteNoOverwrite, "later flush not a NO_OVERWRITE append");
+    ok &= Expect(FlushConstantArena(arena, device) && arena.frame.maps == 2, "empty flush mapped");
+    EndConstantArenaFrame(arena);
+
+    // frame 1 still owns the whole ring until the GPU is done with it
+    BeginConstantArenaFrame(arena, 2, 0);
+    ok &= Expect(PushFilled(arena, 0xD4, 16) == kConstantArenaFull && arena.frame.full == 1, "overwrote a frame in flight");
+    EndConstantArenaFrame(arena);
+
+    BeginConstantArenaFrame(arena, 3, 1);
+    a = PushFilled(arena, 0xE5, 256);
+    b = PushFilled(arena, 0xF6, 512);
+    ok &= Expect(a == 0 && b == 256 && arena.frame.wraps == 1, "ring did not wrap once frame 1 completed");
+    ok &= Expect(FlushConstantArena(arena, device) && BlockHolds(memory, 0, 0xE5, 256) && BlockHolds(memory, 256, 0xF6, 512), "wrapped blocks wrong");
+    EndConstantArenaFrame(arena);
+
+    // 256 bytes left at the end, too few for 512; skipping them would overlap frame 3
+    BeginConstantArenaFrame(arena, 4, 1);
+    ok &= Expect(PushFilled(arena, 0x17, 512) == kConstantArenaFull, "wrap padding not accounted");
+    a = PushFilled(arena, 0x28, 256);
+    ok &= Expect(a == 768, "tail space not used");
+    EndConstantArenaFrame(arena);
+
+    BeginConstantArenaFrame(arena, 5, 4);
+    a = PushFilled(arena, 0x39, 256);
+    b = PushFilled(arena, 0x4A, 256);
+    ok &= Expect(a == 0 && b == 256 && FlushConstantArena(arena, device), "ring not reused after frames 3 and 4");
+    EndConstantArenaFrame(arena);
+
+    // one frame split across the end of the ring: two segments, still one map
+    BeginConstantArenaFrame(arena, 6, 5);
+    a = PushFilled(arena, 0x5B, 512);
+    b = PushFilled(arena, 0x6C, 256);
+    size_t maps = device.mapModes.size();
+    ok &= Expect(a == 512 && b == 0 && FlushConstantArena(arena, device) && device.mapModes.size() == maps + 1, "split frame not one map");
+    ok &= Expect(BlockHolds(memory, 512, 0x5B, 512) && BlockHolds(memory, 0, 0x6C, 256) && BlockHolds(memory, 256, 0x4A, 256), "split frame touched the wrong bytes");
+    EndConstantArenaFrame(arena);
+
+    // without NO_OVERWRITE every frame starts over and every flush discards
+    InitConstantArena(arena, buffer, 1024, true);
+    BeginConstantArenaFrame(arena, 1, 0);
+    PushFilled(arena, 0x71, 256);
+    FlushConstantArena(arena, device);
+    EndConstantArenaFrame(arena);
+
+    BeginConstantArenaFrame(arena, 2, 0);
+    a = PushFilled(arena, 0x82, 256);
+    FlushConstantArena(arena, device);
+    b = PushFilled(arena, 0x93, 256);
+    FlushConstantArena(arena, device);
+    ok &= Expect(a == 0 && b == 256 && device.mapModes.back() == MapMode::WriteDiscard, "discard mode kept the ring");
+    ok &= Expect(arena.frame.bytes == 768 && BlockHolds(memory, 0, 0x82, 256) && BlockHolds(memory, 256, 0x93, 256), "discard lost the frame's earlier blocks");
+    EndConstantArenaFrame(arena);
+
+    // bucket draws bind their block by offset, and only when it changes
+    RecordingRenderContext recorder;
+    DrawBucket             bucket;
+    ResetDrawBucket(bucket, 1);
+    for (uint32_t i = 0; i < 3; ++i)
+    {
+        DrawCommand cmd      = {};
+        cmd.sortKey          = MakeDrawSortKey(0, 0, 0, 0.f);
+        cmd.constants        = ConstantArenaRange(arena, (i / 2) * 256, 64);
+        cmd.indexCount       = 3;
+        cmd.vertexBuffers[0] = buffer;
+        bucket.lists[0].commands.push_back(cmd);
+    }
+    SortDrawBucket(bucket);
+    SubmitDrawBucket(bucket, recorder);
+    ok &= Expect(recorder.calls == 7, "bucket rebinds an unchanged constant block");
+
+    return ok;
+}
+
+struct alignas(32) PooledObject
+{
+    PooledObject(int* liveCount, float objectValue)
+        : live(liveCount)
+        , value(objectValue)
+    {
+        ++*live;
+    }
+    ~PooledObject() { --*live; }
+
+    int*  live;
+    float value;
+};
+
+bool ValidateFrameAllocator()
+{
+    bool ok = true;
+
+    LinearAllocator scratch;
+    InitLinearAllocator(scratch, 256);
+
+    void*   a = LinearAllocate(scratch, 3, 1);
+    double* b = LinearAllocateArray<double>(scratch, 2);
+    void*   c = LinearAllocate(scratch, 1, 64);
+    ok &= Expect(a && b && c, "small requests failed");
+    ok &= Expect(reinterpret_cast<uintptr_t>(b) % alignof(double) == 0 && reinterpret_cast<uintptr_t>(c) % 64 == 0, "misaligned block");
+    ok &= Expect(static_cast<uint8_t*>(static_cast<void*>(b)) >= static_cast<uint8_t*>(a) + 3, "blocks overlap");
+    ok &= Expect(!LinearAllocate(scratch, 256, 1) && scratch.failures == 1, "oversized request did not fail");
+
+    size_t peak = scratch.used;
+    ResetLinearAllocator(scratch);
+    ok &= Expect(scratch.used == 0 && scratch.peak == peak, "reset lost the usage");
+    ok &= Expect(LinearAllocate(scratch, 256, 1) == scratch.storage.get(), "reset did not hand back the whole block");
+
+    PoolAllocator pool;
+    InitPoolAllocator(pool, sizeof(PooledObject), alignof(PooledObject), 3);
+
+    int           live = 0;
+    PooledObject* objects[3];
+    for (int i = 0; i < 3; ++i)
+        objects[i] = PoolCreate<PooledObject>(pool, &live, static_cast<float>(i));
+    ok &= Expect(objects[0] && objects[1] && objects[2] && live == 3 && pool.live == 3, "pool did not fill");
+    ok &= Expect(reinterpret_cast<uintptr_t>(objects[1]) % alignof(PooledObject) == 0, "misaligned pool slot");
+    ok &= Expect(!PoolCreate<PooledObject>(pool, &live, 3.f) && pool.failures == 1 && live == 3, "full pool handed out a slot");
+
+    PooledObject* freed = objects[1];
+    PoolDestroy(pool, objects[1]);
+    PooledObject* reused = PoolCreate<PooledObject>(pool, &live, 4.f);
+    ok &= Expect(reused == freed && reused->value == 4.f && objects[0]->value == 0.f && objects[2]->value == 2.f, "freed slot not reused");
+
+    PoolDestroy(pool, objects[0]);
+    PoolDestroy(pool, objects[2]);
+    PoolDestroy(pool, reused);
+    PoolDestroy<PooledObject>(pool, nullptr);
+    ok &= Expect(live == 0 && pool.live == 0 && pool.peak == 3, "objects not destroyed");
+
+    for (int i = 0; i < 3; ++i)
+        objects[i] = PoolCreate<PooledObject>(pool, &live, 0.f);
+    ok &= Expect(objects[0] && objects[1] && objects[2] && pool.failures == 1, "emptied pool did not refill");
+    for (PooledObject* object : objects)
+        PoolDestroy(pool, object);
+
+    return ok;
+}
+
+// A window-like frame on the null device, phase by phase: input, update,
+// upload and draws through the state tracker, the overlay, the UI's frame
+// statistics from the scratch allocator and the profiler drain. Once warm,
+// none of it may touch the heap on this thread.
+bool ValidateSteadyStateFrame()
+{
+    NullRenderContext device;
+    RenderResources   resources;
+    resources.constantBuffer = device.CreateBuffer(sizeof(ConstantBuffer));
+    resources.instanceBuffer = device.CreateBuffer(sizeof(InstanceData) * resources.instanceCapacity);
+    resources.vertexShader   = device.CreateObject();
+    resources.pixelShader    = device.CreateObject();
+
+    StateTrackingContext tracker;
+    tracker.inner = &device;
+
+    ConstantArena arena;
+    InitConstantArena(arena, device.CreateBuffer(1 << 16), 1 << 16, false);
+    resources.constantArena = &arena;
+
+    PrimitiveBatcher batcher;
+    InitPrimitiveBatcher(batcher, &tracker, device.CreateBuffer(sizeof(BatchVertex) << 12), 1 << 12, device.CreateBuffer(sizeof(uint32_t) * 3 << 12), 3 << 12);
+    batcher.inputLayout  = device.CreateObject();
+    batcher.vertexShader = resources.vertexShader;
+    batcher.pixelShader  = resources.pixelShader;
+
+    const BatchVertex triangle[3] = {
+        { -0.5f, 0.f, 1.f, 0.f, 0.f },
+        { 0.f, 0.5f, 0.f, 0.f, 1.f },
+        { 0.5f, 0.f, 0.f, 1.f, 0.f },
+    };
+
+    SceneState scene;
+    scene.requestedInstanceCount = 10000;
+    DrawBucket bucket;
+
+    FrameTimer timer;
+    InitFrameTimer(timer, 1024);
+    LinearAllocator scratch;
+    InitLinearAllocator(scratch, 64 * 1024);
+
+    auto          queue = std::make_unique<InputQueue>();
+    InputTracker  input;
+    KeyFrameInput frameInput;
+    InitInputTracker(input, 0, 1024);
+
+    uint64_t nowNs    = 0;
+    auto     runFrame = [&](HeapPhaseStats& heap, uint64_t frame)
+    {
+        PROFILE_FRAME(frame);
+        PROFILE_SCOPE("Frame");
+
+        ResetLinearAllocator(scratch);
+        nowNs += 16'000'000;
+
+        {
+            HeapPhaseScope phase(heap, "input");
+            if (frame % 30 == 1)
+                queue->Push(InputEvent { nowNs - 8'000'000, 'D', frame % 60 == 1 });
+            ConsumeInputEvents(input, *queue, nowNs, frameInput);
+        }
+        {
+            HeapPhaseScope phase(heap, "update");
+            UpdateSceneInput(scene, frameInput, 1.f / 60.f);
+        }
+
+        ConstantRange triangleConstants;
+        {
+            HeapPhaseScope phase(heap, "render");
+            BeginConstantArenaFrame(arena, frame, frame > 2 ? frame - 2 : 0);
+            UploadScene(tracker, resources, scene);
+            triangleConstants = RenderScene(tracker, resources, scene.cpuConstantData, scene.drawnInstances, bucket);
+        }
+        {
+            HeapPhaseScope phase(heap, "overlay");
+            float*         frameTimesMs = LinearAllocateArray<float>(scratch, 256);
+            size_t         frameCount   = frameTimesMs ? CopyFrameTimesMs(timer, frameTimesMs, 256) : 0;
+            RenderDebugOverlay(batcher, resources, triangleConstants, triangle, 3, frameTimesMs, frameCount);
+            EndBatcherFrame(batcher);
+            EndConstantArenaFrame(arena);
+        }
+        {
+            HeapPhaseScope phase(heap, "stats");
+            uint32_t       buckets[64];
+            FrameTimeStats stats = ComputeFrameTimeStats(timer, scratch);
+            CountFrameTimeBuckets(timer, 0.5, buckets, 64);
+            g_testSink          = g_testSink + static_cast<float>(stats.p99Ms) + static_cast<float>(buckets[0]);
+        }
+        {
+            HeapPhaseScope phase(heap, "end");
+            RecordFrameTime(timer, 1'000'000 + frame % 7 * 100'000);
+            RecordInputSubmit(input, nowNs);
+            device.EndFrame();
+            tracker.EndFrame();
+            ProfilerDiscard();
+        }
+    };
+
+    // the first frames size the buckets, grid, staging and the profiler's thread buffer
+    HeapPhaseStats warmup;
+    uint64_t       frame = 1;
+    for (; frame <= 8; ++frame)
+        runFrame(warmup, frame);
+
+    bool           ok = true;
+    HeapPhaseStats steady;
+    for (; frame <= 8 + 120; ++frame)
+        runFrame(steady, frame);
+    for (uint32_t i = 0; i < steady.count; ++i)
+    {
+        Expect(steady.allocations[i] == 0,
+               "phase %s made %llu heap allocations (%llu bytes) in 120 warm frames",
+               steady.names[i],
+               static_cast<unsigned long long>(steady.allocations[i]),
+               static_cast<unsigned long long>(steady.bytes[i]));
+    }
+    ok &= Expect(TotalHeapAllocations(steady) == 0 && steady.count == 6, "steady-state frames touched the heap");
+    ok &= Expect(scratch.failures == 0 && arena.total.full == 0, "frame scratch or constant arena ran out");
+
+    // the check has to be able to fail
+    HeapPhaseStats probe;
+    {
+        HeapPhaseScope   phase(probe, "probe");
+        std::vector<int> allocated(16);
+        g_testSink = g_testSink + static_cast<float>(allocated.size());
+    }
+    runFrame(probe, frame);
+    ok &= Expect(probe.count == 7 && probe.allocations[0] == 1 && probe.bytes[0] >= 16 * sizeof(int) && TotalHeapAllocations(probe) == 1,
+                            "a deliberate allocation went unnoticed");
+
+    return ok;
+}
+
+// Every index in [0, count) hit exactly once.
+bool ParallelForCovers(JobSystem& jobs, uint32_t count, uint32_t grain)
+{
+    std::vector<std::atomic<uint32_t>> hits(count);
+    ParallelFor(jobs,
+                count,
+                grain,
+                [&](uint32_t begin, uint32_t end)
+                {
+                    for (uint32_t i = begin; i < end; ++i)
+                        hits[i].fetch_add(1, std::memory_order_relaxed);
+                });
+
+    for (const std::atomic<uint32_t>& hit : hits)
+    {
+        if (hit.load() != 1)
+            return false;
+    }
+    return true;
+}
+
+struct JobGraphStage
+{
+    std::atomic<uint32_t>*       runs;
+    const std::atomic<uint32_t>* before;   // must reach beforeCount before this stage runs
+    uint32_t                     beforeCount = 0;
+    std::atomic<uint32_t>        early { 0 };
+};
+
+void RunJobGraphStage(void* data, uint32_t begin, uint32_t end)
+{
+    JobGraphStage& stage = *static_cast<JobGraphStage*>(data);
+    for (uint32_t i = begin; i < end; ++i)
+    {
+        if (stage.before && stage.before->load() != stage.beforeCount)
+            stage.early.fetch_add(1);
+        stage.runs->fetch_add(1);
+    }
+}
+
+bool ValidateJobSystem()
+{
+    bool ok = true;
+
+    // more threads than this machine may have cores: workers get preempted mid-steal
+    JobSystem jobs;
+    StartJobSystem(jobs, 8);
+    ok &= Expect(IsJobThread(jobs) && jobs.workerCount == 8, "starting thread is not worker 0");
+
+    for (int round = 0; round < 20 && ok; ++round)
+        ok &= Expect(ParallelForCovers(jobs, 100000 + round * 37, 1 + round * 13), "parallel for missed or repeated an index");
+    ok &= Expect(ParallelForCovers(jobs, 5, 64) && ParallelForCovers(jobs, 1, 1), "small parallel for");
+
+    // far more jobs than a worker's ring and deque hold, all on one counter
+    std::atomic<uint32_t> runs { 0 };
+    JobCounter            counter;
+    JobFunction           count = [](void* data, uint32_t begin, uint32_t end) { static_cast<std::atomic<uint32_t>*>(data)->fetch_add(end - begin); };
+    for (uint32_t i = 0; i < 3 * kJobsPerWorker; ++i)
+        SubmitJob(jobs, count, &runs, 0, 1, 0, &counter);
+    WaitForCounter(jobs, counter);
+    ok &= Expect(runs.load() == 3 * kJobsPerWorker && counter.pending.load() == 0, "job flood lost jobs");
+
+    // diamond: a -> (b, c) -> d, each stage split into many jobs
+    std::atomic<uint32_t> a { 0 }, b { 0 }, c { 0 }, bc { 0 }, d { 0 };
+    for (int round = 0; round < 50 && ok; ++round)
+    {
+        a = b = c = bc = d = 0;
+
+        JobGraphStage stageA { &a, nullptr, 0 };
+        JobGraphStage stageB { &b, &a, 1000 };
+        JobGraphStage stageC { &c, &a, 1000 };
+        JobGraphStage stageD { &d, &bc, 2000 };
+        JobGraphStage stageBC { &bc, nullptr, 0 };
+
+        JobCounter aDone, bcDone, dDone;
+        SubmitJob(jobs, RunJobGraphStage, &stageA, 0, 1000, 16, &aDone);
+        SubmitJobAfter(jobs, aDone, RunJobGraphStage, &stageB, 0, 1000, 16, &bcDone);
+        SubmitJobAfter(jobs, aDone, RunJobGraphStage, &stageC, 0, 1000, 16, &bcDone);
+        SubmitJobAfter(jobs, aDone, RunJobGraphStage, &stageBC, 0, 2000, 64, &bcDone);
+        SubmitJobAfter(jobs, bcDone, RunJobGraphStage, &stageD, 0, 500, 8, &dDone);
+        WaitForCounter(jobs, dDone);
+        WaitForCounter(jobs, bcDone);
+        WaitForCounter(jobs, aDone);
+
+        ok &= Expect(a == 1000 && b == 1000 && c == 1000 && d == 500, "dependency graph lost jobs");
+        ok &= Expect(stageB.early == 0 && stageC.early == 0 && stageD.early == 0, "a continuation ran before its dependency");
+    }
+
+    // a continuation on a counter that already reached zero runs right away
+    JobCounter            idle;
+    JobCounter            afterIdle;
+    std::atomic<uint32_t> late { 0 };
+    SubmitJobAfter(jobs, idle, count, &late, 0, 3, 0, &afterIdle);
+    WaitForCounter(jobs, afterIdle);
+    ok &= Expect(late == 3, "continuation on a finished counter never ran");
+
+    // parallel for from inside jobs
+    std::atomic<uint64_t> nested { 0 };
+    ParallelFor(jobs,
+                64,
+                1,
+                [&](uint32_t begin, uint32_t end)
+                {
+                    for (uint32_t i = begin; i < end; ++i)
+                        ParallelFor(jobs, 1000, 50, [&](uint32_t first, uint32_t last) { nested.fetch_add(last - first); });
+                });
+    ok &= Expect(nested == 64 * 1000, "nested parallel for");
+
+    // threads outside the system run inline
+    bool inlineOk = false;
+    std::thread outsider([&]() { inlineOk = !IsJobThread(jobs) && ParallelForCovers(jobs, 10000, 100); });
+    outsider.join();
+    ok &= Expect(inlineOk, "parallel for from a foreign thread");
+
+    // the scene's passes give the same state and instance data split or not
+    SceneState    single;
+    SceneState    split;
+    KeyFrameInput input;
+    single.requestedInstanceCount = split.requestedInstanceCount = 50000;
+    single.cullInstances = split.cullInstances = false;
+    split.jobs                                 = &jobs;
+    input.heldFraction['D']                    = 1.f;
+
+    for (int frame = 0; frame < 10; ++frame)
+    {
+        UpdateSceneInput(single, input, 1.f / 60.f);
+        UpdateSceneInput(split, input, 1.f / 60.f);
+    }
+    single.cullInstances = split.cullInstances = true;
+    split.instanceExtent = single.instanceExtent = 2.f;
+    UpdateSceneInput(single, input, 1.f / 60.f);
+    UpdateSceneInput(split, input, 1.f / 60.f);
+
+    RecordingRenderContext device;
+    RenderResources        singleResources;
+    RenderResources        splitResources;
+    singleResources.instanceBuffer = device.AddBuffer(sizeof(InstanceData) * singleResources.instanceCapacity);
+    splitResources.instanceBuffer  = device.AddBuffer(sizeof(InstanceData) * splitResources.instanceCapacity);
+    UploadScene(device, singleResources, single);
+    UploadScene(device, splitResources, split);
+    ok &= Expect(HashSceneState(single) == HashSceneState(split), "split spin changed the scene");
+    ok &= Expect(single.drawnInstances == split.drawnInstances && single.drawnInstances > 0 &&
+                         std::memcmp(singleResources.instanceBuffer, splitResources.instanceBuffer, single.drawnInstances * sizeof(InstanceData)) == 0,
+                     "split packing changed the instance data");
+
+    StopJobSystem(jobs);
+    ok &= Expect(!IsJobThread(jobs), "stopped system still takes jobs");
+
+    // start and stop under load
+    for (int round = 0; round < 20 && ok; ++round)
+    {
+        StartJobSystem(jobs, 2 + round % 5);
+        std::atomic<uint32_t> queuedRuns { 0 };
+        JobCounter            pending;
+        for (uint32_t i = 0; i < 200; ++i)
+            SubmitJob(jobs, count, &queuedRuns, 0, 100, 7, &pending);
+        if (round % 2)
+            WaitForCounter(jobs, pending);
+        StopJobSystem(jobs);
+        ok &= Expect(queuedRuns == 200 * 100, "stop dropped queued jobs");
+    }
+
+    return ok;
+}
+
+// Holds the builder thread that runs it until `open` is set.
+bool GateShaderObjects(void* user, const ShaderBuild&, std::string&)
+{
+    const std::atomic<bool>& open = *static_cast<const std::atomic<bool>*>(user);
+    while (!open.load())
+        std::this_thread::yield();
+    return true;
+}
+
+// Counts the builds whose objects were created.
+bool CountShaderObjects(void* user, const ShaderBuild& build, std::string& errors)
+{
+    static_cast<std::atomic<int>*>(user)->fetch_add(1);
+    if (build.bytecode.empty())
+    {
+        errors = "no bytecode";
+        return false;
+    }
+    return true;
+}
+
+bool FailShaderObjects(void*, const ShaderBuild&, std::string& errors)
+{
+    errors = "object creation failed";
+    return false;
+}
+
+// Ordering, fallback to ready, failures, the cache round trip and draining on
+// stop, against the latency stub.
+bool ValidateAsyncShaders()
+{
+    const char* path = "shader_cache_async.bin";
+    std::remove(path);
+
+    const char           source[] = "float4 main() : SV_TARGET { return 1; }";
+    ShaderCompileRequest request;
+    request.source     = source;
+    request.sourceSize = sizeof(source) - 1;
+    request.target     = "ps_5_0";
+
+    const char* entries[] = { "gate", "late0", "late1", "first0", "first1" };
+
+    bool                  ok = true;
+    LatencyShaderCompiler compiler;
+    ShaderCache           cache;
+    AsyncShaderBuilder    builder;
+    std::atomic<bool>     open { false };
+    std::atomic<int>      created { 0 };
+
+    // one thread held by the gate: critical builds queued later still go first
+    OpenShaderCache(cache, path, 1 << 20);
+    StartShaderBuilder(builder, compiler, &cache, 1);
+
+    ShaderBuild* builds[5];
+    for (int i = 0; i < 5; ++i)
+    {
+        request.entryPoint = entries[i];
+        builds[i]          = &QueueShaderBuild(builder, entries[i], request, i >= 3, i == 0 ? GateShaderObjects : CountShaderObjects, i == 0 ? static_cast<void*>(&open) : &created);
+    }
+    ok &= Expect(!IsShaderBuildDone(*builds[1]) && !IsShaderBuildReady(*builds[3]), "builds done while the only thread is held");
+    ok &= Expect(!CollectShaderBuilds(builder), "collect reports done with builds pending");
+
+    open = true;
+    ok &= Expect(WaitForCriticalShaders(builder), "critical builds failed");
+    ok &= Expect(IsShaderBuildReady(*builds[3]) && IsShaderBuildReady(*builds[4]), "critical builds not ready after the wait");
+    ok &= Expect(WaitForShaderBuild(builder, *builds[2]) && IsShaderBuildReady(*builds[1]), "deferred builds never became ready");
+    ok &= Expect(created == 4 && CollectShaderBuilds(builder), "objects not created or collect not done");
+    {
+        std::lock_guard<std::mutex> lock(compiler.orderMutex);
+        auto                        position = [&](const char* entry) { return std::find(compiler.order.begin(), compiler.order.end(), entry) - compiler.order.begin(); };
+        ok &= Expect(compiler.order.size() == 5 && std::max(position("first0"), position("first1")) < std::min(position("late0"), position("late1")), "critical builds did not jump the queue");
+        ok &= Expect(position("first0") < position("first1") && position("late0") < position("late1"), "builds of one priority out of order");
+    }
+
+    // failures surface as Failed with the errors, and a failed critical build fails the wait
+    compiler.failEntry = "broken";
+    request.entryPoint = "broken";
+    ShaderBuild& broken = QueueShaderBuild(builder, "broken", request, true, CountShaderObjects, &created);
+    request.entryPoint  = "objects";
+    ShaderBuild& noObjects = QueueShaderBuild(builder, "objects", request, false, FailShaderObjects, nullptr);
+    ok &= Expect(!WaitForCriticalShaders(builder) && broken.state == ShaderBuildState::Failed && broken.errors == "stub: forced failure", "compile failure not surfaced");
+    ok &= Expect(!WaitForShaderBuild(builder, noObjects) && noObjects.errors == "object creation failed", "object failure not surfaced");
+
+    // only successful compiles go into the cache
+    StopShaderBuilder(builder);
+    ok &= Expect(cache.stats.misses == 7 && cache.entries.size() == 5, "collect did not store the compiles");
+    ok &= Expect(SaveShaderCache(cache), "save failed");
+    CloseShaderCache(cache);
+
+    // warm: every good entry hits, only the broken one compiles again
+    compiler.compiles = 0;
+    created           = 0;
+    OpenShaderCache(cache, path, 1 << 20);
+    StartShaderBuilder(builder, compiler, &cache, 2);
+    for (int i = 1; i < 5; ++i)
+    {
+        request.entryPoint = entries[i];
+        QueueShaderBuild(builder, entries[i], request, i >= 3, CountShaderObjects, &created);
+    }
+    request.entryPoint = "broken";
+    QueueShaderBuild(builder, "broken", request, false, CountShaderObjects, &created);
+    StopShaderBuilder(builder);
+
+    int hits = 0;
+    for (const auto& build : builder.builds)
+        hits += build->cacheHit && IsShaderBuildReady(*build);
+    ok &= Expect(hits == 4 && compiler.compiles == 1 && created == 4, "warm start compiled or skipped objects");
+    CloseShaderCache(cache);
+    std::remove(path);
+
+    // stop right after queueing still builds everything, on several threads at once
+    compiler.failEntry  = nullptr;
+    compiler.latencyMs  = 5;
+    compiler.peakActive = 0;
+    created             = 0;
+    StartShaderBuilder(builder, compiler, nullptr, 4);
+    std::string names[16];
+    for (int i = 0; i < 16; ++i)
+    {
+        names[i]           = "drain" + std::to_string(i);
+        request.entryPoint = names[i].c_str();
+        QueueShaderBuild(builder, "drain", request, i % 3 == 0, CountShaderObjects, &created);
+    }
+    StopShaderBuilder(builder);
+    ok &= Expect(created == 16 && builder.threads.empty() && builder.queue.empty(), "stop dropped queued builds");
+    ok &= Expect(compiler.peakActive > 1, "builds never overlapped");
+
+    return ok;
+}
+
+// World of `node` the slow way: its local times every ancestor's local, as
+// full 4x4 products.
+void ReferenceWorld(const TransformGraph& graph, uint32_t node, float* out)
+{
+    const InstanceTransforms& l = graph.local;
+    BuildAffineMatrices(&l.positionX[node], &l.positionY[node], &l.scaleX[node], &l.scaleY[node], &l.rotation[node], 1, out);
+
+    for (uint32_t p = graph.parent[node]; p != kNoTransformNode; p = graph.parent[p])
+    {
+        float parent[16];
+        float product[16];
+        BuildAffineMatrices(&l.positionX[p], &l.positionY[p], &l.scaleX[p], &l.scaleY[p], &l.rotation[p], 1, parent);
+        for (int row = 0; row < 4; ++row)
+            for (int col = 0; col < 4; ++col)
+                product[row * 4 + col] = out[row * 4] * parent[col] + out[row * 4 + 1] * parent[4 + col] + out[row * 4 + 2] * parent[8 + col] + out[row * 4 + 3] * parent[12 + col];
+        std::memcpy(out, product, sizeof(product));
+    }
+}
+
+bool MatchesReference(const TransformGraph& graph)
+{
+    for (uint32_t i = 0; i < TransformNodeCount(graph); ++i)
+    {
+        float expected[16];
+        ReferenceWorld(graph, i, expected);
+        for (int k = 0; k < 16; ++k)
+        {
+            if (std::fabs(expected[k] - graph.world[i].world[k]) > 1e-4f * std::max(1.f, std::fabs(expected[k])))
+                return false;
+        }
+    }
+    return true;
+}
+
+// The scene's instance buffer against its graph: slot i holds the world matrix
+// of the i-th drawn instance.
+bool MatchesDrawnInstances(const SceneState& scene, const void* buffer)
+{
+    const InstanceData* uploaded = static_cast<const InstanceData*>(buffer);
+    for (size_t i = 0; i < scene.drawnInstances; ++i)
+    {
+        size_t instance = scene.cullInstances ? scene.visibleInstances[i] : i;
+        if (std::memcmp(&uploaded[i], &scene.transforms.world[kFirstInstanceNode + instance], sizeof(InstanceData)) != 0)
+            return false;
+    }
+    return true;
+}
+
+// `count` nodes, each attached to a random node of the open chain or made a
+// new root: random depths and fan-outs, always in depth-first order.
+void AddRandomTransformTree(TransformGraph& graph, uint32_t count, std::mt19937& random)
+{
+    std::uniform_real_distribution<float> unit(-1.f, 1.f);
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        uint32_t pick   = random() % (graph.open.size() + 1);
+        uint32_t parent = pick < graph.open.size() ? graph.open[graph.open.size() - 1 - pick / 2] : kNoTransformNode;
+        AddTransformNode(graph, parent, 0.5f * unit(random), 0.5f * unit(random), 1.f + 0.1f * unit(random), 1.f + 0.1f * unit(random), 3.f * unit(random));
+    }
+}
+
+// Order, incremental updates against a from-scratch reference, the changed
+// ranges, partial uploads, and the scene's skipped work for a still triangle
+// and still instances.
+bool ValidateTransformGraph()
+{
+    bool ok = true;
+
+    // depth-first order only
+    TransformGraph graph;
+    uint32_t       root  = AddTransformNode(graph, kNoTransformNode, 0.f, 0.f, 1.f, 1.f, 0.f);
+    uint32_t       child = AddTransformNode(graph, root, 1.f, 0.f, 1.f, 1.f, 0.f);
+    uint32_t       leaf  = AddTransformNode(graph, child, 1.f, 0.f, 1.f, 1.f, 0.f);
+    ok &= Expect(AddTransformNode(graph, root, 0.f, 1.f, 1.f, 1.f, 0.f) == 3, "sibling of an open subtree refused");
+    ok &= Expect(AddTransformNode(graph, leaf, 0.f, 0.f, 1.f, 1.f, 0.f) == kNoTransformNode, "attached to a finished subtree");
+    ok &= Expect(AddTransformNode(graph, 9, 0.f, 0.f, 1.f, 1.f, 0.f) == kNoTransformNode, "attached to a missing node");
+    ok &= Expect(TransformSubtreeEnd(graph, root) == 4 && TransformSubtreeEnd(graph, child) == 3 && TransformSubtreeEnd(graph, leaf) == 3, "subtree ends");
+    ok &= Expect(UpdateTransformGraph(graph) && graph.changed.size() == 1 && graph.changed[0].end == 4 && MatchesReference(graph), "first update");
+
+    // a random forest, then random edits frame after frame; every few frames
+    // enough of them to take the sweep path
+    std::mt19937 random(25);
+    ClearTransformGraph(graph);
+    AddRandomTransformTree(graph, 5000, random);
+    uint32_t count = static_cast<uint32_t>(TransformNodeCount(graph));
+    ok &= Expect(UpdateTransformGraph(graph) && graph.stats.updatedNodes == count && MatchesReference(graph), "full update");
+
+    RecordingRenderContext device;
+    RenderHandle           buffer = device.AddBuffer(count * sizeof(InstanceData));
+    ok &= Expect(UploadTransformGraph(device, buffer, graph) == count * sizeof(InstanceData) && device.updates == 1, "full upload not one copy");
+
+    uint64_t version = graph.version;
+    ok &= Expect(!UpdateTransformGraph(graph) && graph.changed.empty() && graph.stats.updatedNodes == 0 && graph.version == version, "static update did work");
+    const InstanceTransforms& l = graph.local;
+    SetTransformLocal(graph, 7, l.positionX[7], l.positionY[7], l.scaleX[7], l.scaleY[7], l.rotation[7]);
+    ok &= Expect(!UpdateTransformGraph(graph) && UploadTransformGraph(device, buffer, graph) == 0, "same values marked dirty");
+
+    std::vector<InstanceData> before;
+    std::vector<uint8_t>      expectChanged(count);
+    for (int frame = 0; frame < 40 && ok; ++frame)
+    {
+        before = graph.world;
+        std::fill(expectChanged.begin(), expectChanged.end(), 0);
+
+        uint32_t edits = frame % 8 == 7 ? count / 8 : random() % 20;
+        for (uint32_t e = 0; e < edits; ++e)
+        {
+            uint32_t node = random() % count;
+            SetTransformLocal(graph, node, l.positionX[node] + 0.01f, l.positionY[node], l.scaleX[node], l.scaleY[node], l.rotation[node] + 0.1f);
+            std::fill(expectChanged.begin() + node, expectChanged.begin() + TransformSubtreeEnd(graph, node), 1);
+        }
+        UpdateTransformGraph(graph);
+        UploadTransformGraph(device, buffer, graph);
+
+        std::vector<uint8_t> inRanges(count);
+        uint32_t             last = 0;
+        for (const TransformRange& range : graph.changed)
+        {
+            ok &= Expect(range.begin >= last && range.begin < range.end && (last == 0 || range.begin > last), "ranges unsorted or not merged");
+            std::fill(inRanges.begin() + range.begin, inRanges.begin() + range.end, 1);
+            last = range.end;
+        }
+        ok &= Expect(inRanges == expectChanged, "changed ranges are not the edited subtrees");
+
+        bool untouched = true;
+        for (uint32_t i = 0; i < count; ++i)
+            untouched &= expectChanged[i] || std::memcmp(&before[i], &graph.world[i], sizeof(InstanceData)) == 0;
+        ok &= Expect(untouched, "clean node rewritten");
+        ok &= Expect(std::memcmp(buffer, graph.world.data(), count * sizeof(InstanceData)) == 0, "partial uploads diverged from the graph");
+        if (frame % 8 == 7)
+            ok &= Expect(MatchesReference(graph), "incremental update differs from the reference");
+    }
+
+    // two ranges a few nodes apart go up as one copy
+    ClearTransformGraph(graph);
+    root = AddTransformNode(graph, kNoTransformNode, 0.f, 0.f, 1.f, 1.f, 0.f);
+    for (int i = 0; i < 100; ++i)
+        AddTransformNode(graph, root, 0.01f * i, 0.f, 1.f, 1.f, 0.f);
+    UpdateTransformGraph(graph);
+    SetTransformLocal(graph, 10, 1.f, 1.f, 1.f, 1.f, 0.f);
+    SetTransformLocal(graph, 14, 1.f, 1.f, 1.f, 1.f, 0.f);
+    SetTransformLocal(graph, 90, 1.f, 1.f, 1.f, 1.f, 0.f);
+    device.updates = 0;
+    UpdateTransformGraph(graph);
+    ok &= Expect(graph.changed.size() == 3 && UploadTransformGraph(device, device.AddBuffer(101 * sizeof(InstanceData)), graph) == 6 * sizeof(InstanceData) && device.updates == 2,
+                           "nearby ranges not uploaded together");
+
+    // the scene triangle: rebuilt and uploaded only when it moves
+    SceneState    scene;
+    KeyFrameInput input;
+    UpdateSceneInput(scene, input, 1.f / 60.f);
+    BuildSceneConstants(scene);
+    ConstantBuffer expected;
+    BuildAffineMatrices(&scene.triPosition[0], &scene.triPosition[1], &scene.triScale[0], &scene.triScale[1], &scene.triRotation, 1, expected.world);
+    ok &= Expect(std::memcmp(expected.world, scene.cpuConstantData.world, sizeof(expected.world)) == 0, "triangle constants differ");
+
+    RecordingRenderContext sceneDevice;
+    RenderResources        resources;
+    DrawBucket             bucket;
+    resources.constantBuffer = sceneDevice.AddBuffer(sizeof(ConstantBuffer));
+    for (int frame = 0; frame < 3; ++frame)
+    {
+        UpdateSceneInput(scene, input, 1.f / 60.f);
+        BuildSceneConstants(scene);
+        ok &= Expect(frame == 0 || scene.transforms.stats.updatedNodes == 0, "unmoved triangle recomputed");
+        RenderScene(sceneDevice, resources, scene.cpuConstantData, 0, bucket);
+    }
+    ok &= Expect(sceneDevice.mapModes.size() == 1, "unmoved triangle uploaded again");
+
+    input.heldFraction['D'] = 1.f;
+    UpdateSceneInput(scene, input, 1.f / 60.f);
+    BuildSceneConstants(scene);
+    RenderScene(sceneDevice, resources, scene.cpuConstantData, 0, bucket);
+    ok &= Expect(scene.transforms.stats.updatedNodes == 1 && sceneDevice.mapModes.size() == 2 &&
+                               std::memcmp(resources.constantBuffer, &scene.cpuConstantData, sizeof(ConstantBuffer)) == 0,
+                           "moved triangle not uploaded");
+
+    // a key held for hours keeps the angle wrapped
+    input.heldFraction['D']       = 0.f;
+    input.heldFraction[KEY_SPACE] = 1.f;
+    for (int frame = 0; frame < 4; ++frame)
+        UpdateSceneInput(scene, input, 10000.f);
+    BuildSceneConstants(scene);
+    BuildAffineMatrices(&scene.triPosition[0], &scene.triPosition[1], &scene.triScale[0], &scene.triScale[1], &scene.triRotation, 1, expected.world);
+    ok &= Expect(std::fabs(scene.triRotation) <= 3.1416f, "rotation not wrapped: %f", scene.triRotation);
+    ok &= Expect(std::memcmp(expected.world, scene.cpuConstantData.world, sizeof(expected.world)) == 0, "wrapped triangle constants differ");
+
+    // the instances are the nodes after the triangle: the buffer gets what
+    // moved since the last upload, nothing while the scene is still
+    SceneState             spun;
+    KeyFrameInput          still;
+    RecordingRenderContext spunDevice;
+    RenderResources        spunResources;
+    spunResources.instanceCapacity = 1024;
+    spunResources.instanceBuffer   = spunDevice.AddBuffer(1024 * sizeof(InstanceData));
+    spun.requestedInstanceCount    = 400;
+    spun.instanceExtent            = 2.f;   // about a quarter on screen
+
+    UpdateSceneInput(spun, still, 1.f / 60.f);
+    UploadScene(spunDevice, spunResources, spun);
+    size_t drawn = spun.drawnInstances;
+    size_t bytes = drawn * sizeof(InstanceData);
+    ok &= Expect(SceneInstanceCount(spun) == 400 && drawn > 8 && drawn < 400, "%zu of %zu instances drawn", drawn, SceneInstanceCount(spun));
+    ok &= Expect(spunDevice.updates == 1 && spunDevice.updatedBytes == bytes && spunDevice.mapModes.empty(), "first upload not one copy of the drawn instances");
+    ok &= Expect(MatchesReference(spun.transforms) && MatchesDrawnInstances(spun, spunResources.instanceBuffer), "instance buffer is not the graph");
+
+    UpdateSceneInput(spun, still, 1.f / 60.f);
+    UploadScene(spunDevice, spunResources, spun);
+    bytes += drawn * sizeof(InstanceData);
+    ok &= Expect(spun.transforms.stats.updatedNodes == 400 && spun.transforms.stats.ranges == 1, "spin did not rebuild the instances in one range");
+    ok &= Expect(spunDevice.updates == 2 && spunDevice.updatedBytes == bytes && MatchesDrawnInstances(spun, spunResources.instanceBuffer), "spun instances not uploaded");
+
+    spun.instanceSpinSpeed = 0.f;
+    uint64_t spunVersion   = spun.transforms.version;
+    for (int frame = 0; frame < 3; ++frame)
+    {
+        UpdateSceneInput(spun, still, 1.f / 60.f);
+        UploadScene(spunDevice, spunResources, spun);
+    }
+    ok &= Expect(spun.transforms.version == spunVersion && spunDevice.updates == 2 && spun.drawnInstances == drawn, "still instances rebuilt or uploaded");
+
+    KeyFrameInput moving;
+    moving.heldFraction['W'] = 1.f;
+    UpdateSceneInput(spun, moving, 1.f / 60.f);
+    UploadScene(spunDevice, spunResources, spun);
+    ok &= Expect(spun.transforms.stats.updatedNodes == 1 && spunDevice.updates == 2, "moving the triangle uploaded instances");
+
+    // single edits go up alone, also when two updates come before an upload;
+    // off-screen ones not at all
+    const InstanceTransforms& sl      = spun.transforms.local;
+    uint32_t                  edits[] = { kFirstInstanceNode + spun.visibleInstances[3], kFirstInstanceNode + spun.visibleInstances[drawn - 2], kFirstInstanceNode + 399 };
+    for (uint32_t node : edits)
+    {
+        SetTransformLocal(spun.transforms, node, sl.positionX[node], sl.positionY[node], sl.scaleX[node], sl.scaleY[node], sl.rotation[node] + 0.5f);
+        BuildSceneConstants(spun);
+    }
+    UploadScene(spunDevice, spunResources, spun);
+    bytes += 2 * sizeof(InstanceData);
+    ok &= Expect(spunDevice.updates == 4 && spunDevice.updatedBytes == bytes && MatchesDrawnInstances(spun, spunResources.instanceBuffer), "edited instances not uploaded alone");
+
+    // what is drawn changes: everything again
+    spun.cullInstances = false;
+    UploadScene(spunDevice, spunResources, spun);
+    bytes += 400 * sizeof(InstanceData);
+    ok &= Expect(spun.drawnInstances == 400 && spunDevice.updates == 5 && spunDevice.updatedBytes == bytes && MatchesDrawnInstances(spun, spunResources.instanceBuffer),
+                 "culling switched off without a full upload");
+
+    // snapshots write the buffer elsewhere, so the next upload starts over
+    SceneSnapshot spunSnapshot;
+    CaptureSceneSnapshot(spun, 1024, spunSnapshot);
+    UploadScene(spunDevice, spunResources, spun);
+    bytes += 400 * sizeof(InstanceData);
+    ok &= Expect(spunDevice.updates == 6 && spunDevice.updatedBytes == bytes, "upload after a snapshot not whole");
+
+    return ok;
+}
+
+struct RendererTest
+{
+    const char* name;
+    bool (*run)();
+};
+
+const RendererTest kRendererTests[] = {
+    { "affine_kernels",      ValidateAffineKernels },
+    { "software_rasterizer", ValidateSoftwareRasterizer },
+    { "null_render_context", ValidateNullRenderContext },
+    { "frame_timer",         ValidateFrameTimer },
+    { "profiler",            ValidateProfiler },
+    { "shader_cache",        ValidateShaderCache },
+    { "state_tracking",      ValidateStateTracking },
+    { "draw_bucket",         ValidateDrawBucket },
+    { "triple_buffer",       ValidateTripleBuffer },
+    { "simulation_thread",   ValidateSimulationThread },
+    { "primitive_batcher",   ValidatePrimitiveBatcher },
+    { "vertex_formats",      ValidateVertexFormats },
+    { "mesh_file",           ValidateMeshFile },
+    { "mesh_optimizer",      ValidateMeshOptimizer },
+    { "spatial_grid",        ValidateSpatialGrid },
+    { "input_events",        ValidateInputEvents },
+    { "frame_pacer",         ValidateFramePacer },
+    { "dynamic_resolution",  ValidateDynamicResolution },
+    { "input_capture",       ValidateInputCapture },
+    { "bench_report",        ValidateBenchReport },
+    { "constant_arena",      ValidateConstantArena },
+    { "frame_allocator",     ValidateFrameAllocator },
+    { "steady_state_frame",  ValidateSteadyStateFrame },
+    { "job_system",          ValidateJobSystem },
+    { "async_shaders",       ValidateAsyncShaders },
+    { "transform_graph",     ValidateTransformGraph },
+};
+
+int main(int argc, char** argv)
+{
+    if (argc == 2 && std::strcmp(argv[1], "--list") == 0)
+    {
+        for (const RendererTest& test : kRendererTests)
+            std::printf("%s\n", test.name);
+        return 0;
+    }
+
+    int run    = 0;
+    int failed = 0;
+    for (const RendererTest& test : kRendererTests)
+    {
+        bool selected = argc == 1;
+        for (int i = 1; i < argc && !selected; ++i)
+            selected = std::strcmp(argv[i], test.name) == 0;
+        if (!selected)
+            continue;
+
+        g_testName = test.name;
+        bool ok    = test.run();
+        std::printf("%-4s %s\n", ok ? "ok" : "FAIL", test.name);
+        ++run;
+        failed += ok ? 0 : 1;
+    }
+
+    if (run == 0)
+    {
+        std::fprintf(stderr, "no test matches\n");
+        return 1;
+    }
+    std::printf("%d of %d tests passed\n", run - failed, run);
+    return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,534 @@
+#include "Scene.h"
+#include "Profiler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+    // Radius of the circle instance i covers at any rotation.
+    float InstanceRadius(const SceneState& scene, size_t i)
+    {
+        const InstanceTransforms& t    = scene.transforms.local;
+        size_t                    node = kFirstInstanceNode + i;
+        return scene.instanceRadius * std::max(std::fabs(t.scaleX[node]), std::fabs(t.scaleY[node]));
+    }
+
+    SpatialRect InstanceBounds(const SceneState& scene, size_t i)
+    {
+        const InstanceTransforms& t    = scene.transforms.local;
+        size_t                    node = kFirstInstanceNode + i;
+
+        float r = InstanceRadius(scene, i);
+        return SpatialRect { t.positionX[node] - r, t.positionY[node] - r, t.positionX[node] + r, t.positionY[node] + r };
+    }
+
+    // FNV-1a
+    uint64_t HashBytes(uint64_t hash, const void* data, size_t size)
+    {
+        const uint8_t* bytes = static_cast<const uint8_t*>(data);
+        for (size_t i = 0; i < size; ++i)
+        {
+            hash ^= bytes[i];
+            hash *= 1099511628211ull;
+        }
+        return hash;
+    }
+
+    // The instances' entries of one local transform component.
+    uint64_t HashInstanceFloats(uint64_t hash, const std::vector<float>& values)
+    {
+        if (values.size() <= kFirstInstanceNode)
+            return hash;
+        return HashBytes(hash, values.data() + kFirstInstanceNode, (values.size() - kFirstInstanceNode) * sizeof(float));
+    }
+
+    void RebuildInstanceGrid(SceneState& scene)
+    {
+        PROFILE_SCOPE("RebuildInstanceGrid");
+
+        // cells two layout pitches wide: about four instances each
+        size_t count  = SceneInstanceCount(scene);
+        float  extent = std::max(scene.layoutExtent, 1e-3f);
+        float  pitch  = 2.f * extent / std::max(1.f, std::ceil(std::sqrt(static_cast<float>(count))));
+        InitSpatialGrid(scene.instanceGrid, SpatialRect { -extent, -extent, extent, extent }, 2.f * pitch);
+
+        for (size_t i = 0; i < count; ++i)
+            SetSpatialEntry(scene.instanceGrid, static_cast<uint32_t>(i), InstanceBounds(scene, i));
+    }
+
+    // Number of instances to draw (at most `capacity`); with culling their
+    // indices are left in scene.visibleInstances.
+    size_t CullInstances(SceneState& scene, size_t capacity)
+    {
+        PROFILE_SCOPE("CullInstances");
+
+        if (!scene.cullInstances)
+            return std::min(SceneInstanceCount(scene), capacity);
+
+        // world space is clip space, so the view is the unit square
+        CullSpatialGrid(scene.instanceGrid, SpatialRect { -1.f, -1.f, 1.f, 1.f }, scene.visibleInstances);
+        return std::min(scene.visibleInstances.size(), capacity);
+    }
+
+    // The graph again: the triangle, then the instances on a fresh grid.
+    void LayoutSceneInstances(SceneState& scene)
+    {
+        PROFILE_SCOPE("LayoutSceneInstances");
+
+        size_t             count = static_cast<size_t>(std::max(scene.requestedInstanceCount, 0));
+        InstanceTransforms layout;
+        LayoutInstanceGrid(layout, count, scene.instanceExtent);
+
+        TransformGraph& graph = scene.transforms;
+        ClearTransformGraph(graph);
+        ReserveTransformGraph(graph, kFirstInstanceNode + count);
+        AddTransformNode(graph, kNoTransformNode, scene.triPosition[0], scene.triPosition[1], scene.triScale[0], scene.triScale[1], scene.triRotation);
+        for (size_t i = 0; i < count; ++i)
+            AddTransformNode(graph, kNoTransformNode, layout.positionX[i], layout.positionY[i], layout.scaleX[i], layout.scaleY[i], layout.rotation[i]);
+
+        scene.layoutExtent  = scene.instanceExtent;
+        scene.drawListDirty = true;
+        RebuildInstanceGrid(scene);
+    }
+
+    // Instances per job: enough work to outweigh a steal.
+    constexpr uint32_t kSpinGrain = 8192;
+
+    // Culls again when the layout or the culling setting changed; the spin
+    // alone never changes what is drawn.
+    void RefreshDrawList(SceneState& scene, size_t capacity)
+    {
+        if (!scene.drawListDirty && scene.drawnCulled == scene.cullInstances)
+            return;
+
+        scene.drawnInstances = CullInstances(scene, capacity);
+        scene.drawnCulled    = scene.cullInstances;
+        scene.drawListDirty  = false;
+        scene.uploadAll      = true;
+        if (scene.drawnCulled)
+            scene.packedInstances.resize(scene.drawnInstances);
+    }
+
+    // First drawn slot whose instance's node is `node` or later.
+    size_t DrawnSlot(const SceneState& scene, uint32_t node)
+    {
+        uint32_t instance = node > kFirstInstanceNode ? node - kFirstInstanceNode : 0;
+        if (!scene.drawnCulled)
+            return std::min<size_t>(instance, scene.drawnInstances);
+
+        const uint32_t* visible = scene.visibleInstances.data();
+        return std::lower_bound(visible, visible + scene.drawnInstances, instance) - visible;
+    }
+
+    // World matrices of drawn slots [first, last), gathered from the graph.
+    void CopyDrawnInstances(const SceneState& scene, size_t first, size_t last, InstanceData* out)
+    {
+        if (first >= last)
+            return;
+
+        const InstanceData* world = scene.transforms.world.data() + kFirstInstanceNode;
+        if (!scene.drawnCulled)
+        {
+            std::memcpy(out, world + first, (last - first) * sizeof(InstanceData));
+            return;
+        }
+
+        for (size_t slot = first; slot < last; ++slot)
+            out[slot - first] = world[scene.visibleInstances[slot]];
+    }
+
+    void UploadDrawnInstances(IRenderContext& context, const RenderResources& r, SceneState& scene, size_t first, size_t last)
+    {
+        if (first >= last)
+            return;
+
+        // unculled slots are the graph's own order, so those go straight from it
+        const InstanceData* source = scene.transforms.world.data() + kFirstInstanceNode + first;
+        if (scene.drawnCulled)
+        {
+            CopyDrawnInstances(scene, first, last, scene.packedInstances.data() + first);
+            source = scene.packedInstances.data() + first;
+        }
+        context.UpdateBuffer(r.instanceBuffer, first * sizeof(InstanceData), source, (last - first) * sizeof(InstanceData));
+    }
+
+    // Adds the node ranges the last graph update rewrote to the ones waiting
+    // for UploadScene, keeping them ascending and merged.
+    void QueueChangedNodes(SceneState& scene)
+    {
+        if (scene.drawListDirty || scene.uploadAll)
+            return;   // everything goes up anyway
+
+        std::vector<TransformRange>& pending = scene.pendingUploads;
+        const TransformGraph&        graph   = scene.transforms;
+
+        size_t queued = pending.size();
+        pending.insert(pending.end(), graph.changed.begin(), graph.changed.end());
+        if (queued == 0)
+            return;
+
+        // updated twice without an upload in between
+        std::sort(pending.begin(), pending.end(), [](const TransformRange& a, const TransformRange& b) { return a.begin < b.begin; });
+        size_t last = 0;
+        for (size_t i = 1; i < pending.size(); ++i)
+        {
+            if (pending[i].begin <= pending[last].end)
+                pending[last].end = std::max(pending[last].end, pending[i].end);
+            else
+                pending[++last] = pending[i];
+        }
+        pending.resize(last + 1);
+    }
+
+    // Binds `fallback` as is when its shadow says it holds the constants
+    // already. Otherwise stages them in the arena (flushed by the caller before
+    // the draw is submitted), or writes them to `fallback` without one.
+    // Constants repeating the previous call's are written to `fallback` rather
+    // than staged again, so from then on they cost nothing: the previous
+    // frame's arena block cannot be bound instead, its space goes back to the
+    // ring as soon as that frame completes on the GPU.
+    ConstantRange PushDrawConstants(IRenderContext& context, const RenderResources& r, RenderHandle fallback, ConstantBufferShadow* shadow, const ConstantBuffer& constants)
+    {
+        ConstantRange whole;
+        whole.buffer = fallback;
+        if (shadow && shadow->valid && std::memcmp(&shadow->contents, &constants, sizeof(constants)) == 0)
+            return whole;
+
+        bool repeated = shadow && shadow->hasLast && std::memcmp(&shadow->last, &constants, sizeof(constants)) == 0;
+        if (shadow)
+        {
+            shadow->last    = constants;
+            shadow->hasLast = true;
+        }
+
+        if (r.constantArena && !repeated)
+        {
+            uint32_t offset = PushConstants(*r.constantArena, &constants, sizeof(constants));
+            if (offset != kConstantArenaFull)
+                return ConstantArenaRange(*r.constantArena, offset, sizeof(constants));
+        }
+
+        // a failed write leaves the buffer unknown
+        bool written = UpdateConstantBuffer(context, fallback, &constants, sizeof(constants));
+        if (shadow)
+        {
+            shadow->contents = constants;
+            shadow->valid    = written;
+        }
+        return whole;
+    }
+}   // namespace
+
+void UpdateScene(SceneState& scene, const bool keys[256], float deltaTime)
+{
+    KeyFrameInput input;
+    for (int key = 0; key < 256; ++key)
+        input.heldFraction[key] = keys[key] ? 1.f : 0.f;
+
+    UpdateSceneInput(scene, input, deltaTime);
+}
+
+void UpdateSceneInput(SceneState& scene, const KeyFrameInput& input, float deltaTime)
+{
+    PROFILE_SCOPE("UpdateScene");
+
+    // keyboard input, weighted by the share of the frame each key was held
+    const float* held = input.heldFraction;
+
+    scene.triPosition[1] += 1.f * (held['W'] - held['S']) * deltaTime;
+    scene.triPosition[0] += 1.f * (held['D'] - held['A']) * deltaTime;
+
+    scene.triScale[1] += 1.f * (held[KEY_UP] - held[KEY_DOWN]) * deltaTime;
+    scene.triScale[0] += 1.f * (held[KEY_RIGHT] - held[KEY_LEFT]) * deltaTime;
+
+    // wrapped like the instances' angles, so the polynomial sin/cos stays accurate
+    constexpr float twoPi = 6.28318530718f;
+    scene.triRotation     = std::remainder(scene.triRotation + 1.f * (held[KEY_CONTROL] - held[KEY_SPACE]) * deltaTime, twoPi);
+
+    if (held[KEY_ESCAPE] > 0.f || input.pressed[KEY_ESCAPE])
+        scene.quitRequested = true;
+
+    // instances
+    if (scene.requestedInstanceCount != static_cast<int>(SceneInstanceCount(scene)) || scene.instanceExtent != scene.layoutExtent)
+        LayoutSceneInstances(scene);
+
+    // spun in place in the graph; without a spin they stay clean
+    uint32_t count = static_cast<uint32_t>(SceneInstanceCount(scene));
+    float    angle = scene.instanceSpinSpeed * deltaTime;
+    if (angle == 0.f || count == 0)
+        return;
+
+    InstanceTransforms& local = scene.transforms.local;
+    if (scene.jobs)
+        ParallelFor(*scene.jobs, count, kSpinGrain, [&](uint32_t begin, uint32_t end) { RotateInstanceRange(local, kFirstInstanceNode + begin, end - begin, angle); });
+    else
+        RotateInstanceRange(local, kFirstInstanceNode, count, angle);
+    MarkTransformRangeDirty(scene.transforms, kFirstInstanceNode, kFirstInstanceNode + count);
+}
+
+size_t SceneInstanceCount(const SceneState& scene)
+{
+    size_t nodes = TransformNodeCount(scene.transforms);
+    return nodes > kFirstInstanceNode ? nodes - kFirstInstanceNode : 0;
+}
+
+void BuildSceneConstants(SceneState& scene)
+{
+    TransformGraph& graph = scene.transforms;
+    if (TransformNodeCount(graph) == 0)
+        AddTransformNode(graph, kNoTransformNode, scene.triPosition[0], scene.triPosition[1], scene.triScale[0], scene.triScale[1], scene.triRotation);
+    else
+        SetTransformLocal(graph, 0, scene.triPosition[0], scene.triPosition[1], scene.triScale[0], scene.triScale[1], scene.triRotation);
+
+    if (!UpdateTransformGraph(graph))
+        return;
+
+    // a root's world is its local Scale * RotationZ * Translation
+    if (graph.changed[0].begin == 0)
+        std::memcpy(scene.cpuConstantData.world, graph.world[0].world, sizeof(scene.cpuConstantData.world));
+    QueueChangedNodes(scene);
+}
+
+bool UploadScene(IRenderContext& context, const RenderResources& resources, SceneState& scene)
+{
+    PROFILE_SCOPE("UploadScene");
+
+    BuildSceneConstants(scene);
+    RefreshDrawList(scene, resources.instanceCapacity);
+
+    if (scene.uploadAll)
+    {
+        UploadDrawnInstances(context, resources, scene, 0, scene.drawnInstances);
+        scene.uploadAll = false;
+    }
+    else
+    {
+        for (const TransformRange& range : scene.pendingUploads)
+            UploadDrawnInstances(context, resources, scene, DrawnSlot(scene, range.begin), DrawnSlot(scene, range.end));
+    }
+    scene.pendingUploads.clear();
+
+    return true;
+}
+
+bool PickSceneInstance(const SceneState& scene, float x, float y, uint32_t& index)
+{
+    // the grid holds boxes around the circles; narrow down to the circles
+    std::vector<uint32_t> hits;
+    QuerySpatialPoint(scene.instanceGrid, x, y, hits);
+
+    const InstanceTransforms& t     = scene.transforms.local;
+    bool                      found = false;
+    for (uint32_t i : hits)
+    {
+        float r  = InstanceRadius(scene, i);
+        float dx = x - t.positionX[kFirstInstanceNode + i];
+        float dy = y - t.positionY[kFirstInstanceNode + i];
+        if (dx * dx + dy * dy <= r * r && (!found || i > index))
+        {
+            index = i;
+            found = true;
+        }
+    }
+    return found;
+}
+
+SceneControls GetSceneControls(const SceneState& scene)
+{
+    SceneControls controls;
+    std::memcpy(controls.triPosition, scene.triPosition, sizeof(controls.triPosition));
+    std::memcpy(controls.triScale, scene.triScale, sizeof(controls.triScale));
+    controls.triRotation            = scene.triRotation;
+    controls.requestedInstanceCount = scene.requestedInstanceCount;
+    controls.instanceSpinSpeed      = scene.instanceSpinSpeed;
+    controls.instanceExtent         = scene.instanceExtent;
+    controls.cullInstances          = scene.cullInstances;
+    return controls;
+}
+
+void ApplySceneControls(SceneState& scene, const SceneControls& controls)
+{
+    std::memcpy(scene.triPosition, controls.triPosition, sizeof(scene.triPosition));
+    std::memcpy(scene.triScale, controls.triScale, sizeof(scene.triScale));
+    scene.triRotation            = controls.triRotation;
+    scene.requestedInstanceCount = controls.requestedInstanceCount;
+    scene.instanceSpinSpeed      = controls.instanceSpinSpeed;
+    scene.instanceExtent         = controls.instanceExtent;
+    scene.cullInstances          = controls.cullInstances;
+}
+
+uint64_t HashSceneState(const SceneState& scene)
+{
+    SceneControls controls = GetSceneControls(scene);
+
+    uint64_t hash = 14695981039346656037ull;
+    hash          = HashBytes(hash, controls.triPosition, sizeof(controls.triPosition));
+    hash          = HashBytes(hash, controls.triScale, sizeof(controls.triScale));
+    hash          = HashBytes(hash, &controls.triRotation, sizeof(controls.triRotation));
+    hash          = HashBytes(hash, &controls.requestedInstanceCount, sizeof(controls.requestedInstanceCount));
+    hash          = HashBytes(hash, &controls.instanceSpinSpeed, sizeof(controls.instanceSpinSpeed));
+    hash          = HashBytes(hash, &controls.instanceExtent, sizeof(controls.instanceExtent));
+    hash          = HashBytes(hash, &controls.cullInstances, sizeof(controls.cullInstances));
+    hash          = HashBytes(hash, &scene.quitRequested, sizeof(scene.quitRequested));
+    hash          = HashInstanceFloats(hash, scene.transforms.local.positionX);
+    hash          = HashInstanceFloats(hash, scene.transforms.local.positionY);
+    hash          = HashInstanceFloats(hash, scene.transforms.local.scaleX);
+    hash          = HashInstanceFloats(hash, scene.transforms.local.scaleY);
+    hash          = HashInstanceFloats(hash, scene.transforms.local.rotation);
+    return hash;
+}
+
+void CaptureSceneSnapshot(SceneState& scene, size_t instanceCapacity, SceneSnapshot& snapshot)
+{
+    PROFILE_SCOPE("CaptureSceneSnapshot");
+
+    BuildSceneConstants(scene);
+
+    snapshot.constants     = scene.cpuConstantData;
+    snapshot.controls      = GetSceneControls(scene);
+    snapshot.quitRequested = scene.quitRequested;
+
+    RefreshDrawList(scene, instanceCapacity);
+    snapshot.instances.resize(scene.drawnInstances);
+    CopyDrawnInstances(scene, 0, scene.drawnInstances, snapshot.instances.data());
+
+    // the renderer uploads the snapshots; an UploadScene after them starts over
+    scene.uploadAll = true;
+    scene.pendingUploads.clear();
+}
+
+bool UploadSceneSnapshot(IRenderContext& context, const RenderResources& resources, const SceneSnapshot& snapshot)
+{
+    PROFILE_SCOPE("UploadSceneSnapshot");
+
+    size_t count = std::min<size_t>(snapshot.instances.size(), resources.instanceCapacity);
+    if (count == 0)
+        return true;
+
+    // already packed on the simulation thread, this is only the copy
+    context.UpdateBuffer(resources.instanceBuffer, 0, snapshot.instances.data(), count * sizeof(InstanceData));
+
+    return true;
+}
+
+ConstantRange RenderScene(IRenderContext& c, RenderResources& r, const ConstantBuffer& constants, size_t instanceCount, DrawBucket& bucket)
+{
+    PROFILE_SCOPE("RenderScene");
+
+    ConstantRange triangleConstants = PushDrawConstants(c, r, r.constantBuffer, &r.constantBufferShadow, constants);
+
+    // Pass state
+    c.SetPrimitiveTopology(PrimitiveTopology::TriangleList);
+    c.SetViewport(r.viewport);
+    c.SetRenderTarget(r.renderTargetView);
+    c.ClearRenderTarget(r.renderTargetView, r.clearColor);
+
+    ResetDrawBucket(bucket, 1);
+    std::vector<DrawCommand>& commands = bucket.lists[0].commands;
+
+    DrawCommand triangle      = {};
+    triangle.sortKey          = MakeDrawSortKey(0, 0, 0, 0.f);
+    triangle.inputLayout      = r.inputLayout;
+    triangle.vertexShader     = r.vertexShader;
+    triangle.pixelShader      = r.pixelShader;
+    triangle.constants        = triangleConstants;
+    triangle.indexBuffer      = r.indexBuffer;
+    triangle.indexFormat      = r.indexFormat;
+    triangle.vertexBuffers[0] = r.vertexBuffer;
+    triangle.vertexStrides[0] = r.vertexStride;
+    triangle.vertexOffsets[0] = r.vertexOffset;
+    triangle.indexCount       = r.indexCount;
+    commands.push_back(triangle);
+
+    // Instances: one draw for every copy; none while their shader still builds
+    instanceCount = std::min<size_t>(instanceCount, r.instanceCapacity);
+    if (instanceCount && r.instancedVertexShader)
+    {
+        DrawCommand instanced      = triangle;
+        instanced.sortKey          = MakeDrawSortKey(0, 1, 1, 0.f);
+        instanced.inputLayout      = r.instancedInputLayout;
+        instanced.vertexShader     = r.instancedVertexShader;
+        instanced.vertexBuffers[1] = r.instanceBuffer;
+        instanced.vertexStrides[1] = r.instanceStride;
+        instanced.instanceCount    = static_cast<uint32_t>(instanceCount);
+        commands.push_back(instanced);
+    }
+
+    if (r.constantArena)
+        FlushConstantArena(*r.constantArena, c);
+
+    SortDrawBucket(bucket);
+    SubmitDrawBucket(bucket, c);
+    return triangleConstants;
+}
+
+void RenderDebugOverlay(PrimitiveBatcher& batcher, const RenderResources& r, const ConstantRange& triangleConstants, const BatchVertex* outline, size_t outlineCount, const float* frameTimesMs, size_t frameCount)
+{
+    PROFILE_SCOPE("RenderDebugOverlay");
+
+    // the scene may have been drawn to another target and size
+    batcher.context->SetRenderTarget(r.renderTargetView);
+    batcher.context->SetViewport(r.viewport);
+
+    // pixel (x, y) from the top left -> clip space
+    ConstantBuffer pixelToClip = {};
+    pixelToClip.world[0]       = 2.f / r.viewport.width;
+    pixelToClip.world[5]       = -2.f / r.viewport.height;
+    pixelToClip.world[10]      = 1.f;
+    pixelToClip.world[12]      = -1.f;
+    pixelToClip.world[13]      = 1.f;
+    pixelToClip.world[15]      = 1.f;
+    ConstantRange overlayConstants = PushDrawConstants(*batcher.context, r, r.overlayConstantBuffer, nullptr, pixelToClip);
+    if (r.constantArena)
+        FlushConstantArena(*r.constantArena, *batcher.context);
+
+    // outline: same transform as the triangle itself
+    SetBatchConstantRange(batcher, triangleConstants);
+    for (size_t i = 0; i < outlineCount; ++i)
+    {
+        BatchVertex a = outline[i];
+        BatchVertex b = outline[i + 1 == outlineCount ? 0 : i + 1];
+        a.r = a.g = a.b = 1.f;
+        b.r = b.g = b.b = 1.f;
+        BatchLine(batcher, a, b);
+    }
+
+    // frame times: one bar per frame, 4 px per ms, red past 60 Hz
+    const float left     = 10.f;
+    const float bottom   = r.viewport.height - 10.f;
+    const float pxPerMs  = 4.f;
+    const float budgetMs = 1000.f / 60.f;
+    const float panel[3] = { 0.1f, 0.1f, 0.1f };
+    const float good[3]  = { 0.2f, 0.8f, 0.2f };
+    const float bad[3]   = { 0.9f, 0.2f, 0.2f };
+    const float maxBarPx = 2.f * budgetMs * pxPerMs;
+
+    SetBatchConstantRange(batcher, overlayConstants);
+    BatchRect(batcher, left, bottom - maxBarPx, 2.f * frameCount, maxBarPx, panel);
+    for (size_t i = 0; i < frameCount; ++i)
+    {
+        float height = std::min(frameTimesMs[i] * pxPerMs, maxBarPx);
+        BatchRect(batcher, left + 2.f * i, bottom - height, 2.f, height, frameTimesMs[i] > budgetMs ? bad : good);
+    }
+
+    BatchVertex budgetLine[2] = {
+        { left, bottom - budgetMs * pxPerMs, 1.f, 1.f, 0.f },
+        { left + 2.f * frameCount, bottom - budgetMs * pxPerMs, 1.f, 1.f, 0.f },
+    };
+    BatchLine(batcher, budgetLine[0], budgetLine[1]);
+}
+
+bool UpdateConstantBuffer(IRenderContext& context, RenderHandle buffer, const void* data, size_t size)
+{
+    void* mapped = context.Map(buffer, MapMode::WriteDiscard);
+    if (!mapped)
+        return false;
+
+    std::memcpy(mapped, data, size);
+
+    context.Unmap(buffer, size);
+
+    return true;
+}
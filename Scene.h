@@ -0,0 +1,192 @@
+#pragma once
+
+#include "ConstantArena.h"
+#include "DrawBucket.h"
+#include "InputEvents.h"
+#include "InstanceBuffer.h"
+#include "JobSystem.h"
+#include "PrimitiveBatcher.h"
+#include "RenderContext.h"
+#include "SpatialGrid.h"
+#include "TransformGraph.h"
+#include "VertexFormat.h"
+
+#include <cstdint>
+#include <vector>
+
+// Virtual-key codes the update reads; same values as VK_*, so WndProc's
+// wParam indexes the key array directly.
+constexpr uint8_t KEY_CONTROL = 0x11;
+constexpr uint8_t KEY_ESCAPE  = 0x1B;
+constexpr uint8_t KEY_SPACE   = 0x20;
+constexpr uint8_t KEY_LEFT    = 0x25;
+constexpr uint8_t KEY_UP      = 0x26;
+constexpr uint8_t KEY_RIGHT   = 0x27;
+constexpr uint8_t KEY_DOWN    = 0x28;
+
+// Layout the scene geometry is uploaded in. The triangle lies within [-1, 1],
+// so every format holds it without rescaling.
+constexpr VertexFormat kSceneVertexFormat = VertexFormat::Half;
+
+struct alignas(16) ConstantBuffer
+{
+    float world[16];   // 64 bytes, row-major
+};
+
+// What a constant buffer was last written with, so unchanged constants are
+// not uploaded again.
+struct ConstantBufferShadow
+{
+    ConstantBuffer contents = {};
+    bool           valid    = false;
+    ConstantBuffer last     = {};   // the previous draw's, wherever they went
+    bool           hasLast  = false;
+};
+
+// Node of instance 0 in SceneState::transforms; node 0 is the triangle.
+constexpr uint32_t kFirstInstanceNode = 1;
+
+struct SceneState
+{
+    float triPosition[2] = { 0.f, 0.f };
+    float triScale[2]    = { 1.f, 1.f };
+    float triRotation    = 0.f;
+
+    int   requestedInstanceCount = 0;
+    float instanceSpinSpeed      = 1.f;
+    float instanceExtent         = 1.f;    // half size of the instance layout; past 1 it spills off screen
+    float instanceRadius         = 0.5f;   // local bounding radius of the scene mesh, set before the first update
+    bool  cullInstances          = true;
+
+    // The triangle and then every instance, all roots. The instances' locals
+    // are their simulated transforms; world matrices are only rebuilt for the
+    // nodes that moved.
+    TransformGraph transforms;
+    ConstantBuffer cpuConstantData = {};
+
+    // Instance bounds are circles, so spinning never touches the grid or the
+    // culling; both are only redone with the layout.
+    SpatialGrid           instanceGrid;
+    float                 layoutExtent = 0.f;
+    std::vector<uint32_t> visibleInstances;
+
+    // What the instance buffer holds: drawnInstances world matrices, in
+    // instance order or, when culled, those in visibleInstances. UploadScene
+    // rewrites only the ranges of nodes that changed since its last call.
+    size_t                      drawnInstances = 0;
+    bool                        drawnCulled    = false;
+    bool                        drawListDirty  = true;   // layout changed: cull and upload everything again
+    bool                        uploadAll      = true;   // the buffer was written elsewhere, e.g. from snapshots
+    std::vector<TransformRange> pendingUploads;          // node ranges changed since the last UploadScene
+    std::vector<InstanceData>   packedInstances;         // culled instances gathered for the upload
+
+    bool quitRequested = false;
+
+    // Splits the per-instance passes (spin and packing) across its workers
+    // when set. Only the thread that started it fans out; elsewhere, e.g. on
+    // the simulation thread, the passes run inline.
+    JobSystem* jobs = nullptr;
+};
+
+// The values the UI edits.
+struct SceneControls
+{
+    float triPosition[2]         = { 0.f, 0.f };
+    float triScale[2]            = { 1.f, 1.f };
+    float triRotation            = 0.f;
+    int   requestedInstanceCount = 0;
+    float instanceSpinSpeed      = 1.f;
+    float instanceExtent         = 1.f;
+    bool  cullInstances          = true;
+};
+
+// Everything the render side needs from one simulated frame. Immutable once published.
+struct SceneSnapshot
+{
+    uint64_t                  frame     = 0;
+    ConstantBuffer            constants = {};
+    std::vector<InstanceData> instances;   // packed (visible ones only when culling), ready to copy into the instance buffer
+    SceneControls             controls;
+    bool                      quitRequested = false;
+};
+
+// Backend objects the scene draws with, plus their fixed parameters.
+struct RenderResources
+{
+    RenderHandle inputLayout           = nullptr;
+    RenderHandle instancedInputLayout  = nullptr;
+    RenderHandle vertexShader          = nullptr;
+    RenderHandle instancedVertexShader = nullptr;   // null while it builds: instances are not drawn
+    RenderHandle pixelShader           = nullptr;
+    RenderHandle vertexBuffer          = nullptr;
+    RenderHandle indexBuffer           = nullptr;
+    RenderHandle constantBuffer        = nullptr;
+    RenderHandle instanceBuffer        = nullptr;   // written with UpdateBuffer only, never mapped
+    RenderHandle overlayConstantBuffer = nullptr;   // pixels to clip space, for the debug overlay
+    RenderHandle renderTargetView      = nullptr;
+
+    ConstantBufferShadow constantBufferShadow;   // what constantBuffer holds
+
+    // Per-draw constants go here when set, bound by offset; the two constant
+    // buffers above are the fallback when it is null or full.
+    ConstantArena* constantArena = nullptr;
+
+    uint32_t    vertexStride     = 0;
+    uint32_t    vertexOffset     = 0;
+    uint32_t    indexCount       = 0;
+    IndexFormat indexFormat      = IndexFormat::UInt32;
+    uint32_t    instanceStride   = sizeof(InstanceData);
+    uint32_t    instanceCapacity = 1 << 17;
+
+    RenderViewport viewport;
+    float          clearColor[4] = { 0.f, 0.f, 0.f, 1.f };
+};
+
+// Keyboard input and instance animation; pure CPU. Movement is scaled by how
+// much of the frame each key was held, so taps shorter than a frame count.
+void UpdateSceneInput(SceneState& scene, const KeyFrameInput& input, float deltaTime);
+
+// Same with every key in `keys` held for the whole frame.
+void UpdateScene(SceneState& scene, const bool keys[256], float deltaTime);
+
+size_t SceneInstanceCount(const SceneState& scene);
+
+// Updates the transform graph: the triangle's world matrix into
+// scene.cpuConstantData when it moved, and the instance nodes that changed
+// queued for UploadScene. A still scene costs a compare.
+void BuildSceneConstants(SceneState& scene);
+
+// Triangle constants into scene.cpuConstantData and the instance buffer
+// upload. With culling only the instances overlapping the view are drawn, in
+// index order. Only the changed instances are written, with UpdateBuffer;
+// nothing at all when none moved.
+bool UploadScene(IRenderContext& context, const RenderResources& resources, SceneState& scene);
+
+// Topmost instance whose bounding circle contains the world-space point.
+bool PickSceneInstance(const SceneState& scene, float x, float y, uint32_t& index);
+
+SceneControls GetSceneControls(const SceneState& scene);
+void          ApplySceneControls(SceneState& scene, const SceneControls& controls);
+
+// FNV-1a over the simulated state: the UI values, the quit flag and every
+// instance transform. Derived data (grid, constants, culling) is left out.
+uint64_t HashSceneState(const SceneState& scene);
+
+// Constants, packed instances (at most instanceCapacity) and UI values of `scene`.
+// Reuses the snapshot's storage.
+void CaptureSceneSnapshot(SceneState& scene, size_t instanceCapacity, SceneSnapshot& snapshot);
+bool UploadSceneSnapshot(IRenderContext& context, const RenderResources& resources, const SceneSnapshot& snapshot);
+
+// Pass setup, then the scene's draws recorded into `bucket`, sorted and
+// submitted. Uploads the triangle's constants and returns where they are bound;
+// constants that did not change since the last frame are bound from
+// constantBuffer, which is not rewritten while it already holds them.
+ConstantRange RenderScene(IRenderContext& context, RenderResources& resources, const ConstantBuffer& constants, size_t instanceCount, DrawBucket& bucket);
+
+// Debug overlay through the batcher, after RenderScene: the triangle's outline
+// in world space (with the constants RenderScene returned) and a frame time
+// graph in pixels (oldest first). Binds resources.renderTargetView and
+// resources.viewport; the caller ends the batcher frame.
+void RenderDebugOverlay(PrimitiveBatcher& batcher, const RenderResources& resources, const ConstantRange& triangleConstants, const BatchVertex* outline, size_t outlineCount, const float* frameTimesMs, size_t frameCount);
+
+bool UpdateConstantBuffer(IRenderContext& context, RenderHandle buffer, const void* data, size_t size);
@@ -0,0 +1,324 @@
+#include "ShaderCache.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+
+namespace
+{
+    constexpr uint32_t kShaderCacheMagic   = 0x43444853;   // "SHDC"
+    constexpr uint32_t kShaderCacheVersion = 1;
+    constexpr uint32_t kBlobAlignment      = 16;
+
+    // On-disk layout: header, entryCount table entries, then the blobs.
+    struct ShaderCacheHeader
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t entryCount;
+        uint32_t reserved;
+        uint64_t generation;
+        uint64_t tableChecksum;
+    };
+
+    struct ShaderCacheTableEntry
+    {
+        uint64_t key;
+        uint64_t lastUsed;
+        uint64_t checksum;
+        uint32_t offset;
+        uint32_t size;
+    };
+
+    static_assert(sizeof(ShaderCacheHeader) == 32, "file layout");
+    static_assert(sizeof(ShaderCacheTableEntry) == 32, "file layout");
+
+    constexpr uint64_t kFnvOffset = 14695981039346656037ull;
+    constexpr uint64_t kFnvPrime  = 1099511628211ull;
+
+    uint64_t Fnv1a(uint64_t hash, const void* data, size_t size)
+    {
+        const uint8_t* bytes = static_cast<const uint8_t*>(data);
+        for (size_t i = 0; i < size; ++i)
+            hash = (hash ^ bytes[i]) * kFnvPrime;
+        return hash;
+    }
+
+    uint64_t Fnv1aString(uint64_t hash, const char* s)
+    {
+        // the terminator is hashed too, so "ab","c" and "a","bc" differ
+        return Fnv1a(hash, s ? s : "", s ? std::strlen(s) + 1 : 1);
+    }
+
+    const uint8_t* EntryData(const ShaderCacheEntry& entry)
+    {
+        return entry.owned.empty() ? entry.mapped : entry.owned.data();
+    }
+
+    void ResetEntries(ShaderCache& cache)
+    {
+        cache.entries.clear();
+        CloseMappedFile(cache.file);
+    }
+
+    // Reads the table from the mapped file. Returns false if the file is missing;
+    // a corrupt or outdated file is dropped and marks the cache dirty.
+    bool LoadShaderCacheFile(ShaderCache& cache)
+    {
+        ResetEntries(cache);
+
+        if (!OpenMappedFile(cache.file, cache.path.c_str()))
+            return false;
+
+        const MappedFile& file   = cache.file;
+        ShaderCacheHeader header = {};
+        if (file.size >= sizeof(header))
+            std::memcpy(&header, file.data, sizeof(header));
+
+        size_t tableBytes = static_cast<size_t>(header.entryCount) * sizeof(ShaderCacheTableEntry);
+
+        bool valid = file.size >= sizeof(header) && header.magic == kShaderCacheMagic && header.version == kShaderCacheVersion;
+        valid      = valid && tableBytes <= file.size - sizeof(header);
+        valid      = valid && Fnv1a(kFnvOffset, file.data + sizeof(header), tableBytes) == header.tableChecksum;
+
+        if (!valid)
+        {
+            ++cache.stats.corrupt;
+            cache.dirty = true;
+            ResetEntries(cache);
+            return true;
+        }
+
+        cache.generation = header.generation;
+
+        for (uint32_t i = 0; i < header.entryCount; ++i)
+        {
+            ShaderCacheTableEntry e;
+            std::memcpy(&e, file.data + sizeof(header) + i * sizeof(e), sizeof(e));
+
+            if (static_cast<uint64_t>(e.offset) + e.size > file.size || cache.entries.count(e.key))
+            {
+                ++cache.stats.corrupt;
+                cache.dirty = true;
+                continue;
+            }
+
+            ShaderCacheEntry& entry = cache.entries[e.key];
+            entry.lastUsed          = e.lastUsed;
+            entry.mapped            = file.data + e.offset;
+            entry.size              = e.size;
+            entry.checksum          = e.checksum;
+        }
+        return true;
+    }
+
+    bool WriteShaderCacheFile(const ShaderCache& cache, const std::vector<uint64_t>& keys, const char* path)
+    {
+        std::vector<ShaderCacheTableEntry> table;
+        table.reserve(keys.size());
+
+        uint64_t offset = sizeof(ShaderCacheHeader) + keys.size() * sizeof(ShaderCacheTableEntry);
+        for (uint64_t key : keys)
+        {
+            const ShaderCacheEntry& entry = cache.entries.at(key);
+
+            offset = (offset + kBlobAlignment - 1) & ~static_cast<uint64_t>(kBlobAlignment - 1);
+            if (offset + entry.size > UINT32_MAX)
+                return false;
+
+            table.push_back({ key, entry.lastUsed, entry.checksum, static_cast<uint32_t>(offset), entry.size });
+            offset += entry.size;
+        }
+
+        ShaderCacheHeader header = {};
+        header.magic             = kShaderCacheMagic;
+        header.version           = kShaderCacheVersion;
+        header.entryCount        = static_cast<uint32_t>(table.size());
+        header.generation        = cache.generation;
+        header.tableChecksum     = Fnv1a(kFnvOffset, table.data(), table.size() * sizeof(ShaderCacheTableEntry));
+
+        FILE* file = std::fopen(path, "wb");
+        if (!file)
+            return false;
+
+        std::fwrite(&header, sizeof(header), 1, file);
+        std::fwrite(table.data(), sizeof(ShaderCacheTableEntry), table.size(), file);
+
+        static const uint8_t padding[kBlobAlignment] = {};
+        uint64_t             written                 = sizeof(header) + table.size() * sizeof(ShaderCacheTableEntry);
+        for (size_t i = 0; i < keys.size(); ++i)
+        {
+            std::fwrite(padding, 1, table[i].offset - written, file);
+            std::fwrite(EntryData(cache.entries.at(keys[i])), 1, table[i].size, file);
+            written = table[i].offset + table[i].size;
+        }
+
+        bool ok = std::ferror(file) == 0;
+        return std::fclose(file) == 0 && ok;
+    }
+}   // namespace
+
+uint64_t HashShaderRequest(const ShaderCompileRequest& request)
+{
+    uint64_t hash = kFnvOffset;
+    hash          = Fnv1a(hash, &request.sourceSize, sizeof(request.sourceSize));
+    hash          = Fnv1a(hash, request.source, request.sourceSize);
+    hash          = Fnv1aString(hash, request.entryPoint);
+    hash          = Fnv1aString(hash, request.target);
+    for (size_t i = 0; i < request.defineCount; ++i)
+    {
+        hash = Fnv1aString(hash, request.defines[i].name);
+        hash = Fnv1aString(hash, request.defines[i].value);
+    }
+    hash = Fnv1a(hash, &request.defineCount, sizeof(request.defineCount));
+    hash = Fnv1a(hash, &request.flags, sizeof(request.flags));
+    return hash;
+}
+
+void OpenShaderCache(ShaderCache& cache, const char* path, size_t maxBytes)
+{
+    CloseShaderCache(cache);
+
+    cache          = {};
+    cache.path     = path;
+    cache.maxBytes = maxBytes;
+
+    if (!LoadShaderCacheFile(cache))
+        cache.dirty = true;   // no file yet
+
+    ++cache.generation;
+}
+
+bool FindCachedShader(ShaderCache& cache, const ShaderCompileRequest& request, ShaderBytecode& out)
+{
+    auto it = cache.entries.find(HashShaderRequest(request));
+    if (it != cache.entries.end())
+    {
+        ShaderCacheEntry& entry = it->second;
+        if (!entry.verified)
+            entry.verified = Fnv1a(kFnvOffset, EntryData(entry), entry.size) == entry.checksum;
+
+        if (entry.verified)
+        {
+            // the use decides what eviction keeps, so it has to be saved
+            ++cache.stats.hits;
+            if (entry.lastUsed != cache.generation)
+            {
+                entry.lastUsed = cache.generation;
+                cache.dirty    = true;
+            }
+            out = { EntryData(entry), entry.size };
+            return true;
+        }
+
+        ++cache.stats.corrupt;
+        cache.entries.erase(it);
+    }
+
+    ++cache.stats.misses;
+    return false;
+}
+
+bool AddCompiledShader(ShaderCache& cache, const ShaderCompileRequest& request, std::vector<uint8_t>&& bytecode, double compileMs, ShaderBytecode& out)
+{
+    cache.stats.compileMs += compileMs;
+    if (bytecode.empty() || bytecode.size() > UINT32_MAX)
+        return false;
+
+    ShaderCacheEntry& entry = cache.entries[HashShaderRequest(request)];
+    entry.lastUsed          = cache.generation;
+    entry.size              = static_cast<uint32_t>(bytecode.size());
+    entry.checksum          = Fnv1a(kFnvOffset, bytecode.data(), bytecode.size());
+    entry.verified          = true;
+    entry.owned             = std::move(bytecode);
+    cache.dirty             = true;
+
+    out = { entry.owned.data(), entry.size };
+    return true;
+}
+
+bool GetOrCompileShader(ShaderCache&                cache,
+                        IShaderCompiler&            compiler,
+                        const ShaderCompileRequest& request,
+                        ShaderBytecode&             out,
+                        std::string*                errors)
+{
+    if (FindCachedShader(cache, request, out))
+        return true;
+
+    std::vector<uint8_t> bytecode;
+    std::string          compileErrors;
+
+    auto   begin     = std::chrono::steady_clock::now();
+    bool   ok        = compiler.Compile(request, bytecode, compileErrors);
+    double compileMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+
+    if (errors)
+        *errors = compileErrors;
+    if (!ok)
+    {
+        cache.stats.compileMs += compileMs;
+        return false;
+    }
+    return AddCompiledShader(cache, request, std::move(bytecode), compileMs, out);
+}
+
+bool SaveShaderCache(ShaderCache& cache)
+{
+    if (!cache.dirty)
+        return true;
+
+    // most recently used first; whatever does not fit in maxBytes is evicted
+    std::vector<uint64_t> keys;
+    keys.reserve(cache.entries.size());
+    for (const auto& [key, entry] : cache.entries)
+        keys.push_back(key);
+
+    std::sort(keys.begin(), keys.end(), [&](uint64_t a, uint64_t b) {
+        uint64_t ua = cache.entries.at(a).lastUsed;
+        uint64_t ub = cache.entries.at(b).lastUsed;
+        return ua != ub ? ua > ub : a < b;
+    });
+
+    size_t total = 0;
+    size_t kept  = 0;
+    for (; kept < keys.size(); ++kept)
+    {
+        size_t size = cache.entries.at(keys[kept]).size;
+        if (total + size > cache.maxBytes)
+            break;
+        total += size;
+    }
+    cache.stats.evictions += static_cast<uint32_t>(keys.size() - kept);
+    keys.resize(kept);
+
+    // write next to the old file, then swap it in; the old mapping is read while writing
+    std::string tempPath = cache.path + ".tmp";
+    if (!WriteShaderCacheFile(cache, keys, tempPath.c_str()))
+    {
+        std::remove(tempPath.c_str());
+        return false;
+    }
+
+    CloseMappedFile(cache.file);
+
+    std::error_code error;
+    std::filesystem::rename(tempPath, cache.path, error);
+    if (error)
+    {
+        std::remove(tempPath.c_str());
+        ResetEntries(cache);
+        return false;
+    }
+
+    cache.dirty = false;
+    LoadShaderCacheFile(cache);
+    return true;
+}
+
+void CloseShaderCache(ShaderCache& cache)
+{
+    ResetEntries(cache);
+}
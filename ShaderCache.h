@@ -0,0 +1,102 @@
+#pragma once
+
+#include "MappedFile.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct ShaderDefine
+{
+    const char* name;
+    const char* value;
+};
+
+struct ShaderCompileRequest
+{
+    const char*         source      = nullptr;
+    size_t              sourceSize  = 0;
+    const char*         entryPoint  = nullptr;
+    const char*         target      = nullptr;   // e.g. "vs_5_0"
+    const ShaderDefine* defines     = nullptr;
+    size_t              defineCount = 0;
+    uint32_t            flags       = 0;         // compiler flags, part of the key
+};
+
+// The compiler behind the cache: D3DCompile on Windows, a stub in the benchmark.
+struct IShaderCompiler
+{
+    virtual ~IShaderCompiler() = default;
+
+    // Returns false and fills `errors` on failure.
+    virtual bool Compile(const ShaderCompileRequest& request, std::vector<uint8_t>& bytecode, std::string& errors) = 0;
+};
+
+// View of cached bytecode. Valid until SaveShaderCache or CloseShaderCache.
+struct ShaderBytecode
+{
+    const uint8_t* data = nullptr;
+    size_t         size = 0;
+};
+
+struct ShaderCacheStats
+{
+    uint32_t hits      = 0;
+    uint32_t misses    = 0;
+    uint32_t corrupt   = 0;   // entries (or whole files) rejected on load or lookup
+    uint32_t evictions = 0;
+    double   compileMs = 0.0;
+};
+
+struct ShaderCacheEntry
+{
+    uint64_t             lastUsed = 0;   // cache generation of the last use, written on save
+    const uint8_t*       mapped   = nullptr;
+    uint32_t             size     = 0;
+    uint64_t             checksum = 0;
+    bool                 verified = false;
+    std::vector<uint8_t> owned;   // freshly compiled, not yet in the file
+};
+
+// Bytecode blobs keyed by a hash of source, entry point, target, defines and
+// flags. The file is memory-mapped on open; each blob's checksum is verified
+// the first time it is used. One thread at a time; AsyncShaderBuilder keeps it
+// on the owning thread.
+struct ShaderCache
+{
+    std::string path;
+    size_t      maxBytes   = 0;   // blob bytes kept by SaveShaderCache, oldest evicted first
+    uint64_t    generation = 0;   // bumped on every open
+    bool        dirty      = false;
+
+    MappedFile                                     file;
+    std::unordered_map<uint64_t, ShaderCacheEntry> entries;
+
+    ShaderCacheStats stats;
+};
+
+uint64_t HashShaderRequest(const ShaderCompileRequest& request);
+
+// Loads `path` if it exists and is valid; a bad or outdated file is ignored
+// and replaced on the next save.
+void OpenShaderCache(ShaderCache& cache, const char* path, size_t maxBytes);
+
+// Verified cached bytecode for `request`; counts a hit or a miss.
+bool FindCachedShader(ShaderCache& cache, const ShaderCompileRequest& request, ShaderBytecode& out);
+
+// Stores bytecode compiled elsewhere, e.g. on another thread, after a miss.
+// False for empty or oversized bytecode.
+bool AddCompiledShader(ShaderCache& cache, const ShaderCompileRequest& request, std::vector<uint8_t>&& bytecode, double compileMs, ShaderBytecode& out);
+
+bool GetOrCompileShader(ShaderCache&                cache,
+                        IShaderCompiler&            compiler,
+                        const ShaderCompileRequest& request,
+                        ShaderBytecode&             out,
+                        std::string*                errors);
+
+// Rewrites the file if anything changed, including which entries were last used.
+// Invalidates previous ShaderBytecode views.
+bool SaveShaderCache(ShaderCache& cache);
+void CloseShaderCache(ShaderCache& cache);
@@ -0,0 +1,158 @@
+#include "SimulationThread.h"
+#include "FrameTimer.h"
+#include "Profiler.h"
+
+#include <cstring>
+
+namespace
+{
+    void SimulationMain(SimulationThread& sim)
+    {
+        PROFILE_THREAD("Simulation");
+
+        uint64_t appliedVersion = 0;
+        uint64_t previousNs     = NowNanoseconds();
+
+        while (true)
+        {
+            // don't get more than frameLag snapshots ahead of the renderer
+            {
+                std::unique_lock<std::mutex> lock(sim.mutex);
+                sim.wake.wait(lock, [&]() {
+                    return !sim.running ||
+                           (sim.producedFrame - sim.consumedFrame <= static_cast<uint64_t>(sim.frameLag) && sim.producedFrame < sim.frameLimit);
+                });
+                if (!sim.running)
+                    break;
+            }
+
+            PROFILE_SCOPE("SimulationFrame");
+
+            uint64_t nowNs     = NowNanoseconds();
+            float    deltaTime = sim.fixedDeltaTime > 0.f ? sim.fixedDeltaTime : static_cast<float>((nowNs - previousNs) / 1e9);
+            previousNs         = nowNs;
+
+            sim.inputs.Update();
+            const SimulationInput& input = sim.inputs.ReadBuffer();
+            if (input.controlsVersion != appliedVersion)
+            {
+                ApplySceneControls(sim.scene, input.controls);
+                appliedVersion = input.controlsVersion;
+            }
+
+            UpdateScene(sim.scene, input.keys, deltaTime);
+
+            SceneSnapshot& snapshot = sim.snapshots.WriteBuffer();
+            CaptureSceneSnapshot(sim.scene, sim.instanceCapacity, snapshot);
+
+            // only this thread writes producedFrame, so reading it unlocked is fine
+            snapshot.frame = sim.producedFrame + 1;
+            sim.snapshots.Publish();
+
+            {
+                std::lock_guard<std::mutex> lock(sim.mutex);
+                ++sim.producedFrame;
+            }
+            sim.wake.notify_all();
+        }
+    }
+}   // namespace
+
+void StartSimulationThread(SimulationThread& sim, const SceneState& initial, size_t instanceCapacity, int frameLag, float fixedDeltaTime)
+{
+    StopSimulationThread(sim);
+
+    sim.scene            = initial;
+    sim.instanceCapacity = instanceCapacity;
+    sim.fixedDeltaTime   = fixedDeltaTime;
+    sim.skippedSnapshots = 0;
+
+    // the first frame must not pick up input left over from a previous run
+    SceneControls controls  = GetSceneControls(initial);
+    bool          keys[256] = {};
+    PostSimulationInput(sim, keys, &controls);
+
+    sim.producedFrame = 0;
+    sim.consumedFrame = 0;
+    sim.frameLag      = frameLag;
+    sim.running       = true;
+
+    sim.thread = std::thread(SimulationMain, std::ref(sim));
+}
+
+void StopSimulationThread(SimulationThread& sim)
+{
+    {
+        std::lock_guard<std::mutex> lock(sim.mutex);
+        sim.running = false;
+    }
+    sim.wake.notify_all();
+
+    if (sim.thread.joinable())
+        sim.thread.join();
+}
+
+bool IsSimulationRunning(SimulationThread& sim)
+{
+    std::lock_guard<std::mutex> lock(sim.mutex);
+    return sim.running;
+}
+
+void SetSimulationFrameLag(SimulationThread& sim, int frameLag)
+{
+    {
+        std::lock_guard<std::mutex> lock(sim.mutex);
+        sim.frameLag = frameLag < 0 ? 0 : frameLag;
+    }
+    sim.wake.notify_all();
+}
+
+void SetSimulationFrameLimit(SimulationThread& sim, uint64_t frames)
+{
+    {
+        std::lock_guard<std::mutex> lock(sim.mutex);
+        sim.frameLimit = frames;
+    }
+    sim.wake.notify_all();
+}
+
+void PostSimulationInput(SimulationThread& sim, const bool keys[256], const SceneControls* edits)
+{
+    if (edits)
+    {
+        sim.postedControls = *edits;
+        ++sim.postedVersion;
+    }
+
+    // every slot gets the full state; the simulation may skip posts
+    SimulationInput& input = sim.inputs.WriteBuffer();
+    std::memcpy(input.keys, keys, sizeof(input.keys));
+    input.controls        = sim.postedControls;
+    input.controlsVersion = sim.postedVersion;
+    sim.inputs.Publish();
+}
+
+const SceneSnapshot& AcquireSimulationSnapshot(SimulationThread& sim)
+{
+    PROFILE_SCOPE("AcquireSnapshot");
+
+    {
+        std::unique_lock<std::mutex> lock(sim.mutex);
+        bool                         waitForFresh = sim.frameLag == 0 || sim.consumedFrame == 0;
+        sim.wake.wait(lock, [&]() {
+            return !sim.running || sim.producedFrame > sim.consumedFrame || (!waitForFresh && sim.producedFrame > 0);
+        });
+
+        sim.snapshots.Update();
+        uint64_t frame = sim.snapshots.ReadBuffer().frame;
+        if (frame > sim.consumedFrame)
+        {
+            if (sim.consumedFrame > 0)
+                sim.skippedSnapshots += frame - sim.consumedFrame - 1;
+            sim.consumedFrame = frame;
+        }
+    }
+    sim.wake.notify_all();
+
+    return sim.snapshots.ReadBuffer();
+}
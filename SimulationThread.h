@@ -0,0 +1,72 @@
+#pragma once
+
+#include "Scene.h"
+#include "TripleBuffer.h"
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+
+// What the render thread hands the simulation each frame.
+struct SimulationInput
+{
+    bool          keys[256] = {};
+    SceneControls controls;
+    uint64_t      controlsVersion = 0;   // the simulation applies `controls` when this changes
+};
+
+// Runs UpdateScene on its own thread and publishes a SceneSnapshot per frame
+// through a triple buffer; the render thread takes the newest one.
+//
+// frameLag is how many published snapshots the simulation may get ahead of
+// the renderer:
+//   0  the renderer waits for the snapshot of the frame it is about to draw;
+//      input reaches the screen one frame later, but render can stall on update.
+//   1+ the renderer never waits and draws the newest snapshot; update and
+//      submission fully overlap at the cost of extra frames of latency.
+//      Snapshots overwritten before the renderer saw them are counted as skipped.
+struct SimulationThread
+{
+    TripleBuffer<SceneSnapshot>   snapshots;
+    TripleBuffer<SimulationInput> inputs;
+
+    SceneState scene;   // owned by the simulation thread between Start and Stop
+    size_t     instanceCapacity = 0;
+    float      fixedDeltaTime   = 0.f;   // 0 = measure wall clock time
+
+    // render thread only
+    SceneControls postedControls;
+    uint64_t      postedVersion    = 0;
+    uint64_t      skippedSnapshots = 0;
+
+    // guarded by mutex
+    std::mutex              mutex;
+    std::condition_variable wake;
+    uint64_t                producedFrame = 0;
+    uint64_t                consumedFrame = 0;
+    int                     frameLag      = 0;
+    uint64_t                frameLimit    = UINT64_MAX;   // frames to simulate before idling; kept across Start
+    bool                    running       = false;
+
+    std::thread thread;
+};
+
+void StartSimulationThread(SimulationThread& sim, const SceneState& initial, size_t instanceCapacity, int frameLag, float fixedDeltaTime);
+
+// Joins the thread; sim.scene then holds the final state.
+void StopSimulationThread(SimulationThread& sim);
+
+bool IsSimulationRunning(SimulationThread& sim);
+void SetSimulationFrameLag(SimulationThread& sim, int frameLag);
+
+// Stops simulating once `frames` frames have been published since Start, until
+// raised; lets a test step the thread a known number of frames.
+void SetSimulationFrameLimit(SimulationThread& sim, uint64_t frames);
+
+// Render thread: current key state, plus UI edits when `edits` is not null.
+void PostSimulationInput(SimulationThread& sim, const bool keys[256], const SceneControls* edits);
+
+// Render thread: the newest snapshot, valid until the next call. Blocks for a
+// fresh one when frameLag is 0, and always until the first one exists.
+const SceneSnapshot& AcquireSimulationSnapshot(SimulationThread& sim);
@@ -0,0 +1,527 @@
+#include "SoftwareRasterizer.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdio>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+#if defined(_M_X64) || defined(__x86_64__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#    define RASTER_SSE 1
+#    include <emmintrin.h>
+#else
+#    define RASTER_SSE 0
+#endif
+
+namespace
+{
+    constexpr int32_t kTileSize = 64;
+
+    // Triangle after vertex shading and setup. Edge i is opposite vertex i and
+    // evaluates as a[i] * x + b[i] * y + c[i], positive inside. Color channels
+    // are stored as screen-space planes in the same form.
+    struct RasterTriangle
+    {
+        float    a[3], b[3], c[3];
+        float    colorA[3], colorB[3], colorC[3];
+        uint32_t topLeftMask;
+        int32_t  minX, minY, maxX, maxY;
+    };
+
+    struct RasterWorker
+    {
+        std::vector<RasterTriangle>        triangles;
+        std::vector<std::vector<uint32_t>> bins;   // per tile, indices into triangles
+        RasterStats                        stats;
+    };
+
+    uint32_t PackColor(float r, float g, float b)
+    {
+        auto toUnorm = [](float v) {
+            v = std::min(std::max(v, 0.f), 1.f);
+            return static_cast<uint32_t>(std::lrint(v * 255.f));
+        };
+        return toUnorm(r) | (toUnorm(g) << 8) | (toUnorm(b) << 16) | 0xFF000000u;
+    }
+}   // namespace
+
+struct SoftwareRasterizer
+{
+    uint32_t                  workerCount = 1;
+    RasterPath                path        = RasterPath::Scalar;
+    std::vector<RasterWorker> workers;
+    std::vector<std::thread>  threads;   // workerCount - 1, the caller is worker 0
+
+    std::mutex                    mutex;
+    std::condition_variable       wake;
+    std::condition_variable       done;
+    std::function<void(uint32_t)> job;
+    uint64_t                      generation = 0;
+    uint32_t                      pending    = 0;
+    bool                          quit       = false;
+
+    // current frame
+    RasterTarget*         target    = nullptr;
+    const RasterDrawCall* draws     = nullptr;
+    size_t                drawCount = 0;
+    int32_t               tilesX    = 0;
+    int32_t               tilesY    = 0;
+    std::atomic<int32_t>  nextTile { 0 };
+};
+
+namespace
+{
+    void WorkerLoop(SoftwareRasterizer* r, uint32_t index)
+    {
+        uint64_t seen = 0;
+        while (true)
+        {
+            std::function<void(uint32_t)> job;
+            {
+                std::unique_lock<std::mutex> lock(r->mutex);
+                r->wake.wait(lock, [&]() { return r->quit || r->generation != seen; });
+                if (r->quit)
+                    return;
+
+                seen = r->generation;
+                job  = r->job;
+            }
+
+            job(index);
+
+            std::lock_guard<std::mutex> lock(r->mutex);
+            if (--r->pending == 0)
+                r->done.notify_one();
+        }
+    }
+
+    void RunOnWorkers(SoftwareRasterizer* r, std::function<void(uint32_t)> job)
+    {
+        {
+            std::lock_guard<std::mutex> lock(r->mutex);
+            r->job     = std::move(job);
+            r->pending = r->workerCount - 1;
+            ++r->generation;
+        }
+        r->wake.notify_all();
+
+        r->job(0);
+
+        std::unique_lock<std::mutex> lock(r->mutex);
+        r->done.wait(lock, [&]() { return r->pending == 0; });
+    }
+
+    // Vertex shader + triangle setup for one triangle. Returns false if culled.
+    bool SetupTriangle(const RasterVertex* v[3], const float* m, float width, float height, RasterTriangle& tri)
+    {
+        float sx[3], sy[3];
+        for (int i = 0; i < 3; ++i)
+        {
+            // mul(float4(posL, 0, 1), world)
+            float x = v[i]->x * m[0] + v[i]->y * m[4] + m[12];
+            float y = v[i]->x * m[1] + v[i]->y * m[5] + m[13];
+            float w = v[i]->x * m[3] + v[i]->y * m[7] + m[15];
+            if (!(w > 0.f))
+                return false;
+
+            sx[i] = (x / w + 1.f) * 0.5f * width;
+            sy[i] = (1.f - y / w) * 0.5f * height;
+        }
+
+        float area = (sx[1] - sx[0]) * (sy[2] - sy[0]) - (sy[1] - sy[0]) * (sx[2] - sx[0]);
+        if (!(area > 0.f))
+            return false;   // back face or degenerate
+
+        float minX = std::min({ sx[0], sx[1], sx[2] });
+        float maxX = std::max({ sx[0], sx[1], sx[2] });
+        float minY = std::min({ sy[0], sy[1], sy[2] });
+        float maxY = std::max({ sy[0], sy[1], sy[2] });
+
+        // pixel i is covered when its center i + 0.5 falls inside
+        tri.minX = static_cast<int32_t>(std::max(std::ceil(minX - 0.5f), 0.f));
+        tri.minY = static_cast<int32_t>(std::max(std::ceil(minY - 0.5f), 0.f));
+        tri.maxX = static_cast<int32_t>(std::min(std::floor(maxX - 0.5f), width - 1.f));
+        tri.maxY = static_cast<int32_t>(std::min(std::floor(maxY - 0.5f), height - 1.f));
+        if (tri.minX > tri.maxX || tri.minY > tri.maxY)
+            return false;
+
+        tri.topLeftMask = 0;
+        for (int i = 0; i < 3; ++i)
+        {
+            int p = (i + 1) % 3;
+            int q = (i + 2) % 3;
+
+            tri.a[i] = sy[p] - sy[q];
+            tri.b[i] = sx[q] - sx[p];
+            tri.c[i] = sx[p] * sy[q] - sx[q] * sy[p];
+
+            if (tri.a[i] > 0.f || (tri.a[i] == 0.f && tri.b[i] > 0.f))
+                tri.topLeftMask |= 1u << i;
+        }
+
+        float invArea = 1.f / area;
+        for (int k = 0; k < 3; ++k)
+        {
+            float c0 = (&v[0]->r)[k];
+            float c1 = (&v[1]->r)[k];
+            float c2 = (&v[2]->r)[k];
+
+            tri.colorA[k] = (tri.a[0] * c0 + tri.a[1] * c1 + tri.a[2] * c2) * invArea;
+            tri.colorB[k] = (tri.b[0] * c0 + tri.b[1] * c1 + tri.b[2] * c2) * invArea;
+            tri.colorC[k] = (tri.c[0] * c0 + tri.c[1] * c1 + tri.c[2] * c2) * invArea;
+        }
+        return true;
+    }
+
+    void SetupAndBin(SoftwareRasterizer* r, uint32_t workerIndex)
+    {
+        RasterWorker& worker = r->workers[workerIndex];
+        worker.triangles.clear();
+        for (auto& bin : worker.bins)
+            bin.clear();
+        worker.bins.resize(static_cast<size_t>(r->tilesX) * r->tilesY);
+
+        size_t first = r->drawCount * workerIndex / r->workerCount;
+        size_t last  = r->drawCount * (workerIndex + 1) / r->workerCount;
+
+        float width  = static_cast<float>(r->target->width);
+        float height = static_cast<float>(r->target->height);
+
+        for (size_t d = first; d < last; ++d)
+        {
+            const RasterDrawCall& draw = r->draws[d];
+            for (uint32_t i = 0; i + 3 <= draw.indexCount; i += 3)
+            {
+                const RasterVertex* v[3] = {
+                    &draw.vertices[draw.indices[i + 0]],
+                    &draw.vertices[draw.indices[i + 1]],
+                    &draw.vertices[draw.indices[i + 2]]
+                };
+
+                ++worker.stats.trianglesSubmitted;
+
+                RasterTriangle tri;
+                if (!SetupTriangle(v, draw.world, width, height, tri))
+                {
+                    ++worker.stats.trianglesCulled;
+                    continue;
+                }
+
+                uint32_t index = static_cast<uint32_t>(worker.triangles.size());
+                worker.triangles.push_back(tri);
+
+                for (int32_t ty = tri.minY / kTileSize; ty <= tri.maxY / kTileSize; ++ty)
+                {
+                    for (int32_t tx = tri.minX / kTileSize; tx <= tri.maxX / kTileSize; ++tx)
+                    {
+                        worker.bins[ty * r->tilesX + tx].push_back(index);
+                        ++worker.stats.binEntries;
+                    }
+                }
+            }
+        }
+    }
+
+    bool CoversPixel(const RasterTriangle& tri, float px, float py)
+    {
+        for (int i = 0; i < 3; ++i)
+        {
+            float e = tri.a[i] * px + (tri.b[i] * py + tri.c[i]);
+            if (e < 0.f || (e == 0.f && !(tri.topLeftMask & (1u << i))))
+                return false;
+        }
+        return true;
+    }
+
+    void ShadePixel(const RasterTriangle& tri, float px, float py, uint32_t* dst)
+    {
+        *dst = PackColor(tri.colorA[0] * px + (tri.colorB[0] * py + tri.colorC[0]),
+                         tri.colorA[1] * px + (tri.colorB[1] * py + tri.colorC[1]),
+                         tri.colorA[2] * px + (tri.colorB[2] * py + tri.colorC[2]));
+    }
+
+    void RasterizeInTile(const RasterTriangle& tri, int32_t tileX0, int32_t tileY0, int32_t tileX1, int32_t tileY1, RasterPath path, RasterTarget& target, RasterStats& stats)
+    {
+        int32_t x0 = std::max(tri.minX, tileX0);
+        int32_t x1 = std::min(tri.maxX, tileX1 - 1);
+        int32_t y0 = std::max(tri.minY, tileY0);
+        int32_t y1 = std::min(tri.maxY, tileY1 - 1);
+
+#if !RASTER_SSE
+        (void)path;
+#else
+        const __m128  lanes   = _mm_setr_ps(0.f, 1.f, 2.f, 3.f);
+        const __m128  half    = _mm_set1_ps(0.5f);
+        const __m128  minX    = _mm_set1_ps(static_cast<float>(x0));
+        const __m128  maxX    = _mm_set1_ps(static_cast<float>(x1));
+        const __m128i alpha   = _mm_set1_epi32(static_cast<int>(0xFF000000u));
+        const __m128  zero    = _mm_setzero_ps();
+        const __m128  one     = _mm_set1_ps(1.f);
+        const __m128  scale   = _mm_set1_ps(255.f);
+
+        __m128 edgeA[3], topLeft[3], colorA[3];
+        for (int i = 0; i < 3; ++i)
+        {
+            edgeA[i]   = _mm_set1_ps(tri.a[i]);
+            topLeft[i] = _mm_castsi128_ps(_mm_set1_epi32((tri.topLeftMask & (1u << i)) ? -1 : 0));
+            colorA[i]  = _mm_set1_ps(tri.colorA[i]);
+        }
+#endif
+
+        for (int32_t y = y0; y <= y1; ++y)
+        {
+            float     py  = y + 0.5f;
+            uint32_t* row = target.pixels.data() + static_cast<size_t>(y) * target.width;
+
+            int32_t x = x0;
+#if RASTER_SSE
+            __m128 edgeRow[3], colorRow[3];
+            for (int i = 0; i < 3; ++i)
+            {
+                edgeRow[i]  = _mm_set1_ps(tri.b[i] * py + tri.c[i]);
+                colorRow[i] = _mm_set1_ps(tri.colorB[i] * py + tri.colorC[i]);
+            }
+
+            // 4-wide blocks aligned to the tile, never touching pixels outside it
+            for (x = x0 & ~3; path == RasterPath::SSE && x <= x1 && x + 4 <= tileX1; x += 4)
+            {
+
+                // blocks start aligned, so clip them to the bounding box to
+                // cover exactly the pixels the scalar path would
+                __m128 ix   = _mm_add_ps(_mm_set1_ps(static_cast<float>(x)), lanes);
+                __m128 px   = _mm_add_ps(ix, half);
+                __m128 mask = _mm_and_ps(_mm_cmpge_ps(ix, minX), _mm_cmple_ps(ix, maxX));
+                for (int i = 0; i < 3; ++i)
+                {
+                    __m128 e = _mm_add_ps(_mm_mul_ps(edgeA[i], px), edgeRow[i]);
+                    __m128 m = _mm_or_ps(_mm_cmpgt_ps(e, zero), _mm_and_ps(_mm_cmpeq_ps(e, zero), topLeft[i]));
+                    mask     = _mm_and_ps(mask, m);
+                }
+
+                int bits = _mm_movemask_ps(mask);
+                if (bits == 0)
+                    continue;
+
+                __m128i rgb[3];
+                for (int k = 0; k < 3; ++k)
+                {
+                    __m128 c = _mm_add_ps(_mm_mul_ps(colorA[k], px), colorRow[k]);
+                    c        = _mm_min_ps(_mm_max_ps(c, zero), one);
+                    rgb[k]   = _mm_cvtps_epi32(_mm_mul_ps(c, scale));
+                }
+
+                __m128i packed = _mm_or_si128(_mm_or_si128(rgb[0], _mm_slli_epi32(rgb[1], 8)),
+                                              _mm_or_si128(_mm_slli_epi32(rgb[2], 16), alpha));
+
+                __m128i* dst    = reinterpret_cast<__m128i*>(row + x);
+                __m128i  maskI  = _mm_castps_si128(mask);
+                __m128i  result = _mm_or_si128(_mm_and_si128(maskI, packed), _mm_andnot_si128(maskI, _mm_loadu_si128(dst)));
+                _mm_storeu_si128(dst, result);
+
+                stats.pixelsWritten += ((bits >> 0) & 1) + ((bits >> 1) & 1) + ((bits >> 2) & 1) + ((bits >> 3) & 1);
+            }
+            x = std::max(x, x0);
+#endif
+            for (; x <= x1; ++x)
+            {
+                float px = x + 0.5f;
+                if (!CoversPixel(tri, px, py))
+                    continue;
+
+                ShadePixel(tri, px, py, row + x);
+                ++stats.pixelsWritten;
+            }
+        }
+    }
+
+    void RasterizeTiles(SoftwareRasterizer* r, uint32_t workerIndex)
+    {
+        RasterStats& stats     = r->workers[workerIndex].stats;
+        int32_t      tileCount = r->tilesX * r->tilesY;
+
+        for (int32_t tile = r->nextTile.fetch_add(1); tile < tileCount; tile = r->nextTile.fetch_add(1))
+        {
+            int32_t tileX0 = (tile % r->tilesX) * kTileSize;
+            int32_t tileY0 = (tile / r->tilesX) * kTileSize;
+            int32_t tileX1 = std::min(tileX0 + kTileSize, static_cast<int32_t>(r->target->width));
+            int32_t tileY1 = std::min(tileY0 + kTileSize, static_cast<int32_t>(r->target->height));
+
+            // workers set up contiguous draw ranges, so walking them in order
+            // keeps submission order within the tile
+            for (const RasterWorker& source : r->workers)
+            {
+                for (uint32_t index : source.bins[tile])
+                    RasterizeInTile(source.triangles[index], tileX0, tileY0, tileX1, tileY1, r->path, *r->target, stats);
+            }
+        }
+    }
+}   // namespace
+
+RasterPath SelectedRasterPath()
+{
+    return IsRasterPathSupported(RasterPath::SSE) ? RasterPath::SSE : RasterPath::Scalar;
+}
+
+const char* RasterPathName(RasterPath path)
+{
+    switch (path)
+    {
+        case RasterPath::Scalar:
+            return "scalar";
+        case RasterPath::SSE:
+            return "sse";
+    }
+    return "unknown";
+}
+
+bool IsRasterPathSupported(RasterPath path)
+{
+#if RASTER_SSE
+    (void)path;
+    return true;
+#else
+    return path == RasterPath::Scalar;
+#endif
+}
+
+SoftwareRasterizer* CreateSoftwareRasterizer(uint32_t workerCount)
+{
+    if (workerCount == 0)
+        workerCount = std::max(1u, std::thread::hardware_concurrency());
+
+    SoftwareRasterizer* r = new SoftwareRasterizer();
+    r->workerCount        = workerCount;
+    r->path               = SelectedRasterPath();
+    r->workers.resize(workerCount);
+
+    for (uint32_t i = 1; i < workerCount; ++i)
+        r->threads.emplace_back(WorkerLoop, r, i);
+
+    return r;
+}
+
+void DestroySoftwareRasterizer(SoftwareRasterizer* rasterizer)
+{
+    if (!rasterizer)
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(rasterizer->mutex);
+        rasterizer->quit = true;
+    }
+    rasterizer->wake.notify_all();
+
+    for (std::thread& t : rasterizer->threads)
+        t.join();
+
+    delete rasterizer;
+}
+
+uint32_t RasterWorkerCount(const SoftwareRasterizer* rasterizer)
+{
+    return rasterizer->workerCount;
+}
+
+void SetRasterPath(SoftwareRasterizer* rasterizer, RasterPath path)
+{
+    rasterizer->path = IsRasterPathSupported(path) ? path : RasterPath::Scalar;
+}
+
+void ResizeRasterTarget(RasterTarget& target, uint32_t width, uint32_t height)
+{
+    target.width  = width;
+    target.height = height;
+    target.pixels.resize(static_cast<size_t>(width) * height);
+}
+
+void ClearRasterTarget(RasterTarget& target, const float color[4])
+{
+    uint32_t alpha  = static_cast<uint32_t>(std::lrint(std::min(std::max(color[3], 0.f), 1.f) * 255.f));
+    uint32_t packed = (PackColor(color[0], color[1], color[2]) & 0x00FFFFFFu) | (alpha << 24);
+    std::fill(target.pixels.begin(), target.pixels.end(), packed);
+}
+
+void RasterizeDraws(SoftwareRasterizer*   rasterizer,
+                    RasterTarget&         target,
+                    const RasterDrawCall* draws,
+                    size_t                drawCount,
+                    RasterStats*          stats)
+{
+    using Clock = std::chrono::steady_clock;
+
+    SoftwareRasterizer* r = rasterizer;
+    r->target             = &target;
+    r->draws              = draws;
+    r->drawCount          = drawCount;
+    r->tilesX             = (static_cast<int32_t>(target.width) + kTileSize - 1) / kTileSize;
+    r->tilesY             = (static_cast<int32_t>(target.height) + kTileSize - 1) / kTileSize;
+    r->nextTile           = 0;
+
+    for (RasterWorker& worker : r->workers)
+        worker.stats = {};
+
+    auto begin = Clock::now();
+    RunOnWorkers(r, [r](uint32_t index) { SetupAndBin(r, index); });
+    auto binned = Clock::now();
+    RunOnWorkers(r, [r](uint32_t index) { RasterizeTiles(r, index); });
+    auto end = Clock::now();
+
+    if (stats)
+    {
+        *stats = {};
+        for (const RasterWorker& worker : r->workers)
+        {
+            stats->trianglesSubmitted += worker.stats.trianglesSubmitted;
+            stats->trianglesCulled += worker.stats.trianglesCulled;
+            stats->binEntries += worker.stats.binEntries;
+            stats->pixelsWritten += worker.stats.pixelsWritten;
+        }
+        stats->setupMs  = std::chrono::duration<double, std::milli>(binned - begin).count();
+        stats->rasterMs = std::chrono::duration<double, std::milli>(end - binned).count();
+    }
+}
+
+bool WriteRasterTargetPPM(const RasterTarget& target, const char* path)
+{
+    FILE* file = std::fopen(path, "wb");
+    if (!file)
+        return false;
+
+    std::fprintf(file, "P6\n%u %u\n255\n", target.width, target.height);
+
+    std::vector<uint8_t> row(static_cast<size_t>(target.width) * 3);
+    for (uint32_t y = 0; y < target.height; ++y)
+    {
+        for (uint32_t x = 0; x < target.width; ++x)
+        {
+            uint32_t pixel = target.pixels[static_cast<size_t>(y) * target.width + x];
+            row[x * 3 + 0] = static_cast<uint8_t>(pixel);
+            row[x * 3 + 1] = static_cast<uint8_t>(pixel >> 8);
+            row[x * 3 + 2] = static_cast<uint8_t>(pixel >> 16);
+        }
+        std::fwrite(row.data(), 1, row.size(), file);
+    }
+
+    bool ok = std::ferror(file) == 0;
+    std::fclose(file);
+    return ok;
+}
+
+uint64_t HashRasterTarget(const RasterTarget& target)
+{
+    // FNV-1a
+    uint64_t hash = 14695981039346656037ull;
+    for (uint32_t pixel : target.pixels)
+    {
+        for (int i = 0; i < 4; ++i)
+        {
+            hash ^= (pixel >> (i * 8)) & 0xFF;
+            hash *= 1099511628211ull;
+        }
+    }
+    return hash;
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// CPU implementation of the VSmain/PSmain pipeline: positions are transformed
+// by a row-major world matrix, color is interpolated and written to an RGBA8
+// target laid out like R8G8B8A8_UNORM. Rasterization is binned into tiles and
+// spread over one worker per core. Single sample per pixel (no MSAA), back
+// faces culled like the default D3D11 rasterizer state.
+
+// Same memory layout as Vertex (posL, color).
+struct RasterVertex
+{
+    float x, y;
+    float r, g, b;
+};
+
+struct RasterTarget
+{
+    uint32_t              width  = 0;
+    uint32_t              height = 0;
+    std::vector<uint32_t> pixels;   // R in the low byte
+};
+
+struct RasterDrawCall
+{
+    const RasterVertex* vertices   = nullptr;
+    const uint32_t*     indices    = nullptr;
+    uint32_t            indexCount = 0;
+    const float*        world      = nullptr;   // 16 floats, row-major
+};
+
+struct RasterStats
+{
+    uint64_t trianglesSubmitted = 0;
+    uint64_t trianglesCulled    = 0;
+    uint64_t binEntries         = 0;
+    uint64_t pixelsWritten      = 0;
+    double   setupMs            = 0.0;
+    double   rasterMs           = 0.0;
+};
+
+// Edge function and shading per pixel, or four pixels at a time. Both give
+// bit-identical images.
+enum class RasterPath
+{
+    Scalar,
+    SSE,
+};
+
+RasterPath  SelectedRasterPath();
+const char* RasterPathName(RasterPath path);
+bool        IsRasterPathSupported(RasterPath path);
+
+struct SoftwareRasterizer;
+
+// workerCount 0 means one worker per hardware thread.
+SoftwareRasterizer* CreateSoftwareRasterizer(uint32_t workerCount);
+void                DestroySoftwareRasterizer(SoftwareRasterizer* rasterizer);
+uint32_t            RasterWorkerCount(const SoftwareRasterizer* rasterizer);
+
+// Forces a specific path; used for validation. New rasterizers use
+// SelectedRasterPath().
+void SetRasterPath(SoftwareRasterizer* rasterizer, RasterPath path);
+
+void ResizeRasterTarget(RasterTarget& target, uint32_t width, uint32_t height);
+void ClearRasterTarget(RasterTarget& target, const float color[4]);
+
+void RasterizeDraws(SoftwareRasterizer*   rasterizer,
+                    RasterTarget&         target,
+                    const RasterDrawCall* draws,
+                    size_t                drawCount,
+                    RasterStats*          stats);
+
+// Binary PPM (alpha dropped), for diffing frames.
+bool     WriteRasterTargetPPM(const RasterTarget& target, const char* path);
+uint64_t HashRasterTarget(const RasterTarget& target);
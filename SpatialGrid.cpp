@@ -0,0 +1,211 @@
+#include "SpatialGrid.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+
+namespace
+{
+    // Cell coordinate of a world position along one axis, clamped to the
+    // grid. NaN lands in cell 0.
+    uint32_t CellCoordinate(float position, float origin, float invCellSize, uint32_t count)
+    {
+        float f = (position - origin) * invCellSize;
+        if (!(f >= 0.f))
+            return 0;
+        return f < static_cast<float>(count) ? std::min(static_cast<uint32_t>(f), count - 1) : count - 1;
+    }
+
+    uint32_t CellOf(const SpatialGrid& grid, const SpatialRect& bounds)
+    {
+        float    cx = (bounds.minX + bounds.maxX) * 0.5f;
+        float    cy = (bounds.minY + bounds.maxY) * 0.5f;
+        uint32_t x  = CellCoordinate(cx, grid.originX, grid.invCellSize, grid.columns);
+        uint32_t y  = CellCoordinate(cy, grid.originY, grid.invCellSize, grid.rows);
+        return y * grid.columns + x;
+    }
+
+    bool Overlaps(const SpatialRect& a, const SpatialRect& b)
+    {
+        return a.maxX >= b.minX && a.minX <= b.maxX && a.maxY >= b.minY && a.minY <= b.maxY;
+    }
+
+    // Cells whose entries may overlap `rect`: the rect widened by the loose margin.
+    void CellRange(const SpatialGrid& grid, const SpatialRect& rect, uint32_t& x0, uint32_t& y0, uint32_t& x1, uint32_t& y1)
+    {
+        float margin = grid.maxHalfExtent;
+        x0           = CellCoordinate(rect.minX - margin, grid.originX, grid.invCellSize, grid.columns);
+        y0           = CellCoordinate(rect.minY - margin, grid.originY, grid.invCellSize, grid.rows);
+        x1           = CellCoordinate(rect.maxX + margin, grid.originX, grid.invCellSize, grid.columns);
+        y1           = CellCoordinate(rect.maxY + margin, grid.originY, grid.invCellSize, grid.rows);
+    }
+
+    void DetachEntry(SpatialGrid& grid, uint32_t id)
+    {
+        std::vector<SpatialGridItem>& cell = grid.cells[grid.entryCell[id]];
+        uint32_t                      slot = grid.entrySlot[id];
+
+        cell[slot]                    = cell.back();
+        grid.entrySlot[cell[slot].id] = slot;
+        cell.pop_back();
+    }
+}   // namespace
+
+void InitSpatialGrid(SpatialGrid& grid, const SpatialRect& area, float cellSize)
+{
+    grid.originX     = area.minX;
+    grid.originY     = area.minY;
+    grid.cellSize    = cellSize;
+    grid.invCellSize = 1.f / cellSize;
+    grid.columns     = std::max(1u, static_cast<uint32_t>(std::ceil((area.maxX - area.minX) / cellSize)));
+    grid.rows        = std::max(1u, static_cast<uint32_t>(std::ceil((area.maxY - area.minY) / cellSize)));
+
+    grid.cells.clear();
+    grid.cells.resize(size_t(grid.columns) * grid.rows);
+    grid.entryCell.clear();
+    grid.entrySlot.clear();
+    grid.entryCount    = 0;
+    grid.maxHalfExtent = 0.f;
+}
+
+void ClearSpatialGrid(SpatialGrid& grid)
+{
+    for (std::vector<SpatialGridItem>& cell : grid.cells)
+        cell.clear();
+    std::fill(grid.entryCell.begin(), grid.entryCell.end(), kSpatialNoCell);
+    grid.entryCount    = 0;
+    grid.maxHalfExtent = 0.f;
+}
+
+void SetSpatialEntry(SpatialGrid& grid, uint32_t id, const SpatialRect& bounds)
+{
+    if (id >= grid.entryCell.size())
+    {
+        grid.entryCell.resize(size_t(id) + 1, kSpatialNoCell);
+        grid.entrySlot.resize(size_t(id) + 1, 0);
+    }
+
+    float halfExtent   = std::max(bounds.maxX - bounds.minX, bounds.maxY - bounds.minY) * 0.5f;
+    grid.maxHalfExtent = std::max(grid.maxHalfExtent, halfExtent);
+
+    uint32_t cell = CellOf(grid, bounds);
+    if (grid.entryCell[id] == cell)
+    {
+        grid.cells[cell][grid.entrySlot[id]].bounds = bounds;
+        return;
+    }
+
+    if (grid.entryCell[id] != kSpatialNoCell)
+        DetachEntry(grid, id);
+    else
+        ++grid.entryCount;
+
+    grid.entryCell[id] = cell;
+    grid.entrySlot[id] = static_cast<uint32_t>(grid.cells[cell].size());
+    grid.cells[cell].push_back({ bounds, id });
+}
+
+void RemoveSpatialEntry(SpatialGrid& grid, uint32_t id)
+{
+    if (!HasSpatialEntry(grid, id))
+        return;
+
+    DetachEntry(grid, id);
+    grid.entryCell[id] = kSpatialNoCell;
+    --grid.entryCount;
+}
+
+bool HasSpatialEntry(const SpatialGrid& grid, uint32_t id)
+{
+    return id < grid.entryCell.size() && grid.entryCell[id] != kSpatialNoCell;
+}
+
+void QuerySpatialRect(const SpatialGrid& grid, const SpatialRect& rect, std::vector<uint32_t>& out)
+{
+    if (grid.entryCount == 0)
+        return;
+
+    uint32_t x0, y0, x1, y1;
+    CellRange(grid, rect, x0, y0, x1, y1);
+    for (uint32_t y = y0; y <= y1; ++y)
+    {
+        for (uint32_t x = x0; x <= x1; ++x)
+        {
+            for (const SpatialGridItem& item : grid.cells[y * grid.columns + x])
+            {
+                if (Overlaps(item.bounds, rect))
+                    out.push_back(item.id);
+            }
+        }
+    }
+}
+
+void QuerySpatialPoint(const SpatialGrid& grid, float x, float y, std::vector<uint32_t>& out)
+{
+    QuerySpatialRect(grid, SpatialRect { x, y, x, y }, out);
+}
+
+void CullSpatialGrid(SpatialGrid& grid, const SpatialRect& rect, std::vector<uint32_t>& out)
+{
+    out.clear();
+    if (grid.entryCount == 0)
+        return;
+
+    grid.cullMask.assign((grid.entryCell.size() + 63) / 64, 0);
+
+    uint32_t x0, y0, x1, y1;
+    CellRange(grid, rect, x0, y0, x1, y1);
+    // every entry of an inner cell lies within margin of it (plus slack for
+    // rounding in CellCoordinate); border cells also hold clamped outsiders
+    float margin = grid.maxHalfExtent + grid.cellSize * (1.f / 1024.f);
+    for (uint32_t y = y0; y <= y1; ++y)
+    {
+        for (uint32_t x = x0; x <= x1; ++x)
+        {
+            float cellMinX = grid.originX + x * grid.cellSize;
+            float cellMinY = grid.originY + y * grid.cellSize;
+            bool  inner    = x > 0 && y > 0 && x + 1 < grid.columns && y + 1 < grid.rows;
+            bool  inside   = inner && cellMinX - margin >= rect.minX && cellMinY - margin >= rect.minY &&
+                          cellMinX + grid.cellSize + margin <= rect.maxX && cellMinY + grid.cellSize + margin <= rect.maxY;
+
+            for (const SpatialGridItem& item : grid.cells[y * grid.columns + x])
+            {
+                if (inside || Overlaps(item.bounds, rect))
+                    grid.cullMask[item.id >> 6] |= uint64_t(1) << (item.id & 63);
+            }
+        }
+    }
+
+    for (size_t word = 0; word < grid.cullMask.size(); ++word)
+    {
+        for (uint64_t bits = grid.cullMask[word]; bits; bits &= bits - 1)
+            out.push_back(static_cast<uint32_t>(word * 64 + std::countr_zero(bits)));
+    }
+}
+
+bool PickSpatialPoint(const SpatialGrid& grid, float x, float y, uint32_t& id)
+{
+    if (grid.entryCount == 0)
+        return false;
+
+    SpatialRect point = { x, y, x, y };
+    bool        found = false;
+
+    uint32_t x0, y0, x1, y1;
+    CellRange(grid, point, x0, y0, x1, y1);
+    for (uint32_t cy = y0; cy <= y1; ++cy)
+    {
+        for (uint32_t cx = x0; cx <= x1; ++cx)
+        {
+            for (const SpatialGridItem& item : grid.cells[cy * grid.columns + cx])
+            {
+                if (Overlaps(item.bounds, point) && (!found || item.id > id))
+                {
+                    id    = item.id;
+                    found = true;
+                }
+            }
+        }
+    }
+    return found;
+}
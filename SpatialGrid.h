@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Axis-aligned box in world space (the scene's world space is clip space, so
+// the visible area is [-1, 1] on both axes).
+struct SpatialRect
+{
+    float minX;
+    float minY;
+    float maxX;
+    float maxY;
+};
+
+struct SpatialGridItem
+{
+    SpatialRect bounds;
+    uint32_t    id;
+};
+
+// Loose uniform grid. Each entry lives in the one cell that holds the center
+// of its bounds, so moving an entry is a bounds write unless its center
+// crosses into another cell. Queries widen their cell range by the largest
+// half size any entry has had, then test bounds exactly. Centers outside the
+// grid area are clamped into the border cells; they stay correct, only slower.
+//
+// Entries are keyed by a caller-chosen dense id (the instance index for the
+// scene), so per-entry bookkeeping is a plain array lookup.
+struct SpatialGrid
+{
+    float    originX     = 0.f;
+    float    originY     = 0.f;
+    float    cellSize    = 1.f;
+    float    invCellSize = 1.f;
+    uint32_t columns     = 0;
+    uint32_t rows        = 0;
+
+    float  maxHalfExtent = 0.f;   // only grows until ClearSpatialGrid
+    size_t entryCount    = 0;
+
+    std::vector<std::vector<SpatialGridItem>> cells;       // row-major
+    std::vector<uint32_t>                     entryCell;   // per id, kSpatialNoCell when absent
+    std::vector<uint32_t>                     entrySlot;   // index into its cell
+
+    std::vector<uint64_t> cullMask;   // CullSpatialGrid scratch, one bit per id
+};
+
+constexpr uint32_t kSpatialNoCell = ~0u;
+
+// Cells of `cellSize` covering `area`. Entries should be about a cell in size
+// or smaller; much larger ones widen every query.
+void InitSpatialGrid(SpatialGrid& grid, const SpatialRect& area, float cellSize);
+void ClearSpatialGrid(SpatialGrid& grid);
+
+// Inserts or moves entry `id`.
+void SetSpatialEntry(SpatialGrid& grid, uint32_t id, const SpatialRect& bounds);
+void RemoveSpatialEntry(SpatialGrid& grid, uint32_t id);
+bool HasSpatialEntry(const SpatialGrid& grid, uint32_t id);
+
+// Appends the ids whose bounds overlap `rect` (edges touching count), in no
+// particular order.
+void QuerySpatialRect(const SpatialGrid& grid, const SpatialRect& rect, std::vector<uint32_t>& out);
+void QuerySpatialPoint(const SpatialGrid& grid, float x, float y, std::vector<uint32_t>& out);
+
+// Replaces `out` with the ids overlapping `rect` in ascending order, so a
+// culled draw keeps the original draw order. Cells entirely inside the rect
+// are taken without per-entry tests.
+void CullSpatialGrid(SpatialGrid& grid, const SpatialRect& rect, std::vector<uint32_t>& out);
+
+// Highest id whose bounds contain the point, i.e. the one drawn on top.
+bool PickSpatialPoint(const SpatialGrid& grid, float x, float y, uint32_t& id);
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+// Bounded single producer, single consumer FIFO, lock-free. Unlike
+// TripleBuffer every value is delivered, in order, unless the ring is full.
+// Each side caches the other's index and only reloads it when the ring looks
+// full or empty, so the common case touches no shared cache line but its own.
+template<typename T, uint32_t Capacity>
+struct SpscQueue
+{
+    static_assert(Capacity && (Capacity & (Capacity - 1)) == 0, "capacity must be a power of two");
+
+    // Producer side. False when full; the value is not queued.
+    bool Push(const T& value)
+    {
+        uint32_t t = tail.load(std::memory_order_relaxed);
+        if (t - cachedHead == Capacity)
+        {
+            cachedHead = head.load(std::memory_order_acquire);
+            if (t - cachedHead == Capacity)
+                return false;
+        }
+
+        slots[t & (Capacity - 1)] = value;
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side. False when empty.
+    bool Pop(T& value)
+    {
+        uint32_t h = head.load(std::memory_order_relaxed);
+        if (h == cachedTail)
+        {
+            cachedTail = tail.load(std::memory_order_acquire);
+            if (h == cachedTail)
+                return false;
+        }
+
+        value = slots[h & (Capacity - 1)];
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+private:
+    T slots[Capacity] = {};
+
+    alignas(64) std::atomic<uint32_t> tail { 0 };
+    uint32_t cachedHead = 0;   // producer only
+
+    alignas(64) std::atomic<uint32_t> head { 0 };
+    uint32_t cachedTail = 0;   // consumer only
+};
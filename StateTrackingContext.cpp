@@ -0,0 +1,266 @@
+#include "StateTrackingContext.h"
+
+namespace
+{
+    uint32_t Bit(BindKind kind)
+    {
+        return 1u << static_cast<uint32_t>(kind);
+    }
+
+    bool SameViewport(const RenderViewport& a, const RenderViewport& b)
+    {
+        return a.x == b.x && a.y == b.y && a.width == b.width && a.height == b.height && a.minDepth == b.minDepth && a.maxDepth == b.maxDepth;
+    }
+}   // namespace
+
+const char* BindKindName(BindKind kind)
+{
+    switch (kind)
+    {
+        case BindKind::InputLayout:
+            return "InputLayout";
+        case BindKind::Topology:
+            return "Topology";
+        case BindKind::VertexBuffers:
+            return "VertexBuffers";
+        case BindKind::IndexBuffer:
+            return "IndexBuffer";
+        case BindKind::VertexShader:
+            return "VertexShader";
+        case BindKind::VSConstantBuffer:
+            return "VSConstantBuffer";
+        case BindKind::Viewport:
+            return "Viewport";
+        case BindKind::PixelShader:
+            return "PixelShader";
+        case BindKind::RenderTarget:
+            return "RenderTarget";
+        default:
+            return "?";
+    }
+}
+
+uint64_t TotalIssued(const BindStats& stats)
+{
+    uint64_t sum = 0;
+    for (uint64_t n : stats.issued)
+        sum += n;
+    return sum;
+}
+
+uint64_t TotalElided(const BindStats& stats)
+{
+    uint64_t sum = 0;
+    for (uint64_t n : stats.elided)
+        sum += n;
+    return sum;
+}
+
+void AccumulateBindStats(BindStats& total, const BindStats& frame)
+{
+    for (size_t i = 0; i < static_cast<size_t>(BindKind::Count); ++i)
+    {
+        total.issued[i] += frame.issued[i];
+        total.elided[i] += frame.elided[i];
+    }
+}
+
+void StateTrackingContext::Invalidate()
+{
+    known               = 0;
+    vertexBufferKnown   = 0;
+    constantBufferKnown = 0;
+}
+
+void StateTrackingContext::EndFrame()
+{
+    AccumulateBindStats(total, frame);
+    frame = {};
+}
+
+bool StateTrackingContext::Elide(BindKind kind, bool current)
+{
+    size_t index = static_cast<size_t>(kind);
+    if ((known & Bit(kind)) && current)
+    {
+        ++frame.elided[index];
+        return true;
+    }
+
+    known |= Bit(kind);
+    ++frame.issued[index];
+    return false;
+}
+
+void StateTrackingContext::SetInputLayout(RenderHandle layout)
+{
+    if (Elide(BindKind::InputLayout, inputLayout == layout))
+        return;
+
+    inputLayout = layout;
+    inner->SetInputLayout(layout);
+}
+
+void StateTrackingContext::SetPrimitiveTopology(PrimitiveTopology value)
+{
+    if (Elide(BindKind::Topology, topology == value))
+        return;
+
+    topology = value;
+    inner->SetPrimitiveTopology(value);
+}
+
+void StateTrackingContext::SetVertexBuffers(uint32_t startSlot, uint32_t count, const RenderHandle* buffers, const uint32_t* strides, const uint32_t* offsets)
+{
+    // forward only the span of slots that actually changed
+    uint32_t first = count;
+    uint32_t last  = 0;
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        uint32_t slot = startSlot + i;
+
+        bool current = slot < kVertexBufferSlots && (vertexBufferKnown & (1u << slot));
+        current      = current && vertexBuffers[slot].buffer == buffers[i];
+        current      = current && vertexBuffers[slot].stride == strides[i] && vertexBuffers[slot].offset == offsets[i];
+        if (current)
+            continue;
+
+        if (first == count)
+            first = i;
+        last = i;
+
+        if (slot < kVertexBufferSlots)
+        {
+            vertexBuffers[slot] = { buffers[i], strides[i], offsets[i] };
+            vertexBufferKnown |= 1u << slot;
+        }
+    }
+
+    size_t index = static_cast<size_t>(BindKind::VertexBuffers);
+    if (first == count)
+    {
+        ++frame.elided[index];
+        return;
+    }
+
+    ++frame.issued[index];
+    inner->SetVertexBuffers(startSlot + first, last - first + 1, buffers + first, strides + first, offsets + first);
+}
+
+void StateTrackingContext::SetIndexBuffer(RenderHandle buffer, IndexFormat format, uint32_t offset)
+{
+    if (Elide(BindKind::IndexBuffer, indexBuffer == buffer && indexFormat == format && indexOffset == offset))
+        return;
+
+    indexBuffer = buffer;
+    indexFormat = format;
+    indexOffset = offset;
+    inner->SetIndexBuffer(buffer, format, offset);
+}
+
+void StateTrackingContext::SetVertexShader(RenderHandle shader)
+{
+    if (Elide(BindKind::VertexShader, vertexShader == shader))
+        return;
+
+    vertexShader = shader;
+    inner->SetVertexShader(shader);
+}
+
+bool StateTrackingContext::ElideConstantBuffer(uint32_t slot, const ConstantRange& range)
+{
+    size_t index = static_cast<size_t>(BindKind::VSConstantBuffer);
+    if (slot < kConstantBufferSlots)
+    {
+        const ConstantRange& current = constantBuffers[slot];
+        if ((constantBufferKnown & (1u << slot)) &&
+            current.buffer == range.buffer &&
+            current.offset == range.offset &&
+            current.size == range.size)
+        {
+            ++frame.elided[index];
+            return true;
+        }
+
+        constantBuffers[slot] = range;
+        constantBufferKnown |= 1u << slot;
+    }
+
+    ++frame.issued[index];
+    return false;
+}
+
+void StateTrackingContext::SetVSConstantBuffer(uint32_t slot, RenderHandle buffer)
+{
+    ConstantRange whole;
+    whole.buffer = buffer;
+    if (ElideConstantBuffer(slot, whole))
+        return;
+
+    inner->SetVSConstantBuffer(slot, buffer);
+}
+
+void StateTrackingContext::SetVSConstantBufferRange(uint32_t slot, const ConstantRange& range)
+{
+    if (ElideConstantBuffer(slot, range))
+        return;
+
+    inner->SetVSConstantBufferRange(slot, range);
+}
+
+void StateTrackingContext::SetViewport(const RenderViewport& value)
+{
+    if (Elide(BindKind::Viewport, SameViewport(viewport, value)))
+        return;
+
+    viewport = value;
+    inner->SetViewport(value);
+}
+
+void StateTrackingContext::SetPixelShader(RenderHandle shader)
+{
+    if (Elide(BindKind::PixelShader, pixelShader == shader))
+        return;
+
+    pixelShader = shader;
+    inner->SetPixelShader(shader);
+}
+
+void StateTrackingContext::SetRenderTarget(RenderHandle view)
+{
+    if (Elide(BindKind::RenderTarget, renderTarget == view))
+        return;
+
+    renderTarget = view;
+    inner->SetRenderTarget(view);
+}
+
+void StateTrackingContext::ClearRenderTarget(RenderHandle view, const float color[4])
+{
+    inner->ClearRenderTarget(view, color);
+}
+
+void* StateTrackingContext::Map(RenderHandle buffer, MapMode mode)
+{
+    return inner->Map(buffer, mode);
+}
+
+void StateTrackingContext::Unmap(RenderHandle buffer, size_t bytesWritten)
+{
+    inner->Unmap(buffer, bytesWritten);
+}
+
+void StateTrackingContext::UpdateBuffer(RenderHandle buffer, size_t offset, const void* data, size_t size)
+{
+    inner->UpdateBuffer(buffer, offset, data, size);
+}
+
+void StateTrackingContext::DrawIndexed(uint32_t indexCount, uint32_t startIndex, int32_t baseVertex)
+{
+    inner->DrawIndexed(indexCount, startIndex, baseVertex);
+}
+
+void StateTrackingContext::DrawIndexedInstanced(uint32_t indexCount, uint32_t instanceCount, uint32_t startIndex, int32_t baseVertex, uint32_t startInstance)
+{
+    inner->DrawIndexedInstanced(indexCount, instanceCount, startIndex, baseVertex, startInstance);
+}
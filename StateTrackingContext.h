@@ -0,0 +1,105 @@
+#pragma once
+
+#include "RenderContext.h"
+
+#include <cstdint>
+
+enum class BindKind : uint32_t
+{
+    InputLayout,
+    Topology,
+    VertexBuffers,
+    IndexBuffer,
+    VertexShader,
+    VSConstantBuffer,
+    Viewport,
+    PixelShader,
+    RenderTarget,
+    Count,
+};
+
+const char* BindKindName(BindKind kind);
+
+// Set* calls forwarded to the device vs. dropped because nothing changed.
+struct BindStats
+{
+    uint64_t issued[static_cast<size_t>(BindKind::Count)] = {};
+    uint64_t elided[static_cast<size_t>(BindKind::Count)] = {};
+};
+
+uint64_t TotalIssued(const BindStats& stats);
+uint64_t TotalElided(const BindStats& stats);
+void     AccumulateBindStats(BindStats& total, const BindStats& frame);
+
+// Sits in front of another IRenderContext and shadows its bindings, so a Set*
+// that matches the current state never reaches the device. Anything that
+// changes device state behind this layer's back must be followed by Invalidate.
+struct StateTrackingContext : IRenderContext
+{
+    // Slots past these are forwarded untracked.
+    static constexpr uint32_t kVertexBufferSlots   = 16;
+    static constexpr uint32_t kConstantBufferSlots = 14;
+
+    IRenderContext* inner = nullptr;
+
+    BindStats frame;
+    BindStats total;
+
+    // Forget all shadowed state; the next Set* of every kind is issued.
+    void Invalidate();
+
+    // Folds `frame` into `total` and resets it.
+    void EndFrame();
+
+    void SetInputLayout(RenderHandle layout) override;
+    void SetPrimitiveTopology(PrimitiveTopology topology) override;
+    void SetVertexBuffers(uint32_t startSlot, uint32_t count, const RenderHandle* buffers, const uint32_t* strides, const uint32_t* offsets) override;
+    void SetIndexBuffer(RenderHandle buffer, IndexFormat format, uint32_t offset) override;
+    void SetVertexShader(RenderHandle shader) override;
+    void SetVSConstantBuffer(uint32_t slot, RenderHandle buffer) override;
+    void SetVSConstantBufferRange(uint32_t slot, const ConstantRange& range) override;
+    void SetViewport(const RenderViewport& viewport) override;
+    void SetPixelShader(RenderHandle shader) override;
+    void SetRenderTarget(RenderHandle view) override;
+    void ClearRenderTarget(RenderHandle view, const float color[4]) override;
+
+    void* Map(RenderHandle buffer, MapMode mode) override;
+    void  Unmap(RenderHandle buffer, size_t bytesWritten) override;
+    void  UpdateBuffer(RenderHandle buffer, size_t offset, const void* data, size_t size) override;
+
+    void DrawIndexed(uint32_t indexCount, uint32_t startIndex, int32_t baseVertex) override;
+    void DrawIndexedInstanced(uint32_t indexCount, uint32_t instanceCount, uint32_t startIndex, int32_t baseVertex, uint32_t startInstance) override;
+
+private:
+    struct VertexBufferBinding
+    {
+        RenderHandle buffer = nullptr;
+        uint32_t     stride = 0;
+        uint32_t     offset = 0;
+    };
+
+    // Returns true (and counts an elided call) if the binding is already current.
+    bool Elide(BindKind kind, bool current);
+
+    // Same for a constant buffer slot; otherwise records `range` as current.
+    bool ElideConstantBuffer(uint32_t slot, const ConstantRange& range);
+
+    uint32_t known = 0;   // bit per BindKind with a valid shadow
+
+    RenderHandle      inputLayout  = nullptr;
+    PrimitiveTopology topology     = PrimitiveTopology::TriangleList;
+    RenderHandle      vertexShader = nullptr;
+    RenderHandle      pixelShader  = nullptr;
+    RenderHandle      renderTarget = nullptr;
+    RenderViewport    viewport;
+
+    RenderHandle indexBuffer = nullptr;
+    IndexFormat  indexFormat = IndexFormat::UInt32;
+    uint32_t     indexOffset = 0;
+
+    VertexBufferBinding vertexBuffers[kVertexBufferSlots];
+    uint32_t            vertexBufferKnown = 0;   // bit per slot
+
+    ConstantRange constantBuffers[kConstantBufferSlots];
+    uint32_t      constantBufferKnown = 0;   // bit per slot
+};
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstdarg>
+#include <cstdio>
+
+// The running test, set by renderer_tests; names every failure printed.
+inline const char* g_testName = "";
+
+// Prints the printf-style message under the running test's name when the
+// condition fails. Returns the condition, for `ok &= Expect(...)`.
+inline bool Expect(bool condition, const char* format, ...)
+{
+    if (!condition)
+    {
+        va_list args;
+        va_start(args, format);
+        std::printf("%s: ", g_testName);
+        std::vprintf(format, args);
+        std::printf("\n");
+        va_end(args);
+    }
+    return condition;
+}
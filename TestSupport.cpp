@@ -0,0 +1,183 @@
+#include "TestSupport.h"
+
+#include <algorithm>
+#include <cmath>
+
+void ReferenceWorldMatrix(float px, float py, float sx, float sy, float rotation, float* out)
+{
+    float s = std::sin(rotation);
+    float c = std::cos(rotation);
+
+    float scale[16]       = { sx, 0, 0, 0, 0, sy, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1 };
+    float rotationZ[16]   = { c, s, 0, 0, -s, c, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1 };
+    float translation[16] = { 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, px, py, 0, 1 };
+
+    auto multiply = [](const float* a, const float* b, float* r) {
+        for (int row = 0; row < 4; ++row)
+            for (int col = 0; col < 4; ++col)
+                r[row * 4 + col] = a[row * 4 + 0] * b[0 * 4 + col] +
+                                   a[row * 4 + 1] * b[1 * 4 + col] +
+                                   a[row * 4 + 2] * b[2 * 4 + col] +
+                                   a[row * 4 + 3] * b[3 * 4 + col];
+    };
+
+    float scaleRotation[16];
+    multiply(scale, rotationZ, scaleRotation);
+    multiply(scaleRotation, translation, out);
+}
+
+AffineInputs MakeAffineInputs(size_t count, float rotationRange)
+{
+    std::mt19937                          rng(1234);
+    std::uniform_real_distribution<float> position(-1.f, 1.f);
+    std::uniform_real_distribution<float> scale(0.01f, 2.f);
+    std::uniform_real_distribution<float> angle(-rotationRange, rotationRange);
+
+    AffineInputs in;
+    for (size_t i = 0; i < count; ++i)
+    {
+        in.px.push_back(position(rng));
+        in.py.push_back(position(rng));
+        in.sx.push_back(scale(rng));
+        in.sy.push_back(scale(rng));
+        in.rot.push_back(angle(rng));
+    }
+    return in;
+}
+
+void FillStubBytecode(const ShaderCompileRequest& request, std::vector<uint8_t>& bytecode)
+{
+    uint64_t seed = HashShaderRequest(request);
+    bytecode.resize(1024 + seed % 2048);
+    for (uint8_t& b : bytecode)
+    {
+        seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+        b    = static_cast<uint8_t>(seed >> 56);
+    }
+}
+
+void BindDrawState(IRenderContext& c, RenderHandle vertexBuffer, RenderHandle shader, const RenderViewport& viewport)
+{
+    RenderHandle handle = reinterpret_cast<RenderHandle>(0x10);
+    uint32_t     stride = 20;
+    uint32_t     offset = 0;
+
+    c.SetInputLayout(handle);
+    c.SetPrimitiveTopology(PrimitiveTopology::TriangleList);
+    c.SetVertexBuffers(0, 1, &vertexBuffer, &stride, &offset);
+    c.SetIndexBuffer(handle, IndexFormat::UInt32, 0);
+    c.SetVertexShader(shader);
+    c.SetVSConstantBuffer(0, handle);
+    c.SetViewport(viewport);
+    c.SetPixelShader(handle);
+    c.SetRenderTarget(handle);
+}
+
+void RecordSyntheticDraws(DrawCommandList& list, int count, int thread, int threads)
+{
+    for (int i = thread; i < count; i += threads)
+    {
+        uint32_t h      = static_cast<uint32_t>(i) * 2654435761u;
+        uint32_t shader = (h >> 8) % 8;
+        uint32_t mesh   = (h >> 16) % 64;
+        float    depth  = (h & 0xFF) / 255.f;
+
+        DrawCommand cmd      = {};
+        cmd.sortKey          = MakeDrawSortKey(0, shader, mesh, depth);
+        cmd.inputLayout      = reinterpret_cast<RenderHandle>(static_cast<uintptr_t>(0x1000 + shader % 2));
+        cmd.vertexShader     = reinterpret_cast<RenderHandle>(static_cast<uintptr_t>(0x2000 + shader));
+        cmd.pixelShader      = reinterpret_cast<RenderHandle>(static_cast<uintptr_t>(0x3000 + shader / 2));
+        cmd.constants.buffer = reinterpret_cast<RenderHandle>(static_cast<uintptr_t>(0x4000));
+        cmd.indexBuffer      = reinterpret_cast<RenderHandle>(static_cast<uintptr_t>(0x5000 + mesh));
+        cmd.indexFormat      = IndexFormat::UInt16;
+        cmd.vertexBuffers[0] = reinterpret_cast<RenderHandle>(static_cast<uintptr_t>(0x6000 + mesh));
+        cmd.vertexStrides[0] = 20;
+        cmd.indexCount       = 36;
+        list.commands.push_back(cmd);
+    }
+}
+
+void RecordSyntheticDrawsThreaded(DrawBucket& bucket, int count, int threads)
+{
+    ResetDrawBucket(bucket, threads);
+
+    std::vector<std::thread> workers;
+    for (int t = 1; t < threads; ++t)
+        workers.emplace_back(RecordSyntheticDraws, std::ref(bucket.lists[t]), count, t, threads);
+    RecordSyntheticDraws(bucket.lists[0], count, 0, threads);
+
+    for (std::thread& worker : workers)
+        worker.join();
+}
+
+void AppendSphere(std::vector<float>& positions, std::vector<uint32_t>& indices, uint32_t rings, uint32_t segments, float radius)
+{
+    uint32_t base = static_cast<uint32_t>(positions.size() / 3);
+    for (uint32_t r = 0; r <= rings; ++r)
+    {
+        float theta = 3.14159265f * r / rings;
+        for (uint32_t s = 0; s < segments; ++s)
+        {
+            float phi = 6.28318531f * s / segments;
+            positions.insert(positions.end(), { radius * std::sin(theta) * std::cos(phi), radius * std::cos(theta), radius * std::sin(theta) * std::sin(phi) });
+        }
+    }
+    for (uint32_t r = 0; r < rings; ++r)
+    {
+        for (uint32_t s = 0; s < segments; ++s)
+        {
+            uint32_t a = base + r * segments + s;
+            uint32_t b = base + r * segments + (s + 1) % segments;
+            uint32_t c = a + segments;
+            uint32_t d = b + segments;
+            indices.insert(indices.end(), { a, c, b, b, c, d });
+        }
+    }
+}
+
+void ShuffleTriangles(std::vector<uint32_t>& indices, uint32_t seed)
+{
+    std::mt19937 rng(seed);
+    for (size_t t = indices.size() / 3; t > 1; --t)
+    {
+        size_t j = rng() % t;
+        std::swap_ranges(indices.begin() + (t - 1) * 3, indices.begin() + t * 3, indices.begin() + j * 3);
+    }
+}
+
+float ScaledFrameMs(const DynamicResolution& dr, float fullMs)
+{
+    float scale = DynamicResolutionScale(dr);
+    return fullMs * scale * scale;
+}
+
+InputCaptureFrame SyntheticCaptureFrame(std::mt19937& rng, int frame)
+{
+    static const uint8_t keys[] = { 'W', 'A', 'S', 'D', KEY_UP, KEY_DOWN, KEY_LEFT, KEY_RIGHT, KEY_SPACE, KEY_CONTROL };
+
+    InputCaptureFrame out;
+    out.deltaTime = (14 + rng() % 6) / 1000.f;
+    if (frame % 20 < 12)
+    {
+        uint8_t key                 = keys[(frame / 20) % sizeof(keys)];
+        out.input.heldFraction[key] = frame % 20 == 0 ? 0.25f * (1 + rng() % 4) : 1.f;
+        out.input.pressed[key]      = frame % 20 == 0;
+    }
+    if (frame % 97 == 50)
+    {
+        out.hasControls                     = true;
+        out.controls.triPosition[0]         = 0.01f * (rng() % 50);
+        out.controls.triScale[1]            = 0.5f;
+        out.controls.requestedInstanceCount = 200 + frame;
+        out.controls.instanceExtent         = 1.f + (frame % 3);
+        out.controls.cullInstances          = frame % 2 == 0;
+    }
+    return out;
+}
+
+void StepCapturedFrame(SceneState& scene, const InputCaptureFrame& frame)
+{
+    UpdateSceneInput(scene, frame.input, frame.deltaTime);
+    if (frame.hasControls)
+        ApplySceneControls(scene, frame.controls);
+}
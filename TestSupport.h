@@ -0,0 +1,266 @@
+#pragma once
+
+// Test doubles and synthetic inputs shared by bench and renderer_tests.
+
+#include "DrawBucket.h"
+#include "DynamicResolution.h"
+#include "InputCapture.h"
+#include "RenderContext.h"
+#include "Scene.h"
+#include "ShaderCache.h"
+#include "VertexFormat.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+constexpr VertexPackPath kVertexPackPaths[] = { VertexPackPath::Scalar, VertexPackPath::SSE, VertexPackPath::F16C };
+
+// Scale * RotationZ * Translation as SimpleMath evaluates it: two full 4x4 products.
+void ReferenceWorldMatrix(float px, float py, float sx, float sy, float rotation, float* out);
+
+struct AffineInputs
+{
+    std::vector<float> px, py, sx, sy, rot;
+};
+
+AffineInputs MakeAffineInputs(size_t count, float rotationRange);
+
+// Deterministic fake bytecode derived from the request.
+void FillStubBytecode(const ShaderCompileRequest& request, std::vector<uint8_t>& bytecode);
+
+// Deterministic fake compiler, with a configurable cost so cold and warm
+// starts can be told apart.
+struct StubShaderCompiler : IShaderCompiler
+{
+    int  compiles = 0;
+    int  spinUs   = 0;
+    bool failNext = false;
+
+    bool Compile(const ShaderCompileRequest& request, std::vector<uint8_t>& bytecode, std::string& errors) override
+    {
+        ++compiles;
+        if (failNext)
+        {
+            failNext = false;
+            errors   = "stub: forced failure";
+            return false;
+        }
+
+        auto end = std::chrono::steady_clock::now() + std::chrono::microseconds(spinUs);
+        while (std::chrono::steady_clock::now() < end)
+        {
+        }
+
+        FillStubBytecode(request, bytecode);
+        return true;
+    }
+};
+
+// Mock device: counts what reaches it and remembers the last vertex buffer
+// range, render target and viewport.
+struct RecordingRenderContext : IRenderContext
+{
+    int      calls            = 0;
+    uint32_t lastVertexStart  = 0;
+    uint32_t lastVertexCount  = 0;
+    int      vertexBufferSets = 0;
+
+    RenderHandle   lastRenderTarget = nullptr;
+    RenderViewport lastViewport;
+
+    // binds per kind, for checking what redundant-state filtering skipped
+    int inputLayoutSets   = 0;
+    int indexBufferSets   = 0;
+    int vertexShaderSets  = 0;
+    int pixelShaderSets   = 0;
+    int constantRangeSets = 0;
+
+    int    updates      = 0;
+    size_t updatedBytes = 0;
+
+    // Only buffers from AddBuffer can be mapped or updated. With resolveDraws, every
+    // DrawIndexed looks up its indices and appends the (x, y) of each vertex.
+    bool                           resolveDraws   = false;
+    int                            draws          = 0;
+    int                            instancedDraws = 0;
+    std::vector<MapMode>           mapModes;
+    std::vector<PrimitiveTopology> drawTopologies;
+    std::vector<float>             drawnPositions;
+
+    RenderHandle AddBuffer(size_t size)
+    {
+        memory.push_back(std::make_unique<std::vector<uint8_t>>(size));
+        return memory.back()->data();
+    }
+
+    void SetInputLayout(RenderHandle) override
+    {
+        ++calls;
+        ++inputLayoutSets;
+    }
+    void SetPrimitiveTopology(PrimitiveTopology t) override
+    {
+        ++calls;
+        topology = t;
+    }
+    void SetVertexBuffers(uint32_t startSlot, uint32_t count, const RenderHandle* buffers, const uint32_t* strides, const uint32_t*) override
+    {
+        ++calls;
+        ++vertexBufferSets;
+        lastVertexStart = startSlot;
+        lastVertexCount = count;
+        if (startSlot == 0)
+        {
+            vertexBuffer = static_cast<const uint8_t*>(buffers[0]);
+            vertexStride = strides[0];
+        }
+    }
+    void SetIndexBuffer(RenderHandle buffer, IndexFormat, uint32_t) override
+    {
+        ++calls;
+        ++indexBufferSets;
+        indexBuffer = static_cast<const uint32_t*>(buffer);
+    }
+    void SetVertexShader(RenderHandle) override
+    {
+        ++calls;
+        ++vertexShaderSets;
+    }
+    void SetVSConstantBuffer(uint32_t, RenderHandle) override { ++calls; }
+    void SetVSConstantBufferRange(uint32_t, const ConstantRange&) override
+    {
+        ++calls;
+        ++constantRangeSets;
+    }
+    void SetViewport(const RenderViewport& viewport) override
+    {
+        ++calls;
+        lastViewport = viewport;
+    }
+    void SetPixelShader(RenderHandle) override
+    {
+        ++calls;
+        ++pixelShaderSets;
+    }
+    void SetRenderTarget(RenderHandle target) override
+    {
+        ++calls;
+        lastRenderTarget = target;
+    }
+    void ClearRenderTarget(RenderHandle, const float*) override {}
+
+    void* Map(RenderHandle buffer, MapMode mode) override
+    {
+        for (const auto& m : memory)
+        {
+            if (m->data() == buffer)
+            {
+                mapModes.push_back(mode);
+                return buffer;
+            }
+        }
+        return nullptr;
+    }
+    void Unmap(RenderHandle, size_t) override {}
+    void UpdateBuffer(RenderHandle buffer, size_t offset, const void* data, size_t size) override
+    {
+        ++updates;
+        updatedBytes += size;
+        std::memcpy(static_cast<uint8_t*>(buffer) + offset, data, size);
+    }
+
+    void DrawIndexed(uint32_t indexCount, uint32_t startIndex, int32_t baseVertex) override
+    {
+        ++draws;
+        if (!resolveDraws)
+            return;
+
+        drawTopologies.push_back(topology);
+        for (uint32_t i = startIndex; i < startIndex + indexCount; ++i)
+        {
+            float xy[2];
+            std::memcpy(xy, vertexBuffer + (indexBuffer[i] + baseVertex) * vertexStride, sizeof(xy));
+            drawnPositions.insert(drawnPositions.end(), xy, xy + 2);
+        }
+    }
+    void DrawIndexedInstanced(uint32_t, uint32_t, uint32_t, int32_t, uint32_t) override { ++instancedDraws; }
+
+private:
+    std::vector<std::unique_ptr<std::vector<uint8_t>>> memory;
+
+    PrimitiveTopology topology     = PrimitiveTopology::TriangleList;
+    const uint8_t*    vertexBuffer = nullptr;
+    uint32_t          vertexStride = 0;
+    const uint32_t*   indexBuffer  = nullptr;
+};
+
+// The binds RenderScene issues for one draw.
+void BindDrawState(IRenderContext& c, RenderHandle vertexBuffer, RenderHandle shader, const RenderViewport& viewport);
+
+// Synthetic scene: `count` draws over a handful of shaders and meshes, in
+// scrambled order. Thread `t` of `threads` records every threads-th draw.
+void RecordSyntheticDraws(DrawCommandList& list, int count, int thread, int threads);
+
+void RecordSyntheticDrawsThreaded(DrawBucket& bucket, int count, int threads);
+
+// UV sphere appended to positions (x, y, z) and indices.
+void AppendSphere(std::vector<float>& positions, std::vector<uint32_t>& indices, uint32_t rings, uint32_t segments, float radius);
+
+void ShuffleTriangles(std::vector<uint32_t>& indices, uint32_t seed);
+
+// GPU time at the current scale for a scene costing fullMs at full size;
+// cost follows the pixel count.
+float ScaledFrameMs(const DynamicResolution& dr, float fullMs);
+
+// Random held keys and taps, uneven delta times and a UI edit every 97 frames.
+InputCaptureFrame SyntheticCaptureFrame(std::mt19937& rng, int frame);
+
+void StepCapturedFrame(SceneState& scene, const InputCaptureFrame& frame);
+
+// Thread-safe stand-in for a slow compiler: sleeps rather than spins, so the
+// overlap shows on any core count. Records the order compiles start in.
+struct LatencyShaderCompiler : IShaderCompiler
+{
+    int         latencyMs = 0;
+    const char* failEntry = nullptr;   // compiles of this entry point fail
+
+    std::atomic<int>         compiles { 0 };
+    std::atomic<int>         active { 0 };
+    std::atomic<int>         peakActive { 0 };
+    std::mutex               orderMutex;
+    std::vector<std::string> order;
+
+    bool Compile(const ShaderCompileRequest& request, std::vector<uint8_t>& bytecode, std::string& errors) override
+    {
+        compiles.fetch_add(1);
+        int now  = active.fetch_add(1) + 1;
+        int peak = peakActive.load();
+        while (now > peak && !peakActive.compare_exchange_weak(peak, now))
+        {
+        }
+        {
+            std::lock_guard<std::mutex> lock(orderMutex);
+            order.push_back(request.entryPoint);
+        }
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(latencyMs));
+        active.fetch_sub(1);
+
+        if (failEntry && std::strcmp(request.entryPoint, failEntry) == 0)
+        {
+            errors = "stub: forced failure";
+            return false;
+        }
+        FillStubBytecode(request, bytecode);
+        return true;
+    }
+};
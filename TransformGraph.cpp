@@ -0,0 +1,247 @@
+#include "TransformGraph.h"
+#include "AffineKernel.h"
+#include "Profiler.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+    // Past this share of dirty nodes a sweep over the flags beats sorting the list.
+    constexpr size_t kDirtySweepDivisor = 64;
+
+    // Clean nodes between two changed ranges that are uploaded along with them
+    // rather than splitting the copy.
+    constexpr uint32_t kUploadGapNodes = 16;
+
+    // m = m * p for the 2D affine matrices BuildAffineMatrices writes; the z
+    // row and column stay identity.
+    void ConcatAffine(float* m, const float* p)
+    {
+        float a0  = m[0];
+        float a1  = m[1];
+        float a4  = m[4];
+        float a5  = m[5];
+        float a12 = m[12];
+        float a13 = m[13];
+
+        m[0]  = a0 * p[0] + a1 * p[4];
+        m[1]  = a0 * p[1] + a1 * p[5];
+        m[4]  = a4 * p[0] + a5 * p[4];
+        m[5]  = a4 * p[1] + a5 * p[5];
+        m[12] = a12 * p[0] + a13 * p[4] + p[12];
+        m[13] = a12 * p[1] + a13 * p[5] + p[13];
+    }
+
+    // Locals of [begin, end) in one batch, then each joined with its parent.
+    // Parents come first, and the parent of `begin` is outside and up to date.
+    void UpdateWorldRange(TransformGraph& graph, uint32_t begin, uint32_t end)
+    {
+        const InstanceTransforms& l = graph.local;
+        BuildAffineMatrices(l.positionX.data() + begin,
+                            l.positionY.data() + begin,
+                            l.scaleX.data() + begin,
+                            l.scaleY.data() + begin,
+                            l.rotation.data() + begin,
+                            end - begin,
+                            graph.world[begin].world);
+
+        for (uint32_t i = begin; i < end; ++i)
+        {
+            uint32_t parent = graph.parent[i];
+            if (parent != kNoTransformNode)
+                ConcatAffine(graph.world[i].world, graph.world[parent].world);
+        }
+    }
+
+    // Recomputes whole subtrees [begin, end), appending them to `changed`.
+    void UpdateSubtrees(TransformGraph& graph, uint32_t begin, uint32_t end)
+    {
+        UpdateWorldRange(graph, begin, end);
+        graph.stats.updatedNodes += end - begin;
+
+        if (!graph.changed.empty() && graph.changed.back().end == begin)
+            graph.changed.back().end = end;
+        else
+            graph.changed.push_back(TransformRange { begin, end });
+    }
+}   // namespace
+
+size_t TransformNodeCount(const TransformGraph& graph)
+{
+    return graph.parent.size();
+}
+
+void ClearTransformGraph(TransformGraph& graph)
+{
+    ClearInstances(graph.local);
+    graph.parent.clear();
+    graph.subtreeEnd.clear();
+    graph.world.clear();
+    graph.dirty.clear();
+    graph.dirtyCount = 0;
+    graph.dirtyNodes.clear();
+    graph.changed.clear();
+    graph.open.clear();
+    graph.stats = {};
+}
+
+void ReserveTransformGraph(TransformGraph& graph, size_t capacity)
+{
+    ReserveInstances(graph.local, capacity);
+    graph.parent.reserve(capacity);
+    graph.subtreeEnd.reserve(capacity);
+    graph.world.reserve(capacity);
+    graph.dirty.reserve(capacity);
+    graph.dirtyNodes.reserve(capacity);
+}
+
+uint32_t AddTransformNode(TransformGraph& graph, uint32_t parent, float x, float y, float scaleX, float scaleY, float rotation)
+{
+    uint32_t index = static_cast<uint32_t>(TransformNodeCount(graph));
+    if (parent != kNoTransformNode && (parent >= index || graph.subtreeEnd[parent] != kNoTransformNode))
+        return kNoTransformNode;
+
+    // every open subtree below the parent ends here
+    while (!graph.open.empty() && graph.open.back() != parent)
+    {
+        graph.subtreeEnd[graph.open.back()] = index;
+        graph.open.pop_back();
+    }
+
+    AddInstance(graph.local, x, y, scaleX, scaleY, rotation);
+    graph.parent.push_back(parent);
+    graph.subtreeEnd.push_back(kNoTransformNode);
+    graph.world.push_back(InstanceData {});
+    graph.dirty.push_back(1);
+    graph.dirtyNodes.push_back(index);
+    ++graph.dirtyCount;
+    graph.open.push_back(index);
+    return index;
+}
+
+void SetTransformLocal(TransformGraph& graph, uint32_t node, float x, float y, float scaleX, float scaleY, float rotation)
+{
+    InstanceTransforms& l = graph.local;
+    if (l.positionX[node] == x && l.positionY[node] == y && l.scaleX[node] == scaleX && l.scaleY[node] == scaleY && l.rotation[node] == rotation)
+        return;
+
+    l.positionX[node] = x;
+    l.positionY[node] = y;
+    l.scaleX[node]    = scaleX;
+    l.scaleY[node]    = scaleY;
+    l.rotation[node]  = rotation;
+
+    if (!graph.dirty[node])
+    {
+        graph.dirty[node] = 1;
+        graph.dirtyNodes.push_back(node);
+        ++graph.dirtyCount;
+    }
+}
+
+void MarkTransformRangeDirty(TransformGraph& graph, uint32_t begin, uint32_t end)
+{
+    // the update sweeps the flags for this many anyway, so only they are set
+    uint8_t* flags = graph.dirty.data();
+    if (end - begin > TransformNodeCount(graph) / kDirtySweepDivisor)
+    {
+        graph.dirtyCount += static_cast<uint32_t>(std::count(flags + begin, flags + end, 0));
+        std::memset(flags + begin, 1, end - begin);
+        return;
+    }
+
+    for (uint32_t node = begin; node < end; ++node)
+    {
+        if (!flags[node])
+        {
+            flags[node] = 1;
+            graph.dirtyNodes.push_back(node);
+            ++graph.dirtyCount;
+        }
+    }
+}
+
+bool UpdateTransformGraph(TransformGraph& graph)
+{
+    graph.changed.clear();
+    graph.stats = {};
+    if (graph.dirtyCount == 0)
+        return false;
+
+    PROFILE_SCOPE("UpdateTransformGraph");
+
+    uint32_t count         = static_cast<uint32_t>(TransformNodeCount(graph));
+    graph.stats.dirtyNodes = graph.dirtyCount;
+
+    // In node order either way, so an edited subtree is recomputed whole
+    // before any dirty node inside it comes up. The list is only walked when
+    // it holds every dirty node.
+    if (graph.dirtyCount > count / kDirtySweepDivisor || graph.dirtyNodes.size() != graph.dirtyCount)
+    {
+        const uint8_t* flags = graph.dirty.data();
+        for (uint32_t node = 0; node < count;)
+        {
+            const void* next = std::memchr(flags + node, 1, count - node);
+            if (!next)
+                break;
+
+            // dirty subtrees right behind this one go in the same batch, so
+            // a run of edited siblings is one BuildAffineMatrices call
+            node         = static_cast<uint32_t>(static_cast<const uint8_t*>(next) - flags);
+            uint32_t end = TransformSubtreeEnd(graph, node);
+            while (end < count && flags[end])
+                end = TransformSubtreeEnd(graph, end);
+
+            UpdateSubtrees(graph, node, end);
+            std::memset(graph.dirty.data() + node, 0, end - node);
+            node = end;
+        }
+    }
+    else
+    {
+        std::sort(graph.dirtyNodes.begin(), graph.dirtyNodes.end());
+
+        uint32_t updatedEnd = 0;
+        for (uint32_t node : graph.dirtyNodes)
+        {
+            graph.dirty[node] = 0;
+            if (node >= updatedEnd)
+            {
+                updatedEnd = TransformSubtreeEnd(graph, node);
+                UpdateSubtrees(graph, node, updatedEnd);
+            }
+        }
+    }
+
+    graph.dirtyNodes.clear();
+    graph.dirtyCount   = 0;
+    graph.stats.ranges = static_cast<uint32_t>(graph.changed.size());
+    ++graph.version;
+    return true;
+}
+
+uint32_t TransformSubtreeEnd(const TransformGraph& graph, uint32_t node)
+{
+    uint32_t end = graph.subtreeEnd[node];
+    return end == kNoTransformNode ? static_cast<uint32_t>(TransformNodeCount(graph)) : end;
+}
+
+size_t UploadTransformGraph(IRenderContext& context, RenderHandle buffer, const TransformGraph& graph)
+{
+    PROFILE_SCOPE("UploadTransformGraph");
+
+    size_t bytes = 0;
+    for (size_t i = 0; i < graph.changed.size();)
+    {
+        uint32_t begin = graph.changed[i].begin;
+        uint32_t end   = graph.changed[i].end;
+        for (++i; i < graph.changed.size() && graph.changed[i].begin - end <= kUploadGapNodes; ++i)
+            end = graph.changed[i].end;
+
+        size_t size = (end - begin) * sizeof(InstanceData);
+        context.UpdateBuffer(buffer, begin * sizeof(InstanceData), graph.world.data() + begin, size);
+        bytes += size;
+    }
+    return bytes;
+}
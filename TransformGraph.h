@@ -0,0 +1,79 @@
+#pragma once
+
+#include "InstanceBuffer.h"
+#include "RenderContext.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+constexpr uint32_t kNoTransformNode = UINT32_MAX;
+
+// Nodes [begin, end).
+struct TransformRange
+{
+    uint32_t begin = 0;
+    uint32_t end   = 0;
+};
+
+// What the last UpdateTransformGraph did.
+struct TransformGraphStats
+{
+    uint32_t dirtyNodes   = 0;   // edited since the update before
+    uint32_t updatedNodes = 0;   // world matrices recomputed: the edited nodes and everything below them
+    uint32_t ranges       = 0;   // entries in `changed`
+};
+
+// 2D transform hierarchy in flat arrays, in depth-first order: a parent comes
+// before its children and every subtree is one contiguous range of nodes, so
+// recomputing or uploading a changed subtree is a single linear pass. Local
+// transforms are structure-of-arrays like InstanceTransforms; world matrices
+// are kept in the instance buffer layout, ready to upload.
+//
+// Edits mark nodes dirty. UpdateTransformGraph recomputes only the dirty
+// subtrees and leaves the node ranges it rewrote in `changed`; with nothing
+// dirty it does no work at all.
+struct TransformGraph
+{
+    InstanceTransforms        local;
+    std::vector<uint32_t>     parent;       // kNoTransformNode for roots, else a lower index
+    std::vector<uint32_t>     subtreeEnd;   // one past the last descendant; kNoTransformNode while still open
+    std::vector<InstanceData> world;        // local * parent's world
+
+    std::vector<uint8_t>        dirty;        // edited since the last update
+    uint32_t                    dirtyCount = 0;
+    std::vector<uint32_t>       dirtyNodes;   // the same nodes, in edit order; left out by ranges big enough to sweep
+    std::vector<TransformRange> changed;      // rewritten by the last update, ascending and merged
+    std::vector<uint32_t>       open;         // the last node and its ancestors: where the next node may attach
+
+    uint64_t            version = 0;   // counts the updates that changed something
+    TransformGraphStats stats;
+};
+
+size_t TransformNodeCount(const TransformGraph& graph);
+void   ClearTransformGraph(TransformGraph& graph);
+void   ReserveTransformGraph(TransformGraph& graph, size_t capacity);
+
+// Appends a node, dirty. Nodes go in depth-first order: `parent` is
+// kNoTransformNode, the last node, or one of its ancestors; a later node can
+// no longer attach to a finished subtree. Returns the index, or
+// kNoTransformNode for a parent out of that order.
+uint32_t AddTransformNode(TransformGraph& graph, uint32_t parent, float x, float y, float scaleX, float scaleY, float rotation);
+
+// Marks the node dirty only when a value differs.
+void SetTransformLocal(TransformGraph& graph, uint32_t node, float x, float y, float scaleX, float scaleY, float rotation);
+
+// Marks nodes [begin, end) dirty, for locals edited in place, e.g. by
+// RotateInstanceRange on graph.local.
+void MarkTransformRangeDirty(TransformGraph& graph, uint32_t begin, uint32_t end);
+
+// Recomputes the world matrices of every dirty node and its subtree. False,
+// and `changed` empty, when nothing was dirty.
+bool UpdateTransformGraph(TransformGraph& graph);
+
+// One past the last node of `node`'s subtree.
+uint32_t TransformSubtreeEnd(const TransformGraph& graph, uint32_t node);
+
+// Writes the ranges the last update changed into `buffer`, which holds one
+// InstanceData per node, leaving the rest as it was. Returns the bytes written.
+size_t UploadTransformGraph(IRenderContext& context, RenderHandle buffer, const TransformGraph& graph);
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+// Single writer, single reader, wait-free. The writer fills WriteBuffer() and
+// publishes it; the reader picks up the newest published value with Update().
+// Values in between are overwritten, never queued.
+template<typename T>
+struct TripleBuffer
+{
+    // Writer side.
+    T& WriteBuffer()
+    {
+        return slots[back];
+    }
+
+    void Publish()
+    {
+        uint32_t previous = middle.exchange(back | kFresh, std::memory_order_acq_rel);
+        back              = previous & kIndexMask;
+    }
+
+    // Reader side. True if something newer than the current ReadBuffer() was taken.
+    bool Update()
+    {
+        if ((middle.load(std::memory_order_relaxed) & kFresh) == 0)
+            return false;
+
+        uint32_t previous = middle.exchange(front, std::memory_order_acq_rel);
+        front             = previous & kIndexMask;
+        return true;
+    }
+
+    T& ReadBuffer()
+    {
+        return slots[front];
+    }
+
+private:
+    static constexpr uint32_t kIndexMask = 3;
+    static constexpr uint32_t kFresh     = 4;
+
+    T slots[3] = {};
+
+    alignas(64) std::atomic<uint32_t> middle { 1 };
+    alignas(64) uint32_t back  = 0;   // writer only
+    alignas(64) uint32_t front = 2;   // reader only
+};
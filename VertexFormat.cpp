@@ -0,0 +1,479 @@
+#include "VertexFormat.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(_M_X64) || defined(__x86_64__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#    define VERTEX_PACK_X86 1
+#    include <immintrin.h>
+#    if defined(_MSC_VER)
+#        include <intrin.h>
+#        define VERTEX_TARGET_F16C
+#    else
+#        define VERTEX_TARGET_F16C __attribute__((target("f16c")))
+#    endif
+#else
+#    define VERTEX_PACK_X86 0
+#endif
+
+namespace
+{
+    const VertexLayout kLayouts[] = {
+        { VertexFormat::Float32, 20, 2, { { "POSITION", 0, VertexElementFormat::Float2, 0 }, { "COLOR", 0, VertexElementFormat::Float3, 8 } } },
+        { VertexFormat::Half, 8, 2, { { "POSITION", 0, VertexElementFormat::Half2, 0 }, { "COLOR", 0, VertexElementFormat::Unorm8x4, 4 } } },
+        { VertexFormat::Snorm16, 8, 2, { { "POSITION", 0, VertexElementFormat::Snorm16x2, 0 }, { "COLOR", 0, VertexElementFormat::Unorm8x4, 4 } } },
+    };
+
+    static_assert(sizeof(kLayouts) / sizeof(kLayouts[0]) == static_cast<size_t>(VertexFormat::Count), "one layout per VertexFormat");
+
+    constexpr size_t kSourceFloats = 5;   // x, y, r, g, b
+
+    // float -> half bit tricks (round to nearest even), after F. Giesen's float_to_half_fast3_rtne
+    constexpr uint32_t kF32Infinity = 255u << 23;
+    constexpr uint32_t kF16Max      = (127u + 16u) << 23;              // 65536.f, first value that is inf in half
+    constexpr uint32_t kDenormMagic = ((127u - 15u) + (23u - 10u) + 1u) << 23;
+    constexpr uint32_t kMinNormal   = 113u << 23;                      // 2^-14, smallest normal half
+
+    uint32_t AsBits(float f)
+    {
+        uint32_t u;
+        std::memcpy(&u, &f, sizeof(u));
+        return u;
+    }
+
+    float AsFloat(uint32_t u)
+    {
+        float f;
+        std::memcpy(&f, &u, sizeof(f));
+        return f;
+    }
+
+    uint16_t HalfScalar(float f)
+    {
+        uint32_t u    = AsBits(f);
+        uint32_t sign = u & 0x80000000u;
+        u ^= sign;
+
+        uint32_t h;
+        if (u >= kF16Max)
+            h = u > kF32Infinity ? 0x7E00 : 0x7C00;
+        else if (u < kMinNormal)
+            h = AsBits(AsFloat(u) + AsFloat(kDenormMagic)) - kDenormMagic;
+        else
+            h = (u + ((15u - 127u) << 23) + 0xFFF + ((u >> 13) & 1)) >> 13;
+
+        return static_cast<uint16_t>(h | (sign >> 16));
+    }
+
+    float ZeroNaN(float x)
+    {
+        return x == x ? x : 0.f;
+    }
+
+    int16_t Snorm16Scalar(float x)
+    {
+        x = std::min(std::max(ZeroNaN(x), -1.f), 1.f);
+        return static_cast<int16_t>(std::lrint(x * 32767.f));
+    }
+
+    uint8_t Unorm8Scalar(float x)
+    {
+        x = std::min(std::max(ZeroNaN(x), 0.f), 1.f);
+        return static_cast<uint8_t>(std::lrint(x * 255.f));
+    }
+
+    void PackVertexScalar(VertexFormat format, const float* v, uint8_t* out)
+    {
+        uint8_t color[4] = { Unorm8Scalar(v[2]), Unorm8Scalar(v[3]), Unorm8Scalar(v[4]), 255 };
+
+        if (format == VertexFormat::Half)
+        {
+            uint16_t position[2] = { HalfScalar(v[0]), HalfScalar(v[1]) };
+            std::memcpy(out, position, sizeof(position));
+        }
+        else
+        {
+            int16_t position[2] = { Snorm16Scalar(v[0]), Snorm16Scalar(v[1]) };
+            std::memcpy(out, position, sizeof(position));
+        }
+        std::memcpy(out + 4, color, sizeof(color));
+    }
+
+#if VERTEX_PACK_X86
+    __m128i Select(__m128i mask, __m128i a, __m128i b)
+    {
+        return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+    }
+
+    // HalfScalar on 4 lanes; halves in the low 16 bits of each 32-bit lane
+    __m128i HalfSSE(__m128 f)
+    {
+        __m128i u    = _mm_castps_si128(f);
+        __m128i sign = _mm_and_si128(u, _mm_set1_epi32(static_cast<int>(0x80000000u)));
+        u            = _mm_xor_si128(u, sign);
+
+        __m128i isInfNaN = _mm_cmpgt_epi32(u, _mm_set1_epi32(kF16Max - 1));
+        __m128i infNaN   = _mm_or_si128(_mm_set1_epi32(0x7C00), _mm_and_si128(_mm_cmpgt_epi32(u, _mm_set1_epi32(kF32Infinity)), _mm_set1_epi32(0x0200)));
+
+        __m128i isDenormal = _mm_cmplt_epi32(u, _mm_set1_epi32(kMinNormal));
+        __m128  magic      = _mm_castsi128_ps(_mm_set1_epi32(kDenormMagic));
+        __m128i denormal   = _mm_sub_epi32(_mm_castps_si128(_mm_add_ps(_mm_castsi128_ps(u), magic)), _mm_castps_si128(magic));
+
+        __m128i odd    = _mm_and_si128(_mm_srli_epi32(u, 13), _mm_set1_epi32(1));
+        __m128i normal = _mm_add_epi32(u, _mm_set1_epi32(static_cast<int>(((15u - 127u) << 23) + 0xFFF)));
+        normal         = _mm_srli_epi32(_mm_add_epi32(normal, odd), 13);
+
+        __m128i h = Select(isInfNaN, infNaN, Select(isDenormal, denormal, normal));
+        return _mm_or_si128(h, _mm_srli_epi32(sign, 16));
+    }
+
+    // Two vectors of HalfSSE results -> 8 halves
+    __m128i NarrowHalves(__m128i a, __m128i b)
+    {
+        // sign-extend so the signed saturating pack keeps all 16 bits
+        a = _mm_srai_epi32(_mm_slli_epi32(a, 16), 16);
+        b = _mm_srai_epi32(_mm_slli_epi32(b, 16), 16);
+        return _mm_packs_epi32(a, b);
+    }
+
+    __m128 ClampSSE(__m128 x, __m128 lo, __m128 hi)
+    {
+        x = _mm_and_ps(x, _mm_cmpord_ps(x, x));   // NaN -> 0
+        return _mm_min_ps(_mm_max_ps(x, lo), hi);
+    }
+
+    __m128i Snorm16SSE(__m128 a, __m128 b)
+    {
+        __m128 lo    = _mm_set1_ps(-1.f);
+        __m128 hi    = _mm_set1_ps(1.f);
+        __m128 scale = _mm_set1_ps(32767.f);
+        return _mm_packs_epi32(_mm_cvtps_epi32(_mm_mul_ps(ClampSSE(a, lo, hi), scale)),
+                               _mm_cvtps_epi32(_mm_mul_ps(ClampSSE(b, lo, hi), scale)));
+    }
+
+    __m128i Unorm8SSE(__m128 a, __m128 b, __m128 c, __m128 d)
+    {
+        __m128  lo    = _mm_setzero_ps();
+        __m128  hi    = _mm_set1_ps(1.f);
+        __m128  scale = _mm_set1_ps(255.f);
+        __m128i ab    = _mm_packs_epi32(_mm_cvtps_epi32(_mm_mul_ps(ClampSSE(a, lo, hi), scale)),
+                                        _mm_cvtps_epi32(_mm_mul_ps(ClampSSE(b, lo, hi), scale)));
+        __m128i cd    = _mm_packs_epi32(_mm_cvtps_epi32(_mm_mul_ps(ClampSSE(c, lo, hi), scale)),
+                                        _mm_cvtps_epi32(_mm_mul_ps(ClampSSE(d, lo, hi), scale)));
+        return _mm_packus_epi16(ab, cd);
+    }
+
+    __m128 LoadXY(const float* v)
+    {
+        return _mm_castpd_ps(_mm_load_sd(reinterpret_cast<const double*>(v)));
+    }
+
+    // r, g, b, 1 of one source vertex; reads one float past it
+    __m128 LoadRGB1(const float* v)
+    {
+        __m128 rgbMask = _mm_castsi128_ps(_mm_setr_epi32(-1, -1, -1, 0));
+        return _mm_or_ps(_mm_and_ps(_mm_loadu_ps(v + 2), rgbMask), _mm_setr_ps(0.f, 0.f, 0.f, 1.f));
+    }
+
+    // x0 y0 x1 y1 and x2 y2 x3 y3 of four source vertices
+    void LoadPositions4(const float* v, __m128& p01, __m128& p23)
+    {
+        p01 = _mm_movelh_ps(LoadXY(v), LoadXY(v + kSourceFloats));
+        p23 = _mm_movelh_ps(LoadXY(v + 2 * kSourceFloats), LoadXY(v + 3 * kSourceFloats));
+    }
+
+    __m128i LoadColors4(const float* v)
+    {
+        return Unorm8SSE(LoadRGB1(v), LoadRGB1(v + kSourceFloats), LoadRGB1(v + 2 * kSourceFloats), LoadRGB1(v + 3 * kSourceFloats));
+    }
+
+    // positions and colors of four vertices -> four 8-byte vertices
+    void Store4(uint8_t* out, __m128i positions, __m128i colors)
+    {
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm_unpacklo_epi32(positions, colors));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 16), _mm_unpackhi_epi32(positions, colors));
+    }
+
+    // Vector loops stop one vertex early: the color load of the fourth vertex
+    // reads into the next one.
+    size_t PackVerticesSSE(VertexFormat format, const float* source, size_t count, uint8_t* out)
+    {
+        size_t i = 0;
+        for (; i + 4 < count; i += 4)
+        {
+            const float* v = source + i * kSourceFloats;
+
+            __m128 p01, p23;
+            LoadPositions4(v, p01, p23);
+
+            __m128i positions = format == VertexFormat::Half ? NarrowHalves(HalfSSE(p01), HalfSSE(p23)) : Snorm16SSE(p01, p23);
+            Store4(out + i * 8, positions, LoadColors4(v));
+        }
+        return i;
+    }
+
+    VERTEX_TARGET_F16C size_t PackHalfVerticesF16C(const float* source, size_t count, uint8_t* out)
+    {
+        size_t i = 0;
+        for (; i + 4 < count; i += 4)
+        {
+            const float* v = source + i * kSourceFloats;
+
+            __m128 p01, p23;
+            LoadPositions4(v, p01, p23);
+
+            __m128i positions = _mm_unpacklo_epi64(_mm_cvtps_ph(p01, _MM_FROUND_TO_NEAREST_INT), _mm_cvtps_ph(p23, _MM_FROUND_TO_NEAREST_INT));
+            Store4(out + i * 8, positions, LoadColors4(v));
+        }
+        return i;
+    }
+
+    size_t FloatToHalfSSE(const float* source, size_t count, uint16_t* out)
+    {
+        size_t i = 0;
+        for (; i + 8 <= count; i += 8)
+        {
+            __m128i h = NarrowHalves(HalfSSE(_mm_loadu_ps(source + i)), HalfSSE(_mm_loadu_ps(source + i + 4)));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), h);
+        }
+        return i;
+    }
+
+    VERTEX_TARGET_F16C size_t FloatToHalfF16C(const float* source, size_t count, uint16_t* out)
+    {
+        size_t i = 0;
+        for (; i + 8 <= count; i += 8)
+        {
+            __m128i h = _mm_unpacklo_epi64(_mm_cvtps_ph(_mm_loadu_ps(source + i), _MM_FROUND_TO_NEAREST_INT),
+                                           _mm_cvtps_ph(_mm_loadu_ps(source + i + 4), _MM_FROUND_TO_NEAREST_INT));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), h);
+        }
+        return i;
+    }
+
+    size_t FloatToSnorm16SSE(const float* source, size_t count, int16_t* out)
+    {
+        size_t i = 0;
+        for (; i + 8 <= count; i += 8)
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), Snorm16SSE(_mm_loadu_ps(source + i), _mm_loadu_ps(source + i + 4)));
+        return i;
+    }
+
+    size_t FloatToUnorm8SSE(const float* source, size_t count, uint8_t* out)
+    {
+        size_t i = 0;
+        for (; i + 16 <= count; i += 16)
+        {
+            __m128i u = Unorm8SSE(_mm_loadu_ps(source + i), _mm_loadu_ps(source + i + 4), _mm_loadu_ps(source + i + 8), _mm_loadu_ps(source + i + 12));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), u);
+        }
+        return i;
+    }
+
+    bool CpuHasF16C()
+    {
+#    if defined(_MSC_VER)
+        int info[4] = {};
+        __cpuid(info, 1);
+        bool osxsave = (info[2] & (1 << 27)) != 0;
+        bool avx     = (info[2] & (1 << 28)) != 0;
+        bool f16c    = (info[2] & (1 << 29)) != 0;
+        return osxsave && avx && f16c && (_xgetbv(0) & 0x6) == 0x6;
+#    else
+        return __builtin_cpu_supports("f16c");
+#    endif
+    }
+#endif
+}   // namespace
+
+const VertexLayout& GetVertexLayout(VertexFormat format)
+{
+    return kLayouts[static_cast<size_t>(format) < static_cast<size_t>(VertexFormat::Count) ? static_cast<size_t>(format) : 0];
+}
+
+const char* VertexFormatName(VertexFormat format)
+{
+    switch (format)
+    {
+        case VertexFormat::Float32:
+            return "float32";
+        case VertexFormat::Half:
+            return "half";
+        case VertexFormat::Snorm16:
+            return "snorm16";
+        default:
+            return "unknown";
+    }
+}
+
+bool IsVertexPackPathSupported(VertexPackPath path)
+{
+    switch (path)
+    {
+        case VertexPackPath::Scalar:
+            return true;
+#if VERTEX_PACK_X86
+        case VertexPackPath::SSE:
+            return true;
+        case VertexPackPath::F16C:
+        {
+            static const bool hasF16C = CpuHasF16C();
+            return hasF16C;
+        }
+#endif
+        default:
+            return false;
+    }
+}
+
+VertexPackPath SelectedVertexPackPath()
+{
+    static const VertexPackPath path =
+        IsVertexPackPathSupported(VertexPackPath::F16C) ? VertexPackPath::F16C :
+        IsVertexPackPathSupported(VertexPackPath::SSE)  ? VertexPackPath::SSE :
+                                                          VertexPackPath::Scalar;
+    return path;
+}
+
+const char* VertexPackPathName(VertexPackPath path)
+{
+    switch (path)
+    {
+        case VertexPackPath::Scalar:
+            return "scalar";
+        case VertexPackPath::SSE:
+            return "sse";
+        case VertexPackPath::F16C:
+            return "f16c";
+    }
+    return "unknown";
+}
+
+void PackVertices(VertexFormat format, const float* source, size_t count, void* out)
+{
+    PackVertices(SelectedVertexPackPath(), format, source, count, out);
+}
+
+void PackVertices(VertexPackPath path, VertexFormat format, const float* source, size_t count, void* out)
+{
+    if (format == VertexFormat::Float32)
+    {
+        std::memcpy(out, source, count * kSourceFloats * sizeof(float));
+        return;
+    }
+
+    if (!IsVertexPackPathSupported(path))
+        path = VertexPackPath::Scalar;
+
+    uint8_t* bytes = static_cast<uint8_t*>(out);
+    size_t   done  = 0;
+
+#if VERTEX_PACK_X86
+    if (path == VertexPackPath::F16C && format == VertexFormat::Half)
+        done = PackHalfVerticesF16C(source, count, bytes);
+    else if (path != VertexPackPath::Scalar)
+        done = PackVerticesSSE(format, source, count, bytes);
+#endif
+
+    for (size_t i = done; i < count; ++i)
+        PackVertexScalar(format, source + i * kSourceFloats, bytes + i * 8);
+}
+
+void FloatToHalf(VertexPackPath path, const float* source, size_t count, uint16_t* out)
+{
+    if (!IsVertexPackPathSupported(path))
+        path = VertexPackPath::Scalar;
+
+    size_t done = 0;
+#if VERTEX_PACK_X86
+    if (path == VertexPackPath::F16C)
+        done = FloatToHalfF16C(source, count, out);
+    else if (path == VertexPackPath::SSE)
+        done = FloatToHalfSSE(source, count, out);
+#endif
+
+    for (size_t i = done; i < count; ++i)
+        out[i] = HalfScalar(source[i]);
+}
+
+void FloatToSnorm16(VertexPackPath path, const float* source, size_t count, int16_t* out)
+{
+    if (!IsVertexPackPathSupported(path))
+        path = VertexPackPath::Scalar;
+
+    size_t done = 0;
+#if VERTEX_PACK_X86
+    if (path != VertexPackPath::Scalar)
+        done = FloatToSnorm16SSE(source, count, out);
+#endif
+
+    for (size_t i = done; i < count; ++i)
+        out[i] = Snorm16Scalar(source[i]);
+}
+
+void FloatToUnorm8(VertexPackPath path, const float* source, size_t count, uint8_t* out)
+{
+    if (!IsVertexPackPathSupported(path))
+        path = VertexPackPath::Scalar;
+
+    size_t done = 0;
+#if VERTEX_PACK_X86
+    if (path != VertexPackPath::Scalar)
+        done = FloatToUnorm8SSE(source, count, out);
+#endif
+
+    for (size_t i = done; i < count; ++i)
+        out[i] = Unorm8Scalar(source[i]);
+}
+
+float HalfToFloat(uint16_t half)
+{
+    uint32_t sign     = static_cast<uint32_t>(half & 0x8000) << 16;
+    uint32_t exponent = (half >> 10) & 0x1F;
+    uint32_t mantissa = half & 0x3FF;
+
+    if (exponent == 0x1F)
+        return AsFloat(sign | 0x7F800000u | (mantissa << 13));
+
+    if (exponent == 0)
+    {
+        float magnitude = std::ldexp(static_cast<float>(mantissa), -24);
+        return sign ? -magnitude : magnitude;
+    }
+
+    return AsFloat(sign | ((exponent + 112) << 23) | (mantissa << 13));
+}
+
+float Snorm16ToFloat(int16_t value)
+{
+    return std::max(value / 32767.f, -1.f);
+}
+
+float Unorm8ToFloat(uint8_t value)
+{
+    return value / 255.f;
+}
+
+IndexFormat SelectIndexFormat(size_t vertexCount)
+{
+    return vertexCount <= 0x10000 ? IndexFormat::UInt16 : IndexFormat::UInt32;
+}
+
+size_t IndexFormatSize(IndexFormat format)
+{
+    return format == IndexFormat::UInt16 ? sizeof(uint16_t) : sizeof(uint32_t);
+}
+
+void PackIndices(const uint32_t* indices, size_t count, IndexFormat format, void* out)
+{
+    if (format == IndexFormat::UInt32)
+    {
+        std::memcpy(out, indices, count * sizeof(uint32_t));
+        return;
+    }
+
+    uint16_t* narrow = static_cast<uint16_t*>(out);
+    for (size_t i = 0; i < count; ++i)
+        narrow[i] = static_cast<uint16_t>(indices[i]);
+}
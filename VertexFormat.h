@@ -0,0 +1,86 @@
+#pragma once
+
+#include "RenderContext.h"
+
+#include <cstddef>
+#include <cstdint>
+
+// Vertex layouts the scene can be uploaded in. The source is always the float
+// layout (x, y, r, g, b per vertex); the packed ones trade precision for fetch
+// bandwidth. The shader input stays float2 POSITION / float3 COLOR either way,
+// the input assembler expands packed elements.
+enum class VertexFormat : uint32_t
+{
+    Float32,   // float2 position, float3 color              20 bytes
+    Half,      // half2 position, RGBA8 unorm color           8 bytes
+    Snorm16,   // snorm16x2 position, RGBA8 unorm color       8 bytes
+    Count,
+};
+
+// Snorm16 positions are clamped to [-1, 1]; meshes that extend further need
+// their extent folded into the world matrix before packing.
+
+enum class VertexElementFormat : uint32_t
+{
+    Float2,
+    Float3,
+    Half2,
+    Snorm16x2,
+    Unorm8x4,
+};
+
+struct VertexElement
+{
+    const char*         semantic;
+    uint32_t            semanticIndex;
+    VertexElementFormat format;
+    uint32_t            offset;
+};
+
+// Elements of one vertex stream, in slot 0. D3D11RenderContext turns this into
+// D3D11_INPUT_ELEMENT_DESCs.
+struct VertexLayout
+{
+    static constexpr uint32_t kMaxElements = 2;
+
+    VertexFormat  format;
+    uint32_t      stride;
+    uint32_t      elementCount;
+    VertexElement elements[kMaxElements];
+};
+
+const VertexLayout& GetVertexLayout(VertexFormat format);
+const char*         VertexFormatName(VertexFormat format);
+
+enum class VertexPackPath
+{
+    Scalar,
+    SSE,    // SSE2, halves converted with integer ops
+    F16C,   // SSE2 + hardware float -> half
+};
+
+VertexPackPath SelectedVertexPackPath();
+const char*    VertexPackPathName(VertexPackPath path);
+bool           IsVertexPackPathSupported(VertexPackPath path);
+
+// Packs `count` float vertices into `out` (count * stride bytes). Rounding is
+// to nearest even on every path, so all paths produce identical bytes (NaNs
+// aside: they pack to 0 for snorm/unorm and to some NaN for halves).
+void PackVertices(VertexFormat format, const float* source, size_t count, void* out);
+void PackVertices(VertexPackPath path, VertexFormat format, const float* source, size_t count, void* out);
+
+// Element converters, also used on their own by the mesh tools.
+void FloatToHalf(VertexPackPath path, const float* source, size_t count, uint16_t* out);
+void FloatToSnorm16(VertexPackPath path, const float* source, size_t count, int16_t* out);
+void FloatToUnorm8(VertexPackPath path, const float* source, size_t count, uint8_t* out);
+
+float HalfToFloat(uint16_t half);
+float Snorm16ToFloat(int16_t value);
+float Unorm8ToFloat(uint8_t value);
+
+// UInt16 when every index into `vertexCount` vertices fits, else UInt32.
+IndexFormat SelectIndexFormat(size_t vertexCount);
+size_t      IndexFormatSize(IndexFormat format);
+
+// Narrows or copies `count` indices into `out` at `format` width.
+void PackIndices(const uint32_t* indices, size_t count, IndexFormat format, void* out);